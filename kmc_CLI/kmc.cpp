@@ -50,10 +50,18 @@ void usage()
 		<< "  -sr<value> - number of threads for 2nd stage\n"
 		<< "  -j<file_name> - file name with execution summary in JSON format\n"
 		<< "  -w - without output\n"
-		<< "  -o<kmc/kff> - output in KMC of KFF format; default: KMC\n"
+		<< "  -o<kmc/kff/txt/bin/hist> - output in KMC or KFF format, or instead of a database: text dump (as kmc_tools transform dump),\n"
+		<< "     binary dump (as kmc_tools transform dump -fbin) or histogram of counters written to <output_file_name> (- for standard output);\n"
+		<< "     default: KMC\n"
 		<< "  -hp - hide percentage progress (default: false)\n"
 		<< "  -e - only estimate histogram of k-mers occurrences instead of exact k-mer counting\n"
 		<< "  --opt-out-size - optimize output database size (may increase running time)\n"
+		<< "  --singleton-filter - drop k-mers occurring once already in the 1st stage (requires -ci2 or higher)\n"
+		<< "  --sample<scale> - count only a FracMinHash subsample of k-mers (of ntHash at most 2^64/<scale>), selected already in the 1st stage (not with -e)\n"
+		<< "  --lut-ef - store Elias-Fano encoded LUT in *.kmc_pre (database version 0x201, smaller and faster to load for random access)\n"
+		<< "  --sketch<scale> - store also FracMinHash sketch (hashes at most 2^64/<scale> with counters, as selected by kmc_tools distance -s<scale>)\n"
+		<< "     of counted k-mers in <output_file_name>.sketch\n"
+		<< "  --compress-suf - store compressed *.kmc_suf (database version 0x202, or 0x203 with --lut-ef; smaller, slower to read)\n"
 		<< "Example:\n"
 		<< "kmc -k27 -m24 NA19238.fastq NA.res /data/kmc_tmp_dir/\n"
 		<< "kmc -k27 -m24 @files.lst NA.res /data/kmc_tmp_dir/\n";
@@ -106,6 +114,7 @@ bool parse_parameters(int argc, char* argv[], Params& params)
 
 	bool was_e = false;
 	bool was_opt_out_size = false;
+	bool was_singleton_filter = false;
 	if (argc < 4)
 		return false;
 
@@ -149,9 +158,15 @@ bool parse_parameters(int argc, char* argv[], Params& params)
 				stage2Params.SetOutputFileType(KMC::OutputFileType::KFF);
 			else if (strncmp(argv[i] + 2, "kmc", 3) == 0)
 				stage2Params.SetOutputFileType(KMC::OutputFileType::KMC);
+			else if (strncmp(argv[i] + 2, "txt", 3) == 0)
+				stage2Params.SetOutputFileType(KMC::OutputFileType::DUMP);
+			else if (strncmp(argv[i] + 2, "bin", 3) == 0)
+				stage2Params.SetOutputFileType(KMC::OutputFileType::BINARY_DUMP);
+			else if (strncmp(argv[i] + 2, "hist", 4) == 0)
+				stage2Params.SetOutputFileType(KMC::OutputFileType::HISTOGRAM);
 			else
 			{
-				std::cerr << "Error: unsupported output type: " << argv[i] << " (use -okff or -okmc)\n";
+				std::cerr << "Error: unsupported output type: " << argv[i] << " (use -okff, -okmc, -otxt, -obin or -ohist)\n";
 				exit(1);
 			}
 		}
@@ -170,6 +185,8 @@ bool parse_parameters(int argc, char* argv[], Params& params)
 #ifdef DEVELOP_MODE
 		else if (strncmp(argv[i], "-vl", 3) == 0)
 			stage1Params.SetDevelopVerbose(true);
+		else if (strcmp(argv[i], "--force-big-bins") == 0)
+			stage2Params.SetDevelopForceBigBins(true);
 #endif
 		else if (strncmp(argv[i], "-v", 2) == 0)
 		{
@@ -225,6 +242,35 @@ bool parse_parameters(int argc, char* argv[], Params& params)
 			if (stage1Params.GetEstimateHistogramCfg() != KMC::EstimateHistogramCfg::ONLY_ESTIMATE) //ONLY_ESTIMATE has priority over estimate and count
 				stage1Params.SetEstimateHistogramCfg(KMC::EstimateHistogramCfg::ESTIMATE_AND_COUNT_KMERS);
 		}
+		else if (strcmp(argv[i], "--singleton-filter") == 0)
+		{
+			was_singleton_filter = true;
+			stage1Params.SetSingletonFilter(true);
+		}
+		else if (strcmp(argv[i], "--lut-ef") == 0)
+			stage2Params.SetLutEliasFano(true);
+		else if (strcmp(argv[i], "--compress-suf") == 0)
+			stage2Params.SetCompressSuffixes(true);
+		else if (strncmp(argv[i], "--sample", 8) == 0)
+		{
+			uint64_t scale = strtoull(argv[i] + 8, nullptr, 10);
+			if (!scale)
+			{
+				cerr << "Error: wrong scale of sample: " << argv[i] << "\n";
+				exit(1);
+			}
+			stage1Params.SetSampleScale(scale);
+		}
+		else if (strncmp(argv[i], "--sketch", 8) == 0)
+		{
+			uint64_t scale = strtoull(argv[i] + 8, nullptr, 10);
+			if (!scale)
+			{
+				cerr << "Error: wrong scale of sketch: " << argv[i] << "\n";
+				exit(1);
+			}
+			stage2Params.SetSketchScale(scale);
+		}
 		else if (strncmp(argv[i], "-w", 2) == 0)
 			stage2Params.SetWithoutOutput(true);			
 
@@ -280,9 +326,32 @@ bool parse_parameters(int argc, char* argv[], Params& params)
 		cerr << "Error: -sm can not be used with -r\n";
 		return false;
 	}
+
+	if (was_singleton_filter && stage2Params.GetCutoffMin() < 2)
+	{
+		cerr << "Error: --singleton-filter requires -ci2 or higher\n";
+		return false;
+	}
+
+	if (was_e && stage1Params.GetSampleScale() > 1)
+	{
+		cerr << "Error: -e can not be used with --sample (histogram is estimated from all k-mers)\n";
+		return false;
+	}
 	
 	//Check if output files may be created and if it is possible to create file in specified tmp location
-	if (!stage2Params.GetWithoutOutput())
+	bool stream_output = stage2Params.GetOutputFileType() == KMC::OutputFileType::DUMP ||
+		stage2Params.GetOutputFileType() == KMC::OutputFileType::BINARY_DUMP ||
+		stage2Params.GetOutputFileType() == KMC::OutputFileType::HISTOGRAM;
+	if (stream_output && stage2Params.GetOutputFileName() != "-")
+	{
+		if (!stage2Params.GetWithoutOutput() && !CanCreateFile(stage2Params.GetOutputFileName()))
+		{
+			cerr << "Error: Cannot create file: " << stage2Params.GetOutputFileName() << "\n";
+			return false;
+		}
+	}
+	else if (!stream_output && !stage2Params.GetWithoutOutput())
 	{		
 		string pre_file_name = stage2Params.GetOutputFileName() + ".kmc_pre";
 		string suff_file_name = stage2Params.GetOutputFileName() + ".kmc_suf";
@@ -320,6 +389,27 @@ void save_estimated_histogram(const std::string& fileName, const std::vector<uin
 		out << i << "\t" << estimatedHistogram[i] << "\n";
 }
 
+void save_histogram(const Params& params, const std::vector<uint64_t>& histogram)
+{
+	const KMC::Stage2Params& stage2Params = params.stage2Params;
+	if (stage2Params.GetOutputFileType() != KMC::OutputFileType::HISTOGRAM || stage2Params.GetWithoutOutput())
+		return;
+
+	std::ofstream file;
+	if (stage2Params.GetOutputFileName() != "-")
+	{
+		file.open(stage2Params.GetOutputFileName());
+		if (!file)
+		{
+			std::cerr << "Error: Cannot open file " << stage2Params.GetOutputFileName() << " to store histogram\n";
+			return;
+		}
+	}
+	std::ostream& out = file.is_open() ? file : cout;
+	for (uint64_t i = max<uint64_t>(stage2Params.GetCutoffMin(), 1); i < histogram.size(); ++i)
+		out << i << "\t" << histogram[i] << "\n";
+}
+
 void save_stats_in_json_file(const Params& params, const KMC::Stage1Results& stage1Results,	const KMC::Stage2Results& stage2Results)
 {
 	if (params.cliParams.jsonSummaryFileName == "")
@@ -382,41 +472,42 @@ void save_stats_in_json_file(const Params& params, const KMC::Stage1Results& sta
 void print_summary(
 	const Params& params,	
 	const KMC::Stage1Results& stage1Results,
-	const KMC::Stage2Results& stage2Results)
+	const KMC::Stage2Results& stage2Results,
+	std::ostream& out)
 {
 	const KMC::Stage1Params& stage1Params = params.stage1Params;
 	const KMC::Stage2Params& stage2Params = params.stage2Params;
 
-	cout << "1st stage: " << stage1Results.time << "s\n"
+	out << "1st stage: " << stage1Results.time << "s\n"
 		<< "2nd stage: " << stage2Results.time << "s\n";
 
 	bool display_strict_mem_stats = stage2Params.GetStrictMemoryMode() && !stage1Results.wasSmallKOptUsed;
 	if (display_strict_mem_stats)
 	{
-		cout << "3rd stage: " << stage2Results.timeStrictMem << "s\n";
-		cout << "Total    : " << (stage1Results.time + stage2Results.time + stage2Results.timeStrictMem) << "s\n";
+		out << "3rd stage: " << stage2Results.timeStrictMem << "s\n";
+		out << "Total    : " << (stage1Results.time + stage2Results.time + stage2Results.timeStrictMem) << "s\n";
 	}
 	else
-		cout << "Total    : " << (stage1Results.time + stage2Results.time) << "s\n";
+		out << "Total    : " << (stage1Results.time + stage2Results.time) << "s\n";
 	if (display_strict_mem_stats)
 	{
-		cout << "Tmp size : " << stage1Results.tmpSize / 1000000 << "MB\n"
+		out << "Tmp size : " << stage1Results.tmpSize / 1000000 << "MB\n"
 			<< "Tmp size strict memory : " << stage2Results.tmpSizeStrictMemory / 1000000 << "MB\n"
 			<< "Tmp total: " << stage2Results.maxDiskUsage / 1000000 << "MB\n";
 	}
 	else
-		cout << "Tmp size : " << stage1Results.tmpSize / 1000000 << "MB\n";
-	cout << "\nStats:\n"
+		out << "Tmp size : " << stage1Results.tmpSize / 1000000 << "MB\n";
+	out << "\nStats:\n"
 		<< "   No. of k-mers below min. threshold : " << setw(12) << stage2Results.nBelowCutoffMin << "\n"
 		<< "   No. of k-mers above max. threshold : " << setw(12) << stage2Results.nAboveCutoffMax << "\n"
 		<< "   No. of unique k-mers               : " << setw(12) << stage2Results.nUniqueKmers << "\n"
 		<< "   No. of unique counted k-mers       : " << setw(12) << stage2Results.nUniqueKmers - stage2Results.nBelowCutoffMin - stage2Results.nAboveCutoffMax << "\n"
 		<< "   Total no. of k-mers                : " << setw(12) << stage2Results.nTotalKmers << "\n";
 	if (stage1Params.GetInputFileType() != KMC::InputFileType::MULTILINE_FASTA)
-		cout << "   Total no. of reads                 : " << setw(12) << stage1Results.nSeqences << "\n";
+		out << "   Total no. of reads                 : " << setw(12) << stage1Results.nSeqences << "\n";
 	else
-		cout << "   Total no. of sequences             : " << setw(12) << stage1Results.nSeqences << "\n";
-	cout << "   Total no. of super-k-mers          : " << setw(12) << stage1Results.nTotalSuperKmers << "\n";
+		out << "   Total no. of sequences             : " << setw(12) << stage1Results.nSeqences << "\n";
+	out << "   Total no. of super-k-mers          : " << setw(12) << stage1Results.nTotalSuperKmers << "\n";
 }
 
 //----------------------------------------------------------------------------------
@@ -441,7 +532,11 @@ int main(int argc, char** argv)
 		auto stage1Results = runner.RunStage1(params.stage1Params);
 		save_estimated_histogram(params.cliParams.estimatedHistogramFileName, stage1Results.estimatedHistogram);
 		auto stage2Results = runner.RunStage2(params.stage2Params);
-		print_summary(params, stage1Results, stage2Results);
+		save_histogram(params, stage2Results.histogram);
+		//k-mers or histogram may be written to the standard output
+		bool stdout_used = params.stage2Params.GetOutputFileName() == "-" && params.stage2Params.GetOutputFileType() != KMC::OutputFileType::KMC &&
+			params.stage2Params.GetOutputFileType() != KMC::OutputFileType::KFF;
+		print_summary(params, stage1Results, stage2Results, stdout_used ? cerr : cout);
 		save_stats_in_json_file(params, stage1Results, stage2Results);
 	}
 	catch (const std::exception& err)
@@ -0,0 +1,666 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _COMPRESSED_SUFFIXES_H
+#define _COMPRESSED_SUFFIXES_H
+
+#include "kmer_defs.h"
+#include "elias_fano.h"
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//************************************************************************************************************
+// CCompressedSuffixes - compressed *.kmc_suf of KMC databases in versions 0x202 and 0x203 (the latter with
+// Elias-Fano encoded LUT). Records are split into blocks of BLOCK_SIZE consecutive records.
+//
+// The key of a record is its prefix followed by its sufix, so keys increase inside each bin. The head of a key,
+// i.e. the prefix and the first head_bytes bytes of the sufix (at most 64 bits), is delta coded with a Rice code
+// of a parameter chosen for each block, the remaining tail bytes of the sufix are stored as they are.
+// Counters are stored on a width chosen for each block, the largest value of this width is an escape and
+// such counters are stored on counter_size bytes in the escape table of a block.
+//
+// Block (a bit stream, the least significant bits of words first):
+//   Rice parameter (6 bits), counter width (6 bits), no. of escapes (7 bits), no. of resets (7 bits),
+//   positions of resets (6 bits each), the head of the first record, counters, escapes, tails,
+//   heads of the other records: absolute for resets (the first records of bins or large gaps), Rice coded deltas otherwise
+// File: "KMCS", blocks (uint64 words), Elias-Fano encoded bit positions of blocks (no. of blocks + 1 values,
+// the last one is the end of the last block), no. of words of blocks (uint64), BLOCK_SIZE (uint64), "KMCS"
+//
+// Bit positions of blocks are skip pointers: a sufix is searched with a binary search over the first records
+// of blocks of its LUT range, and then in a single block
+//************************************************************************************************************
+class CCompressedSuffixes
+{
+public:
+	static const uint32 BLOCK_SIZE = 64;
+	static const uint32 FOOTER_SIZE = 2 * sizeof(uint64);
+
+protected:
+	static const uint32 RICE_BITS = 6;
+	static const uint32 WIDTH_BITS = 6;
+	static const uint32 N_ESCAPES_BITS = 7;
+	static const uint32 N_RESETS_BITS = 7;
+	static const uint32 RESET_POS_BITS = 6;
+	static const uint32 BLOCK_HEADER_BITS = RICE_BITS + WIDTH_BITS + N_ESCAPES_BITS + N_RESETS_BITS;
+
+	uint32 sufix_size = 0;
+	uint32 counter_size = 0;
+	uint32 rec_size = 0;
+	uint32 head_bytes = 0;			// bytes of a sufix in the head of a key
+	uint32 head_bits = 0;
+	uint32 tail_bytes = 0;
+	uint64 n_recs = 0;
+	uint64 n_words = 0;				// words of blocks
+
+	const uchar* data = nullptr;	// blocks, for decoding from memory
+	CEliasFano block_pos;			// bit positions of blocks
+
+	// A block being decoded
+	struct block_t
+	{
+		uint32 n;					// no. of records
+		uint32 rice;
+		uint32 width;
+		uint64 resets;				// bit i is set if a head of the record i is stored as it is
+		uint64 counters_pos, escapes_pos, tails_pos, heads_pos;	// bit positions of parts
+		uint64 head;				// head of the current record
+		uint32 i;					// the current record
+	};
+
+	static uint64 low_mask(uint32 bits)
+	{
+		return bits >= 64 ? ~0ull : (1ull << bits) - 1;
+	}
+
+	static uint64 ctz(uint64 x)
+	{
+#ifdef _MSC_VER
+		unsigned long pos;
+		_BitScanForward64(&pos, x);
+		return pos;
+#else
+		return __builtin_ctzll(x);
+#endif
+	}
+
+	static uint64 load_word(const uchar* p, uint64 word)
+	{
+		uint64 x;
+		memcpy(&x, p + word * sizeof(uint64), sizeof(uint64));
+		return x;
+	}
+
+	// n (<= 64) bits starting at the bit pos
+	static uint64 get_bits(const uchar* p, uint64 pos, uint32 n)
+	{
+		if (!n)
+			return 0;
+		uint64 word = pos >> 6;
+		uint32 shift = pos & 63;
+		uint64 x = load_word(p, word) >> shift;
+		if (shift + n > 64)
+			x |= load_word(p, word + 1) << (64 - shift);
+		return x & low_mask(n);
+	}
+
+	// Rice coded value (unary coded quotient and r low bits), pos is moved after it
+	static uint64 get_rice(const uchar* p, uint64& pos, uint32 r)
+	{
+		uint64 q = 0;
+		while (true)
+		{
+			uint64 x = load_word(p, pos >> 6) >> (pos & 63);
+			if (x)
+			{
+				uint64 zeros = ctz(x);
+				q += zeros;
+				pos += zeros + 1;
+				break;
+			}
+			uint64 skipped = 64 - (pos & 63);
+			q += skipped;
+			pos += skipped;
+		}
+		uint64 low = get_bits(p, pos, r);
+		pos += r;
+		return (q << r) | low;
+	}
+
+	uint32 block_size(uint64 block_id) const
+	{
+		return (uint32)std::min<uint64>((uint64)BLOCK_SIZE, n_recs - block_id * BLOCK_SIZE);
+	}
+
+	void open_block(const uchar* p, uint64 pos, uint32 n, block_t& b) const
+	{
+		b.n = n;
+		b.rice = (uint32)get_bits(p, pos, RICE_BITS);
+		pos += RICE_BITS;
+		b.width = (uint32)get_bits(p, pos, WIDTH_BITS);
+		pos += WIDTH_BITS;
+		uint64 n_escapes = get_bits(p, pos, N_ESCAPES_BITS);
+		pos += N_ESCAPES_BITS;
+		uint32 n_resets = (uint32)get_bits(p, pos, N_RESETS_BITS);
+		pos += N_RESETS_BITS;
+		b.resets = 0;
+		for (uint32 j = 0; j < n_resets; ++j, pos += RESET_POS_BITS)
+			b.resets |= 1ull << get_bits(p, pos, RESET_POS_BITS);
+		b.head = get_bits(p, pos, head_bits);
+		pos += head_bits;
+		b.counters_pos = pos;
+		pos += (uint64)n * b.width;
+		b.escapes_pos = pos;
+		pos += n_escapes * 8 * counter_size;
+		b.tails_pos = pos;
+		pos += (uint64)n * 8 * tail_bytes;
+		b.heads_pos = pos;
+		b.i = 0;
+	}
+
+	void next_record(const uchar* p, block_t& b) const
+	{
+		++b.i;
+		if ((b.resets >> b.i) & 1)
+		{
+			b.head = get_bits(p, b.heads_pos, head_bits);
+			b.heads_pos += head_bits;
+		}
+		else
+			b.head += get_rice(p, b.heads_pos, b.rice);
+	}
+
+	bool is_escape(uint64 counter, uint32 width) const
+	{
+		return width < 8 * counter_size && counter == low_mask(width);
+	}
+
+	// Counter of the record i of a block
+	uint64 block_counter(const uchar* p, const block_t& b, uint32 i) const
+	{
+		uint64 counter = get_bits(p, b.counters_pos + (uint64)i * b.width, b.width);
+		if (!is_escape(counter, b.width))
+			return counter;
+		uint64 n_escapes = 0;
+		for (uint32 j = 0; j < i; ++j)
+			n_escapes += is_escape(get_bits(p, b.counters_pos + (uint64)j * b.width, b.width), b.width);
+		return get_bits(p, b.escapes_pos + n_escapes * 8 * counter_size, 8 * counter_size);
+	}
+
+	// Compare the tail of the record i of a block with tail bytes of a sufix
+	int compare_tail(const uchar* p, const block_t& b, uint32 i, const uchar* tail) const
+	{
+		uint64 pos = b.tails_pos + (uint64)i * 8 * tail_bytes;
+		for (uint32 a = 0; a < tail_bytes; ++a, pos += 8)
+		{
+			uint64 x = get_bits(p, pos, 8);
+			if (x != tail[a])
+				return x < tail[a] ? -1 : 1;
+		}
+		return 0;
+	}
+
+	// Decode n records of a block starting at the bit pos to out (in the form of records of *.kmc_suf in version 0x200)
+	void decode_block(const uchar* p, uint64 pos, uint32 n, uchar* out) const
+	{
+		block_t b;
+		open_block(p, pos, n, b);
+		uint64 escape_pos = b.escapes_pos;
+		uint64 tail_pos = b.tails_pos;
+		for (uint32 i = 0; i < n; ++i, out += rec_size)
+		{
+			if (i)
+				next_record(p, b);
+			for (uint32 a = 0; a < head_bytes; ++a)
+				out[a] = (uchar)(b.head >> (8 * (head_bytes - 1 - a)));
+			for (uint32 a = 0; a < tail_bytes; ++a, tail_pos += 8)
+				out[head_bytes + a] = (uchar)get_bits(p, tail_pos, 8);
+			uint64 counter = get_bits(p, b.counters_pos + (uint64)i * b.width, b.width);
+			if (is_escape(counter, b.width))
+			{
+				counter = get_bits(p, escape_pos, 8 * counter_size);
+				escape_pos += 8 * counter_size;
+			}
+			for (uint32 a = 0; a < counter_size; ++a)
+				out[sufix_size + a] = (uchar)(counter >> (8 * a));
+		}
+	}
+
+	void set_params(uint32 kmer_length, uint32 lut_prefix_length, uint32 _counter_size, uint64 _n_recs)
+	{
+		sufix_size = (kmer_length - lut_prefix_length) / 4;
+		counter_size = _counter_size;
+		rec_size = sufix_size + counter_size;
+		head_bytes = std::min(sufix_size, (64 - 2 * lut_prefix_length) / 8);
+		head_bits = 2 * lut_prefix_length + 8 * head_bytes;
+		tail_bytes = sufix_size - head_bytes;
+		n_recs = _n_recs;
+	}
+
+public:
+	uint64 NoOfBlocks() const noexcept { return (n_recs + BLOCK_SIZE - 1) / BLOCK_SIZE; }
+
+	// Load skip pointers of a compressed *.kmc_suf, blocks are accessed later in memory (SetData) or by CCompressedSuffixReader
+	bool Load(FILE* file, uint32 kmer_length, uint32 lut_prefix_length, uint32 _counter_size, uint64 _n_recs)
+	{
+		set_params(kmer_length, lut_prefix_length, _counter_size, _n_recs);
+
+		uint64 footer[2];
+		if (my_fseek(file, -(int64)(FOOTER_SIZE + 4), SEEK_END) != 0 || fread(footer, sizeof(uint64), 2, file) != 2)
+			return false;
+		n_words = footer[0];
+		if (footer[1] != BLOCK_SIZE)
+			return false;
+		my_fseek(file, 4 + n_words * sizeof(uint64), SEEK_SET);
+		return block_pos.Load(file) && block_pos.Size() == NoOfBlocks() + 1 && block_pos.Get(NoOfBlocks()) <= n_words * 64;
+	}
+
+	// Set blocks in memory (just after the initial marker of *.kmc_suf)
+	void SetData(const uchar* _data)
+	{
+		data = _data;
+	}
+
+	// Decode a block (of data set with SetData) to out, BLOCK_SIZE records of *.kmc_suf in version 0x200 at most
+	void DecodeBlock(uint64 block_id, uchar* out) const
+	{
+		decode_block(data, block_pos.Get(block_id), block_size(block_id), out);
+	}
+
+	// Find a sufix among records first, ..., last (of data set with SetData), which have the same prefix, so their keys increase
+	// IN	: first, last	- the range of records
+	//		  sufix			- sufix_size bytes of the sufix
+	// OUT	: counter		- counter of the record if found
+	// RET	: true if found
+	bool Find(uint64 first, uint64 last, const uchar* sufix, uint64& counter) const
+	{
+		if (first > last || last >= n_recs)
+			return false;
+
+		// records in the range have the same prefix, so only parts of heads from sufixes are compared
+		uint64 key = 0;
+		for (uint32 a = 0; a < head_bytes; ++a)
+			key = (key << 8) | sufix[a];
+		const uint64 mask = low_mask(8 * head_bytes);
+
+		// the first records of blocks after the one of the first record are in the range, the search starts
+		// from the last block which first key is lower than the searched one
+		uint64 first_block = first / BLOCK_SIZE;
+		uint64 lo = first_block + 1, hi = last / BLOCK_SIZE + 1;
+		while (lo < hi)
+		{
+			uint64 mid = (lo + hi) / 2;
+			uint64 pos = block_pos.Get(mid);
+			uint64 n_resets = get_bits(data, pos + RICE_BITS + WIDTH_BITS + N_ESCAPES_BITS, N_RESETS_BITS);
+			uint64 head = get_bits(data, pos + BLOCK_HEADER_BITS + n_resets * RESET_POS_BITS, head_bits);
+			if ((head & mask) < key)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		uint64 block_id = lo - 1;
+		block_t b;
+		open_block(data, block_pos.Get(block_id), block_size(block_id), b);
+		uint64 rec = block_id * BLOCK_SIZE;
+		for (; rec < first; ++rec)
+			next_record(data, b);
+
+		while (true)
+		{
+			uint64 head = b.head & mask;
+			if (head > key)
+				return false;
+			if (head == key)
+			{
+				int cmp = compare_tail(data, b, b.i, sufix + head_bytes);
+				if (cmp == 0)
+				{
+					counter = counter_size ? block_counter(data, b, b.i) : 1;
+					return true;
+				}
+				if (cmp > 0)
+					return false;
+			}
+			if (++rec > last)
+				return false;
+			if (b.i + 1 == b.n)
+			{
+				++block_id;
+				open_block(data, block_pos.Get(block_id), block_size(block_id), b);
+			}
+			else
+				next_record(data, b);
+		}
+	}
+
+	void Clear()
+	{
+		data = nullptr;
+		n_recs = n_words = 0;
+		block_pos.Clear();
+	}
+};
+
+//************************************************************************************************************
+// CCompressedSuffixReader - sequential reading of a compressed *.kmc_suf from a file. Records are decoded
+// to the form of *.kmc_suf in version 0x200, so Read may replace fread of records from uncompressed *.kmc_suf
+//************************************************************************************************************
+class CCompressedSuffixReader : public CCompressedSuffixes
+{
+	static const uint64 CHUNK_WORDS = 1 << 17;
+
+	FILE* file = nullptr;
+	std::vector<uint64> chunk;		// words chunk_start, chunk_start + 1, ... of blocks
+	uint64 chunk_start = 0;
+	std::vector<uchar> recs;		// decoded records of the current block
+	uint64 recs_size = 0;
+	uint64 recs_pos = 0;
+	uint64 next_block = 0;
+
+	bool load_block(uint64 block_id)
+	{
+		uint64 start, end;
+		block_pos.GetPair(block_id, start, end);
+		uint64 first_word = start >> 6, last_word = (end - 1) >> 6;
+		if (first_word < chunk_start || last_word >= chunk_start + chunk.size())
+		{
+			uint64 to_read = std::min(std::max((uint64)CHUNK_WORDS, last_word - first_word + 1), n_words - first_word);
+			chunk.resize(to_read);
+			chunk_start = first_word;
+			my_fseek(file, 4 + first_word * sizeof(uint64), SEEK_SET);
+			if (fread(chunk.data(), sizeof(uint64), to_read, file) != to_read)
+				return false;
+		}
+		uint32 n = block_size(block_id);
+		decode_block((const uchar*)chunk.data(), start - chunk_start * 64, n, recs.data());
+		recs_size = (uint64)n * rec_size;
+		recs_pos = 0;
+		next_block = block_id + 1;
+		return true;
+	}
+
+public:
+	// Open a compressed *.kmc_suf, the file is used only by the reader then
+	bool Open(FILE* _file, uint32 kmer_length, uint32 lut_prefix_length, uint32 _counter_size, uint64 _n_recs)
+	{
+		file = _file;
+		if (!Load(file, kmer_length, lut_prefix_length, _counter_size, _n_recs))
+			return false;
+		recs.resize((uint64)BLOCK_SIZE * rec_size);
+		chunk.clear();
+		chunk_start = 0;
+		Seek(0);
+		return true;
+	}
+
+	// Set the position of reading to the record rec
+	bool Seek(uint64 rec)
+	{
+		recs_size = recs_pos = 0;
+		if (rec >= n_recs)
+		{
+			next_block = NoOfBlocks();
+			return true;
+		}
+		if (!load_block(rec / BLOCK_SIZE))
+			return false;
+		recs_pos = rec % BLOCK_SIZE * rec_size;
+		return true;
+	}
+
+	// Read size bytes of records (as from *.kmc_suf in version 0x200)
+	// RET	: the number of bytes read
+	uint64 Read(uchar* out, uint64 size)
+	{
+		uint64 readed = 0;
+		while (readed < size)
+		{
+			if (recs_pos == recs_size)
+			{
+				if (next_block >= NoOfBlocks() || !load_block(next_block))
+					break;
+			}
+			uint64 to_copy = std::min(size - readed, recs_size - recs_pos);
+			memcpy(out + readed, recs.data() + recs_pos, to_copy);
+			recs_pos += to_copy;
+			readed += to_copy;
+		}
+		return readed;
+	}
+};
+
+//************************************************************************************************************
+// CCompressedSuffixWriter - writing of a compressed *.kmc_suf. Records must be added in the order of the database
+// with their prefixes, then Finish must be called. Markers of the file are written by the caller
+//************************************************************************************************************
+class CCompressedSuffixWriter : public CCompressedSuffixes
+{
+	static const uint64 FLUSH_WORDS = 1 << 16;
+
+	FILE* file = nullptr;
+	std::vector<uint64> words;		// not written words of the bit stream
+	uint64 bit_pos = 0;				// the end of the bit stream
+	uint64 flushed_words = 0;
+	std::vector<uint64> block_starts;
+
+	uint64 heads[BLOCK_SIZE];
+	uint64 counters[BLOCK_SIZE];
+	std::vector<uchar> tails;
+	uint32 n_in_block = 0;
+
+	void put(uint64 x, uint32 n)
+	{
+		if (!n)
+			return;
+		uint32 shift = bit_pos & 63;
+		if (shift == 0)
+			words.push_back(x);
+		else
+		{
+			words.back() |= x << shift;
+			if (shift + n > 64)
+				words.push_back(x >> (64 - shift));
+		}
+		bit_pos += n;
+	}
+
+	void put_rice(uint64 x, uint32 r)
+	{
+		for (uint64 q = x >> r; q; )
+		{
+			uint32 zeros = (uint32)std::min<uint64>(q, 64);
+			put(0, zeros);
+			q -= zeros;
+		}
+		put(1, 1);
+		put(x & low_mask(r), r);
+	}
+
+	bool flush(bool all)
+	{
+		uint64 n_full = bit_pos / 64 - flushed_words;
+		uint64 to_write = all ? words.size() : n_full;
+		if (fwrite(words.data(), sizeof(uint64), to_write, file) != to_write)
+			return false;
+		words.erase(words.begin(), words.begin() + to_write);
+		flushed_words += to_write;
+		return true;
+	}
+
+	static uint32 bit_len(uint64 x)
+	{
+		uint32 len = 0;
+		for (; x; x >>= 1)
+			++len;
+		return len;
+	}
+
+	bool encode_block()
+	{
+		const uint32 n = n_in_block;
+		block_starts.push_back(bit_pos);
+
+		// a head is stored as it is if it is lower than the previous one (a new bin) or if it is cheaper than its Rice code
+		const uint64 reset_cost = head_bits + RESET_POS_BITS;
+		auto rice_len = [&](uint64 delta, uint32 r) {
+			return (delta >> r) >= reset_cost ? reset_cost + 1 : (delta >> r) + 1 + r;
+		};
+		uint64 deltas[BLOCK_SIZE];
+		uint64 sum = 0, n_deltas = 0;
+		for (uint32 i = 1; i < n; ++i)
+		{
+			deltas[i] = heads[i] - heads[i - 1];
+			if (heads[i] >= heads[i - 1] && deltas[i] < (1ull << 56))
+			{
+				sum += deltas[i];
+				++n_deltas;
+			}
+		}
+		uint32 rice = 0;
+		if (n_deltas && sum / n_deltas)
+			rice = bit_len(sum / n_deltas) - 1;
+		auto rice_cost = [&](uint32 r) {
+			uint64 cost = 0;
+			for (uint32 i = 1; i < n; ++i)
+				cost += heads[i] < heads[i - 1] ? reset_cost : std::min(reset_cost, rice_len(deltas[i], r));
+			return cost;
+		};
+		uint64 best_cost = rice_cost(rice);
+		for (uint32 r = rice > 2 ? rice - 2 : 0; r <= rice + 2 && r < 64; ++r)
+		{
+			uint64 cost = rice_cost(r);
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				rice = r;
+			}
+		}
+		uint64 resets = 0;
+		uint32 n_resets = 0;
+		for (uint32 i = 1; i < n; ++i)
+			if (heads[i] < heads[i - 1] || rice_len(deltas[i], rice) > reset_cost)
+			{
+				resets |= 1ull << i;
+				++n_resets;
+			}
+
+		// counter width for which counters (and escapes) take the least space
+		const uint32 full_width = 8 * counter_size;
+		uint32 width = full_width;
+		uint64 n_escapes = 0;
+		if (counter_size)
+		{
+			uint64 hist[65] = {};
+			for (uint32 i = 0; i < n; ++i)
+				++hist[bit_len(counters[i] + 1)];		// counter is stored directly if counter + 1 < 2^width
+			uint64 best = (uint64)n * full_width;
+			uint64 direct = 0;
+			for (uint32 w = 0; w < full_width; ++w)
+			{
+				direct += hist[w];
+				uint64 cost = (uint64)n * w + (n - direct) * full_width;
+				if (cost < best)
+				{
+					best = cost;
+					width = w;
+					n_escapes = n - direct;
+				}
+			}
+		}
+
+		put(rice, RICE_BITS);
+		put(width, WIDTH_BITS);
+		put(n_escapes, N_ESCAPES_BITS);
+		put(n_resets, N_RESETS_BITS);
+		for (uint32 i = 1; i < n; ++i)
+			if ((resets >> i) & 1)
+				put(i, RESET_POS_BITS);
+		put(heads[0], head_bits);
+		for (uint32 i = 0; i < n; ++i)
+			put(width < full_width ? std::min(counters[i], low_mask(width)) : counters[i], width);
+		if (width < full_width)
+			for (uint32 i = 0; i < n; ++i)
+				if (counters[i] >= low_mask(width))
+					put(counters[i], full_width);
+		for (uint64 i = 0; i < (uint64)n * tail_bytes; ++i)
+			put(tails[i], 8);
+		for (uint32 i = 1; i < n; ++i)
+		{
+			if ((resets >> i) & 1)
+				put(heads[i], head_bits);
+			else
+				put_rice(deltas[i], rice);
+		}
+
+		n_in_block = 0;
+		return words.size() < FLUSH_WORDS || flush(false);
+	}
+
+public:
+	// Start writing to a file, just after the initial marker
+	void Init(FILE* _file, uint32 kmer_length, uint32 lut_prefix_length, uint32 _counter_size)
+	{
+		file = _file;
+		set_params(kmer_length, lut_prefix_length, _counter_size, 0);
+		words.clear();
+		bit_pos = flushed_words = 0;
+		block_starts.clear();
+		tails.resize((uint64)BLOCK_SIZE * tail_bytes);
+		n_in_block = 0;
+	}
+
+	// Add the next record (in the form of *.kmc_suf in version 0x200) of a given prefix
+	bool Add(uint64 prefix, const uchar* record)
+	{
+		uint64 head = prefix;
+		for (uint32 a = 0; a < head_bytes; ++a)
+			head = (head << 8) | record[a];
+		heads[n_in_block] = head;
+		if (tail_bytes)
+			memcpy(tails.data() + (uint64)n_in_block * tail_bytes, record + head_bytes, tail_bytes);
+		uint64 counter = 0;
+		for (uint32 a = 0; a < counter_size; ++a)
+			counter |= (uint64)record[sufix_size + a] << (8 * a);
+		counters[n_in_block] = counter;
+		++n_recs;
+		if (++n_in_block == BLOCK_SIZE)
+			return encode_block();
+		return true;
+	}
+
+	// Write the last block, skip pointers and the footer
+	bool Finish()
+	{
+		if (n_in_block && !encode_block())
+			return false;
+		uint64 end = bit_pos;
+		if (!flush(true))
+			return false;
+
+		CEliasFano ef;
+		ef.Init(block_starts.size() + 1, end);
+		for (auto x : block_starts)
+			ef.Add(x);
+		ef.Add(end);
+		uint64 footer[2] = { flushed_words, BLOCK_SIZE };
+		return ef.Store(file) && fwrite(footer, sizeof(uint64), 2, file) == 2;
+	}
+
+	uint64 NoOfRecords() const noexcept { return n_recs; }
+};
+
+#endif
+
+// ***** EOF
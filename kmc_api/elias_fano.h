@@ -0,0 +1,257 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _ELIAS_FANO_H
+#define _ELIAS_FANO_H
+
+#include "kmer_defs.h"
+#include <vector>
+#include <cstdio>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//************************************************************************************************************
+// CEliasFano - Elias-Fano representation of a non-decreasing sequence of integers with fast access,
+// used for LUTs of KMC databases in version 0x201 (instead of an uint64 per prefix of each bin).
+// Each value is split into l lower bits, stored explicitly, and upper bits, stored in unary as a bit vector,
+// in which the i-th set bit is at position (x_i >> l) + i. Positions of every SAMPLE_RATE-th set bit are
+// sampled, so a value is accessed with at most a few popcounts.
+// Serialized form (uint64 each): n, l, no. of words of lower bits, no. of words of upper bits, no. of samples,
+// followed by the three arrays
+//************************************************************************************************************
+class CEliasFano
+{
+public:
+	static const uint64 SAMPLE_RATE = 64;
+
+private:
+	uint64 n = 0;
+	uint64 l = 0;
+	std::vector<uint64> lower;
+	std::vector<uint64> upper;
+	std::vector<uint64> samples;		// positions in upper of set bits no. 0, SAMPLE_RATE, 2 * SAMPLE_RATE, ...
+
+	uint64 n_added = 0;					// for building
+
+	static const uint64 ONES_STEP_8 = 0x0101010101010101ull;
+	static const uint64 MSBS_STEP_8 = 0x8080808080808080ull;
+
+	// Positions of the r-th set bit of bytes, at [byte | r << 8]
+	struct CSelectInByte
+	{
+		uchar pos[8 * 256];
+		constexpr CSelectInByte() : pos{}
+		{
+			for (uint32 byte = 0; byte < 256; ++byte)
+			{
+				uint32 r = 0;
+				for (uint32 bit = 0; bit < 8; ++bit)
+					if ((byte >> bit) & 1)
+						pos[byte | (r++ << 8)] = (uchar)bit;
+			}
+		}
+	};
+
+	// Cumulative popcounts of bytes (byte j holds the number of set bits in bytes 0, ..., j)
+	static uint64 byte_sums(uint64 x)
+	{
+		x = x - ((x >> 1) & 0x5555555555555555ull);
+		x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+		x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+		return x * ONES_STEP_8;
+	}
+
+	static uint64 popcount(uint64 x)
+	{
+		return byte_sums(x) >> 56;
+	}
+
+	static uint64 ctz(uint64 x)
+	{
+#ifdef _MSC_VER
+		unsigned long pos;
+		_BitScanForward64(&pos, x);
+		return pos;
+#else
+		return __builtin_ctzll(x);
+#endif
+	}
+
+	// Position of the rank-th set bit of x (broadword, x must have more than rank set bits)
+	static uint64 select_in_word(uint64 x, uint64 rank)
+	{
+		uint64 sums = byte_sums(x);
+		uint64 rank_step_8 = rank * ONES_STEP_8;
+		// bytes j for which sums[j] <= rank
+		uint64 leq = ((((rank_step_8 | MSBS_STEP_8) - (sums & ~MSBS_STEP_8)) ^ sums ^ rank_step_8) & MSBS_STEP_8) >> 7;
+		uint64 place = ((leq * ONES_STEP_8) >> 53) & ~7ull;
+		uint64 byte_rank = rank - (((sums << 8) >> place) & 0xFF);
+		static constexpr CSelectInByte select_in_byte{};
+		return place + select_in_byte.pos[((x >> place) & 0xFF) | (byte_rank << 8)];
+	}
+
+	uint64 lower_bits(uint64 i) const
+	{
+		if (l == 0)
+			return 0;
+		uint64 bit_pos = i * l;
+		uint64 word = bit_pos >> 6;
+		uint64 shift = bit_pos & 63;
+		uint64 x = lower[word] >> shift;
+		if (shift + l > 64)
+			x |= lower[word + 1] << (64 - shift);
+		return x & ((1ull << l) - 1);
+	}
+
+	// Position of the i-th set bit of upper
+	uint64 select(uint64 i) const
+	{
+		uint64 pos = samples[i / SAMPLE_RATE];
+		uint64 rank = i % SAMPLE_RATE;
+		uint64 word = pos >> 6;
+		uint64 bits = upper[word] & (~0ull << (pos & 63));
+		while (true)
+		{
+			uint64 cnt = popcount(bits);
+			if (rank < cnt)
+				break;
+			rank -= cnt;
+			bits = upper[++word];
+		}
+		return (word << 6) + select_in_word(bits, rank);
+	}
+
+	// Position of the next set bit of upper after pos
+	uint64 next_one(uint64 pos) const
+	{
+		uint64 word = pos >> 6;
+		uint64 bits = upper[word] & ~((2ull << (pos & 63)) - 1);
+		while (!bits)
+			bits = upper[++word];
+		return (word << 6) + ctz(bits);
+	}
+
+public:
+	// Start building a sequence of _n values not greater than max_value, values must be added with Add
+	void Init(uint64 _n, uint64 max_value)
+	{
+		n = _n;
+		l = 0;
+		while (n && (max_value / n) >> (l + 1))
+			++l;
+		lower.assign((n * l + 63) / 64 + 1, 0);		// + 1 so lower_bits may read a next word
+		upper.assign((n + (max_value >> l) + 1 + 63) / 64 + 1, 0);
+		samples.clear();
+		samples.reserve(n / SAMPLE_RATE + 1);
+		n_added = 0;
+	}
+
+	// Add the next value, it must not be lower than the previous one
+	void Add(uint64 x)
+	{
+		if (l)
+		{
+			uint64 bit_pos = n_added * l;
+			uint64 word = bit_pos >> 6;
+			uint64 shift = bit_pos & 63;
+			uint64 low = x & ((1ull << l) - 1);
+			lower[word] |= low << shift;
+			if (shift + l > 64)
+				lower[word + 1] |= low >> (64 - shift);
+		}
+		uint64 pos = (x >> l) + n_added;
+		upper[pos >> 6] |= 1ull << (pos & 63);
+		if (n_added % SAMPLE_RATE == 0)
+			samples.push_back(pos);
+		++n_added;
+	}
+
+	uint64 Size() const noexcept { return n; }
+
+	// The size of the representation in bytes
+	uint64 SizeInBytes() const noexcept
+	{
+		return 5 * sizeof(uint64) + (lower.size() + upper.size() + samples.size()) * sizeof(uint64);
+	}
+
+	// Value of the i-th element (i < n)
+	uint64 Get(uint64 i) const
+	{
+		return ((select(i) - i) << l) | lower_bits(i);
+	}
+
+	// Values of the i-th and the (i + 1)-th elements (i + 1 < n)
+	void GetPair(uint64 i, uint64& first, uint64& second) const
+	{
+		uint64 pos = select(i);
+		first = ((pos - i) << l) | lower_bits(i);
+		second = ((next_one(pos) - i - 1) << l) | lower_bits(i + 1);
+	}
+
+	// Decode count consecutive values starting from the first-th element
+	void Decode(uint64 first, uint64 count, uint64* out) const
+	{
+		if (!count)
+			return;
+		uint64 pos = select(first);
+		for (uint64 i = first; ; )
+		{
+			*out++ = ((pos - i) << l) | lower_bits(i);
+			if (--count == 0)
+				break;
+			pos = next_one(pos);
+			++i;
+		}
+	}
+
+	bool Store(FILE* file) const
+	{
+		uint64 desc[5] = { n, l, (uint64)lower.size(), (uint64)upper.size(), (uint64)samples.size() };
+		return fwrite(desc, sizeof(uint64), 5, file) == 5 &&
+			fwrite(lower.data(), sizeof(uint64), lower.size(), file) == lower.size() &&
+			fwrite(upper.data(), sizeof(uint64), upper.size(), file) == upper.size() &&
+			fwrite(samples.data(), sizeof(uint64), samples.size(), file) == samples.size();
+	}
+
+	// Load from the current position of a file
+	bool Load(FILE* file)
+	{
+		uint64 desc[5];
+		if (fread(desc, sizeof(uint64), 5, file) != 5)
+			return false;
+		n = desc[0];
+		l = desc[1];
+		if (l >= 64 || desc[4] != (n + SAMPLE_RATE - 1) / SAMPLE_RATE)
+			return false;
+		lower.resize(desc[2]);
+		upper.resize(desc[3]);
+		samples.resize(desc[4]);
+		n_added = n;
+		return fread(lower.data(), sizeof(uint64), lower.size(), file) == lower.size() &&
+			fread(upper.data(), sizeof(uint64), upper.size(), file) == upper.size() &&
+			fread(samples.data(), sizeof(uint64), samples.size(), file) == samples.size();
+	}
+
+	void Clear()
+	{
+		n = l = n_added = 0;
+		lower.clear();
+		lower.shrink_to_fit();
+		upper.clear();
+		upper.shrink_to_fit();
+		samples.clear();
+		samples.shrink_to_fit();
+	}
+};
+
+#endif
+
+// ***** EOF
@@ -11,10 +11,33 @@
 #include "mmer.h"
 #include "kmc_file.h"
 #include <tuple>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <xmmintrin.h>
+#define KMC_API_PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#define KMC_API_PREFETCH(p) __builtin_prefetch(p)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 uint64 CKMCFile::part_size = 1 << 25;
 
+// Secondary index file (*.kmc_idx): marker "KMCI", version, sample step, no. of key bytes (4 bytes each),
+// total no. of k-mers, no. of samples, size of *.kmc_suf, fingerprint of the database (8 bytes each),
+// samples (8 bytes each), marker "KMCI"
+static const uint32 KMC_INDEX_VERSION = 3;
+static const uint64 KMC_INDEX_HEADER_SIZE = 48;
+static const uint64 KMC_INDEX_N_CHECKED_SAMPLES = 64;
+static const uint64 KMC_INDEX_N_FINGERPRINT_WORDS = 64;
 
 // ----------------------------------------------------------------------------------
 // Open files *.kmc_pre & *.kmc_suf, read them to RAM, close files. 
@@ -23,6 +46,20 @@ uint64 CKMCFile::part_size = 1 << 25;
 // RET	: true		- if successful
 // ----------------------------------------------------------------------------------
 bool CKMCFile::OpenForRA(const std::string &file_name)
+{
+	return OpenForRA(file_name, ra_mode::read);
+}
+
+// ----------------------------------------------------------------------------------
+// Open files *.kmc_pre & *.kmc_suf for random access
+// In ra_mode::read mode files are read to RAM, in ra_mode::mmap and ra_mode::mmap_populate
+// modes the LUT and suffixes are accessed directly in read only memory mappings of the files,
+// so opening is fast and the memory (page cache) is shared by all processes using the same database
+// IN	: file_name - the name of kmer_counter's output
+//		  mode		- how the files are loaded
+// RET	: true		- if successful
+// ----------------------------------------------------------------------------------
+bool CKMCFile::OpenForRA(const std::string &file_name, ra_mode mode)
 {
 	uint64 size;
 	size_t result;
@@ -30,22 +67,55 @@ bool CKMCFile::OpenForRA(const std::string &file_name)
 	if (file_pre || file_suf)
 		return false;
 
+	ra_open_mode = mode;
+	bool populate = mode == ra_mode::mmap_populate;
+
 	if (!OpenASingleFile(file_name + ".kmc_pre", file_pre, size, (char *)"KMCP"))
 		return false;
 
-	ReadParamsFrom_prefix_file_buf(size, open_mode::opened_for_RA);
+	if (!ReadParamsFrom_prefix_file_buf(size, open_mode::opened_for_RA))
+		return false;
+
+	if (mode != ra_mode::read && !IsLutEliasFano())
+	{
+		if (!pre_mapping.Open(file_name + ".kmc_pre", populate, false))
+			return false;
+		prefix_lut = pre_mapping.Data() + 4;
+	}
 
 	if (!OpenASingleFile(file_name + ".kmc_suf", file_suf, size, (char *)"KMCS"))
 		return false;
 
-	sufix_file_buf = new uchar[size];
-	result = fread(sufix_file_buf, 1, size, file_suf);
-	if (result != size)
-		return false;
+	if (IsCompressed())
+	{
+		// skip pointers are loaded, blocks are read (or mapped) in the same way as records of uncompressed *.kmc_suf
+		if (!compressed_sufixes.Load(file_suf, kmer_length, lut_prefix_length, counter_size, total_kmers))
+			return false;
+		my_fseek(file_suf, 4, SEEK_SET);
+	}
+
+	if (mode == ra_mode::read)
+	{
+		sufix_file_buf = new uchar[size];
+		result = fread(sufix_file_buf, 1, size, file_suf);
+		if (result != size)
+			return false;
+	}
+	else
+	{
+		if (!suf_mapping.Open(file_name + ".kmc_suf", populate, true))
+			return false;
+		sufix_file_buf = const_cast<uchar*>(suf_mapping.Data()) + 4;	//never modified in random access mode
+	}
 
 	fclose(file_suf);
 	file_suf = NULL;
 
+	if (IsCompressed())
+		compressed_sufixes.SetData(sufix_file_buf);
+
+	LoadIndex(file_name);
+
 	is_opened = opened_for_RA;
 	prefix_index = 0;
 	sufix_number = 0;
@@ -59,6 +129,18 @@ bool CKMCFile::OpenForRA(const std::string &file_name)
 // RET	: true		- if successful
 //----------------------------------------------------------------------------------
 bool CKMCFile::OpenForListing(const std::string &file_name)
+{
+	return OpenForListing(file_name, 0, 1);
+}
+
+//----------------------------------------------------------------------------------
+// Open files *kmc_pre & *.kmc_suf for listing of a part of k-mers, both files are buffered
+// IN	: file_name - the name of kmer_counter's output
+//		  part_id	- the part to list (0, ..., n_parts - 1)
+//		  n_parts	- the number of parts the database is split into
+// RET	: true		- if successful
+//----------------------------------------------------------------------------------
+bool CKMCFile::OpenForListing(const std::string &file_name, uint32 part_id, uint32 n_parts)
 {
 	uint64 size;
 
@@ -68,36 +150,101 @@ bool CKMCFile::OpenForListing(const std::string &file_name)
 	if (file_pre || file_suf)
 		return false;
 
+	if (part_id >= n_parts)
+		return false;
+
 	if (!OpenASingleFile(file_name + ".kmc_pre", file_pre, size, (char *)"KMCP"))
 		return false;
 
-	ReadParamsFrom_prefix_file_buf(size, open_mode::opened_for_listing);
+	if (!ReadParamsFrom_prefix_file_buf(size, open_mode::opened_for_listing))
+	{
+		// unsupported version or corrupted LUT, there is no LUT buffer to list the parts with
+		fclose(file_pre);
+		file_pre = NULL;
+		return false;
+	}
 
-	end_of_file = total_kmers == 0;
+	GetListingPartStart(part_id, n_parts, listing_first_lut, listing_first_kmer);
+	GetListingPartStart(part_id + 1, n_parts, listing_end_lut, listing_end_kmer);
 
 	if (!OpenASingleFile(file_name + ".kmc_suf", file_suf, size, (char *)"KMCS"))
 		return false;
 
-	sufix_file_buf = new uchar[part_size];
-
-	suffix_file_total_to_read = size;
-	suf_file_left_to_read = suffix_file_total_to_read;
-	auto to_read = MIN(suf_file_left_to_read, part_size);
-	auto readed = fread(sufix_file_buf, 1, to_read, file_suf);
-	if (readed != to_read)
+	if (IsCompressed())
 	{
-		std::cerr << "Error: some error while reading suffix file\n";
-		return false;
+		compressed_sufix_reader = std::make_unique<CCompressedSuffixReader>();
+		if (!compressed_sufix_reader->Open(file_suf, kmer_length, lut_prefix_length, counter_size, total_kmers))
+			return false;
 	}
 
-	suf_file_left_to_read -= readed;
+	sufix_file_buf = new uchar[part_size];
+
+	suffix_file_total_to_read = (listing_end_kmer - listing_first_kmer) * sufix_rec_size;
+	if (!StartListing())
+		return false;
 
 	is_opened = opened_for_listing;
-	prefix_index = 0;
-	sufix_number = 0;
-	index_in_partial_buf = 0;
 	return true;
 }
+
+//----------------------------------------------------------------------------------
+// Read a value of LUT from *.kmc_pre in listing mode. Auxiliary function.
+// IN	: index - index of LUT (in a whole LUT area of all bins)
+// RET	: LUT[index], the index of the first sufix of the prefix (total_kmers for the last index)
+//----------------------------------------------------------------------------------
+uint64 CKMCFile::ReadListingLutValue(uint64 index)
+{
+	if (index >= prefixFileBufferForListingMode->LutSize()) //the last value is not valid for kmc1 db
+		return total_kmers;
+	if (IsLutEliasFano())
+		return lut_ef.Get(index);
+
+	uint64 value = 0;
+	my_fseek(file_pre, 4 + index * sizeof(uint64), SEEK_SET);
+	if (fread(&value, sizeof(uint64), 1, file_pre) != 1)
+		return total_kmers;
+	return value;
+}
+
+//----------------------------------------------------------------------------------
+// Find where a part of a database starts. Parts are split at LUT boundaries as close
+// as possible to equal numbers of k-mers. Auxiliary function.
+// IN	: part_id		- the part (n_parts for the end of the last part)
+//		  n_parts		- the number of parts
+// OUT	: lut_index		- the first LUT index of the part
+//		  kmer_index	- the first k-mer of the part
+//----------------------------------------------------------------------------------
+void CKMCFile::GetListingPartStart(uint32 part_id, uint32 n_parts, uint64& lut_index, uint64& kmer_index)
+{
+	if (part_id == 0)
+	{
+		lut_index = 0;
+		kmer_index = 0;
+		return;
+	}
+	if (part_id == n_parts)
+	{
+		lut_index = prefixFileBufferForListingMode->LutSize();
+		kmer_index = total_kmers;
+		return;
+	}
+
+	uint64 target = total_kmers / n_parts * part_id + total_kmers % n_parts * part_id / n_parts;
+
+	//the first LUT index which value is not lower than the target
+	uint64 lo = 0, hi = prefixFileBufferForListingMode->LutSize();
+	while (lo < hi)
+	{
+		uint64 mid = (lo + hi) / 2;
+		if (ReadListingLutValue(mid) >= target)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	lut_index = lo;
+	kmer_index = ReadListingLutValue(lo);
+}
+
 //----------------------------------------------------------------------------------
 CKMCFile::CKMCFile()
 {
@@ -105,6 +252,7 @@ CKMCFile::CKMCFile()
 	file_suf = NULL;
 
 	prefix_file_buf = NULL;
+	prefix_lut = NULL;
 	sufix_file_buf = NULL;
 	signature_map = NULL;
 
@@ -120,7 +268,7 @@ CKMCFile::~CKMCFile()
 		fclose(file_suf);
 	if (prefix_file_buf)
 		delete[] prefix_file_buf;
-	if (sufix_file_buf)
+	if (sufix_file_buf && !suf_mapping.Data())
 		delete[] sufix_file_buf;
 	if (signature_map)
 		delete[] signature_map;
@@ -182,11 +330,11 @@ bool CKMCFile::ReadParamsFrom_prefix_file_buf(uint64 &size, open_mode _open_mode
 	size_t result;
 
 	result = fread(&kmc_version, sizeof(uint32), 1, file_pre);
-	if (kmc_version != 0 && kmc_version != 0x200) //only this versions are supported, 0 = kmc1, 0x200 = kmc2
+	if (kmc_version != 0 && (kmc_version < 0x200 || kmc_version > 0x203)) //only this versions are supported, 0 = kmc1, 0x200 = kmc2, 0x201 = kmc2 with Elias-Fano encoded LUT, 0x202 = kmc2 with compressed *.kmc_suf, 0x203 = both
 		return false;
 	my_fseek(file_pre, prev_pos, SEEK_SET);
 
-	if (kmc_version == 0x200)
+	if (IsKMC2())
 	{
 		my_fseek(file_pre, -8, SEEK_END);
 		
@@ -221,35 +369,44 @@ bool CKMCFile::ReadParamsFrom_prefix_file_buf(uint64 &size, open_mode _open_mode
 		single_LUT_size = 1 << (2 * lut_prefix_length);
 		uint64 last_data_index = lut_area_size_in_bytes / sizeof(uint64);
 
+		if (IsLutEliasFano())
+		{
+			// Elias-Fano encoded LUT (with the total no. of k-mers as the last element) is always loaded, it is small
+			my_fseek(file_pre, 4, SEEK_SET);
+			if (!lut_ef.Load(file_pre) || lut_ef.Size() == 0)
+				return false;
+			last_data_index = lut_ef.Size() - 1;
+		}
+
 		signature_map = new uint32[signature_map_size];
 
-		fseek(file_pre, 4 + lut_area_size_in_bytes + 8, SEEK_SET);
+		my_fseek(file_pre, 4 + lut_area_size_in_bytes + 8, SEEK_SET);
 		result = fread(signature_map, 1, signature_map_size * sizeof(uint32), file_pre);
 		if (result == 0)
 			return false;
 
 		if(_open_mode == opened_for_RA)
 		{
-			rewind(file_pre);
-			my_fseek(file_pre, +4, SEEK_CUR);
-			prefix_file_buf_size = (lut_area_size_in_bytes + 8) / sizeof(uint64);		//reads without 4 bytes of a header_offset (and without markers)
-			prefix_file_buf = new uint64[prefix_file_buf_size];
-			result = fread(prefix_file_buf, 1, (size_t)(lut_area_size_in_bytes + 8), file_pre);
-			if (result == 0)
-				return false;
-
-			prefix_file_buf[last_data_index] = total_kmers + 1; //I think + 1 if wrong, but due to the implementation of binary search it does not matter, it was here in kmc 0.3 and I leave it this way just in case...
-
-			result = fread(signature_map, 1, signature_map_size * sizeof(uint32), file_pre);
-			if (result == 0)
-				return false;
+			prefix_file_buf_size = last_data_index + 1;		//reads without 4 bytes of a header_offset (and without markers)
+			if (ra_open_mode == ra_mode::read && !IsLutEliasFano())
+			{
+				rewind(file_pre);
+				my_fseek(file_pre, +4, SEEK_CUR);
+				prefix_file_buf = new uint64[prefix_file_buf_size];
+				result = fread(prefix_file_buf, 1, (size_t)(lut_area_size_in_bytes + 8), file_pre);
+				if (result == 0)
+					return false;
+
+				prefix_file_buf[last_data_index] = total_kmers + 1; //I think + 1 if wrong, but due to the implementation of binary search it does not matter, it was here in kmc 0.3 and I leave it this way just in case...
+				prefix_lut = (const uchar*)prefix_file_buf;
+			}
 
 			fclose(file_pre);
 			file_pre = nullptr;
 		}
 		else
 		{
-			prefixFileBufferForListingMode = std::make_unique<CPrefixFileBufferForListingMode>(file_pre, last_data_index, lut_prefix_length, false, total_kmers);
+			prefixFileBufferForListingMode = std::make_unique<CPrefixFileBufferForListingMode>(file_pre, last_data_index, lut_prefix_length, false, total_kmers, IsLutEliasFano() ? &lut_ef : nullptr);
 		}
 
 		sufix_size = (kmer_length - lut_prefix_length) / 4;
@@ -298,13 +455,17 @@ bool CKMCFile::ReadParamsFrom_prefix_file_buf(uint64 &size, open_mode _open_mode
 
 		if (_open_mode == opened_for_RA)
 		{
-			prefix_file_buf = new uint64[prefix_file_buf_size];
-			fseek(file_pre, 4, SEEK_SET);
-			result = fread(prefix_file_buf, 1, (size_t)(prefix_file_buf_size * sizeof(uint64)), file_pre);
-			if (result == 0)
-				return false;
-
-			prefix_file_buf[last_data_index] = total_kmers + 1; //I think + 1 if wrong, but due to the implementation of binary search it does not matter, it was here in kmc 0.3 and I leave it this way just in case...
+			if (ra_open_mode == ra_mode::read)
+			{
+				prefix_file_buf = new uint64[prefix_file_buf_size];
+				fseek(file_pre, 4, SEEK_SET);
+				result = fread(prefix_file_buf, 1, (size_t)(prefix_file_buf_size * sizeof(uint64)), file_pre);
+				if (result == 0)
+					return false;
+
+				prefix_file_buf[last_data_index] = total_kmers + 1; //I think + 1 if wrong, but due to the implementation of binary search it does not matter, it was here in kmc 0.3 and I leave it this way just in case...
+				prefix_lut = (const uchar*)prefix_file_buf;
+			}
 
 			fclose(file_pre);
 			file_pre = nullptr;
@@ -332,38 +493,8 @@ bool CKMCFile::ReadParamsFrom_prefix_file_buf(uint64 &size, open_mode _open_mode
 //------------------------------------------------------------------------------------------
 bool CKMCFile::CheckKmer(CKmerAPI &kmer, uint32 &count)
 {
-	if(is_opened != opened_for_RA)
-		return false;
-	if(end_of_file)
-		return false;
-	
-	//recognize a prefix:
-	uint64 pattern_prefix_value = kmer.kmer_data[0];
-
-	uint32 pattern_offset = (sizeof(pattern_prefix_value)* 8) - (lut_prefix_length * 2) - (kmer.byte_alignment * 2);
-	int64 index_start = 0, index_stop = 0;
-
-	pattern_prefix_value = pattern_prefix_value >> pattern_offset;  //complements with 0
-	if (pattern_prefix_value >= prefix_file_buf_size)
-		return false;
-
-	if (kmc_version == 0x200)
-	{
-		uint32 signature = kmer.get_signature(signature_len);
-		uint32 bin_start_pos = signature_map[signature];
-		bin_start_pos *= single_LUT_size;				
-		//look into the array with data
-		index_start = *(prefix_file_buf + bin_start_pos + pattern_prefix_value);
-		index_stop = *(prefix_file_buf + bin_start_pos + pattern_prefix_value + 1) - 1;
-	}
-	else if (kmc_version == 0)
-	{
-		//look into the array with data
-		index_start = prefix_file_buf[pattern_prefix_value];
-		index_stop = prefix_file_buf[pattern_prefix_value + 1] - 1;
-	}
-	uint64 tmp_count ;
-	bool res = BinarySearch(index_start, index_stop, kmer, tmp_count, pattern_offset);
+	uint64 tmp_count = 0;
+	bool res = CheckKmer(kmer, tmp_count, current_filter());
 	count = (uint32)tmp_count;
 	return res;
 }
@@ -375,6 +506,18 @@ bool CKMCFile::CheckKmer(CKmerAPI &kmer, uint32 &count)
 // RET: true  - if kmer exists
 //------------------------------------------------------------------------------------------
 bool CKMCFile::CheckKmer(CKmerAPI &kmer, uint64 &count)
+{
+	return CheckKmer(kmer, count, current_filter());
+}
+
+//------------------------------------------------------------------------------------------
+// Check if kmer exists. 
+// IN : kmer   - kmer
+//		filter - counter thresholds
+// OUT: count  - kmer's counter if kmer exists
+// RET: true   - if kmer exists
+//------------------------------------------------------------------------------------------
+bool CKMCFile::CheckKmer(const CKmerAPI& kmer, uint64& count, const counter_filter_t& filter) const
 {
 	if (is_opened != opened_for_RA)
 		return false;
@@ -391,22 +534,253 @@ bool CKMCFile::CheckKmer(CKmerAPI &kmer, uint64 &count)
 	if (pattern_prefix_value >= prefix_file_buf_size)
 		return false;
 
-	if (kmc_version == 0x200)
+	if (IsKMC2())
 	{
 		uint32 signature = kmer.get_signature(signature_len);
 		uint32 bin_start_pos = signature_map[signature];
 		bin_start_pos *= single_LUT_size;
 		//look into the array with data
-		index_start = *(prefix_file_buf + bin_start_pos + pattern_prefix_value);
-		index_stop = *(prefix_file_buf + bin_start_pos + pattern_prefix_value + 1) - 1;
+		uint64 lut_start, lut_end;
+		lut_range(bin_start_pos + pattern_prefix_value, lut_start, lut_end);
+		index_start = lut_start;
+		index_stop = lut_end - 1;
 	}
 	else if (kmc_version == 0)
 	{
 		//look into the array with data
-		index_start = prefix_file_buf[pattern_prefix_value];
-		index_stop = prefix_file_buf[pattern_prefix_value + 1] - 1;
+		index_start = lut_value(pattern_prefix_value);
+		index_stop = lut_value(pattern_prefix_value + 1) - 1;
+	}
+	return BinarySearch(index_start, index_stop, kmer, count, pattern_offset, filter);
+}
+
+//------------------------------------------------------------------------------------------
+// Check a batch of kmers.
+// Queries are grouped by their positions in *.kmc_suf (LUT range), so consecutive
+// searches touch close records, and searched with InterleavedSearch.
+// IN : kmers  - an array of kmers
+//		n      - the number of kmers
+// OUT: counts - counts[i] is the kmer's counter if kmers[i] exists, 0 otherwise
+// RET: true   - if the database is opened for random access
+//------------------------------------------------------------------------------------------
+bool CKMCFile::CheckKmers(const CKmerAPI* kmers, uint64 n, uint64* counts)
+{
+	return CheckKmers(kmers, n, counts, current_filter());
+}
+
+//------------------------------------------------------------------------------------------
+// Check a batch of kmers.
+// IN : kmers  - an array of kmers
+//		n      - the number of kmers
+//		filter - counter thresholds
+// OUT: counts - counts[i] is the kmer's counter if kmers[i] exists, 0 otherwise
+// RET: true   - if the database is opened for random access
+//------------------------------------------------------------------------------------------
+bool CKMCFile::CheckKmers(const CKmerAPI* kmers, uint64 n, uint64* counts, const counter_filter_t& filter) const
+{
+	if (is_opened != opened_for_RA)
+		return false;
+
+	std::fill(counts, counts + n, 0);
+	if (end_of_file)
+		return true;
+
+	std::vector<lookup_t> lookups;
+	std::vector<uchar> patterns(n * sufix_size);
+	lookups.reserve(n);
+
+	for (uint64 i = 0; i < n; ++i)
+	{
+		int64 index_start, index_stop;
+		if (!GetKmerRange(kmers[i], index_start, index_stop))
+			continue;
+		GetSufixPattern(kmers[i], patterns.data() + i * sufix_size);
+		lookups.push_back({ index_start, index_stop, i });
+	}
+	if (!total_kmers || lookups.empty())
+		return true;		//all k-mers absent
+
+	// Group queries by their LUT ranges with a single counting sort pass (about one group per query), so queries
+	// probing close records of *.kmc_suf are processed together. A full sort costs more than it saves
+	uint32 group_bits = 0;
+	while (group_bits < 40 && (1ull << group_bits) < lookups.size())
+		++group_bits;
+	uint32 group_shift = 0;
+	while ((total_kmers - 1) >> group_shift >> group_bits)
+		++group_shift;
+
+	std::vector<uint64> group_pos(((total_kmers - 1) >> group_shift) + 2);
+	for (auto& q : lookups)
+		++group_pos[(q.index_start >> group_shift) + 1];
+	for (uint64 i = 1; i < group_pos.size(); ++i)
+		group_pos[i] += group_pos[i - 1];
+	std::vector<lookup_t> grouped(lookups.size());
+	for (auto& q : lookups)
+		grouped[group_pos[q.index_start >> group_shift]++] = q;
+
+	InterleavedSearch(grouped.data(), grouped.size(), patterns.data(), counts, filter);
+
+	return true;
+}
+
+//------------------------------------------------------------------------------------------
+// Sufix of a kmer in the same form as it is stored in *.kmc_suf
+// IN : kmer	- kmer
+// OUT: pattern - sufix_size bytes of the sufix
+//------------------------------------------------------------------------------------------
+void CKMCFile::GetSufixPattern(const CKmerAPI& kmer, uchar* pattern) const
+{
+	uint32 pattern_offset = (lut_prefix_length + kmer.byte_alignment) * 2;
+	uint32 row_index = 0;
+	for (uint32 a = 0; a < sufix_size; a++)
+	{
+		pattern[a] = (uchar)((kmer.kmer_data[row_index] << pattern_offset) >> 56);
+		pattern_offset += 8;
+		if (pattern_offset == 64)
+		{
+			pattern_offset = 0;
+			row_index++;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------------------
+// Binary searches of many sufixes at once.
+// CHECK_KMERS_IN_FLIGHT searches are performed at once, in each step the next probed record
+// (or sample of the secondary index) of a search is prefetched and the search is suspended
+// until all the other searches made their steps, so memory latencies overlap.
+// IN : lookups  - ranges of records (not empty) to search and ids of sufixes
+//		n        - the number of lookups
+//		patterns - sufixes (the one of id i at patterns + i * sufix_size)
+//		filter   - counter thresholds
+// OUT: counts   - counts[id] is set to the counter if the sufix is found and passes min/max filtering, not modified otherwise
+//------------------------------------------------------------------------------------------
+void CKMCFile::InterleavedSearch(const lookup_t* lookups, uint64 n, const uchar* patterns, uint64* counts, const counter_filter_t& filter) const
+{
+	if (IsCompressed())
+	{
+		// blocks of compressed *.kmc_suf are decoded during a search, so searches are not interleaved,
+		// but grouped lookups still touch close blocks
+		for (uint64 i = 0; i < n; ++i)
+		{
+			uint64 counter;
+			if (compressed_sufixes.Find(lookups[i].index_start, lookups[i].index_stop, patterns + lookups[i].id * sufix_size, counter) && passes_filter(counter, filter))
+				counts[lookups[i].id] = counter;
+		}
+		return;
+	}
+
+	// A search first looks for the key among samples of the secondary index (if present), then among records
+	struct search_t
+	{
+		int64 index_start, index_stop, mid_index;
+		uint64 sample_first, sample_last, sample_lo, sample_hi;
+		bool in_index;
+		uint64 key;
+		const uchar* pattern;
+		uint64 id;
+	};
+
+	const uint32 CHECK_KMERS_IN_FLIGHT = 16;
+
+	auto probe = [&](search_t& s) {
+		if (s.in_index)
+		{
+			KMC_API_PREFETCH(index_samples + (s.sample_lo + s.sample_hi) / 2);
+			return;
+		}
+		s.mid_index = (s.index_start + s.index_stop) / 2;
+		const uchar* rec = sufix_file_buf + s.mid_index * sufix_rec_size;
+		KMC_API_PREFETCH(rec);
+		KMC_API_PREFETCH(rec + sufix_rec_size - 1);
+	};
+
+	auto start = [&](search_t& s, const lookup_t& q) {
+		s.index_start = q.index_start;
+		s.index_stop = q.index_stop;
+		s.pattern = patterns + q.id * sufix_size;
+		s.id = q.id;
+		s.in_index = index_samples && GetSamplesInRange(s.index_start, s.index_stop, s.sample_first, s.sample_last);
+		if (s.in_index)
+		{
+			s.key = sufix_key(s.pattern);
+			s.sample_lo = s.sample_first;
+			s.sample_hi = s.sample_last + 1;
+		}
+		probe(s);
+	};
+
+	// Make a single step of a search, returns false if the search is finished
+	auto step = [&](search_t& s) {
+		if (s.in_index)
+		{
+			uint64 mid = (s.sample_lo + s.sample_hi) / 2;
+			if (index_samples[mid] < s.key)
+				s.sample_lo = mid + 1;
+			else
+				s.sample_hi = mid;
+			if (s.sample_lo == s.sample_hi)
+			{
+				NarrowRangeAt(s.key, s.sample_lo, s.sample_first, s.sample_last, s.index_start, s.index_stop);
+				s.in_index = false;
+			}
+			return s.in_index || s.index_start <= s.index_stop;
+		}
+
+		const uchar* rec = sufix_file_buf + s.mid_index * sufix_rec_size;
+		int cmp = memcmp(rec, s.pattern, sufix_size);
+		if (cmp == 0)
+		{
+			uint64 counter = counter_size ? counter_value(rec + sufix_size) : 1;
+			if (passes_filter(counter, filter))
+				counts[s.id] = counter;
+			return false;
+		}
+		if (cmp < 0)
+			s.index_start = s.mid_index + 1;
+		else
+			s.index_stop = s.mid_index - 1;
+		return s.index_start <= s.index_stop;
+	};
+
+	search_t in_flight[CHECK_KMERS_IN_FLIGHT];
+	uint32 n_in_flight = 0;
+	uint64 next_query = 0;
+
+	for (; n_in_flight < CHECK_KMERS_IN_FLIGHT && next_query < n; ++n_in_flight)
+		start(in_flight[n_in_flight], lookups[next_query++]);
+
+	while (n_in_flight)
+	{
+		for (uint32 j = 0; j < n_in_flight; )
+		{
+			search_t& s = in_flight[j];
+			if (step(s))
+			{
+				probe(s);
+				++j;
+			}
+			else if (next_query < n)		// the slot of a finished search is taken by a new query or by the last search
+			{
+				start(s, lookups[next_query++]);
+				++j;
+			}
+			else
+				s = in_flight[--n_in_flight];
+		}
 	}
-	return BinarySearch(index_start, index_stop, kmer, count, pattern_offset);
+}
+
+//------------------------------------------------------------------------------------------
+// Check a batch of kmers.
+// IN : kmers  - kmers
+// OUT: counts - counts[i] is the kmer's counter if kmers[i] exists, 0 otherwise
+// RET: true   - if the database is opened for random access
+//------------------------------------------------------------------------------------------
+bool CKMCFile::CheckKmers(const std::vector<CKmerAPI>& kmers, std::vector<uint64>& counts)
+{
+	counts.resize(kmers.size());
+	return CheckKmers(kmers.data(), kmers.size(), counts.data());
 }
 
 //-----------------------------------------------------------------------------------------------
@@ -490,7 +864,7 @@ bool CKMCFile::ReadNextKmer(CKmerAPI &kmer, uint32 &count)
 		}
 		sufix_number++;
 	
-		if(sufix_number == total_kmers)
+		if(sufix_number == listing_end_kmer)
 			end_of_file = true;
 	}
 	while ((counter_size != 0) && ((count < min_count) || (count > max_count))); //do not applay filtering if counter_size == 0 as it does not make sense
@@ -569,7 +943,7 @@ bool CKMCFile::ReadNextKmer(CKmerAPI &kmer, uint64 &count)
 		}
 		sufix_number++;
 
-		if (sufix_number == total_kmers)
+		if (sufix_number == listing_end_kmer)
 			end_of_file = true;
 
 	} while ((counter_size != 0) && ((count < min_count) || (count > max_count))); //do not applay filtering if counter_size == 0 as it does not make sense
@@ -577,13 +951,89 @@ bool CKMCFile::ReadNextKmer(CKmerAPI &kmer, uint64 &count)
 	return true;
 }
 
+//-----------------------------------------------------------------------------------------------
+// Read a batch of next kmers
+// IN : max - the maximal number of kmers to read
+// OUT: packed_kmers - kmers, (kmer_length + 31) / 32 words each, the most significant word first,
+//		symbols (2 bits each) aligned to the least significant bit of the last word (as in CKmerAPI::to_long)
+//		counts - kmers' counters
+// RET: the number of kmers read, 0 if EOF
+//-----------------------------------------------------------------------------------------------
+uint64 CKMCFile::ReadNextKmers(uint64* packed_kmers, uint64* counts, uint64 max)
+{
+	if (is_opened != opened_for_listing)
+		return 0;
+
+	const uint32 n_words = (kmer_length + 31) / 32;
+	uint64 n_read = 0;
+	while (n_read < max && !end_of_file)
+	{
+		// kmer = prefix followed by sufix_size bytes of the sufix (4 symbols each),
+		// pos is the bit position (from the least significant bit of the last word) of the current part,
+		// a byte of the sufix never crosses words, the prefix may
+		uint64* kmer = packed_kmers + n_read * n_words;
+		for (uint32 i = 0; i < n_words; ++i)
+			kmer[i] = 0;
+		uint64 prefix = prefixFileBufferForListingMode->GetPrefix(sufix_number);
+		uint32 pos = 8 * sufix_size;
+		if (lut_prefix_length)
+		{
+			kmer[n_words - 1 - pos / 64] = prefix << (pos % 64);
+			if (pos % 64 + 2 * lut_prefix_length > 64)
+				kmer[n_words - 2 - pos / 64] = prefix >> (64 - pos % 64);
+		}
+
+		for (uint32 a = 0; a < sufix_size; a++)
+		{
+			if (index_in_partial_buf == part_size)
+				Reload_sufix_file_buf();
+			pos -= 8;
+			kmer[n_words - 1 - pos / 64] |= (uint64)sufix_file_buf[index_in_partial_buf++] << (pos % 64);
+		}
+
+		uint64 count = 1;
+		if (counter_size)
+		{
+			count = 0;
+			for (uint32 b = 0; b < counter_size; b++)
+			{
+				if (index_in_partial_buf == part_size)
+					Reload_sufix_file_buf();
+				count |= (uint64)sufix_file_buf[index_in_partial_buf++] << (8 * b);
+			}
+		}
+
+		sufix_number++;
+		if (sufix_number == listing_end_kmer)
+			end_of_file = true;
+
+		//do not applay filtering if counter_size == 0 as it does not make sense
+		if (counter_size == 0 || (count >= min_count && count <= max_count))
+			counts[n_read++] = count;
+	}
+
+	return n_read;
+}
+
+//-------------------------------------------------------------------------------
+// Read records of *.kmc_suf to an array "sufix_file_buf" for listing mode. Auxiliary function.
+// IN	: size - the number of bytes to read
+// RET	: the number of bytes read
+//-------------------------------------------------------------------------------
+uint64 CKMCFile::ReadSufixes(uint64 size)
+{
+	if (compressed_sufix_reader)
+		return compressed_sufix_reader->Read(sufix_file_buf, size);
+	return fread(sufix_file_buf, 1, (size_t)size, file_suf);
+}
+
 //-------------------------------------------------------------------------------
 // Reload a contents of an array "sufix_file_buf" for listing mode. Auxiliary function.
 //-------------------------------------------------------------------------------
 void CKMCFile::Reload_sufix_file_buf()
 {
 	auto to_read = MIN(suf_file_left_to_read, part_size);
-	auto readed = fread(sufix_file_buf, 1, (size_t)to_read, file_suf);
+	auto readed = ReadSufixes(to_read);
 	suf_file_left_to_read -= readed;
 	if (readed != to_read)
 	{
@@ -616,10 +1066,23 @@ bool CKMCFile::Close()
 		end_of_file = false;
 		delete [] prefix_file_buf;
 		prefix_file_buf = NULL;
-		delete [] sufix_file_buf;
+		prefix_lut = NULL;
+		if (suf_mapping.Data())
+			suf_mapping.Close();
+		else
+			delete [] sufix_file_buf;
 		sufix_file_buf = NULL;
+		pre_mapping.Close();
+		lut_ef.Clear();
+		compressed_sufixes.Clear();
+		compressed_sufix_reader.reset();
 		delete[] signature_map;
 		signature_map = NULL;
+		index_samples = nullptr;
+		index_n_samples = 0;
+		index_step = 0;
+		std::vector<uint64>().swap(index_buf);
+		idx_mapping.Close();
 
 		return true;
 	}
@@ -633,28 +1096,40 @@ bool CKMCFile::Close()
 bool CKMCFile::RestartListing(void)
 {
 	if(is_opened == opened_for_listing)
+		return StartListing();
+	return false;
+		
+}
+
+//----------------------------------------------------------------------------------
+// Set initial values to list k-mers from the beginning of the listed range. Auxiliary function.
+// RET: true - if successful
+//----------------------------------------------------------------------------------
+bool CKMCFile::StartListing()
+{
+	prefixFileBufferForListingMode->SeekToLutIndex(listing_first_lut, listing_end_lut);
+
+	if (compressed_sufix_reader)
+		compressed_sufix_reader->Seek(listing_first_kmer);
+	else
+		my_fseek(file_suf, 4 + listing_first_kmer * sufix_rec_size, SEEK_SET);
+	suf_file_left_to_read = suffix_file_total_to_read;
+	auto to_read = MIN(suf_file_left_to_read, part_size);
+	auto readed = ReadSufixes(to_read);
+	if (readed != to_read)
 	{
-		my_fseek(file_suf , 4 , SEEK_SET);
-		suf_file_left_to_read = suffix_file_total_to_read;
-		auto to_read = MIN(suf_file_left_to_read, part_size);
-		auto readed = fread(sufix_file_buf, 1, to_read, file_suf);
-		if (readed != to_read)
-		{
-			std::cerr << "Error: some error while reading suffix file\n";
-			return false;
-		}
+		std::cerr << "Error: some error while reading suffix file\n";
+		return false;
+	}
 
-		suf_file_left_to_read -= readed;
-		prefix_index = 0;
-		sufix_number = 0;
-		index_in_partial_buf = 0;
+	suf_file_left_to_read -= readed;
+	prefix_index = 0;
+	sufix_number = listing_first_kmer;
+	index_in_partial_buf = 0;
 
-		end_of_file = total_kmers == 0;
+	end_of_file = sufix_number == listing_end_kmer;
 
-		return true;
-	}
-	return false;
-		
+	return true;
 }
 //----------------------------------------------------------------------------------------
 // Set the minimal value for a counter. Kmers with counters below this theshold are ignored
@@ -752,13 +1227,14 @@ bool CKMCFile::IsKmer(CKmerAPI &kmer)
 
 //-----------------------------------------------------------------------------------------
 // Check the total number of kmers between current min_count and max_count
+// (only in the listed part if a part of a database is opened for listing)
 // RET	: total number of kmers or 0 if a database has not been opened
 //-----------------------------------------------------------------------------------------
 uint64 CKMCFile::KmerCount(void)
 {
 	if(is_opened)
 		if((min_count == original_min_count) && (max_count == original_max_count))
-			return total_kmers;
+			return is_opened == opened_for_listing ? listing_end_kmer - listing_first_kmer : total_kmers;
 		else
 		{
 			uint32 count;
@@ -767,9 +1243,17 @@ uint64 CKMCFile::KmerCount(void)
 			if(is_opened == opened_for_RA)
 			{
 				uchar *ptr = sufix_file_buf;
+				std::vector<uchar> block;
+				if (IsCompressed())
+					block.resize(CCompressedSuffixes::BLOCK_SIZE * sufix_rec_size);
 				
 				for(uint64 i = 0; i < total_kmers; i++)		
 				{
+					if (IsCompressed() && i % CCompressedSuffixes::BLOCK_SIZE == 0)
+					{
+						compressed_sufixes.DecodeBlock(i / CCompressedSuffixes::BLOCK_SIZE, block.data());
+						ptr = block.data();
+					}
 					ptr += sufix_size;
 
 					if (counter_size == 0)
@@ -797,7 +1281,7 @@ uint64 CKMCFile::KmerCount(void)
 				CKmerAPI kmer(kmer_length);
 				uint32 count;
 				RestartListing();
-				for(uint64 i = 0; i < total_kmers; i++)		
+				for(uint64 i = listing_first_kmer; i < listing_end_kmer; i++)		
 				{
 					ReadNextKmer(kmer, count);
 					if((count >= min_count) && (count <= max_count))
@@ -829,7 +1313,7 @@ bool CKMCFile::Info(uint32 &_kmer_length, uint32 &_mode, uint32 &_counter_size,
 		_mode = mode;
 		_counter_size = counter_size;
 		_lut_prefix_length = lut_prefix_length;
-		if (kmc_version == 0x200)
+		if (IsKMC2())
 			_signature_len = signature_len;
 		else
 			_signature_len = 0; //for kmc1 there is no signature_len
@@ -850,7 +1334,7 @@ bool CKMCFile::Info(CKMCFileInfo& info)
 		info.mode = mode;
 		info.counter_size = counter_size;
 		info.lut_prefix_length = lut_prefix_length;
-		if (kmc_version == 0x200)
+		if (IsKMC2())
 			info.signature_len = signature_len;
 		else
 			info.signature_len = 0; //for kmc1 there is no signature_len
@@ -871,6 +1355,21 @@ bool CKMCFile::Info(CKMCFileInfo& info)
 // RET	:   true if success, false if k > read length or some failure 
 //---------------------------------------------------------------------------------
 bool CKMCFile::GetCountersForRead(const std::string& read, std::vector<uint32>& counters)
+{
+	// Buffers are reused between calls, thread local because a single object may be shared by many threads (e.g. in kmc_tools filter)
+	static thread_local query_state_t state;
+	state.filter = current_filter();
+	return GetCountersForRead(read, counters, state);
+}
+
+//---------------------------------------------------------------------------------
+// Get counters from read
+// IN   :   read			- 
+//			state			- thresholds and buffers of a query handle
+// OUT	:	counters    	- vector of counters of each k-mer in read
+// RET	:   true if success, false if k > read length or some failure 
+//---------------------------------------------------------------------------------
+bool CKMCFile::GetCountersForRead(const std::string& read, std::vector<uint32>& counters, query_state_t& state) const
 {
 	if (is_opened != opened_for_RA)
 		return false;
@@ -881,19 +1380,16 @@ bool CKMCFile::GetCountersForRead(const std::string& read, std::vector<uint32>&
 		return false;
 	}
 
-	if (kmc_version == 0x200)
+	if (IsKMC2())
 	{		
-		if (both_strands)
-			return GetCountersForRead_kmc2_both_strands(read, counters);
-		else
-			return GetCountersForRead_kmc2(read, counters);
+		return GetCountersForRead_kmc2(read, counters, both_strands, state);
 	}
 	else if (kmc_version == 0)
 	{
 		if (both_strands)
-			return GetCountersForRead_kmc1_both_strands(read,counters);
+			return GetCountersForRead_kmc1_both_strands(read, counters, state.filter);
 		else
-			return GetCountersForRead_kmc1(read, counters);
+			return GetCountersForRead_kmc1(read, counters, state.filter);
 	}
 	else
 		return false; //never should be here
@@ -902,7 +1398,7 @@ bool CKMCFile::GetCountersForRead(const std::string& read, std::vector<uint32>&
 //---------------------------------------------------------------------------------
 // Auxiliary function.
 //---------------------------------------------------------------------------------
-uint32 CKMCFile::count_for_kmer_kmc1(CKmerAPI& kmer)
+uint32 CKMCFile::count_for_kmer_kmc1(CKmerAPI& kmer, const counter_filter_t& filter) const
 {
 	//recognize a prefix:
 
@@ -915,11 +1411,11 @@ uint32 CKMCFile::count_for_kmer_kmc1(CKmerAPI& kmer)
 		return false;
 	//look into the array with data
 
-	int64 index_start = prefix_file_buf[pattern_prefix_value];
-	int64 index_stop = prefix_file_buf[pattern_prefix_value + 1] - 1;
+	int64 index_start = lut_value(pattern_prefix_value);
+	int64 index_stop = lut_value(pattern_prefix_value + 1) - 1;
 
 	uint64 counter = 0;
-	if (BinarySearch(index_start, index_stop, kmer, counter, pattern_offset))
+	if (BinarySearch(index_start, index_stop, kmer, counter, pattern_offset, filter))
 		return (uint32)counter;
 	return 0;
 }
@@ -927,31 +1423,7 @@ uint32 CKMCFile::count_for_kmer_kmc1(CKmerAPI& kmer)
 //---------------------------------------------------------------------------------
 // Auxiliary function.
 //---------------------------------------------------------------------------------
-uint32 CKMCFile::count_for_kmer_kmc2(CKmerAPI& kmer, uint32 bin_start_pos)
-{
-	//recognize a prefix:
-	uint64 pattern_prefix_value = kmer.kmer_data[0];
-
-	uint32 pattern_offset = (sizeof(pattern_prefix_value)* 8) - (lut_prefix_length * 2) - (kmer.byte_alignment * 2);
-
-	pattern_prefix_value = pattern_prefix_value >> pattern_offset;  //complements with 0
-	if (pattern_prefix_value >= prefix_file_buf_size)
-		return false;
-	//look into the array with data
-
-	int64 index_start = *(prefix_file_buf + bin_start_pos + pattern_prefix_value);
-	int64 index_stop = *(prefix_file_buf + bin_start_pos + pattern_prefix_value + 1) - 1;
-
-	uint64 counter = 0;
-	if (BinarySearch(index_start, index_stop, kmer, counter, pattern_offset))
-		return (uint32)counter;
-	return 0;
-}
-
-//---------------------------------------------------------------------------------
-// Auxiliary function.
-//---------------------------------------------------------------------------------
-bool CKMCFile::GetCountersForRead_kmc1_both_strands(const std::string& read, std::vector<uint32>& counters)
+bool CKMCFile::GetCountersForRead_kmc1_both_strands(const std::string& read, std::vector<uint32>& counters, const counter_filter_t& filter) const
 {
 	uint32 read_len = static_cast<uint32>(read.length());
 	counters.resize(read.length() - kmer_length + 1);
@@ -996,9 +1468,9 @@ bool CKMCFile::GetCountersForRead_kmc1_both_strands(const std::string& read, std
 		if (pos == kmer_length)
 		{
 			if(kmer < kmer_rev)
-				counters[counters_pos++] = count_for_kmer_kmc1(kmer);
+				counters[counters_pos++] = count_for_kmer_kmc1(kmer, filter);
 			else
-				counters[counters_pos++] = count_for_kmer_kmc1(kmer_rev);
+				counters[counters_pos++] = count_for_kmer_kmc1(kmer_rev, filter);
 		}
 		else
 			break;
@@ -1013,9 +1485,9 @@ bool CKMCFile::GetCountersForRead_kmc1_both_strands(const std::string& read, std
 			kmer_rev.SHR_insert2bits(3 - CKmerAPI::num_codes[(uchar)read[i]]);
 			kmer.SHL_insert2bits(CKmerAPI::num_codes[(uchar)read[i++]]);
 			if(kmer < kmer_rev)
-				counters[counters_pos++] = count_for_kmer_kmc1(kmer);
+				counters[counters_pos++] = count_for_kmer_kmc1(kmer, filter);
 			else
-				counters[counters_pos++] = count_for_kmer_kmc1(kmer_rev);
+				counters[counters_pos++] = count_for_kmer_kmc1(kmer_rev, filter);
 		}
 	}
 	if (counters_pos < counters.size())
@@ -1029,7 +1501,7 @@ bool CKMCFile::GetCountersForRead_kmc1_both_strands(const std::string& read, std
 //---------------------------------------------------------------------------------
 // Auxiliary function.
 //---------------------------------------------------------------------------------
-bool CKMCFile::GetCountersForRead_kmc1(const std::string& read, std::vector<uint32>& counters)
+bool CKMCFile::GetCountersForRead_kmc1(const std::string& read, std::vector<uint32>& counters, const counter_filter_t& filter) const
 {	
 	uint32 read_len = static_cast<uint32>(read.length());
 	counters.resize(read.length() - kmer_length + 1);
@@ -1066,7 +1538,7 @@ bool CKMCFile::GetCountersForRead_kmc1(const std::string& read, std::vector<uint
 			continue;
 		if (pos == kmer_length)
 		{			
-			counters[counters_pos++] = count_for_kmer_kmc1(kmer);
+			counters[counters_pos++] = count_for_kmer_kmc1(kmer, filter);
 		}
 		else
 			break;
@@ -1079,7 +1551,7 @@ bool CKMCFile::GetCountersForRead_kmc1(const std::string& read, std::vector<uint
 				break;
 			}
 			kmer.SHL_insert2bits(CKmerAPI::num_codes[(uchar)read[i++]]);
-			counters[counters_pos++] = count_for_kmer_kmc1(kmer);
+			counters[counters_pos++] = count_for_kmer_kmc1(kmer, filter);
 		}
 	}
 	if (counters_pos < counters.size())
@@ -1093,7 +1565,7 @@ bool CKMCFile::GetCountersForRead_kmc1(const std::string& read, std::vector<uint
 //---------------------------------------------------------------------------------
 // Auxiliary function.
 //---------------------------------------------------------------------------------
-void CKMCFile::GetSuperKmers(const std::string& transformed_read, super_kmers_t& super_kmers)
+void CKMCFile::GetSuperKmers(const std::string& transformed_read, super_kmers_t& super_kmers) const
 {
 	uint32 i = 0;
 	uint32 len = 0; //length of super k-mer
@@ -1181,135 +1653,79 @@ void CKMCFile::GetSuperKmers(const std::string& transformed_read, super_kmers_t&
 
 //---------------------------------------------------------------------------------
 // Auxiliary function.
+// K-mers of each super k-mer are rolled (forward and reverse complement) and their
+// lookups are collected, then all lookups of the read are searched at once
+// with InterleavedSearch.
+// IN	: read			- read
+//		  canonical		- look for canonical k-mers
+//		  state			- thresholds and buffers of a query handle
+// OUT	: counters		- counters of k-mers of the read, 0 for k-mers containing 'N'
+// RET	: true
 //---------------------------------------------------------------------------------
-bool CKMCFile::GetCountersForRead_kmc2_both_strands(const std::string& read, std::vector<uint32>& counters)
+bool CKMCFile::GetCountersForRead_kmc2(const std::string& read, std::vector<uint32>& counters, bool canonical, query_state_t& state) const
 {
-	counters.resize(read.length() - kmer_length + 1);
-	std::string transformed_read = read;
-	for (char& c : transformed_read)
+	std::string& read_codes = state.codes;
+	super_kmers_t& read_super_kmers = state.super_kmers;
+	std::vector<lookup_t>& read_lookups = state.lookups;
+	std::vector<uchar>& read_patterns = state.patterns;
+	std::vector<uint64>& read_counts = state.counts;
+	CKmerAPI& read_kmer = state.kmer;
+	CKmerAPI& read_rev_kmer = state.rev_kmer;
+
+	uint32 n_kmers = static_cast<uint32>(read.length()) - kmer_length + 1;
+	counters.assign(n_kmers, 0);
+
+	read_codes.assign(read);
+	for (char& c : read_codes)
 		c = CKmerAPI::num_codes[(uchar)c];
 
-	super_kmers_t super_kmers;
-	GetSuperKmers(transformed_read, super_kmers);
-
-	uint32 counters_pos = 0;
-	if (super_kmers.empty())
-	{
-		fill_n(counters.begin(), counters.size(), 0);
+	read_super_kmers.clear();
+	GetSuperKmers(read_codes, read_super_kmers);
+	if (read_super_kmers.empty())
 		return true;
-	}
-
-	CKmerAPI kmer(kmer_length), rev_kmer(kmer_length);
 
-	uint32 last_end = 0;
-
-	//'N' somewhere in first k-mer
-	if (std::get<0>(super_kmers.front()) > 0)
+	if (read_kmer.kmer_length != kmer_length)
 	{
-		fill_n(counters.begin(), std::get<0>(super_kmers.front()), 0);
-		last_end = std::get<0>(super_kmers.front());
-		counters_pos = std::get<0>(super_kmers.front());
+		read_kmer = CKmerAPI(kmer_length);
+		read_rev_kmer = CKmerAPI(kmer_length);
 	}
-	for (auto& super_kmer : super_kmers)
-	{
-		//'N's between super k-mers
-		if (last_end < std::get<0>(super_kmer))
-		{
-			uint32 gap = std::get<0>(super_kmer) -last_end;
-			fill_n(counters.begin() + counters_pos, kmer_length + gap - 1, 0);
-			counters_pos += kmer_length + gap - 1;
-		}
-		last_end = std::get<0>(super_kmer) +std::get<1>(super_kmer);
-
-		kmer.from_binary(transformed_read.c_str() + std::get<0>(super_kmer));
-		rev_kmer.from_binary_rev(transformed_read.c_str() + std::get<0>(super_kmer));
-
-		uint32 bin_start_pos = std::get<2>(super_kmer) * single_LUT_size;
-		if(kmer < rev_kmer)
-			counters[counters_pos++] = count_for_kmer_kmc2(kmer, bin_start_pos);
-		else
-			counters[counters_pos++] = count_for_kmer_kmc2(rev_kmer, bin_start_pos);
+	read_lookups.clear();
+	if (read_patterns.size() < (uint64)n_kmers * sufix_size)
+		read_patterns.resize((uint64)n_kmers * sufix_size);
 
-		for (uint32 i = std::get<0>(super_kmer) +kmer_length; i < std::get<0>(super_kmer) +std::get<1>(super_kmer); ++i)
-		{
-			kmer.SHL_insert2bits(transformed_read[i]);
-			rev_kmer.SHR_insert2bits(3 - transformed_read[i]);
-			if(kmer < rev_kmer)
-				counters[counters_pos++] = count_for_kmer_kmc2(kmer, bin_start_pos);
-			else
-				counters[counters_pos++] = count_for_kmer_kmc2(rev_kmer, bin_start_pos);
-		}
-	}
-	//'N's at the end of read
-	if (counters_pos < counters.size())
-	{
-		fill_n(counters.begin() + counters_pos, counters.size() - counters_pos, 0);
-		counters_pos = static_cast<uint32>(counters.size());
-	}
-
-	return true;
-}
-
-
-//---------------------------------------------------------------------------------
-// Auxiliary function.
-//---------------------------------------------------------------------------------
-bool CKMCFile::GetCountersForRead_kmc2(const std::string& read, std::vector<uint32>& counters)
-{	
-	counters.resize(read.length() - kmer_length + 1);
-	std::string transformed_read = read;
-	for (char& c : transformed_read)
-		c = CKmerAPI::num_codes[(uchar)c];
-	
-	super_kmers_t super_kmers;
-	GetSuperKmers(transformed_read, super_kmers);
-	
-	uint32 counters_pos = 0;
-	if (super_kmers.empty())
+	for (auto& super_kmer : read_super_kmers)
 	{
-		fill_n(counters.begin(), counters.size(), 0);
-		return true;
-	}
+		uint32 start = std::get<0>(super_kmer);
+		uint32 end = start + std::get<1>(super_kmer);
+		uint64 bin_start_pos = (uint64)std::get<2>(super_kmer) * single_LUT_size;
 
-	CKmerAPI kmer(kmer_length);
+		read_kmer.from_binary(read_codes.c_str() + start);
+		if (canonical)
+			read_rev_kmer.from_binary_rev(read_codes.c_str() + start);
 
-	uint32 last_end = 0;
-
-	//'N' somewhere in first k-mer
-	if (std::get<0>(super_kmers.front()) > 0)
-	{
-		fill_n(counters.begin(), std::get<0>(super_kmers.front()), 0);
-		last_end = std::get<0>(super_kmers.front());
-		counters_pos = std::get<0>(super_kmers.front());
-	}
-	for (auto& super_kmer : super_kmers)
-	{
-		//'N's between super k-mers
-		if (last_end < std::get<0>(super_kmer))
+		for (uint32 i = start + kmer_length - 1; ; )
 		{
-			uint32 gap = std::get<0>(super_kmer) -last_end;
-			fill_n(counters.begin() + counters_pos, kmer_length + gap - 1, 0);
-			counters_pos += kmer_length + gap - 1;
-		}
-		last_end = std::get<0>(super_kmer) + std::get<1>(super_kmer);
-		
-		kmer.from_binary(transformed_read.c_str() + std::get<0>(super_kmer));
-
-		uint32 bin_start_pos = std::get<2>(super_kmer) * single_LUT_size;
-		counters[counters_pos++] = count_for_kmer_kmc2(kmer, bin_start_pos);
+			const CKmerAPI& kmer = canonical && read_rev_kmer < read_kmer ? read_rev_kmer : read_kmer;
+			uint32 pos = i + 1 - kmer_length;
+			int64 index_start, index_stop;
+			if (GetKmerRange(kmer, bin_start_pos, index_start, index_stop))
+			{
+				GetSufixPattern(kmer, read_patterns.data() + (uint64)pos * sufix_size);
+				read_lookups.push_back({ index_start, index_stop, pos });
+			}
 
-		for (uint32 i = std::get<0>(super_kmer) +kmer_length; i < std::get<0>(super_kmer) +std::get<1>(super_kmer); ++i)
-		{
-			kmer.SHL_insert2bits(transformed_read[i]);
-			counters[counters_pos++] = count_for_kmer_kmc2(kmer, bin_start_pos);
+			if (++i == end)
+				break;
+			read_kmer.SHL_insert2bits(read_codes[i]);
+			if (canonical)
+				read_rev_kmer.SHR_insert2bits(3 - read_codes[i]);
 		}
 	}
-	//'N's at the end of read
-	if (counters_pos < counters.size())
-	{
-		fill_n(counters.begin() + counters_pos, counters.size() - counters_pos, 0);
-		counters_pos = static_cast<uint32>(counters.size());
-	}
+
+	read_counts.assign(n_kmers, 0);
+	InterleavedSearch(read_lookups.data(), read_lookups.size(), read_patterns.data(), read_counts.data(), state.filter);
+	for (uint32 i = 0; i < n_kmers; ++i)
+		counters[i] = (uint32)read_counts[i];
 
 	return true;
 }
@@ -1318,10 +1734,22 @@ bool CKMCFile::GetCountersForRead_kmc2(const std::string& read, std::vector<uint
 //---------------------------------------------------------------------------------
 // Auxiliary function.
 //---------------------------------------------------------------------------------
-bool CKMCFile::BinarySearch(int64 index_start, int64 index_stop, const CKmerAPI& kmer, uint64& counter, uint32 pattern_offset)
+bool CKMCFile::BinarySearch(int64 index_start, int64 index_stop, const CKmerAPI& kmer, uint64& counter, uint32 pattern_offset, const counter_filter_t& filter) const
 {
 	if (index_start >= static_cast<int64>(total_kmers))
 		return false;
+	if (IsCompressed())
+	{
+		uchar pattern[64];		// sufix_size < 64 as k <= 256
+		GetSufixPattern(kmer, pattern);
+		index_stop = std::min(index_stop, static_cast<int64>(total_kmers) - 1);
+		return compressed_sufixes.Find(index_start, index_stop, pattern, counter) && passes_filter(counter, filter);
+	}
+	if (index_samples)
+	{
+		index_stop = std::min(index_stop, static_cast<int64>(total_kmers) - 1);
+		NarrowRange(sufix_key(kmer), index_start, index_stop);
+	}
 	uchar *sufix_byte_ptr = nullptr;
 	uint64 sufix = 0;
 
@@ -1380,23 +1808,493 @@ bool CKMCFile::BinarySearch(int64 index_start, int64 index_stop, const CKmerAPI&
 		if (counter_size == 0)
 			counter = 1;
 		else
+			counter = counter_value(sufix_byte_ptr + sufix_size);
+		//applay filtering only if counter_size != 0
+		return passes_filter(counter, filter);
+	}
+	return false;
+}
+
+
+//---------------------------------------------------------------------------------
+// Range of records of *.kmc_suf that may contain a kmer (determined by its prefix and signature)
+// IN	: kmer			- kmer
+// OUT	: index_start	- the first record of the range
+//		  index_stop	- the last record of the range
+// RET	: true if the range is not empty
+//---------------------------------------------------------------------------------
+bool CKMCFile::GetKmerRange(const CKmerAPI& kmer, int64& index_start, int64& index_stop) const
+{
+	uint64 bin_start_pos = 0;
+	if (IsKMC2())
+		bin_start_pos = (uint64)signature_map[kmer.get_signature(signature_len)] * single_LUT_size;
+	return GetKmerRange(kmer, bin_start_pos, index_start, index_stop);
+}
+
+//---------------------------------------------------------------------------------
+// Range of records of *.kmc_suf that may contain a kmer of a known bin
+// IN	: kmer			- kmer
+//		  bin_start_pos	- position of the LUT of kmer's bin (0 for kmc1 database format)
+// OUT	: index_start	- the first record of the range
+//		  index_stop	- the last record of the range
+// RET	: true if the range is not empty
+//---------------------------------------------------------------------------------
+bool CKMCFile::GetKmerRange(const CKmerAPI& kmer, uint64 bin_start_pos, int64& index_start, int64& index_stop) const
+{
+	uint64 pattern_prefix_value = kmer.kmer_data[0];
+	uint32 pattern_offset = (sizeof(pattern_prefix_value) * 8) - (lut_prefix_length * 2) - (kmer.byte_alignment * 2);
+
+	pattern_prefix_value = pattern_prefix_value >> pattern_offset;
+	if (pattern_prefix_value >= prefix_file_buf_size)
+		return false;
+
+	uint64 lut_start, lut_end;
+	lut_range(bin_start_pos + pattern_prefix_value, lut_start, lut_end);
+	index_start = lut_start;
+	index_stop = std::min(lut_end, total_kmers) - 1;
+	return index_start <= index_stop;
+}
+
+
+//---------------------------------------------------------------------------------
+// Key of a kmer's sufix used in the secondary index
+// IN	: kmer - kmer
+// RET	: the first (at most 8) bytes of the sufix
+//---------------------------------------------------------------------------------
+uint64 CKMCFile::sufix_key(const CKmerAPI& kmer) const
+{
+	uint64 key = 0;
+	uint32 pattern_offset = (lut_prefix_length + kmer.byte_alignment) * 2;
+	uint32 row_index = 0;
+	for (uint32 a = 0; a < sufix_size && a < sizeof(key); a++)
+	{
+		key |= ((kmer.kmer_data[row_index] << pattern_offset) >> 56) << (56 - 8 * a);
+		pattern_offset += 8;
+		if (pattern_offset == 64)
 		{
-			sufix_byte_ptr += sufix_size;
-			counter = *sufix_byte_ptr;
+			pattern_offset = 0;
+			row_index++;
+		}
+	}
+	return key;
+}
 
-			for (uint32 b = 1; b < counter_size; b++)
-			{
-				uint64 aux = 0x000000ff & *(sufix_byte_ptr + b);
+//---------------------------------------------------------------------------------
+// Samples of the secondary index inside a range of records
+// IN	: index_start, index_stop	- the range of records
+// OUT	: first, last				- the range of samples
+// RET	: true if there is at least one sample in the range
+//---------------------------------------------------------------------------------
+bool CKMCFile::GetSamplesInRange(int64 index_start, int64 index_stop, uint64& first, uint64& last) const
+{
+	if (index_start > index_stop)
+		return false;
+	first = ((uint64)index_start + index_step - 1) / index_step;
+	last = (uint64)index_stop / index_step;
+	return first <= last && last < index_n_samples;
+}
 
-				aux = aux << 8 * (b);
-				counter = aux | counter;
-			}
+//---------------------------------------------------------------------------------
+// Narrow a range of records knowing the first sample not smaller than the key.
+// The record of sample lo - 1 is smaller than the key, the record of the first sample
+// greater than the key is greater than it, so at most index_step records are left
+// (more only if many sufixes share the same key)
+// IN	: key			- key of a sufix to find
+//		  lo			- the first sample not smaller than the key (last + 1 if there is no such sample)
+//		  first, last	- samples inside the range
+// IN/OUT: index_start	- the first record of the range
+//		  index_stop	- the last record of the range
+//---------------------------------------------------------------------------------
+void CKMCFile::NarrowRangeAt(uint64 key, uint64 lo, uint64 first, uint64 last, int64& index_start, int64& index_stop) const
+{
+	uint64 hi = lo;
+	while (hi <= last && index_samples[hi] == key)
+		++hi;
+
+	if (lo != first)
+		index_start = (lo - 1) * index_step + 1;
+	if (hi != last + 1)
+		index_stop = hi * index_step - 1;
+}
+
+//---------------------------------------------------------------------------------
+// Narrow a range of records using the secondary index. Samples inside the range are
+// contiguous, so only a few cache lines are touched to find samples surrounding the key
+// IN	: key			- key of a sufix to find
+// IN/OUT: index_start	- the first record of the range
+//		  index_stop	- the last record of the range
+//---------------------------------------------------------------------------------
+void CKMCFile::NarrowRange(uint64 key, int64& index_start, int64& index_stop) const
+{
+	uint64 first, last;
+	if (!GetSamplesInRange(index_start, index_stop, first, last))
+		return;
+	uint64 lo = std::lower_bound(index_samples + first, index_samples + last + 1, key) - index_samples;
+	NarrowRangeAt(key, lo, first, last, index_start, index_stop);
+}
+
+//---------------------------------------------------------------------------------
+// Load the secondary index (*.kmc_idx) in the same way as *.kmc_suf is loaded.
+// The index is optional, if it does not exist or does not match the database it is not used
+// IN	: file_name - the name of kmer_counter's output
+//---------------------------------------------------------------------------------
+void CKMCFile::LoadIndex(const std::string& file_name)
+{
+	if (IsCompressed())		//skip pointers of compressed *.kmc_suf are used instead
+		return;
+
+	const std::string index_name = file_name + ".kmc_idx";
+	FILE* file = my_fopen(index_name.c_str(), "rb");
+	if (!file)
+		return;
+
+	my_fseek(file, 0, SEEK_END);
+	uint64 size = my_ftell(file);
+	my_fseek(file, 0, SEEK_SET);
+
+	uchar header[KMC_INDEX_HEADER_SIZE];
+	uint32 version = 0, step = 0, key_bytes = 0;
+	uint64 n_kmers = 0, n_samples = 0, idx_suf_size = 0, idx_fingerprint = 0;
+	uint64 suf_size = 0, fingerprint = 0;
+	bool ok = size >= KMC_INDEX_HEADER_SIZE + 4 && fread(header, 1, KMC_INDEX_HEADER_SIZE, file) == KMC_INDEX_HEADER_SIZE;
+	if (ok)
+	{
+		memcpy(&version, header + 4, 4);
+		memcpy(&step, header + 8, 4);
+		memcpy(&key_bytes, header + 12, 4);
+		memcpy(&n_kmers, header + 16, 8);
+		memcpy(&n_samples, header + 24, 8);
+		memcpy(&idx_suf_size, header + 32, 8);
+		memcpy(&idx_fingerprint, header + 40, 8);
+		ok = memcmp(header, "KMCI", 4) == 0 && version == KMC_INDEX_VERSION && step != 0 &&
+			key_bytes == MIN(sufix_size, (uint32)sizeof(uint64)) && n_kmers == total_kmers &&
+			n_samples == (total_kmers + step - 1) / step && size == KMC_INDEX_HEADER_SIZE + n_samples * sizeof(uint64) + 4;
+	}
+	ok = ok && DbFingerprint(file_name, suf_size, fingerprint) && suf_size == idx_suf_size && fingerprint == idx_fingerprint;
+
+	if (ok && ra_open_mode == ra_mode::read)
+	{
+		index_buf.resize(n_samples);
+		ok = fread(index_buf.data(), sizeof(uint64), n_samples, file) == n_samples;
+		index_samples = ok ? index_buf.data() : nullptr;
+	}
+	fclose(file);
+
+	if (ok && ra_open_mode != ra_mode::read)
+	{
+		ok = idx_mapping.Open(index_name, ra_open_mode == ra_mode::mmap_populate, true);
+		index_samples = ok ? reinterpret_cast<const uint64*>(idx_mapping.Data() + KMC_INDEX_HEADER_SIZE) : nullptr;	//mapping is page aligned
+	}
+
+	// spot check of samples against *.kmc_suf
+	for (uint64 i = 0; ok && i < MIN(n_samples, KMC_INDEX_N_CHECKED_SAMPLES); ++i)
+	{
+		uint64 sample_id = i * n_samples / MIN(n_samples, KMC_INDEX_N_CHECKED_SAMPLES);
+		ok = index_samples[sample_id] == sufix_key(sufix_file_buf + sample_id * step * sufix_rec_size);
+	}
+
+	if (ok)
+	{
+		index_n_samples = n_samples;
+		index_step = step;
+	}
+	else
+	{
+		index_samples = nullptr;
+		std::vector<uint64>().swap(index_buf);
+	}
+}
+
+//---------------------------------------------------------------------------------
+// Fingerprint of a database stored in its secondary index, so an index of a different database is not used
+// even if the numbers of k-mers are the same. It is bounded (does not depend on the size of the database):
+// parameters of the database, exact sizes of *.kmc_pre and *.kmc_suf and a fixed number of words of
+// *.kmc_pre (LUT) sampled evenly. Samples of the index are also spot checked against *.kmc_suf (see LoadIndex)
+// IN	: file_name		- the name of kmer_counter's output
+// OUT	: suf_size		- size of *.kmc_suf
+//		  fingerprint	- hash of the above
+// RET	: true if successful
+//---------------------------------------------------------------------------------
+bool CKMCFile::DbFingerprint(const std::string& file_name, uint64& suf_size, uint64& fingerprint) const
+{
+	FILE* file = my_fopen((file_name + ".kmc_suf").c_str(), "rb");
+	if (!file)
+		return false;
+	my_fseek(file, 0, SEEK_END);
+	suf_size = my_ftell(file);
+	fclose(file);
+
+	file = my_fopen((file_name + ".kmc_pre").c_str(), "rb");
+	if (!file)
+		return false;
+	my_fseek(file, 0, SEEK_END);
+	uint64 pre_size = my_ftell(file);
+
+	fingerprint = 0;
+	auto add = [&fingerprint](uint64 x) {
+		x = (fingerprint ^ x) * 0xff51afd7ed558ccdull;
+		fingerprint = x ^ (x >> 32);
+	};
+	add(kmc_version);
+	add(kmer_length);
+	add(lut_prefix_length);
+	add(counter_size);
+	add(total_kmers);
+	add(original_min_count);
+	add(original_max_count);
+	add(pre_size);
+	add(suf_size);
+
+	bool ok = pre_size >= 4 + sizeof(uint64);
+	for (uint64 i = 0; ok && i < KMC_INDEX_N_FINGERPRINT_WORDS; ++i)
+	{
+		uint64 word = 0;
+		ok = my_fseek(file, 4 + i * (pre_size - 4 - sizeof(uint64)) / (KMC_INDEX_N_FINGERPRINT_WORDS - 1), SEEK_SET) == 0 &&
+			fread(&word, 1, sizeof(uint64), file) == sizeof(uint64);
+		add(word);
+	}
+	fclose(file);
+	return ok;
+}
+
+//---------------------------------------------------------------------------------
+// Build the secondary index (*.kmc_idx) of a database
+// IN	: file_name		- the name of kmer_counter's output
+//		  sample_step	- every sample_step-th record of *.kmc_suf is sampled
+// RET	: true if successful
+//---------------------------------------------------------------------------------
+bool CKMCFile::BuildIndex(const std::string& file_name, uint32 sample_step)
+{
+	if (sample_step == 0)
+		return false;
+
+	CKMCFile db;
+	if (!db.OpenForRA(file_name, ra_mode::mmap) || db.IsCompressed())
+		return false;
+
+	uint64 suf_size, fingerprint;
+	if (!db.DbFingerprint(file_name, suf_size, fingerprint))
+		return false;
+
+	FILE* file = my_fopen((file_name + ".kmc_idx").c_str(), "wb");
+	if (!file)
+		return false;
+
+	uint32 key_bytes = MIN(db.sufix_size, (uint32)sizeof(uint64));
+	uint64 n_samples = (db.total_kmers + sample_step - 1) / sample_step;
+
+	uchar header[KMC_INDEX_HEADER_SIZE];
+	memcpy(header, "KMCI", 4);
+	memcpy(header + 4, &KMC_INDEX_VERSION, 4);
+	memcpy(header + 8, &sample_step, 4);
+	memcpy(header + 12, &key_bytes, 4);
+	memcpy(header + 16, &db.total_kmers, 8);
+	memcpy(header + 24, &n_samples, 8);
+	memcpy(header + 32, &suf_size, 8);
+	memcpy(header + 40, &fingerprint, 8);
+	bool ok = fwrite(header, 1, KMC_INDEX_HEADER_SIZE, file) == KMC_INDEX_HEADER_SIZE;
+
+	std::vector<uint64> buf;
+	buf.reserve(1 << 16);
+	for (uint64 i = 0; i < n_samples && ok; ++i)
+	{
+		buf.push_back(db.sufix_key(db.sufix_file_buf + i * sample_step * db.sufix_rec_size));
+		if (buf.size() == buf.capacity() || i + 1 == n_samples)
+		{
+			ok = fwrite(buf.data(), sizeof(uint64), buf.size(), file) == buf.size();
+			buf.clear();
 		}
-		//applay filtering only if counter_size != 0
-		return (counter_size == 0) || ((counter >= min_count) && (counter <= max_count));
 	}
-	return false;
+	ok = ok && fwrite("KMCI", 1, 4, file) == 4;
+	ok = fclose(file) == 0 && ok;
+	db.Close();
+	return ok;
+}
+
+
+//---------------------------------------------------------------------------------
+// Map a whole file read only
+// IN	: file_name		- the name of a file
+//		  populate		- load the whole file into the page cache now
+//		  random_access	- hint that the file will be accessed randomly (no read ahead)
+// RET	: true if successful
+//---------------------------------------------------------------------------------
+bool CKMCFile::CMappedFile::Open(const std::string& file_name, bool populate, bool random_access)
+{
+	Close();
+#ifdef _WIN32
+	HANDLE fh = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, random_access ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fh == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(fh, &file_size) || file_size.QuadPart == 0)
+	{
+		CloseHandle(fh);
+		return false;
+	}
+	HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mh)
+	{
+		CloseHandle(fh);
+		return false;
+	}
+	data = (uchar*)MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mh);
+		CloseHandle(fh);
+		return false;
+	}
+	file_handle = fh;
+	mapping_handle = mh;
+	size = file_size.QuadPart;
+	if (populate)
+	{
+		volatile uchar sum = 0;
+		for (uint64 i = 0; i < size; i += 4096)
+			sum += data[i];
+	}
+#else
+	int fd = open(file_name.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+	int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+	if (populate)
+		flags |= MAP_POPULATE;
+#endif
+	void* ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+	close(fd);
+	if (ptr == MAP_FAILED)
+		return false;
+	data = (uchar*)ptr;
+	size = st.st_size;
+	if (populate)
+		madvise(ptr, (size_t)size, MADV_WILLNEED);
+	else if (random_access)
+		madvise(ptr, (size_t)size, MADV_RANDOM);
+#endif
+	return true;
+}
+
+//---------------------------------------------------------------------------------
+void CKMCFile::CMappedFile::Close()
+{
+	if (!data)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)mapping_handle);
+	CloseHandle((HANDLE)file_handle);
+	mapping_handle = file_handle = nullptr;
+#else
+	munmap(data, (size_t)size);
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+//---------------------------------------------------------------------------------
+// CKMCQuery
+//---------------------------------------------------------------------------------
+CKMCQuery::CKMCQuery(const CKMCFile& _kmc_file) : kmc_file(_kmc_file)
+{
+	state.filter = kmc_file.current_filter();
+}
+
+//----------------------------------------------------------------------------------------
+// Set the minimal value for a counter. Kmers with counters below this theshold are ignored
+// IN	: x - minimal value for a counter
+// RET	: true - if successful
+//----------------------------------------------------------------------------------------
+bool CKMCQuery::SetMinCount(uint32 x)
+{
+	if ((kmc_file.original_min_count <= x) && (x <= state.filter.max_count))
+	{
+		state.filter.min_count = x;
+		return true;
+	}
+	else
+		return false;
+}
+
+//----------------------------------------------------------------------------------------
+// Set the maximal value for a counter. Kmers with counters above this theshold are ignored
+// IN	: x - maximal value for a counter
+// RET	: true - if successful
+//----------------------------------------------------------------------------------------
+bool CKMCQuery::SetMaxCount(uint32 x)
+{
+	if ((kmc_file.original_max_count >= x) && (x >= state.filter.min_count))
+	{
+		state.filter.max_count = x;
+		return true;
+	}
+	else
+		return false;
+}
+
+//------------------------------------------------------------------------------------------
+// Check if kmer exists. 
+// IN : kmer  - kmer
+// OUT: count - kmer's counter if kmer exists
+// RET: true  - if kmer exists
+//------------------------------------------------------------------------------------------
+bool CKMCQuery::CheckKmer(const CKmerAPI& kmer, uint64& count) const
+{
+	return kmc_file.CheckKmer(kmer, count, state.filter);
+}
+
+//------------------------------------------------------------------------------------------
+// Check if kmer exists
+// IN : kmer - kmer
+// RET: true - if kmer exists
+//------------------------------------------------------------------------------------------
+bool CKMCQuery::IsKmer(const CKmerAPI& kmer) const
+{
+	uint64 count;
+	return kmc_file.CheckKmer(kmer, count, state.filter);
 }
 
+//------------------------------------------------------------------------------------------
+// Check a batch of kmers.
+// IN : kmers  - an array of kmers
+//		n      - the number of kmers
+// OUT: counts - counts[i] is the kmer's counter if kmers[i] exists, 0 otherwise
+// RET: true   - if the database is opened for random access
+//------------------------------------------------------------------------------------------
+bool CKMCQuery::CheckKmers(const CKmerAPI* kmers, uint64 n, uint64* counts) const
+{
+	return kmc_file.CheckKmers(kmers, n, counts, state.filter);
+}
+
+//------------------------------------------------------------------------------------------
+// Check a batch of kmers.
+// IN : kmers  - kmers
+// OUT: counts - counts[i] is the kmer's counter if kmers[i] exists, 0 otherwise
+// RET: true   - if the database is opened for random access
+//------------------------------------------------------------------------------------------
+bool CKMCQuery::CheckKmers(const std::vector<CKmerAPI>& kmers, std::vector<uint64>& counts) const
+{
+	counts.resize(kmers.size());
+	return kmc_file.CheckKmers(kmers.data(), kmers.size(), counts.data(), state.filter);
+}
+
+//---------------------------------------------------------------------------------
+// Get counters from read
+// IN   :   read			- 
+// OUT	:	counters    	- vector of counters of each k-mer in read
+// RET	:   true if success, false if k > read length or some failure 
+//---------------------------------------------------------------------------------
+bool CKMCQuery::GetCountersForRead(const std::string& read, std::vector<uint32>& counters)
+{
+	return kmc_file.GetCountersForRead(read, counters, state);
+}
 
 // ***** EOF
@@ -13,10 +13,14 @@
 
 #include "kmer_defs.h"
 #include "kmer_api.h"
+#include "elias_fano.h"
+#include "compressed_suffixes.h"
 #include <string>
 #include <vector>
 #include <memory>
 #include <cassert>
+#include <cstring>
+#include <tuple>
 
 struct CKMCFileInfo
 {
@@ -33,6 +37,31 @@ struct CKMCFileInfo
 
 class CKMCFile
 {
+public:
+	// How the database is loaded by OpenForRA
+	// read          - both files are read into private memory
+	// mmap          - both files are memory mapped (read only, the page cache is shared between processes)
+	// mmap_populate - as mmap, but the whole files are loaded into the page cache when opening
+	enum class ra_mode { read, mmap, mmap_populate };
+
+private:
+	// Read only memory mapping of a whole file
+	class CMappedFile
+	{
+		uchar* data = nullptr;
+		uint64 size = 0;
+#ifdef _WIN32
+		void* file_handle = nullptr;
+		void* mapping_handle = nullptr;
+#endif
+	public:
+		bool Open(const std::string& file_name, bool populate, bool random_access);
+		void Close();
+		const uchar* Data() const noexcept { return data; }
+		uint64 Size() const noexcept { return size; }
+		~CMappedFile() { Close(); }
+	};
+
 	class CPrefixFileBufferForListingMode
 	{
 		const uint64_t buffCapacity = 1 << 22;
@@ -41,8 +70,10 @@ class CKMCFile
 		uint64_t buffSize{};
 		uint64_t posInBuf{};
 		uint64_t leftToRead{};
+		uint64_t wholeLutSize;
 		uint64 prefixMask; //for kmc2 db
 		FILE* file;
+		const CEliasFano* lutEF;	//for kmc2 db with Elias-Fano encoded LUT, values are decoded instead of read from file
 		bool isKMC1 = false;
 		uint64_t totalKmers; //for
 
@@ -51,26 +82,46 @@ class CKMCFile
 			assert(leftToRead);
 			buffPosInFile += buffSize;
 			buffSize = (std::min)(buffCapacity, leftToRead);
-			auto readed = fread(buff, 1, 8 * buffSize, file);
-			assert(readed == 8 * buffSize);
+			if (lutEF)
+				lutEF->Decode(buffPosInFile + 1, buffSize, buff);
+			else
+			{
+				auto readed = fread(buff, 1, 8 * buffSize, file);
+				assert(readed == 8 * buffSize);
+			}
 
-			if (isKMC1 && buffSize == leftToRead) //last read, in case of KMC1 guard must be added, fread will read `k` from db instead of guard, fixes #180
+			if (isKMC1 && buffSize == leftToRead && buffPosInFile + buffSize == wholeLutSize) //last read, in case of KMC1 guard must be added, fread will read `k` from db instead of guard, fixes #180
 				buff[buffSize - 1] = totalKmers;
 
 			leftToRead -= buffSize;
 			posInBuf = 0;
 		}
 	public:
-		CPrefixFileBufferForListingMode(FILE* file, uint64_t wholeLutSize, uint64_t lutPrefixLen, bool isKMC1, uint64_t totalKmers)
+		CPrefixFileBufferForListingMode(FILE* file, uint64_t wholeLutSize, uint64_t lutPrefixLen, bool isKMC1, uint64_t totalKmers, const CEliasFano* lutEF = nullptr)
 			:
 			buff(new uint64_t[buffCapacity]),
-			leftToRead(wholeLutSize),
+			wholeLutSize(wholeLutSize),
 			prefixMask((1ull << (2 * lutPrefixLen)) - 1),
 			file(file),
+			lutEF(lutEF),
 			isKMC1(isKMC1),
 			totalKmers(totalKmers)
 		{
-			my_fseek(file, 4 + 8, SEEK_SET); //	skip KMCP and LUT[0] (always = 0)
+			SeekToLutIndex(0, wholeLutSize);
+		}
+
+		uint64_t LutSize() const { return wholeLutSize; }
+
+		// Start listing from the suffix LUT[lutIndex], LUT is read only up to endLutIndex (the end of a listed part),
+		// so listing of a small part does not read the rest of LUT
+		void SeekToLutIndex(uint64_t lutIndex, uint64_t endLutIndex)
+		{
+			if (!lutEF)
+				my_fseek(file, 4 + 8 * (lutIndex + 1), SEEK_SET); //	skip KMCP and LUT[0..lutIndex]
+			buffPosInFile = lutIndex;
+			buffSize = 0;
+			posInBuf = 0;
+			leftToRead = (std::min)(endLutIndex, wholeLutSize) - lutIndex;
 		}
 
 		//no control if next prefix exists here, responsibility to the caller
@@ -95,10 +146,44 @@ class CKMCFile
 		}
 	};
 protected:
+	friend class CKMCQuery;
+
+	// Counter thresholds of queries in random access mode
+	struct counter_filter_t
+	{
+		uint32 min_count;
+		uint64 max_count;
+	};
+
+	using super_kmers_t = std::vector<std::tuple<uint32, uint32, uint32>>;//start_pos, len, bin_no
+
+	// Lookup of a single sufix: range of records of *.kmc_suf to search and an id of the sufix
+	struct lookup_t
+	{
+		int64 index_start, index_stop;
+		uint64 id;
+	};
+
+	// State of a query handle: counter thresholds and buffers reused by GetCountersForRead
+	struct query_state_t
+	{
+		counter_filter_t filter;
+		std::string codes;
+		super_kmers_t super_kmers;
+		std::vector<lookup_t> lookups;
+		std::vector<uchar> patterns;
+		std::vector<uint64> counts;
+		CKmerAPI kmer, rev_kmer;
+	};
+
 	enum open_mode {closed, opened_for_RA, opened_for_listing};
 	open_mode is_opened;
 	uint64 suf_file_left_to_read = 0; // number of bytes that are yet to read in a listing mode
-	uint64 suffix_file_total_to_read = 0; // number of bytes that constitutes records in kmc_suf file
+	uint64 suffix_file_total_to_read = 0; // number of bytes that constitutes records in kmc_suf file (in the listed range)
+	uint64 listing_first_lut = 0;	// LUT index of the first listed k-mer, for listing mode
+	uint64 listing_end_lut = 0;		// LUT index of the first k-mer after the listed ones, for listing mode
+	uint64 listing_first_kmer = 0;	// The range of listed k-mers [listing_first_kmer, listing_end_kmer), for listing mode
+	uint64 listing_end_kmer = 0;
 	bool end_of_file;
 
 	FILE *file_pre;
@@ -106,6 +191,20 @@ protected:
 
 	uint64* prefix_file_buf; //only for random access mode
 	uint64 prefix_file_buf_size; //only for random access mode
+	const uchar* prefix_lut;	//only for random access mode, LUT in prefix_file_buf or in mapped *.kmc_pre (may be unaligned)
+	CEliasFano lut_ef;			//LUT of a database in version 0x201 or 0x203 (in both modes), prefix_file_buf and prefix_lut are not used then
+	CCompressedSuffixes compressed_sufixes;		//compressed *.kmc_suf of a database in version 0x202 or 0x203, for random access mode
+	std::unique_ptr<CCompressedSuffixReader> compressed_sufix_reader;	//for listing mode
+	ra_mode ra_open_mode = ra_mode::read;
+	CMappedFile pre_mapping;
+	CMappedFile suf_mapping;
+
+	// Secondary index (*.kmc_idx): keys (the first bytes of sufixes) of every index_step-th record of *.kmc_suf
+	const uint64* index_samples = nullptr;	//only for random access mode, nullptr if there is no index
+	uint64 index_n_samples = 0;
+	uint32 index_step = 0;
+	std::vector<uint64> index_buf;
+	CMappedFile idx_mapping;
 	std::unique_ptr<CPrefixFileBufferForListingMode> prefixFileBufferForListingMode;
 
 	uint64 prefix_index;			// The current prefix's index in an array "prefix_file_buf", readed from *.kmc_pre
@@ -136,8 +235,88 @@ protected:
 	uint64 original_max_count;
 
 	static uint64 part_size; // the size of a block readed to sufix_file_buf, in listing mode 
+
+	// Value of LUT in random access mode, the last element is a guard
+	inline uint64 lut_value(uint64 index) const
+	{
+		if (index == prefix_file_buf_size - 1)
+			return total_kmers + 1;
+		if (IsLutEliasFano())
+			return lut_ef.Get(index);
+		uint64 value;
+		memcpy(&value, prefix_lut + index * sizeof(uint64), sizeof(uint64));
+		return value;
+	}
+
+	// Values LUT[index] and LUT[index + 1] in random access mode, Elias-Fano encoded LUT is decoded at once
+	inline void lut_range(uint64 index, uint64& first, uint64& second) const
+	{
+		if (IsLutEliasFano() && index + 2 < prefix_file_buf_size)
+		{
+			lut_ef.GetPair(index, first, second);
+			return;
+		}
+		first = lut_value(index);
+		second = lut_value(index + 1);
+	}
 	
-	bool BinarySearch(int64 index_start, int64 index_stop, const CKmerAPI& kmer, uint64& counter, uint32 pattern_offset);
+	inline counter_filter_t current_filter() const
+	{
+		return { min_count, max_count };
+	}
+
+	// Filtering is applied only if counter_size != 0
+	inline bool passes_filter(uint64 counter, const counter_filter_t& filter) const
+	{
+		return counter_size == 0 || (counter >= filter.min_count && counter <= filter.max_count);
+	}
+
+	// Counter stored after the sufix of a record in *.kmc_suf
+	inline uint64 counter_value(const uchar* counter_ptr) const
+	{
+		uint64 counter = 0;
+		for (uint32 b = 0; b < counter_size; b++)
+			counter |= (uint64)counter_ptr[b] << (8 * b);
+		return counter;
+	}
+
+	// Key of a sufix used in the secondary index: its first (at most 8) bytes, the first byte is the most significant
+	inline uint64 sufix_key(const uchar* sufix) const
+	{
+		uint64 key = 0;
+		for (uint32 a = 0; a < sufix_size && a < sizeof(key); ++a)
+			key |= (uint64)sufix[a] << (56 - 8 * a);
+		return key;
+	}
+
+	uint64 sufix_key(const CKmerAPI& kmer) const;
+
+	// Narrow a range of records that may contain a sufix of a given key using the secondary index
+	void NarrowRange(uint64 key, int64& index_start, int64& index_stop) const;
+	bool GetSamplesInRange(int64 index_start, int64 index_stop, uint64& first, uint64& last) const;
+	void NarrowRangeAt(uint64 key, uint64 lo, uint64 first, uint64 last, int64& index_start, int64& index_stop) const;
+
+	// Load *.kmc_idx if it exists and matches the database. Auxiliary function.
+	void LoadIndex(const std::string& file_name);
+	bool DbFingerprint(const std::string& file_name, uint64& suf_size, uint64& fingerprint) const;
+
+	bool BinarySearch(int64 index_start, int64 index_stop, const CKmerAPI& kmer, uint64& counter, uint32 pattern_offset, const counter_filter_t& filter) const;
+
+	// Range of records of *.kmc_suf that may contain a kmer, returns false if there is no such record
+	bool GetKmerRange(const CKmerAPI& kmer, int64& index_start, int64& index_stop) const;
+
+	// As above, for kmc2 database format when the bin of a kmer is known
+	bool GetKmerRange(const CKmerAPI& kmer, uint64 bin_start_pos, int64& index_start, int64& index_stop) const;
+
+	void GetSufixPattern(const CKmerAPI& kmer, uchar* pattern) const;
+
+	// Binary searches of many sufixes interleaved with prefetching
+	void InterleavedSearch(const lookup_t* lookups, uint64 n, const uchar* patterns, uint64* counts, const counter_filter_t& filter) const;
+
+	// Implementations of queries in random access mode, they do not modify the object
+	bool CheckKmer(const CKmerAPI& kmer, uint64& count, const counter_filter_t& filter) const;
+	bool CheckKmers(const CKmerAPI* kmers, uint64 n, uint64* counts, const counter_filter_t& filter) const;
+	bool GetCountersForRead(const std::string& read, std::vector<uint32>& counters, query_state_t& state) const;
 
 	// Open a file, recognize its size and check its marker. Auxiliary function.
 	bool OpenASingleFile(const std::string &file_name, FILE *&file_handler, uint64 &size, char marker[]);	
@@ -145,23 +324,31 @@ protected:
 	// Recognize current parameters. Auxiliary function.
 	bool ReadParamsFrom_prefix_file_buf(uint64 &size, open_mode _open_mode);
 
+	// Value of LUT read from *.kmc_pre in listing mode. Auxiliary function.
+	uint64 ReadListingLutValue(uint64 index);
+
+	// The first LUT index and the first k-mer of a part of a database in listing mode. Auxiliary function.
+	void GetListingPartStart(uint32 part_id, uint32 n_parts, uint64& lut_index, uint64& kmer_index);
+
+	// Set initial values to list k-mers from the beginning of the listed range. Auxiliary function.
+	bool StartListing();
+
 	// Reload a contents of an array "sufix_file_buf" for listing mode. Auxiliary function. 
 	void Reload_sufix_file_buf();
 
+	// Read size bytes of records of *.kmc_suf (decoded if it is compressed) to "sufix_file_buf", for listing mode. Auxiliary function.
+	uint64 ReadSufixes(uint64 size);
+
 	// Implementation of GetCountersForRead for kmc1 database format for both strands
-	bool GetCountersForRead_kmc1_both_strands(const std::string& read, std::vector<uint32>& counters);
+	bool GetCountersForRead_kmc1_both_strands(const std::string& read, std::vector<uint32>& counters, const counter_filter_t& filter) const;
 
 	// Implementation of GetCountersForRead for kmc1 database format without choosing canonical k-mer
-	bool GetCountersForRead_kmc1(const std::string& read, std::vector<uint32>& counters);		
+	bool GetCountersForRead_kmc1(const std::string& read, std::vector<uint32>& counters, const counter_filter_t& filter) const;
 
-	using super_kmers_t = std::vector<std::tuple<uint32, uint32, uint32>>;//start_pos, len, bin_no
-	void GetSuperKmers(const std::string& transformed_read, super_kmers_t& super_kmers);
+	void GetSuperKmers(const std::string& transformed_read, super_kmers_t& super_kmers) const;
 
-	// Implementation of GetCountersForRead for kmc2 database format for both strands
-	bool GetCountersForRead_kmc2_both_strands(const std::string& read, std::vector<uint32>& counters);
-
-	// Implementation of GetCountersForRead for kmc2 database format
-	bool GetCountersForRead_kmc2(const std::string& read, std::vector<uint32>& counters);
+	// Implementation of GetCountersForRead for kmc2 database format (for both strands if canonical)
+	bool GetCountersForRead_kmc2(const std::string& read, std::vector<uint32>& counters, bool canonical, query_state_t& state) const;
 public:
 		
 	CKMCFile();
@@ -170,16 +357,36 @@ public:
 	// Open files *.kmc_pre & *.kmc_suf, read them to RAM, close files. *.kmc_suf is opened for random access
 	bool OpenForRA(const std::string &file_name);
 
+	// Open files *.kmc_pre & *.kmc_suf for random access, mode selects whether files are read or memory mapped
+	bool OpenForRA(const std::string &file_name, ra_mode mode);
+
 	// Open files *kmc_pre & *.kmc_suf, read *.kmc_pre to RAM, *.kmc_suf is buffered
 	bool OpenForListing(const std::string& file_name);
 
+	// Open a database for listing of only a part (part_id = 0, ..., n_parts - 1) of its k-mers.
+	// Parts are disjoint ranges of k-mers of similar sizes (split at LUT boundaries), so n_parts
+	// objects may list a whole database in parallel, each with its own buffers.
+	// K-mers of each part are listed in the same order as by OpenForListing
+	bool OpenForListing(const std::string& file_name, uint32 part_id, uint32 n_parts);
+
 	// Return true if kmc is in KMC2 compatiblie format
-	bool IsKMC2() const noexcept { return kmc_version == 0x200; }
+	bool IsKMC2() const noexcept { return kmc_version >= 0x200 && kmc_version <= 0x203; }
+
+	// Return true if LUT is Elias-Fano encoded (database versions 0x201 and 0x203)
+	bool IsLutEliasFano() const noexcept { return IsKMC2() && (kmc_version & 0x1); }
+
+	// Return true if *.kmc_suf is compressed (database versions 0x202 and 0x203)
+	bool IsCompressed() const noexcept { return IsKMC2() && (kmc_version & 0x2); }
 
 	// Return next kmer in CKmerAPI &kmer. Return its counter in uint64 &count. Return true if not EOF
 	bool ReadNextKmer(CKmerAPI &kmer, uint64 &count); //for small k-values when counter may be longer than 4bytes
 	
 	bool ReadNextKmer(CKmerAPI &kmer, uint32 &count);
+
+	// Read at most max next kmers and their counters at once, return the number of kmers read (0 if EOF).
+	// Each kmer takes (kmer_length + 31) / 32 words of packed_kmers, in the representation of CKmerAPI::to_long
+	uint64 ReadNextKmers(uint64* packed_kmers, uint64* counts, uint64 max);
+
 	// Release memory and close files in case they were opened 
 	bool Close();
 
@@ -198,7 +405,7 @@ public:
 	//Return true if kmc was run without -b switch.
 	bool GetBothStrands(void);
 
-	// Return the total number of kmers between min_count and max_count
+	// Return the total number of kmers between min_count and max_count (in the listed part in listing mode)
 	uint64 KmerCount(void);
 
 	// Return the length of kmers
@@ -215,6 +422,19 @@ public:
 
 	bool CheckKmer(CKmerAPI &kmer, uint64 &count);
 
+	// Build a secondary index (*.kmc_idx) of the database, it is used by OpenForRA automatically to speed up
+	// CheckKmer, CheckKmers and GetCountersForRead. Every sample_step-th record of *.kmc_suf is sampled
+	static bool BuildIndex(const std::string& file_name, uint32 sample_step = 16);
+
+	// Return true if the database opened for random access uses a secondary index
+	bool HasIndex() const noexcept { return index_samples != nullptr; }
+
+	// Check a batch of kmers at once, counts[i] is a counter of kmers[i] or 0 if it does not exist
+	// Lookups are sorted and several binary searches are performed in an interleaved manner, so it is much faster than n calls of CheckKmer
+	bool CheckKmers(const CKmerAPI* kmers, uint64 n, uint64* counts);
+
+	bool CheckKmers(const std::vector<CKmerAPI>& kmers, std::vector<uint64>& counts);
+
 	// Return true if kmer exists
 	bool IsKmer(CKmerAPI &kmer);
 
@@ -230,8 +450,47 @@ public:
 	// Get counters for all k-mers in read
 	bool GetCountersForRead(const std::string& read, std::vector<uint32>& counters);
 	private:
-		uint32 count_for_kmer_kmc1(CKmerAPI& kmer);
-		uint32 count_for_kmer_kmc2(CKmerAPI& kmer, uint32 bin_start_pos);
+		uint32 count_for_kmer_kmc1(CKmerAPI& kmer, const counter_filter_t& filter) const;
+};
+
+//************************************************************************************************************
+// CKMCQuery - lightweight query handle of a database opened for random access with CKMCFile.
+// Queries do not modify the CKMCFile, so any number of handles (e.g. one per thread) may query a single
+// loaded (or mapped) database concurrently, without locks and without copying the database.
+// Each handle has its own counter thresholds (initially copied from the CKMCFile) and buffers,
+// so a single handle must not be used by many threads at once.
+// The CKMCFile must stay opened (and its thresholds must not be changed) while handles are in use.
+//************************************************************************************************************
+class CKMCQuery
+{
+	const CKMCFile& kmc_file;
+	CKMCFile::query_state_t state;
+public:
+	explicit CKMCQuery(const CKMCFile& kmc_file);
+
+	// Set the minimal value for a counter. Kmers with counters below this theshold are ignored
+	bool SetMinCount(uint32 x);
+
+	uint32 GetMinCount() const noexcept { return state.filter.min_count; }
+
+	// Set the maximal value for a counter. Kmers with counters above this theshold are ignored
+	bool SetMaxCount(uint32 x);
+
+	uint64 GetMaxCount() const noexcept { return state.filter.max_count; }
+
+	// Return true if kmer exists. In this case return kmer's counter in count
+	bool CheckKmer(const CKmerAPI& kmer, uint64& count) const;
+
+	// Return true if kmer exists
+	bool IsKmer(const CKmerAPI& kmer) const;
+
+	// Check a batch of kmers at once, counts[i] is a counter of kmers[i] or 0 if it does not exist
+	bool CheckKmers(const CKmerAPI* kmers, uint64 n, uint64* counts) const;
+
+	bool CheckKmers(const std::vector<CKmerAPI>& kmers, std::vector<uint64>& counts) const;
+
+	// Get counters for all k-mers in read
+	bool GetCountersForRead(const std::string& read, std::vector<uint32>& counters);
 };
 
 #endif
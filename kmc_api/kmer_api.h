@@ -412,7 +412,7 @@ public:
 	// IN	: pos - a position of a symbol
 	// RET	: symbol - a symbol placed on a position pos
 	//-----------------------------------------------------------------------
-	inline uchar get_num_symbol(unsigned int pos)
+	inline uchar get_num_symbol(unsigned int pos) const
 	{
 		if (pos >= kmer_length)
 			return 0;
@@ -469,6 +469,21 @@ public:
 		}
 	}
 
+	//-----------------------------------------------------------------------
+	// Set kmer from its representation of to_long (no_of_rows words, the most significant first)
+	// IN	: kmer - words of kmer
+	//-----------------------------------------------------------------------
+	inline void from_long(const uint64* kmer)
+	{
+		uint32 offset = 62 - ((kmer_length - 1 + byte_alignment) & 31) * 2;
+		for (uint32 i = 0; i < no_of_rows; ++i)
+		{
+			kmer_data[i] = kmer[i] << offset;
+			if (offset && i + 1 < no_of_rows)
+				kmer_data[i] += kmer[i + 1] >> (64 - offset);
+		}
+	}
+
 	//-----------------------------------------------------------------------
 	// Convert kmer into string (an alphabet ACGT)
 	// OUT 	: str - string kmer
@@ -651,7 +666,7 @@ public:
 // IN	: sig_len	- the length of a signature
 // RET	: signature value
 //-----------------------------------------------------------------------
-	 uint32 get_signature(uint32 sig_len)
+	 uint32 get_signature(uint32 sig_len) const
 	 {
 		 uchar symb;
 		 CMmer cur_mmr(sig_len);
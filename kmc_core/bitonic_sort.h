@@ -0,0 +1,288 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _BITONIC_SORT_H
+#define _BITONIC_SORT_H
+
+#include "defs.h"
+#include "kmer.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define BITONIC_SORT_MIN_SIZE 8		//for smaller arrays insertion sort is faster
+#define BITONIC_SORT_MAX_SIZE 32
+
+//************************************************************************************************************
+// Bitonic sorting networks for tiny arrays of k-mers (at most BITONIC_SORT_MAX_SIZE elements)
+// Vectorized variants exist only for CKmer<1> and CKmer<2> and only in translation units compiled with AVX2 enabled,
+// for the remaining cases SortAVX2 returns false and the caller must use some other method
+//
+// The array (padded to 8, 16 or 32 elements with max. keys) is kept in R registers of 4 lanes (separately for each 64-bit word of a key),
+// element of (logical) index i = lane * R + reg, so the comparators of distance smaller than R are vertical min/max
+// operations and only comparators of distance R and 2R require lane permutations.
+// The initial order of elements is not important, so data are just loaded, and transposed only when stored
+//************************************************************************************************************
+namespace BitonicSort
+{
+	template<typename KMER_T>
+	inline bool SortAVX2(KMER_T* /*kmers*/, uint64 /*size*/)
+	{
+		return false;
+	}
+
+#if defined(__AVX2__)
+	// Single key in each of 4 lanes, w[W-1] is the most significant word
+	template<unsigned W> struct CVec
+	{
+		__m256i w[W];
+	};
+
+	// Keys are stored with flipped sign bits, so signed comparisons give the order of unsigned values
+	FORCE_INLINE __m256i greater(const CVec<1>& a, const CVec<1>& b)
+	{
+		return _mm256_cmpgt_epi64(a.w[0], b.w[0]);
+	}
+
+	FORCE_INLINE __m256i greater(const CVec<2>& a, const CVec<2>& b)
+	{
+		__m256i hi_gt = _mm256_cmpgt_epi64(a.w[1], b.w[1]);
+		__m256i hi_eq = _mm256_cmpeq_epi64(a.w[1], b.w[1]);
+		__m256i lo_gt = _mm256_cmpgt_epi64(a.w[0], b.w[0]);
+		return _mm256_or_si256(hi_gt, _mm256_and_si256(hi_eq, lo_gt));
+	}
+
+	// Exchange lanes of a and b where mask is set
+	template<unsigned W> FORCE_INLINE void swap_lanes(CVec<W>& a, CVec<W>& b, __m256i mask)
+	{
+		for (unsigned i = 0; i < W; ++i)
+		{
+			__m256i x = _mm256_blendv_epi8(a.w[i], b.w[i], mask);
+			b.w[i] = _mm256_blendv_epi8(b.w[i], a.w[i], mask);
+			a.w[i] = x;
+		}
+	}
+
+	template<int IMM, unsigned W> FORCE_INLINE CVec<W> permute(const CVec<W>& a)
+	{
+		CVec<W> r;
+		for (unsigned i = 0; i < W; ++i)
+			r.w[i] = _mm256_permute4x64_epi64(a.w[i], IMM);
+		return r;
+	}
+
+	// Vertical comparator: min goes to a, max goes to b
+	template<unsigned W> FORCE_INLINE void cmp_swap(CVec<W>& a, CVec<W>& b)
+	{
+		swap_lanes(a, b, greater(a, b));
+	}
+
+	// Comparator between lanes of a and lanes of b permuted by IMM (IMM must be an involution),
+	// hi_lanes are lanes of a of higher index than their partners
+	template<int IMM, unsigned W> FORCE_INLINE void cmp_swap_permuted(CVec<W>& a, CVec<W>& b, __m256i hi_lanes)
+	{
+		CVec<W> p = permute<IMM>(b);
+		swap_lanes(a, p, _mm256_xor_si256(greater(a, p), hi_lanes));
+		b = permute<IMM>(p);
+	}
+
+	// Comparator between lanes of the same register
+	template<int IMM, unsigned W> FORCE_INLINE void cmp_swap_in_reg(CVec<W>& a, __m256i hi_lanes)
+	{
+		CVec<W> p = permute<IMM>(a);
+		__m256i sel = _mm256_xor_si256(greater(a, p), hi_lanes);
+		for (unsigned i = 0; i < W; ++i)
+			a.w[i] = _mm256_blendv_epi8(a.w[i], p.w[i], sel);
+	}
+
+	//----------------------------------------------------------------------------------
+	// Sort 4 * R elements (all comparators are ascending, each merge starts with the "flip" comparators)
+	template<unsigned W, unsigned R> FORCE_INLINE void network(CVec<W>* v)
+	{
+		const __m256i lanes_odd = _mm256_set_epi64x(-1, 0, -1, 0);
+		const __m256i lanes_hi = _mm256_set_epi64x(-1, -1, 0, 0);
+
+		for (unsigned s = 2; s <= 4 * R; s <<= 1)
+		{
+			if (s <= R)
+			{
+				for (unsigned b = 0; b < R; b += s)
+					for (unsigned j = 0; j < s / 2; ++j)
+						cmp_swap(v[b + j], v[b + s - 1 - j]);
+			}
+			else if (s == 2 * R)
+			{
+				for (unsigned j = 0; j < R / 2; ++j)
+					cmp_swap_permuted<0xB1>(v[j], v[R - 1 - j], lanes_odd);
+			}
+			else
+			{
+				for (unsigned j = 0; j < R / 2; ++j)
+					cmp_swap_permuted<0x1B>(v[j], v[R - 1 - j], lanes_hi);
+			}
+
+			for (unsigned d = s / 4; d; d >>= 1)
+			{
+				if (d == 2 * R)
+				{
+					for (unsigned j = 0; j < R; ++j)
+						cmp_swap_in_reg<0x4E>(v[j], lanes_hi);
+				}
+				else if (d == R)
+				{
+					for (unsigned j = 0; j < R; ++j)
+						cmp_swap_in_reg<0xB1>(v[j], lanes_odd);
+				}
+				else
+				{
+					for (unsigned j = 0; j < R; ++j)
+						if (!(j & d))
+							cmp_swap(v[j], v[j + d]);
+				}
+			}
+		}
+	}
+
+	//----------------------------------------------------------------------------------
+	// Bring 4 registers of elements (r, l) to the order of positions 4 * l + r
+	FORCE_INLINE void transpose4(const __m256i* in, __m256i* out)
+	{
+		__m256i t0 = _mm256_unpacklo_epi64(in[0], in[1]);
+		__m256i t1 = _mm256_unpackhi_epi64(in[0], in[1]);
+		__m256i t2 = _mm256_unpacklo_epi64(in[2], in[3]);
+		__m256i t3 = _mm256_unpackhi_epi64(in[2], in[3]);
+		out[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+		out[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+		out[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+		out[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+	}
+
+	// Words of R registers in the order of logical indices
+	template<unsigned R> FORCE_INLINE void to_positions(const __m256i* in, __m256i* out);
+
+	template<> FORCE_INLINE void to_positions<2>(const __m256i* in, __m256i* out)
+	{
+		__m256i t0 = _mm256_unpacklo_epi64(in[0], in[1]);
+		__m256i t1 = _mm256_unpackhi_epi64(in[0], in[1]);
+		out[0] = _mm256_permute2x128_si256(t0, t1, 0x20);
+		out[1] = _mm256_permute2x128_si256(t0, t1, 0x31);
+	}
+
+	template<> FORCE_INLINE void to_positions<4>(const __m256i* in, __m256i* out)
+	{
+		transpose4(in, out);
+	}
+
+	template<> FORCE_INLINE void to_positions<8>(const __m256i* in, __m256i* out)
+	{
+		__m256i lo[4], hi[4];
+		transpose4(in, lo);
+		transpose4(in + 4, hi);
+		for (unsigned l = 0; l < 4; ++l)
+		{
+			out[2 * l] = lo[l];
+			out[2 * l + 1] = hi[l];
+		}
+	}
+
+	//----------------------------------------------------------------------------------
+	template<unsigned R> FORCE_INLINE void sort_words1(uint64* buf)
+	{
+		const __m256i sign = _mm256_set1_epi64x((int64)(1ull << 63));
+		CVec<1> v[R];
+		for (unsigned r = 0; r < R; ++r)
+			v[r].w[0] = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(buf + 4 * r)), sign);
+
+		network<1, R>(v);
+
+		__m256i in[R], out[R];
+		for (unsigned r = 0; r < R; ++r)
+			in[r] = _mm256_xor_si256(v[r].w[0], sign);
+		to_positions<R>(in, out);
+		for (unsigned r = 0; r < R; ++r)
+			_mm256_storeu_si256((__m256i*)(buf + 4 * r), out[r]);
+	}
+
+	template<unsigned R> FORCE_INLINE void sort_words2(uint64* buf)
+	{
+		const __m256i sign = _mm256_set1_epi64x((int64)(1ull << 63));
+		CVec<2> v[R];
+		for (unsigned r = 0; r < R; ++r)
+		{
+			__m256i x = _mm256_loadu_si256((const __m256i*)(buf + 8 * r));
+			__m256i y = _mm256_loadu_si256((const __m256i*)(buf + 8 * r + 4));
+			v[r].w[0] = _mm256_xor_si256(_mm256_unpacklo_epi64(x, y), sign);
+			v[r].w[1] = _mm256_xor_si256(_mm256_unpackhi_epi64(x, y), sign);
+		}
+
+		network<2, R>(v);
+
+		__m256i in_lo[R], in_hi[R], out_lo[R], out_hi[R];
+		for (unsigned r = 0; r < R; ++r)
+		{
+			in_lo[r] = _mm256_xor_si256(v[r].w[0], sign);
+			in_hi[r] = _mm256_xor_si256(v[r].w[1], sign);
+		}
+		to_positions<R>(in_lo, out_lo);
+		to_positions<R>(in_hi, out_hi);
+		for (unsigned r = 0; r < R; ++r)
+		{
+			__m256i a = _mm256_unpacklo_epi64(out_lo[r], out_hi[r]);
+			__m256i b = _mm256_unpackhi_epi64(out_lo[r], out_hi[r]);
+			_mm256_storeu_si256((__m256i*)(buf + 8 * r), _mm256_permute2x128_si256(a, b, 0x20));
+			_mm256_storeu_si256((__m256i*)(buf + 8 * r + 4), _mm256_permute2x128_si256(a, b, 0x31));
+		}
+	}
+
+	//----------------------------------------------------------------------------------
+	template<unsigned SIZE, unsigned N> FORCE_INLINE void sort_padded(CKmer<SIZE>* kmers, uint64 size)
+	{
+		alignas(32) uint64 buf[N * SIZE];
+		memcpy(buf, kmers, size * sizeof(CKmer<SIZE>));
+		std::fill(buf + size * SIZE, buf + N * SIZE, ~0ull);
+
+		if (SIZE == 1)
+			sort_words1<N / 4>(buf);
+		else
+			sort_words2<N / 4>(buf);
+
+		memcpy(kmers, buf, size * sizeof(CKmer<SIZE>));
+	}
+
+	template<unsigned SIZE> FORCE_INLINE bool sort_small(CKmer<SIZE>* kmers, uint64 size)
+	{
+		if (size > BITONIC_SORT_MAX_SIZE)
+			return false;
+		if (size <= 8)
+			sort_padded<SIZE, 8>(kmers, size);
+		else if (size <= 16)
+			sort_padded<SIZE, 16>(kmers, size);
+		else
+			sort_padded<SIZE, 32>(kmers, size);
+		return true;
+	}
+
+	inline bool SortAVX2(CKmer<1>* kmers, uint64 size)
+	{
+		return sort_small(kmers, size);
+	}
+
+	inline bool SortAVX2(CKmer<2>* kmers, uint64 size)
+	{
+		return sort_small(kmers, size);
+	}
+#endif
+}
+
+#endif
+
+// ***** EOF
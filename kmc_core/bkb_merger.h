@@ -11,31 +11,43 @@
 #ifndef _HBH_MERGER_H
 #define _HBH_MERGER_H
 #include "bkb_subbin.h"
+#include "loser_tree.h"
 
 
 //************************************************************************************************************
 // CBigKmerBinMerger - merger sorted k-mers from number of subbins 
+// The k-mer space of each big bin is split into ranges (using LUTs of subbins), ranges are merged concurrently
+// by all mergers and stored in order
 //************************************************************************************************************
 template<unsigned SIZE>
 class CBigKmerBinMerger
 {
 	std::vector<std::unique_ptr<CSubBin<SIZE>>> sub_bins;
-	std::vector<std::tuple<CKmer<SIZE>, uint32, uint32>> curr_min;
+	std::vector<FILE*> range_files;
+	CLoserTree<CKmer<SIZE>> curr_min;
+	std::vector<uint32> curr_count;
 	CDiskLogger* disk_logger;
-	uint32 size;
 	CBigBinDesc* bbd;
 	CBigBinKmerPartQueue* bbkpq;
+	CBigBinMergeRangesQueue* bbmrq;
 	CCompletedBinsCollector* sm_cbc;
 	uint32 kmer_len;
 	uint32 lut_prefix_len;	
+	uint32 n_mergers;
 	uint32 cutoff_min, cutoff_max, counter_max;
 	CMemoryPool* sm_pmm_merger_suff, *sm_pmm_merger_lut, *sm_pmm_sub_bin_suff, *sm_pmm_sub_bin_lut;
 	int64 sm_mem_part_merger_suff, sm_mem_part_merger_lut, sm_mem_part_sub_bin_suff, sm_mem_part_sub_bin_lut;
 	uchar *sub_bin_suff_buff, *sub_bin_lut_buff;
+	uint64 n_unique, n_cutoff_min, n_cutoff_max, n_total;
+
+	void prepare_sub_bins(uint32 size);
+	void split_bin(int32 bin_id);
+	void init_range(const CBigBinMergeRange& range);
+	bool get_min(CKmer<SIZE>& kmer, uint32& count);
+	void push_part(const CBigBinMergeRange& range, uchar* suff_buff, uint64 suff_buff_size, uchar* raw_lut, uint64 lut_size, bool last_in_range);
+	void process_range(const CBigBinMergeRange& range);
 public:
 	CBigKmerBinMerger(CKMCParams& Params, CKMCQueues& Queues);
-	void init(int32 bin_id, uint32 _size);
-	bool get_min(CKmer<SIZE>& kmer, uint32& count);
 	void Process();
 	~CBigKmerBinMerger();
 };
@@ -47,9 +59,11 @@ CBigKmerBinMerger<SIZE>::CBigKmerBinMerger(CKMCParams& Params, CKMCQueues& Queue
 	disk_logger = Queues.disk_logger.get();
 	bbd = Queues.bbd.get();
 	bbkpq = Queues.bbkpq.get();
+	bbmrq = Queues.bbmrq.get();
 	sm_cbc = Queues.sm_cbc.get();
 	kmer_len = Params.kmer_len;
 	lut_prefix_len = Params.lut_prefix_len;
+	n_mergers = Params.sm_n_mergers;
 	cutoff_min = Params.cutoff_min;
 	cutoff_max = (uint32)Params.cutoff_max;
 	counter_max = (uint32)Params.counter_max;
@@ -76,160 +90,274 @@ CBigKmerBinMerger<SIZE>::~CBigKmerBinMerger()
 
 //----------------------------------------------------------------------------------
 template<unsigned SIZE>
-void CBigKmerBinMerger<SIZE>::init(int32 bin_id, uint32 _size)
+void CBigKmerBinMerger<SIZE>::prepare_sub_bins(uint32 size)
 {
-	size = _size;
 	uint32 prev_size = (uint32)sub_bins.size();
-	int32 sub_bin_id;
 	if (size > prev_size)
 	{
 		sub_bins.resize(size);
-		curr_min.resize(size);
+		range_files.resize(size);
+		curr_count.resize(size);
 		for (uint32 i = prev_size; i < size; ++i)
 		{
-			sub_bins[i] = std::make_unique<CSubBin<SIZE>>(disk_logger);
+			sub_bins[i] = std::make_unique<CSubBin<SIZE>>();
 		}
 	}
+}
+
+//----------------------------------------------------------------------------------
+// Split k-mer space of the bin into ranges of part prefixes, each range should fit in a single output buffer
+template<unsigned SIZE>
+void CBigKmerBinMerger<SIZE>::split_bin(int32 bin_id)
+{
+	uint32 size = 0;
+	bbd->get_n_sub_bins(bin_id, size);
+	prepare_sub_bins(size);
+
+	auto bin = std::make_shared<CBigBinMergeDesc>();
+	bin->bin_id = bin_id;
+	bin->sub_bins.resize(size);
+
+	uint32 part_prefix_len = MIN(lut_prefix_len, (uint32)SM_MERGER_MAX_PART_PREFIX_LEN);
+	int32 sub_bin_id;
+	for (auto& sb : bin->sub_bins)
+	{
+		bbd->next_sub_bin(bin_id, sub_bin_id, sb.lut_prefix_len, sb.n_kmers, sb.file, sb.name, sb.file_size);
+		fflush(sb.file); //subbin will be read also by other mergers
+		part_prefix_len = MIN(part_prefix_len, sb.lut_prefix_len);
+	}
+	while (part_prefix_len && size * (1ull << 2 * part_prefix_len) > SM_MERGER_MAX_PART_CUMSUM_RECS)
+		--part_prefix_len;
+	bin->part_prefix_len = part_prefix_len;
 
-	uint32 lut_prefix_len = 0;;
+	uint64 n_parts = 1ull << 2 * part_prefix_len;
+	vector<uint64> part_kmers(n_parts, 0);
 	uint64 n_kmers = 0;
-	uint64 file_size = 0;
-	FILE* file = nullptr;
-	string name;
-	uint32 per_sub_bin_lut_size = (uint32)(sm_mem_part_sub_bin_lut / size);
+	for (auto& sb : bin->sub_bins)
+	{
+		sub_bins[0]->init(sb.file, sb.name, sb.lut_prefix_len, sb.n_kmers, kmer_len, sub_bin_lut_buff, (uint32)sm_mem_part_sub_bin_lut, sub_bin_suff_buff, sm_mem_part_sub_bin_suff);
+		sub_bins[0]->calc_part_cumsum(part_prefix_len, sb.part_cumsum);
+		for (uint64 i = 0; i < n_parts; ++i)
+			part_kmers[i] += sb.part_cumsum[i + 1] - sb.part_cumsum[i];
+		n_kmers += sb.n_kmers;
+	}
+
+	uint32 counter_size = calc_counter_size(cutoff_max, counter_max);
+	uint64 suff_rec_bytes = (kmer_len - lut_prefix_len) / 4 + counter_size;
+	uint64 max_range_kmers = MIN(sm_mem_part_merger_suff / suff_rec_bytes, n_kmers / n_mergers + 1);
+	uint64 max_range_parts = MAX((sm_mem_part_merger_lut / sizeof(uint64)) >> 2 * (lut_prefix_len - part_prefix_len), 1ull);
+
+	vector<CBigBinMergeRange> ranges;
+	uint64 range_start = 0;
+	uint64 range_kmers = 0;
+	for (uint64 i = 0; i < n_parts; ++i)
+	{
+		if (i > range_start && (range_kmers + part_kmers[i] > max_range_kmers || i - range_start >= max_range_parts))
+		{
+			ranges.push_back(CBigBinMergeRange{ bin, (uint32)ranges.size(), range_start, i });
+			range_start = i;
+			range_kmers = 0;
+		}
+		range_kmers += part_kmers[i];
+	}
+	ranges.push_back(CBigBinMergeRange{ bin, (uint32)ranges.size(), range_start, n_parts });
+	bin->n_ranges = (uint32)ranges.size();
+
+	bbmrq->push(ranges);
+}
+
+//----------------------------------------------------------------------------------
+template<unsigned SIZE>
+void CBigKmerBinMerger<SIZE>::init_range(const CBigBinMergeRange& range)
+{
+	auto& bin = *range.bin;
+	uint32 size = (uint32)bin.sub_bins.size();
+	prepare_sub_bins(size);
+
+	uint32 per_sub_bin_lut_size = (uint32)(sm_mem_part_sub_bin_lut / size / sizeof(uint64) * sizeof(uint64));
 	uint32 per_sub_bin_suff_size = (uint32)(sm_mem_part_sub_bin_suff / size);
+	CKmer<SIZE> kmer;
+	curr_min.init(size);
 	for (uint32 i = 0; i < size; ++i)
 	{
-		bbd->next_sub_bin(bin_id, sub_bin_id, lut_prefix_len, n_kmers, file, name, file_size);
-		sub_bins[i]->init(file, file_size, lut_prefix_len, n_kmers, name, kmer_len, sub_bin_lut_buff + i * per_sub_bin_lut_size, per_sub_bin_lut_size, sub_bin_suff_buff + i * per_sub_bin_suff_size, per_sub_bin_suff_size);
-		get<2>(curr_min[i]) = i;
-		sub_bins[i]->get_min(get<0>(curr_min[i]), get<1>(curr_min[i]));
+		auto& sb = bin.sub_bins[i];
+		range_files[i] = fopen(sb.name.c_str(), "rb");
+		if (!range_files[i])
+		{
+			std::ostringstream ostr;
+			ostr << "Error: can not open file : " << sb.name;
+			CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+		}
+		sub_bins[i]->init(range_files[i], sb.name, sb.lut_prefix_len, sb.n_kmers, kmer_len, sub_bin_lut_buff + i * per_sub_bin_lut_size, per_sub_bin_lut_size, sub_bin_suff_buff + i * per_sub_bin_suff_size, per_sub_bin_suff_size);
+		uint64 first_kmer = sb.part_cumsum[range.part_start];
+		sub_bins[i]->set_range(bin.part_prefix_len, range.part_start, range.part_end, first_kmer, sb.part_cumsum[range.part_end] - first_kmer);
+		if (sub_bins[i]->get_min(kmer, curr_count[i]))
+			curr_min.set(i, kmer);
 	}
+	curr_min.build();
 }
 
 //----------------------------------------------------------------------------------
 template<unsigned SIZE>
 bool CBigKmerBinMerger<SIZE>::get_min(CKmer<SIZE>& kmer, uint32& count)
 {
-	if (!size)
+	if (curr_min.empty())
 		return false;
-	uint32 min = 0;
-	for (uint32 i = 1; i < size; ++i)
-		if (get<0>(curr_min[i]) < get<0>(curr_min[min]))
-			min = i;
-
-	kmer = get<0>(curr_min[min]);
-	count = get<1>(curr_min[min]);
-	if (sub_bins[get<2>(curr_min[min])]->get_min(get<0>(curr_min[min]), get<1>(curr_min[min])))
-		;
+	uint32 min = curr_min.winner();
+
+	kmer = curr_min.winner_key();
+	count = curr_count[min];
+	CKmer<SIZE> next_kmer;
+	if (sub_bins[min]->get_min(next_kmer, curr_count[min]))
+		curr_min.replace_winner(next_kmer);
 	else
-		curr_min[min] = curr_min[--size];
+		curr_min.remove_winner();
 	return true;
 }
 
 //----------------------------------------------------------------------------------
+// Parts of the bin must be stored in order, so range waits until all previous ranges are stored
 template<unsigned SIZE>
-void CBigKmerBinMerger<SIZE>::Process()
+void CBigKmerBinMerger<SIZE>::push_part(const CBigBinMergeRange& range, uchar* suff_buff, uint64 suff_buff_size, uchar* raw_lut, uint64 lut_size, bool last_in_range)
 {
-	int32 bin_id;
-	uint32 size = 0;
+	auto& bin = *range.bin;
+	bbmrq->wait_for_turn(bin.bin_id, range.range_id);
+	if (last_in_range && range.range_id + 1 == bin.n_ranges)
+	{
+		uint64 prev_n_unique, prev_n_cutoff_min, prev_n_cutoff_max, prev_n_total;
+		bbmrq->get_stats(bin.bin_id, prev_n_unique, prev_n_cutoff_min, prev_n_cutoff_max, prev_n_total);
+		bbkpq->push(bin.bin_id, suff_buff, suff_buff_size, raw_lut, lut_size, prev_n_unique + n_unique, prev_n_cutoff_min + n_cutoff_min, 
+			prev_n_cutoff_max + n_cutoff_max, prev_n_total + n_total, true);
+	}
+	else
+		bbkpq->push(bin.bin_id, suff_buff, suff_buff_size, raw_lut, lut_size, 0, 0, 0, 0, false);
+}
+
+//----------------------------------------------------------------------------------
+template<unsigned SIZE>
+void CBigKmerBinMerger<SIZE>::process_range(const CBigBinMergeRange& range)
+{
+	auto& bin = *range.bin;
 	uint32 counter_size = calc_counter_size(cutoff_max, counter_max);
-	uint32 lut_recs = 1 << 2 * lut_prefix_len;
 	uint32 kmer_symbols = (kmer_len - lut_prefix_len);
 	uint32 kmer_bytes = kmer_symbols / 4;
 	uint32 suff_rec_bytes = kmer_bytes + counter_size;
 	uint64 suff_buff_size = sm_mem_part_merger_suff / suff_rec_bytes * suff_rec_bytes;
 	uint64 suff_buff_pos = 0;
-	uint64 n_unique, n_cutoff_min, n_cutoff_max, n_total;
 	CKmer<SIZE> kmer, next_kmer;
 	kmer.clear();
 	next_kmer.clear();
 	uint32 count_tmp = 0, count = 0;
-	int32 max_in_lut = (int32)(sm_mem_part_merger_lut / sizeof(uint64));
+	uint64 max_in_lut = sm_mem_part_merger_lut / sizeof(uint64);
+	uint32 lut_shl = 2 * (lut_prefix_len - bin.part_prefix_len);
+	uint64 lut_offset = range.part_start << lut_shl;
+	uint64 lut_end = range.part_end << lut_shl;
 
-	while (sm_cbc->pop(bin_id))
+	uchar *raw_lut;
+	sm_pmm_merger_lut->reserve(raw_lut);
+	uint64 *lut = (uint64*)raw_lut;
+	uchar* suff_buff;
+	sm_pmm_merger_suff->reserve(suff_buff);
+	n_unique = n_cutoff_min = n_cutoff_max = n_total = 0;
+	fill_n(lut, max_in_lut, 0);
+	init_range(range);
+
+	bool is_kmer = get_min(kmer, count_tmp);
+	count = count_tmp;
+	uint64 prefix;
+	while (is_kmer)
 	{
-		bbd->get_n_sub_bins(bin_id, size);
-		uchar *raw_lut;
-		sm_pmm_merger_lut->reserve(raw_lut);
-		uint64 *lut = (uint64*)raw_lut;
-		uchar* suff_buff;
-		sm_pmm_merger_suff->reserve(suff_buff);
-		suff_buff_pos = 0;
-		n_unique = n_cutoff_min = n_cutoff_max = n_total = 0;
-		fill_n(lut, max_in_lut, 0);
-		init(bin_id, size);
-
-		get_min(kmer, count_tmp);
-		count = count_tmp;
-		uint32 lut_offset = 0;
-		uint64 prefix;
-		while (get_min(next_kmer, count_tmp))
+		is_kmer = get_min(next_kmer, count_tmp);
+		if (is_kmer && kmer == next_kmer)
+			count += count_tmp;
+		else
 		{
-			if (kmer == next_kmer)
-				count += count_tmp;
+			++n_unique;
+			n_total += count;
+			if (count < cutoff_min)
+				n_cutoff_min++;
+			else if (count > cutoff_max)
+				n_cutoff_max++;
 			else
 			{
-				++n_unique;
-				n_total += count;
-				if (count < cutoff_min)
-					n_cutoff_min++;
-				else if (count > cutoff_max)
-					n_cutoff_max++;
-				else
+				if (count > counter_max)
+					count = counter_max;
+
+				//store
+				prefix = kmer.remove_suffix(2 * kmer_symbols);
+				while (prefix >= max_in_lut + lut_offset)
+				{
+					push_part(range, nullptr, 0, raw_lut, max_in_lut * sizeof(uint64), false);
+					lut_offset += max_in_lut;
+					sm_pmm_merger_lut->reserve(raw_lut);
+					lut = (uint64*)raw_lut;
+					fill_n(lut, max_in_lut, 0);
+				}
+
+				lut[prefix - lut_offset]++;
+
+				for (int32 j = (int32)kmer_bytes - 1; j >= 0; --j)
+					suff_buff[suff_buff_pos++] = kmer.get_byte(j);
+				for (int32 j = 0; j < (int32)counter_size; ++j)
+					suff_buff[suff_buff_pos++] = (count >> (j * 8)) & 0xFF;
+
+				if (suff_buff_pos >= suff_buff_size)
 				{
-					if (count > counter_max)
-						count = counter_max;
-
-					//store
-					prefix = kmer.remove_suffix(2 * kmer_symbols);
-					if (prefix >= max_in_lut + lut_offset)
-					{
-						bbkpq->push(bin_id, nullptr, 0, raw_lut, max_in_lut * sizeof(uint64), 0, 0, 0, 0, false);
-						lut_offset += max_in_lut;
-						sm_pmm_merger_lut->reserve(raw_lut);
-						lut = (uint64*)raw_lut;
-						fill_n(lut, max_in_lut, 0);
-					}
-
-					lut[prefix - lut_offset]++;
-
-					for (int32 j = (int32)kmer_bytes - 1; j >= 0; --j)
-						suff_buff[suff_buff_pos++] = kmer.get_byte(j);
-					for (int32 j = 0; j < (int32)counter_size; ++j)
-						suff_buff[suff_buff_pos++] = (count >> (j * 8)) & 0xFF;
-
-					if (suff_buff_pos >= suff_buff_size)
-					{
-						bbkpq->push(bin_id, suff_buff, suff_buff_pos, nullptr, 0, 0, 0, 0, 0, false);
-						suff_buff_pos = 0;
-						sm_pmm_merger_suff->reserve(suff_buff);
-					}
+					push_part(range, suff_buff, suff_buff_pos, nullptr, 0, false);
+					suff_buff_pos = 0;
+					sm_pmm_merger_suff->reserve(suff_buff);
 				}
-				count = count_tmp;
-				kmer = next_kmer;
 			}
+			count = count_tmp;
+			kmer = next_kmer;
 		}
-		++n_unique;
-		n_total += count;
-		if (count < cutoff_min)
-			++n_cutoff_min;
-		else if (count > cutoff_max)
-			++n_cutoff_max;
-		else
-		{
-			if (count > counter_max)
-				count = counter_max;
+	}
 
-			//store
-			lut[kmer.remove_suffix(2 * kmer_symbols)]++;
+	for (uint32 i = 0; i < bin.sub_bins.size(); ++i)
+		fclose(range_files[i]);
 
-			for (int32 j = (int32)kmer_bytes - 1; j >= 0; --j)
-				suff_buff[suff_buff_pos++] = kmer.get_byte(j);
-			for (int32 j = 0; j < (int32)counter_size; ++j)
-				suff_buff[suff_buff_pos++] = (count >> (j * 8)) & 0xFF;
+	while (lut_end - lut_offset > max_in_lut)
+	{
+		push_part(range, nullptr, 0, raw_lut, max_in_lut * sizeof(uint64), false);
+		lut_offset += max_in_lut;
+		sm_pmm_merger_lut->reserve(raw_lut);
+		fill_n((uint64*)raw_lut, max_in_lut, 0);
+	}
+	if (!suff_buff_pos)
+	{
+		sm_pmm_merger_suff->free(suff_buff);
+		suff_buff = nullptr;
+	}
+	push_part(range, suff_buff, suff_buff_pos, raw_lut, (lut_end - lut_offset) * sizeof(uint64), true);
+
+	if (range.range_id + 1 == bin.n_ranges)
+	{
+		for (auto& sb : bin.sub_bins)
+		{
+			fclose(sb.file);
+			remove(sb.name.c_str());
+			disk_logger->log_remove(sb.file_size);
 		}
-		bbkpq->push(bin_id, suff_buff, suff_buff_pos, raw_lut, (lut_recs - lut_offset) * sizeof(uint64), n_unique, n_cutoff_min, n_cutoff_max, n_total, true);
+	}
+	bbmrq->pass_turn(bin.bin_id, n_unique, n_cutoff_min, n_cutoff_max, n_total);
+}
+
+//----------------------------------------------------------------------------------
+template<unsigned SIZE>
+void CBigKmerBinMerger<SIZE>::Process()
+{
+	CBigBinMergeRange range;
+	bool split_next_bin;
+	int32 bin_id;
+
+	while (bbmrq->pop(range, split_next_bin))
+	{
+		if (!split_next_bin)
+			process_range(range);
+		else if (sm_cbc->pop(bin_id))
+			split_bin(bin_id);
+		else
+			bbmrq->mark_completed();
 	}
 
 	bbkpq->mark_completed();
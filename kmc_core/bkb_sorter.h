@@ -143,6 +143,10 @@ CBigKmerBinSorter<SIZE>::CBigKmerBinSorter(CKMCParams& Params, CKMCQueues& Queue
 	sm_pmm_sort = Queues.sm_pmm_sort.get();
 
 	kxmers_size = Params.sm_mem_part_sort / 2 / sizeof(CKmer<SIZE>);
+#ifdef DEVELOP_MODE
+	if (Params.force_big_bins)
+		kxmers_size = MIN(kxmers_size, 1ull << 14); //many sub bins even for small bins
+#endif
 
 	sm_mem_part_suffixes = Params.sm_mem_part_suffixes;
 		
@@ -17,7 +17,6 @@
 template<unsigned SIZE>
 class CSubBin
 {
-	CDiskLogger* disk_logger;
 	uchar* raw_lut;
 	uint64* lut;
 	uint32 current_prefix;
@@ -28,16 +27,16 @@ class CSubBin
 	string name;
 	FILE* file;		
 	uint32 suff_rec_len, lut_prefix_len, counter_size, suffix_bytes;	
-	uint64 size;
 	void read_next_lut_part();
 public:
 	bool get_min(CKmer<SIZE>& kmer, uint32& count);
-	CSubBin(CDiskLogger* _disk_logger)
+	CSubBin()
 	{
 		lut_size = 0;
-		disk_logger = _disk_logger;
 	}
-	void init(FILE* _file, uint64 _size, uint32 _lut_prefix_len, uint64 _n_kmers, string _name, uint32 _kmer_len, uchar* _lut_buff, uint32 _lut_buff_size, uchar* _suff_buff, uint64 _suff_buff_size);	
+	void init(FILE* _file, const string& _name, uint32 _lut_prefix_len, uint64 _n_kmers, uint32 _kmer_len, uchar* _lut_buff, uint32 _lut_buff_size, uchar* _suff_buff, uint64 _suff_buff_size);	
+	void calc_part_cumsum(uint32 part_prefix_len, vector<uint64>& part_cumsum);
+	void set_range(uint32 part_prefix_len, uint64 part_start, uint64 part_end, uint64 first_kmer, uint64 n_range_kmers);
 };
 
 //--------------------------------------------------------------------------
@@ -81,12 +80,7 @@ bool CSubBin<SIZE>::get_min(CKmer<SIZE>& kmer, uint32& count)
 			break;
 		}
 		if (current_prefix >= lut_size)
-		{
-			fclose(file);
-			remove(name.c_str());
-			disk_logger->log_remove(size);
 			return false;
-		}
 	}
 
 	uchar *suf_rec = suff_buff + suff_buff_pos * suff_rec_len;
@@ -116,34 +110,60 @@ bool CSubBin<SIZE>::get_min(CKmer<SIZE>& kmer, uint32& count)
 
 //--------------------------------------------------------------------------
 template<unsigned SIZE>
-void CSubBin<SIZE>::init(FILE* _file, uint64 _size, uint32 _lut_prefix_len, uint64 _n_kmers, string _name, uint32 _kmer_len, uchar* _lut_buff, uint32 _lut_buff_size, uchar* _suff_buff, uint64 _suff_buff_size)
+void CSubBin<SIZE>::init(FILE* _file, const string& _name, uint32 _lut_prefix_len, uint64 _n_kmers, uint32 _kmer_len, uchar* _lut_buff, uint32 _lut_buff_size, uchar* _suff_buff, uint64 _suff_buff_size)
 {
-	size = _size;
 	lut = (uint64*)_lut_buff;
 	lut_buff_recs = _lut_buff_size / sizeof(uint64);
 	suff_buff = _suff_buff;
 	suff_buff_size = _suff_buff_size;
-	lut_offset = 0;
 
 	lut_prefix_len = _lut_prefix_len;
 	kmer_len = _kmer_len;
 	suffix_bytes = (kmer_len - lut_prefix_len) / 4;
 	file = _file;
-	n_kmers = _n_kmers;
 	name = _name;
+	n_kmers = _n_kmers;
 	counter_size = sizeof(uint32);
 
-	lut_size = (1 << lut_prefix_len * 2);
-
 	suff_rec_len = (kmer_len - lut_prefix_len) / 4 + counter_size;
-	left_to_read = suff_rec_len * n_kmers;
 	max_in_suff_buff = suff_buff_size / suff_rec_len;
 	lut_start_pos_in_file = n_kmers * suff_rec_len;
-	rewind(file);
+}
+
+//--------------------------------------------------------------------------
+// Sum LUT counts of the whole sub bin for coarser prefixes (part_prefix_len symbols), part_cumsum[i] is the no. of k-mers before part prefix i
+template<unsigned SIZE>
+void CSubBin<SIZE>::calc_part_cumsum(uint32 part_prefix_len, vector<uint64>& part_cumsum)
+{
+	uint32 shr = 2 * (lut_prefix_len - part_prefix_len);
+	part_cumsum.assign((1ull << 2 * part_prefix_len) + 1, 0);
+	lut_size = (1 << lut_prefix_len * 2);
+	lut_offset = 0;
+	for (uint32 i = 0; i < lut_size; ++i)
+	{
+		if (i >= lut_offset)
+			read_next_lut_part();
+		part_cumsum[(i >> shr) + 1] += lut[i + lut_buff_recs - lut_offset];
+	}
+	for (uint64 i = 1; i < part_cumsum.size(); ++i)
+		part_cumsum[i] += part_cumsum[i - 1];
+}
+
+//--------------------------------------------------------------------------
+// Prepare reading of k-mers with part prefixes in [part_start, part_end)
+template<unsigned SIZE>
+void CSubBin<SIZE>::set_range(uint32 part_prefix_len, uint64 part_start, uint64 part_end, uint64 first_kmer, uint64 n_range_kmers)
+{
+	uint32 shl = 2 * (lut_prefix_len - part_prefix_len);
+	current_prefix = (uint32)(part_start << shl);
+	lut_size = (uint32)(part_end << shl);
+	lut_offset = current_prefix;
 	read_next_lut_part();
+
+	left_to_read = suff_rec_len * n_range_kmers;
+	my_fseek(file, first_kmer * suff_rec_len, SEEK_SET);
 	cur_in_suff_buff = (uint32)fread(suff_buff, 1, MIN(max_in_suff_buff * suff_rec_len, left_to_read), file) / suff_rec_len;
 	left_to_read -= cur_in_suff_buff * suff_rec_len;
-	current_prefix = 0;
 	in_current_prefix = 0;
 	suff_buff_pos = 0;
 }
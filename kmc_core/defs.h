@@ -77,6 +77,13 @@
 #define MIN_SMME	1
 #define MAX_SMME	16
 
+//Max. length of prefixes used to split big bins into ranges merged concurrently in strict memory mode
+#define SM_MERGER_MAX_PART_PREFIX_LEN 8
+#define SM_MERGER_MAX_PART_CUMSUM_RECS (1ull << 20)
+
+// Histogram of counters (-ohist) is limited to this counter value, as the one of kmc_tools transform histogram
+#define HISTOGRAM_MAX_COUNTER_DEFAULT 10000
+
 
 
 typedef float	count_t;
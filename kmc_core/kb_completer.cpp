@@ -37,6 +37,8 @@ CKmerBinCompleter::CKmerBinCompleter(CKMCParams &Params, CKMCQueues &Queues)
 	use_strict_mem = Params.use_strict_mem;
 	kmer_file_name = file_name + ".kmc_suf";
 	lut_file_name  = file_name + ".kmc_pre";
+	lut_tmp_file_name = lut_file_name + ".lut_tmp";
+	kmer_tmp_file_name = kmer_file_name + ".suf_tmp";
 
 	kmer_len       = Params.kmer_len;
 	signature_len  = Params.signature_len;
@@ -47,10 +49,16 @@ CKmerBinCompleter::CKmerBinCompleter(CKMCParams &Params, CKMCQueues &Queues)
 	lut_prefix_len = Params.lut_prefix_len;
 	both_strands   = Params.both_strands;
 	without_output = Params.without_output;
+	lut_elias_fano = Params.lut_elias_fano;
+	compress_suffixes = Params.compress_suffixes;
 
 	kmer_t_size    = Params.KMER_T_size;
 
 	output_type = Params.output_type;		
+	stream_output = Params.stream_output;
+	stream_type = Params.stream_type;
+	sketch_scale = Params.sketch_scale;
+	sketch_file_name = Params.sketch_file_name;
 }
 
 
@@ -75,24 +83,39 @@ void CKmerBinCompleter::ProcessBinsFirstStage()
 	
 	counter_size = calc_counter_size(cutoff_max, counter_max);
 	
+	if (!without_output && sketch_scale)
+	{
+		if (output_type == OutputType::KFF)
+			sketch = std::make_unique<CKmerSketch>(sketch_file_name, sketch_scale, kmer_len, 0, (kmer_len + 3) / 4, counter_size, true, both_strands);
+		else
+			sketch = std::make_unique<CKmerSketch>(sketch_file_name, sketch_scale, kmer_len, lut_prefix_len, (kmer_len - lut_prefix_len) / 4, counter_size, false, both_strands);
+	}
+
 	if (!without_output)
 	{
-		if(output_type == OutputType::KMC)
+		// Stream writer decodes k-mers also for the sketch when the database is stored
+		if (output_type == OutputType::KMC && (stream_output || sketch))
+			stream_writer = std::make_unique<CKmerStreamWriter>(file_name, stream_output ? stream_type : OutputType::KMC, kmer_len, lut_prefix_len, counter_size, cutoff_max, histogram, sketch.get());
+
+		if (output_type == OutputType::KMC && !stream_output)
 		{
-			// Open output file
-			out_kmer = fopen(kmer_file_name.c_str(), "wb");
+			// Compressed suffixes are built when all bins are completed, so raw suffixes are stored in a temporary file
+			const string& out_kmer_name = compress_suffixes ? kmer_tmp_file_name : kmer_file_name;
+			out_kmer = fopen(out_kmer_name.c_str(), "wb");
 			if (!out_kmer)
 			{
 				std::ostringstream ostr;
-				ostr << "Error: Cannot create " << kmer_file_name;
+				ostr << "Error: Cannot create " << out_kmer_name;
 				CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
 			}
 
-			out_lut = fopen(lut_file_name.c_str(), "wb");
+			// Elias-Fano encoded LUT (and compressed suffixes) are built when all bins are completed, so raw LUT is stored in a temporary file
+			const string& out_lut_name = lut_elias_fano || compress_suffixes ? lut_tmp_file_name : lut_file_name;
+			out_lut = fopen(out_lut_name.c_str(), "wb");
 			if (!out_lut)
 			{
 				std::ostringstream ostr;
-				ostr << "Error: Cannot create " << lut_file_name;
+				ostr << "Error: Cannot create " << out_lut_name;
 				fclose(out_kmer);
 				CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
 			}
@@ -101,7 +124,7 @@ void CKmerBinCompleter::ProcessBinsFirstStage()
 		{			
 			kff_writer = std::make_unique<CKFFWriter>(file_name + ".kff", both_strands, kmer_len, counter_size, cutoff_min, cutoff_max);
 		}
-		else
+		else if (output_type != OutputType::KMC)
 		{
 			std::ostringstream ostr;
 			ostr << "Error: not implemented, plase contact authors showing this message" << __FILE__ << "\t" << __LINE__;
@@ -119,11 +142,16 @@ void CKmerBinCompleter::ProcessBinsFirstStage()
 
 	if (!without_output)
 	{
-		if (output_type == OutputType::KMC)
+		if (output_type == OutputType::KMC && !stream_output)
 		{
 			// Markers at the beginning
-			fwrite(s_kmc_pre, 1, 4, out_lut);
-			fwrite(s_kmc_suf, 1, 4, out_kmer);
+			if (!lut_elias_fano && !compress_suffixes)
+			{
+				fwrite(s_kmc_pre, 1, 4, out_lut);
+				fwrite(s_kmc_suf, 1, 4, out_kmer);
+			}
+			else if (!compress_suffixes)
+				fwrite(s_kmc_suf, 1, 4, out_kmer);
 		}
 	}
 
@@ -149,7 +177,15 @@ void CKmerBinCompleter::ProcessBinsFirstStage()
 
 		if (!without_output)
 		{
-			if(output_type == OutputType::KMC)
+			if (stream_writer)
+			{
+				// LUT is not cumulated yet, so it gives the number of records of each prefix
+				stream_writer->AddLut((uint64*)lut, lut_recs);
+				for (auto& e : data_packs)
+					stream_writer->AddSuffixes(data + e.first, e.second - e.first);
+			}
+
+			if(output_type == OutputType::KMC && !stream_output)
 			{ 
 				for (auto& e : data_packs)
 				{
@@ -172,10 +208,14 @@ void CKmerBinCompleter::ProcessBinsFirstStage()
 			else if (output_type == OutputType::KFF)
 			{
 				uint32_t rec_size = (kmer_len + 3) / 4 + counter_size;
+				if (sketch)
+					for (auto& e : data_packs)
+						for (uint64 pos = e.first; pos < e.second; pos += rec_size)
+							sketch->Add(0, data + pos);
 				for (auto& e : data_packs)									
 					kff_writer->StoreWholeSection(data + e.first, (e.second - e.first) / rec_size);
 			}
-			else
+			else if (output_type != OutputType::KMC)
 			{
 				std::ostringstream ostr;
 				ostr << "Error: not implemented, plase contact authors showing this message" << __FILE__ << "\t" << __LINE__;
@@ -188,7 +228,7 @@ void CKmerBinCompleter::ProcessBinsFirstStage()
 
 		if (!without_output)
 		{
-			if (output_type == OutputType::KMC)
+			if (output_type == OutputType::KMC && !stream_output)
 			{
 				uint64* ulut = (uint64*)lut;
 				for (uint64 i = 0; i < lut_recs; ++i)
@@ -240,7 +280,9 @@ void CKmerBinCompleter::ProcessBinsSecondStage()
 		{
 			if (data_size)
 			{
-				if(!without_output)
+				if (stream_writer)
+					stream_writer->AddSuffixes(data, data_size);
+				if (!without_output && !stream_output)
 					fwrite(data, 1, data_size, out_kmer);				
 				sm_pmm_merger_suff->free(data);
 			}
@@ -248,13 +290,15 @@ void CKmerBinCompleter::ProcessBinsSecondStage()
 			{
 				uint64 lut_recs = lut_size / sizeof(uint64);
 				uint64* ulut = (uint64*)lut;
+				if (stream_writer)
+					stream_writer->AddLut(ulut, lut_recs);
 				for (uint64 i = 0; i < lut_recs; ++i)
 				{
 					uint64 x = ulut[i];
 					ulut[i] = n_recs;
 					n_recs += x;
 				}
-				if(!without_output)
+				if (!without_output && !stream_output)
 					fwrite(lut, lut_recs, sizeof(uint64), out_lut);				
 				sm_pmm_merger_lut->free(lut);
 			}
@@ -276,15 +320,38 @@ void CKmerBinCompleter::ProcessBinsSecondStage()
 		}
 	}
 
-	if (!without_output)
+	if (stream_writer)
+	{
+		stream_writer->Finish();
+		stream_writer.reset();
+	}
+	if (sketch)
+	{
+		sketch->Store();
+		sketch.reset();
+	}
+
+	if (!without_output && !stream_output)
 	{
 		if(output_type == OutputType::KMC)
 		{
-			// Marker at the end
-			fwrite(s_kmc_suf, 1, 4, out_kmer);
-			fclose(out_kmer);
+			if (compress_suffixes)
+			{
+				fclose(out_kmer);
+				fflush(out_lut);
+				StoreCompressedSuffixes();
+			}
+			else
+			{
+				// Marker at the end
+				fwrite(s_kmc_suf, 1, 4, out_kmer);
+				fclose(out_kmer);
+			}
 
-			fwrite(&n_recs, 1, sizeof(uint64), out_lut);
+			if (lut_elias_fano || compress_suffixes)
+				StoreLutFromTmp();
+			else
+				fwrite(&n_recs, 1, sizeof(uint64), out_lut);
 
 			//store signature mapping 
 			fwrite(sig_map, sizeof(uint32), sig_map_size, out_lut);
@@ -310,7 +377,7 @@ void CKmerBinCompleter::ProcessBinsSecondStage()
 				offset++;
 			}
 
-			store_uint(out_lut, 0x200, 4);
+			store_uint(out_lut, 0x200 | (lut_elias_fano ? 0x1 : 0x0) | (compress_suffixes ? 0x2 : 0x0), 4);
 			offset += 4;
 
 			store_uint(out_lut, offset, 4);
@@ -335,6 +402,147 @@ void CKmerBinCompleter::GetTotal(uint64 &_n_unique, uint64 &_n_cutoff_min, uint6
 	_n_total      = n_total;
 }
 
+//----------------------------------------------------------------------------------
+// Return histogram of counters (only for HISTOGRAM stream output)
+void CKmerBinCompleter::GetHistogram(std::vector<uint64>& _histogram)
+{
+	_histogram = histogram;
+}
+
+//----------------------------------------------------------------------------------
+// Store raw LUT from the temporary file (followed by the total no. of k-mers) in *.kmc_pre, encoded
+// with Elias-Fano if requested, *.kmc_pre is left opened in out_lut
+void CKmerBinCompleter::StoreLutFromTmp()
+{
+	uint64 lut_recs = my_ftell(out_lut) / sizeof(uint64);
+	fclose(out_lut);
+
+	FILE* in_lut = fopen(lut_tmp_file_name.c_str(), "rb");
+	if (!in_lut)
+	{
+		std::ostringstream ostr;
+		ostr << "Error: Cannot open " << lut_tmp_file_name;
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+
+	out_lut = fopen(lut_file_name.c_str(), "wb");
+	if (!out_lut)
+	{
+		std::ostringstream ostr;
+		ostr << "Error: Cannot create " << lut_file_name;
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+	char s_kmc_pre[] = "KMCP";
+	fwrite(s_kmc_pre, 1, 4, out_lut);
+
+	CEliasFano lut_ef;
+	if (lut_elias_fano)
+		lut_ef.Init(lut_recs + 1, n_recs);
+
+	const uint64 buf_recs = 1 << 16;
+	std::vector<uint64> buf(buf_recs);
+	uint64 n_read;
+	while ((n_read = fread(buf.data(), sizeof(uint64), buf_recs, in_lut)) > 0)
+	{
+		if (!lut_elias_fano)
+			fwrite(buf.data(), sizeof(uint64), n_read, out_lut);
+		else
+			for (uint64 i = 0; i < n_read; ++i)
+				lut_ef.Add(buf[i]);
+	}
+	fclose(in_lut);
+	remove(lut_tmp_file_name.c_str());
+
+	bool ok;
+	if (lut_elias_fano)
+	{
+		lut_ef.Add(n_recs);
+		ok = lut_ef.Store(out_lut);
+	}
+	else
+		ok = fwrite(&n_recs, 1, sizeof(uint64), out_lut) == sizeof(uint64);
+	if (!ok)
+	{
+		std::ostringstream ostr;
+		ostr << "Error: Cannot write to " << lut_file_name;
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+}
+
+//----------------------------------------------------------------------------------
+// Compress suffixes from the temporary file to *.kmc_suf, prefixes of k-mers are taken from raw LUT
+// in the temporary file (out_lut must be flushed)
+void CKmerBinCompleter::StoreCompressedSuffixes()
+{
+	FILE* in_kmer = fopen(kmer_tmp_file_name.c_str(), "rb");
+	FILE* in_lut = fopen(lut_tmp_file_name.c_str(), "rb");
+	if (!in_kmer || !in_lut)
+	{
+		std::ostringstream ostr;
+		ostr << "Error: Cannot open " << (in_kmer ? lut_tmp_file_name : kmer_tmp_file_name);
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+	FILE* out = fopen(kmer_file_name.c_str(), "wb");
+	if (!out)
+	{
+		std::ostringstream ostr;
+		ostr << "Error: Cannot create " << kmer_file_name;
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+
+	char s_kmc_suf[] = "KMCS";
+	fwrite(s_kmc_suf, 1, 4, out);
+	CCompressedSuffixWriter writer;
+	writer.Init(out, kmer_len, lut_prefix_len, (uint32)counter_size);
+
+	const uint64 single_lut_size = 1ull << (2 * lut_prefix_len);
+	const uint64 rec_size = (kmer_len - lut_prefix_len) / 4 + counter_size;
+	const uint64 buf_recs = 1 << 16;
+
+	// LUT entries are read sequentially, records of the entry lut_idx end at lut_end
+	std::vector<uint64> lut_buf(buf_recs);
+	uint64 lut_buf_pos = 0, lut_buf_size = 0;
+	auto next_lut_value = [&]() {
+		if (lut_buf_pos == lut_buf_size)
+		{
+			lut_buf_size = fread(lut_buf.data(), sizeof(uint64), buf_recs, in_lut);
+			lut_buf_pos = 0;
+			if (!lut_buf_size)
+				return n_recs;
+		}
+		return lut_buf[lut_buf_pos++];
+	};
+	next_lut_value();
+	uint64 lut_idx = 0;
+	uint64 lut_end = next_lut_value();
+
+	std::vector<uchar> suf_buf(buf_recs * rec_size);
+	uint64 rec_id = 0;
+	uint64 n_read;
+	bool ok = true;
+	while (ok && (n_read = fread(suf_buf.data(), rec_size, buf_recs, in_kmer)) > 0)
+		for (uint64 i = 0; i < n_read && ok; ++i, ++rec_id)
+		{
+			while (rec_id >= lut_end)
+			{
+				lut_end = next_lut_value();
+				++lut_idx;
+			}
+			ok = writer.Add(lut_idx & (single_lut_size - 1), suf_buf.data() + i * rec_size);
+		}
+	ok = ok && rec_id == n_recs && writer.Finish() && fwrite(s_kmc_suf, 1, 4, out) == 4;
+	fclose(in_kmer);
+	fclose(in_lut);
+	fclose(out);
+	remove(kmer_tmp_file_name.c_str());
+	if (!ok)
+	{
+		std::ostringstream ostr;
+		ostr << "Error: Cannot write to " << kmer_file_name;
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+}
+
 //----------------------------------------------------------------------------------
 // Store single unsigned integer in LSB fashion
 bool CKmerBinCompleter::store_uint(FILE *out, uint64 x, uint32 size)
@@ -388,4 +596,12 @@ void CWKmerBinCompleter::GetTotal(uint64 &_n_unique, uint64 &_n_cutoff_min, uint
 		kbc->GetTotal(_n_unique, _n_cutoff_min, _n_cutoff_max, _n_total);
 }
 
+//----------------------------------------------------------------------------------
+// Return histogram of counters (only for HISTOGRAM stream output)
+void CWKmerBinCompleter::GetHistogram(std::vector<uint64>& _histogram)
+{
+	if(kbc)
+		kbc->GetHistogram(_histogram);
+}
+
 // ***** EOF
@@ -21,13 +21,17 @@
 #include <stdio.h>
 #include "small_k_buf.h"
 #include "kff_writer.h"
+#include "kmer_stream_writer.h"
+#define DONT_DEFINE_UCHAR
+#include "../kmc_api/elias_fano.h"
+#include "../kmc_api/compressed_suffixes.h"
 
 //************************************************************************************************************
 // CKmerBinCompleter - complete the sorted bins and store in a file
 //************************************************************************************************************
 class CKmerBinCompleter
 {
-	string file_name, kmer_file_name, lut_file_name;
+	string file_name, kmer_file_name, lut_file_name, lut_tmp_file_name, kmer_tmp_file_name;
 	CKmerQueue *kq;
 	CBinDesc *bd;
 	CSignatureMapper *s_mapper;
@@ -56,9 +60,20 @@ class CKmerBinCompleter
 	int32 signature_len;	
 	bool both_strands;
 	bool without_output;
+	bool lut_elias_fano;
+	bool compress_suffixes;
 	bool store_uint(FILE *out, uint64 x, uint32 size);
+	void StoreLutFromTmp();
+	void StoreCompressedSuffixes();
 	std::unique_ptr<CKFFWriter> kff_writer;
 	OutputType output_type;
+	bool stream_output;
+	OutputType stream_type;
+	std::unique_ptr<CKmerStreamWriter> stream_writer;
+	std::vector<uint64> histogram;
+	uint64 sketch_scale;
+	string sketch_file_name;
+	std::unique_ptr<CKmerSketch> sketch;
 
 public:
 	CKmerBinCompleter(CKMCParams &Params, CKMCQueues &Queues);
@@ -66,6 +81,7 @@ public:
 	void ProcessBinsFirstStage();
 	void ProcessBinsSecondStage();
 	void GetTotal(uint64 &_n_unique, uint64 &_n_cutoff_min, uint64 &_n_cutoff_max, uint64 &_n_total);
+	void GetHistogram(std::vector<uint64>& _histogram);
 	void InitStage2(CKMCParams& Params, CKMCQueues& Queues);
 };
 
@@ -82,6 +98,7 @@ public:
 	void operator()(bool first_stage);
 
 	void GetTotal(uint64 &_n_unique, uint64 &_n_cutoff_min, uint64 &_n_cutoff_max, uint64 &_n_total);
+	void GetHistogram(std::vector<uint64>& _histogram);
 	void InitStage2(CKMCParams& Params, CKMCQueues& Queues);
 };
 
@@ -102,6 +119,11 @@ class CSmallKCompleter
 	bool both_strands;	
 	bool without_output;
 	OutputType output_type;
+	bool stream_output;
+	OutputType stream_type;
+	std::vector<uint64> histogram;
+	uint64 sketch_scale;
+	std::string sketch_file_name;
 
 	inline bool store_uint(FILE *out, uint64 x, uint32 size);
 public:
@@ -116,7 +138,11 @@ public:
 	template<typename COUNTER_TYPE>
 	bool CompleteKFFFormat(CSmallKBuf<COUNTER_TYPE> results);
 
+	template<typename COUNTER_TYPE>
+	bool CompleteStream(CSmallKBuf<COUNTER_TYPE> results);
+
 	inline void GetTotal(uint64 &_n_unique, uint64 &_n_cutoff_min, uint64 &_n_cutoff_max);
+	inline void GetHistogram(std::vector<uint64>& _histogram);
 
 };
 
@@ -135,6 +161,10 @@ CSmallKCompleter::CSmallKCompleter(CKMCParams& Params, CKMCQueues& Queues)
 	mem_tot_small_k_completer = Params.mem_tot_small_k_completer;
 	output_file_name = Params.output_file_name;
 	output_type = Params.output_type;
+	stream_output = Params.stream_output;
+	stream_type = Params.stream_type;
+	sketch_scale = Params.sketch_scale;
+	sketch_file_name = Params.sketch_file_name;
 }
 
 bool CSmallKCompleter::store_uint(FILE *out, uint64 x, uint32 size)
@@ -205,6 +235,10 @@ bool CSmallKCompleter::CompleteKMCFormat(CSmallKBuf<COUNTER_TYPE> result)
 		fwrite(s_kmc_suf, 1, 4, suf_file);
 	}
 
+	std::unique_ptr<CKmerSketch> sketch;
+	if (!this->without_output && sketch_scale)
+		sketch = std::make_unique<CKmerSketch>(sketch_file_name, sketch_scale, kmer_len, lut_prefix_len, kmer_suf_bytes, counter_size, false, both_strands);
+
 	CKmer<1> kmer;
 
 	uint64 prev_prefix = 0, prefix;
@@ -245,10 +279,13 @@ bool CSmallKCompleter::CompleteKMCFormat(CSmallKBuf<COUNTER_TYPE> result)
 					if (result.buf[kmer.data] > (uint64)counter_max)
 						result.buf[kmer.data] = (COUNTER_TYPE)counter_max;
 
+					uint32 rec_pos = suf_pos;
 					for (int32 j = (int32)kmer_suf_bytes - 1; j >= 0; --j)
 						suf[suf_pos++] = kmer.get_byte(j);
 
 					result.Store(kmer.data, suf, suf_pos, counter_size);
+					if (sketch)
+						sketch->Add(prefix, suf + rec_pos);
 
 					if (suf_pos >= suf_recs * (kmer_suf_bytes + counter_size))
 					{
@@ -301,6 +338,8 @@ bool CSmallKCompleter::CompleteKMCFormat(CSmallKBuf<COUNTER_TYPE> result)
 		fclose(pre_file);
 		fclose(suf_file);
 	}
+	if (sketch)
+		sketch->Store();
 	pmm_small_k_completer->free(raw_buffer);
 
 
@@ -325,6 +364,10 @@ bool CSmallKCompleter::CompleteKFFFormat(CSmallKBuf<COUNTER_TYPE> result)
 		kff_writer->InitSection();
 	}
 
+	std::unique_ptr<CKmerSketch> sketch;
+	if (!without_output && sketch_scale)
+		sketch = std::make_unique<CKmerSketch>(sketch_file_name, sketch_scale, kmer_len, 0, (kmer_len + 3) / 4, counter_size, true, both_strands);
+
 	uchar* buff = raw_buffer;
 
 	CKmer<1> kmer;
@@ -354,6 +397,8 @@ bool CSmallKCompleter::CompleteKFFFormat(CSmallKBuf<COUNTER_TYPE> result)
 					COUNTER_TYPE count = result.buf[kmer.data];
 					for (int32 j = (int32)counter_size - 1; j >= 0; --j)
 						buff[buff_pos++] = (count >> (j * 8)) & 0xFF;
+					if (sketch)
+						sketch->Add(0, buff + buff_pos - rec_bytes);
 
 					if (buff_pos == buff_size)
 					{
@@ -372,13 +417,63 @@ bool CSmallKCompleter::CompleteKFFFormat(CSmallKBuf<COUNTER_TYPE> result)
 		kff_writer->FinishSection();
 		kff_writer.reset();
 	}
+	if (sketch)
+		sketch->Store();
 
 	pmm_small_k_completer->free(raw_buffer);
 	return true;
 }
+template<typename COUNTER_TYPE>
+bool CSmallKCompleter::CompleteStream(CSmallKBuf<COUNTER_TYPE> result)
+{
+	uint64 counter_size = calc_counter_size_ull(cutoff_max, counter_max);
+	uint64 kmer_suf_bytes = (kmer_len - lut_prefix_len) / 4;
+
+	std::unique_ptr<CKmerSketch> sketch;
+	std::unique_ptr<CKmerStreamWriter> stream_writer;
+	if (!without_output && sketch_scale)
+		sketch = std::make_unique<CKmerSketch>(sketch_file_name, sketch_scale, kmer_len, lut_prefix_len, kmer_suf_bytes, counter_size, false, both_strands);
+	if (!without_output)
+		stream_writer = std::make_unique<CKmerStreamWriter>(output_file_name, stream_type, kmer_len, lut_prefix_len, counter_size, cutoff_max, histogram, sketch.get());
+
+	uchar rec[16];
+	CKmer<1> kmer;
+	for (kmer.data = 0; kmer.data < (1ull << 2 * kmer_len); ++kmer.data)
+	{
+		if (result.buf[kmer.data])
+		{
+			++n_unique;
+			if (result.buf[kmer.data] < cutoff_min)
+				++n_cutoff_min;
+			else if (result.buf[kmer.data] > (uint64)cutoff_max)
+				++n_cutoff_max;
+			else if (!without_output)
+			{
+				if (result.buf[kmer.data] > (uint64)counter_max)
+					result.buf[kmer.data] = (COUNTER_TYPE)counter_max;
+
+				uint32 rec_pos = 0;
+				for (int32 j = (int32)kmer_suf_bytes - 1; j >= 0; --j)
+					rec[rec_pos++] = kmer.get_byte(j);
+				result.Store(kmer.data, rec, rec_pos, counter_size);
+
+				stream_writer->Store(kmer.remove_suffix(2 * (kmer_len - lut_prefix_len)), rec);
+			}
+		}
+	}
+
+	if (!without_output)
+		stream_writer->Finish();
+	if (sketch)
+		sketch->Store();
+	return true;
+}
+
 template<typename COUNTER_TYPE>
 bool CSmallKCompleter::Complete(CSmallKBuf<COUNTER_TYPE> result)
 {
+	if (stream_output)
+		return CompleteStream(result);
 	switch(output_type)
 	{
 	case OutputType::KMC:
@@ -399,6 +494,11 @@ void CSmallKCompleter::GetTotal(uint64 &_n_unique, uint64 &_n_cutoff_min, uint64
 	_n_cutoff_min = n_cutoff_min;
 	_n_cutoff_max = n_cutoff_max;
 }
+
+void CSmallKCompleter::GetHistogram(std::vector<uint64>& _histogram)
+{
+	_histogram = histogram;
+}
 #endif
 
 // ***** EOF
@@ -51,6 +51,7 @@ template <unsigned SIZE> class CKmerBinReader
 	KMC::IPercentProgressObserver* percentProgressObserver;
 #ifdef DEVELOP_MODE
 	bool verbose_log;
+	bool force_big_bins;
 #endif
 	int64 round_up_to_alignment(int64 x)
 	{
@@ -88,6 +89,7 @@ template <unsigned SIZE> CKmerBinReader<SIZE>::CKmerBinReader(CKMCParams &Params
 
 #ifdef DEVELOP_MODE
 	verbose_log = Params.verbose_log;
+	force_big_bins = Params.force_big_bins;
 #endif
 
 	percentProgressObserver = Params.percentProgressObserver;
@@ -156,6 +158,13 @@ template <unsigned SIZE> void CKmerBinReader<SIZE>::ProcessBins()
 			lut_recs = 0;
 		uint64 lut_size = lut_recs * sizeof(uint64);
 
+#ifdef DEVELOP_MODE
+		if (force_big_bins)
+		{
+			tlbq->insert(bin_id);
+			continue;
+		}
+#endif
 		// Reserve memory only for the file data
 		if (!memory_bins->init(bin_id, rec_len, round_up_to_alignment(size), round_up_to_alignment(input_kmer_size), round_up_to_alignment(out_buffer_size), round_up_to_alignment(kxmer_counter_size), round_up_to_alignment(lut_size)))
 		{
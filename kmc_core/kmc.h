@@ -59,6 +59,7 @@ template <unsigned SIZE> class CKMC {
 	CKMCQueues Queues;
 
 	uint64 n_reads;
+	uint64 n_filtered_singletons = 0;
 
 	bool was_small_k_opt;
 	bool is_only_estimating_histogram = false;
@@ -109,6 +110,7 @@ public:
 template <unsigned SIZE> CKMC<SIZE>::CKMC()
 {
 	initialized   = false;
+	was_small_k_opt = false;
 	Params.kmer_len      = 0;
 	Params.n_readers     = 1;
 	Params.n_splitters   = 1;
@@ -157,6 +159,8 @@ template <unsigned SIZE> void CKMC<SIZE>::SetParamsStage1(const KMC::Stage1Param
 	Params.both_strands = stage1Params.GetCanonicalKmers();
 	Params.homopolymer_compressed = stage1Params.GetHomopolymerCompressed();
 	Params.mem_mode = stage1Params.GetRamOnlyMode();
+	Params.singleton_filter = stage1Params.GetSingletonFilter();
+	Params.sample_scale = stage1Params.GetSampleScale();
 
 	if (stage1Params.GetNReaders() && stage1Params.GetNSplitters())
 	{
@@ -181,6 +185,9 @@ template <unsigned SIZE> void CKMC<SIZE>::SetParamsStage1(const KMC::Stage1Param
 	if (Params.estimateHistogramCfg != KMC::EstimateHistogramCfg::DONT_ESTIMATE && !Params.both_strands)
 		throw std::runtime_error("k-mer histogram estimation possible only for canonical k-mers");
 
+	if (Params.estimateHistogramCfg == KMC::EstimateHistogramCfg::ONLY_ESTIMATE && Params.sample_scale > 1)
+		throw std::runtime_error("k-mer histogram estimation is not possible for subsampled k-mers");
+
 	initialized = true;
 }
 
@@ -189,6 +196,13 @@ template <unsigned SIZE> void CKMC<SIZE>::SetParamsStage1(const KMC::Stage1Param
 template <unsigned SIZE> void CKMC<SIZE>::SetParamsStage2(const KMC::Stage2Params& stage2Params)
 {
 	Params.output_type = stage2Params.GetOutputFileType();
+	Params.stream_output = Params.output_type == OutputType::DUMP || Params.output_type == OutputType::BINARY_DUMP || Params.output_type == OutputType::HISTOGRAM;
+	if (Params.stream_output)
+	{
+		// bins are completed in KMC layout and streamed by the completer
+		Params.stream_type = Params.output_type;
+		Params.output_type = OutputType::KMC;
+	}
 	Params.output_file_name = stage2Params.GetOutputFileName();
 
 	// Thresholds for counters
@@ -221,13 +235,25 @@ template <unsigned SIZE> void CKMC<SIZE>::SetParamsStage2(const KMC::Stage2Param
 		Params.warningsLogger->Log(ostr.str());
 	}
 
+	if (Params.singleton_filter && !was_small_k_opt && Params.cutoff_min < 2)
+		throw std::runtime_error("k-mers occurring once were filtered out in stage 1, cutoff_min must be at least 2");
+
 	Params.without_output = stage2Params.GetWithoutOutput();
+	Params.lut_elias_fano = stage2Params.GetLutEliasFano();
+	Params.compress_suffixes = stage2Params.GetCompressSuffixes();
+	Params.sketch_scale = stage2Params.GetSketchScale();
+	Params.sketch_file_name = stage2Params.GetSketchFileName();
+	if (Params.sketch_scale && Params.sketch_file_name.empty())
+		Params.sketch_file_name = Params.output_file_name + ".sketch";
 	Params.use_strict_mem = stage2Params.GetStrictMemoryMode();
 
 	Params.max_mem_size = NORM(((uint64)stage2Params.GetMaxRamGB()) * 1000000000ull, (uint64)MIN_MEM * 1000000000ull, 1024ull * 1000000000ull);
 	SetThreads2Stage(stage2Params);
 	if(Params.use_strict_mem)
 		SetThreadsStrictMemoryMode(stage2Params);
+#ifdef DEVELOP_MODE
+	Params.force_big_bins = Params.use_strict_mem && stage2Params.GetDevelopForceBigBins();
+#endif
 }
 
 //----------------------------------------------------------------------------------
@@ -320,6 +346,10 @@ template <unsigned SIZE> void CKMC<SIZE>::AdjustMemoryLimitsStrictMemoryMode()
 	int64 m_rest = Params.max_mem_size;
 
 	Params.sm_mem_part_input_file = 1ull << 26;
+#ifdef DEVELOP_MODE
+	if (Params.force_big_bins) //small parts, so a part always fits in a small sorting buffer (see CBigKmerBinSorter)
+		Params.sm_mem_part_input_file = 1ull << 16;
+#endif
 	Params.sm_mem_tot_input_file = Params.sm_mem_part_input_file * (Params.sm_n_uncompactors + 1);
 
 	m_rest -= Params.sm_mem_tot_input_file;
@@ -434,6 +464,14 @@ template <unsigned SIZE> bool CKMC<SIZE>::AdjustMemoryLimits()
 		m_rest -= 1ull << 30; //TODO: 1GB is assumed for estimation, but depending on the parameters it may be different
 	}
 
+	// Counting Bloom filter for singleton filtering (and postponed spans in RAM only mode)
+	Params.mem_singleton_filter = 0;
+	if (Params.singleton_filter)
+	{
+		Params.mem_singleton_filter = Params.max_mem_size / 8;
+		m_rest -= Params.mem_singleton_filter;
+	}
+
 	Params.mem_part_pmm_stats = ((1 << Params.signature_len * 2) + 1) * sizeof(uint32);
 	Params.mem_tot_pmm_stats = (Params.n_splitters + 1 + 1) * Params.mem_part_pmm_stats; //1 merged in main thread, 1 for sorting indices
 
@@ -545,12 +583,16 @@ template <unsigned SIZE> void CKMC<SIZE>::ShowSettingsStage1()
 	case OutputType::KMC:
 		ostr << "KMC\n";
 		break;	
+	default:
+		break;
 	}
 	ostr << "\n";
 	ostr << "k-mer length                 : " << Params.kmer_len << "\n";
 	ostr << "Max. k-mer length            : " << MAX_K << "\n";
 	ostr << "Signature length             : " << Params.signature_len << "\n";
 	ostr << "Both strands                 : " << (Params.both_strands ? "true\n" : "false\n");
+	if (Params.sample_scale)
+		ostr << "Sample scale                 : " << Params.sample_scale << "\n";
 	ostr << "RAM only mode                : " << (Params.mem_mode ? "true\n" : "false\n");
 
 	ostr << "\n******* Stage 1 configuration: *******\n";
@@ -574,6 +616,8 @@ template <unsigned SIZE> void CKMC<SIZE>::ShowSettingsStage1()
 	ostr << "Max. mem. for PMM (FASTQ)    : " << setw(5) << (Params.mem_tot_pmm_fastq / 1000000) << "MB\n";
 	ostr << "Max. mem. for PMM (reads)    : " << setw(5) << (Params.mem_tot_pmm_reads / 1000000) << "MB\n";
 	ostr << "Max. mem. for PMM (b. reader): " << setw(5) << (Params.mem_tot_pmm_binary_file_reader / 1000000) << "MB\n";
+	if (Params.singleton_filter)
+		ostr << "Max. mem. for singleton filt.: " << setw(5) << (Params.mem_singleton_filter / 1000000) << "MB\n";
 
 	ostr << "\n";
 
@@ -590,6 +634,8 @@ template <unsigned SIZE> void CKMC<SIZE>::ShowSettingsStage2()
 	ostr << "Min. count threshold         : " << Params.cutoff_min << "\n";
 	ostr << "Max. count threshold         : " << Params.cutoff_max << "\n";
 	ostr << "Max. counter value           : " << Params.counter_max << "\n";
+	if (Params.sketch_scale)
+		ostr << "Sketch scale                 : " << Params.sketch_scale << "\n";
 
 	ostr << "\n******* Stage 2 configuration: *******\n";
 
@@ -639,7 +685,12 @@ template <unsigned SIZE> void CKMC<SIZE>::ShowSettingsSmallKOpt()
 		ostr << "KFF\n";
 		break;
 	case OutputType::KMC:
-		ostr << "KMC\n";
+		if (Params.stream_output)
+			ostr << (Params.stream_type == OutputType::HISTOGRAM ? "histogram\n" : Params.stream_type == OutputType::DUMP ? "text dump\n" : "binary dump\n");
+		else
+			ostr << "KMC\n";
+		break;
+	default:
 		break;
 	}
 
@@ -651,6 +702,8 @@ template <unsigned SIZE> void CKMC<SIZE>::ShowSettingsSmallKOpt()
 	ostr << "Max. counter value           : " << Params.counter_max << "\n";
 	
 	ostr << "Both strands                 : " << (Params.both_strands ? "true\n" : "false\n");
+	if (Params.sample_scale)
+		ostr << "Sample scale                 : " << Params.sample_scale << "\n";
 	ostr << "Input buffer size            : " << Params.fastq_buffer_size << "\n";
 
 	ostr << "\n";
@@ -949,6 +1002,7 @@ KMC::Stage2Results CKMC<SIZE>::ProcessSmallKOptimization_Stage2()
 	CSmallKCompleter small_k_completer(Params, Queues);
 	small_k_completer.Complete(count_results[0]);
 	small_k_completer.GetTotal(results.nUniqueKmers, results.nBelowCutoffMin, results.nAboveCutoffMax);
+	small_k_completer.GetHistogram(results.histogram);
 
 	Queues.pmm_reads->release();
 	Queues.pmm_small_k_buf->release();
@@ -1222,6 +1276,8 @@ template <unsigned SIZE> KMC::Stage1Results CKMC<SIZE>::ProcessStage1_impl()
 		was_small_k_opt = true;
 
 		Params.verboseLogger->Log("\nInfo: Small k optimization on!\n");
+		if (Params.singleton_filter)
+			Params.verboseLogger->Log("Info: singleton filter is not used in small k optimization\n");
 
 		return ProcessSmallKOptimization_Stage1();
 	}
@@ -1284,6 +1340,12 @@ template <unsigned SIZE> KMC::Stage1Results CKMC<SIZE>::ProcessStage1_impl()
 
 	Queues.tmp_files_owner = std::make_unique<CTmpFilesOwner>(Params.n_bins, Params.mem_mode);
 
+	if (Params.singleton_filter)
+	{
+		Queues.singleton_filter = std::make_unique<CSingletonFilter>(Params.mem_singleton_filter, Params.kmer_len, Params.both_strands);
+		Queues.splitters_barrier = std::make_unique<CSplittersBarrier>(Params.n_splitters);
+	}
+
 	std::vector<CExceptionAwareThread> fastqs_threads;
 	std::vector<CExceptionAwareThread> splitters_threads;
 
@@ -1333,6 +1395,9 @@ template <unsigned SIZE> KMC::Stage1Results CKMC<SIZE>::ProcessStage1_impl()
 		Queues.ntHashEstimator.reset();
 	}
 
+	Queues.singleton_filter.reset();
+	Queues.splitters_barrier.reset();
+
 	for (auto& ptr : Queues.binary_pack_queues)
 		ptr.reset();
 
@@ -1349,6 +1414,7 @@ template <unsigned SIZE> KMC::Stage1Results CKMC<SIZE>::ProcessStage1_impl()
 	storerer_thread.join();
 
 	n_reads = 0;
+	n_filtered_singletons = 0;
 
 	thread release_thr_st1_1([&] {
 		for (int i = 0; i < Params.n_readers; ++i)
@@ -1359,6 +1425,7 @@ template <unsigned SIZE> KMC::Stage1Results CKMC<SIZE>::ProcessStage1_impl()
 			uint64 _n_reads;
 			w_splitters[i]->GetTotal(_n_reads);
 			n_reads += _n_reads;
+			n_filtered_singletons += w_splitters[i]->GetNFilteredSingletons();
 			w_splitters[i].reset();
 		}
 
@@ -1442,6 +1509,8 @@ template <unsigned SIZE> KMC::Stage2Results CKMC<SIZE>::ProcessStage2_impl()
 			auto end = MIN(static_cast<size_t>(Params.cutoff_max + 1), estimated_histogram.size());
 			for (uint64_t i = start; i < end; ++i)
 				n_est_unique_kmers += estimated_histogram[i];
+			if (Params.sample_scale > 1) //histogram is estimated from all k-mers, only a subsample of them is counted
+				n_est_unique_kmers /= Params.sample_scale;
 
 			Params.verboseLogger->Log(std::string("Estimated number of unique counted k-mers: ") + std::to_string(n_est_unique_kmers));
 		}
@@ -1635,6 +1704,7 @@ template <unsigned SIZE> KMC::Stage2Results CKMC<SIZE>::ProcessStage2_impl()
 		Queues.bbd = std::make_unique<CBigBinDesc>();
 		Queues.bbspq = std::make_unique<CBigBinSortedPartQueue>(1);
 		Queues.sm_cbc = std::make_unique<CCompletedBinsCollector>(1);
+		Queues.bbmrq = std::make_unique<CBigBinMergeRangesQueue>();
 
 		std::unique_ptr<CWBigKmerBinReader> w_bkb_reader = std::make_unique<CWBigKmerBinReader>(Params, Queues);
 		CExceptionAwareThread bkb_reader(std::ref(*w_bkb_reader.get()));
@@ -1687,6 +1757,7 @@ template <unsigned SIZE> KMC::Stage2Results CKMC<SIZE>::ProcessStage2_impl()
 			Queues.bbpq.reset();
 			Queues.bbkq.reset();
 			Queues.sm_cbc.reset();
+			Queues.bbmrq.reset();
 			Queues.bbspq.reset();
 		});
 	}
@@ -1727,6 +1798,12 @@ template <unsigned SIZE> KMC::Stage2Results CKMC<SIZE>::ProcessStage2_impl()
 
 	// ***** End of Stage 2 *****
 	w_completer->GetTotal(results.nUniqueKmers, results.nBelowCutoffMin, results.nAboveCutoffMax, results.nTotalKmers);
+	w_completer->GetHistogram(results.histogram);
+
+	// k-mers dropped by the singleton filter in stage 1 are unique and below the cutoff
+	results.nUniqueKmers += n_filtered_singletons;
+	results.nBelowCutoffMin += n_filtered_singletons;
+	results.nTotalKmers += n_filtered_singletons;
 	
 	uint64 stat_n_plus_x_recs, stat_n_recs, stat_n_recs_tmp, stat_n_plus_x_recs_tmp;
 	stat_n_plus_x_recs = stat_n_recs = stat_n_recs_tmp = stat_n_plus_x_recs_tmp = 0;
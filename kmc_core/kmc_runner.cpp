@@ -245,6 +245,16 @@ namespace KMC
 		this->ramOnlyMode = ramOnlyMode;
 		return *this;
 	}
+	Stage1Params& Stage1Params::SetSingletonFilter(bool singletonFilter)
+	{
+		this->singletonFilter = singletonFilter;
+		return *this;
+	}
+	Stage1Params& Stage1Params::SetSampleScale(uint64_t sampleScale)
+	{
+		this->sampleScale = sampleScale;
+		return *this;
+	}
 	Stage1Params& Stage1Params::SetNBins(uint32_t nBins)
 	{
 		if (nBins < MIN_N_BINS || nBins > MAX_N_BINS)
@@ -367,6 +377,26 @@ namespace KMC
 		this->withoutOutput = withoutOutput;
 		return *this;
 	}	
+	Stage2Params& Stage2Params::SetLutEliasFano(bool lutEliasFano)
+	{
+		this->lutEliasFano = lutEliasFano;
+		return *this;
+	}
+	Stage2Params& Stage2Params::SetCompressSuffixes(bool compressSuffixes)
+	{
+		this->compressSuffixes = compressSuffixes;
+		return *this;
+	}
+	Stage2Params& Stage2Params::SetSketchScale(uint64_t sketchScale)
+	{
+		this->sketchScale = sketchScale;
+		return *this;
+	}
+	Stage2Params& Stage2Params::SetSketchFileName(const std::string& sketchFileName)
+	{
+		this->sketchFileName = sketchFileName;
+		return *this;
+	}
 	Stage2Params& Stage2Params::SetStrictMemoryNSortingThreadsPerSorters(uint32_t strictMemoryNSortingThreadsPerSorters)
 	{
 		if (strictMemoryNSortingThreadsPerSorters < MIN_SMSO || strictMemoryNSortingThreadsPerSorters > MAX_SMSO)
@@ -402,6 +432,12 @@ namespace KMC
 		return *this;
 	}
 
+	Stage2Params& Stage2Params::SetDevelopForceBigBins(bool developForceBigBins)
+	{
+		this->developForceBigBins = developForceBigBins;
+		return *this;
+	}
+
 	class Runner::RunnerImpl
 	{
 		std::unique_ptr<CApplication<KMER_WORDS>> app;
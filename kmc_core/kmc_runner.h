@@ -93,7 +93,7 @@ namespace KMC
 	};
 
 	enum class InputFileType { FASTQ, FASTA, MULTILINE_FASTA, BAM, KMC };
-	enum class OutputFileType { KMC, KFF };
+	enum class OutputFileType { KMC, KFF, DUMP, BINARY_DUMP, HISTOGRAM };
 	
 	enum class EstimateHistogramCfg { DONT_ESTIMATE, ESTIMATE_AND_COUNT_KMERS, ONLY_ESTIMATE };
 
@@ -118,6 +118,8 @@ namespace KMC
 		InputFileType inputFileType = InputFileType::FASTQ;
 		bool canonicalKmers = true;
 		bool ramOnlyMode = false;
+		bool singletonFilter = false;
+		uint64_t sampleScale = 0;
 		uint32_t nBins = 512;
 		uint32_t nReaders = 0;
 		uint32_t nSplitters = 0;
@@ -140,6 +142,8 @@ namespace KMC
 		Stage1Params& SetInputFileType(InputFileType inputFileType);
 		Stage1Params& SetCanonicalKmers(bool canonicalKmers);
 		Stage1Params& SetRamOnlyMode(bool ramOnlyMode);
+		Stage1Params& SetSingletonFilter(bool singletonFilter);
+		Stage1Params& SetSampleScale(uint64_t sampleScale);
 		Stage1Params& SetNBins(uint32_t nBins);
 		Stage1Params& SetNReaders(uint32_t nReaders);
 		Stage1Params& SetNSplitters(uint32_t nSplitters);
@@ -162,6 +166,8 @@ namespace KMC
 		InputFileType GetInputFileType() const noexcept { return inputFileType; }
 		bool GetCanonicalKmers() const noexcept { return canonicalKmers; }
 		bool GetRamOnlyMode() const noexcept { return ramOnlyMode; }
+		bool GetSingletonFilter() const noexcept { return singletonFilter; }
+		uint64_t GetSampleScale() const noexcept { return sampleScale; }
 		uint32_t GetNBins() const noexcept { return nBins; }
 		uint32_t GetNReaders() const noexcept { return nReaders; }
 		uint32_t GetNSplitters() const noexcept { return nSplitters; }
@@ -187,10 +193,16 @@ namespace KMC
 		std::string outputFileName;
 		OutputFileType outputFileType = OutputFileType::KMC;
 		bool withoutOutput = false;
+		bool lutEliasFano = false;
+		bool compressSuffixes = false;
+		uint64_t sketchScale = 0;
+		std::string sketchFileName;
 		uint32_t strictMemoryNSortingThreadsPerSorters = 0;
 		uint32_t strictMemoryNUncompactors = 0;
 		uint32_t strictMemoryNMergers = 0;
-
+#ifdef DEVELOP_MODE
+		bool developForceBigBins = false;
+#endif
 		
 	public:	
 		Stage2Params& SetMaxRamGB(uint32_t maxRamGB);
@@ -202,9 +214,16 @@ namespace KMC
 		Stage2Params& SetOutputFileName(const std::string& outputFileName);
 		Stage2Params& SetOutputFileType(OutputFileType outputFileType);
 		Stage2Params& SetWithoutOutput(bool withoutOutput);		
+		Stage2Params& SetLutEliasFano(bool lutEliasFano);
+		Stage2Params& SetCompressSuffixes(bool compressSuffixes);
+		Stage2Params& SetSketchScale(uint64_t sketchScale);
+		Stage2Params& SetSketchFileName(const std::string& sketchFileName);
 		Stage2Params& SetStrictMemoryNSortingThreadsPerSorters(uint32_t strictMemoryNSortingThreadsPerSorters);
 		Stage2Params& SetStrictMemoryNUncompactors(uint32_t strictMemoryNUncompactors);
 		Stage2Params& SetStrictMemoryNMergers(uint32_t strictMemoryNMergers);
+#ifdef DEVELOP_MODE
+		Stage2Params& SetDevelopForceBigBins(bool developForceBigBins);
+#endif
 
 		uint32_t GetMaxRamGB() const noexcept { return maxRamGB; }
 		uint32_t GetNThreads() const noexcept { return nThreads; }
@@ -215,9 +234,16 @@ namespace KMC
 		const std::string& GetOutputFileName() const noexcept { return outputFileName; }
 		OutputFileType GetOutputFileType() const noexcept { return outputFileType; }
 		bool GetWithoutOutput() const noexcept { return withoutOutput; }
+		bool GetLutEliasFano() const noexcept { return lutEliasFano; }
+		bool GetCompressSuffixes() const noexcept { return compressSuffixes; }
+		uint64_t GetSketchScale() const noexcept { return sketchScale; }
+		const std::string& GetSketchFileName() const noexcept { return sketchFileName; }
 		uint32_t GetStrictMemoryNSortingThreadsPerSorters() const noexcept { return strictMemoryNSortingThreadsPerSorters; }
 		uint32_t GetStrictMemoryNUncompactors() const noexcept { return strictMemoryNUncompactors; }
 		uint32_t GetStrictMemoryNMergers() const noexcept { return strictMemoryNMergers; }
+#ifdef DEVELOP_MODE
+		bool GetDevelopForceBigBins() const noexcept { return developForceBigBins; }
+#endif
 	};
 
 	struct Stage1Results
@@ -240,6 +266,7 @@ namespace KMC
 		uint64_t nAboveCutoffMax{};
 		uint64_t nTotalKmers{}; //TODO: this can be get after first stage, maybe changed
 		uint64_t nUniqueKmers{};
+		std::vector<uint64_t> histogram; //only for OutputFileType::HISTOGRAM, histogram[i] - no. of counted k-mers of counter i
 	};
 
 	
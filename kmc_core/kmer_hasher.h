@@ -0,0 +1,140 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _KMER_HASHER_H
+#define _KMER_HASHER_H
+
+#include "defs.h"
+#include "libs/ntHash/ntHash.hpp"
+
+//************************************************************************************************************
+// CNtKmerHasher - rolling ntHash of consecutive k-mers of a sequence of symbol codes (0..3)
+// Canonical ntHash (the same value for a k-mer and its reverse complement) is used when counting canonical k-mers
+//************************************************************************************************************
+class CNtKmerHasher
+{
+	uint32 kmer_len;
+	bool both_strands;
+	uint64 seed_tab[4];
+	uint64 out_tab[4];			//seed of a symbol leaving the window, rotated by k
+
+public:
+	CNtKmerHasher(uint32 _kmer_len, bool _both_strands) :
+		kmer_len(_kmer_len), both_strands(_both_strands)
+	{
+		const uint64 seeds[4] = { seedA, seedC, seedG, seedT };
+		const uint64* ms31[4] = { A31l, C31l, G31l, T31l };
+		const uint64* ms33[4] = { A33r, C33r, G33r, T33r };
+		for (uint32 i = 0; i < 4; ++i)
+		{
+			seed_tab[i] = seeds[i];
+			out_tab[i] = ms31[i][kmer_len % 31] | ms33[i][kmer_len % 33];
+		}
+	}
+
+	// Finalizer of MurmurHash3, ntHash values are not well mixed in the lower bits. It is also chained over words
+	// of k-mers by CKmerSketch, which must select the same k-mers as kmer_hash of kmc_tools (kmc_tools/kmer.h)
+	static FORCE_INLINE uint64 mix(uint64 x)
+	{
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdull;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ull;
+		x ^= x >> 33;
+		return x;
+	}
+
+	//----------------------------------------------------------------------------------
+	// Call f(i, hash) for each k-mer seq[i..i+k-1] of a sequence of length at least k (hash is not mixed)
+	template<typename F> FORCE_INLINE void ForEachKmer(const char* seq, uint32 len, F&& f) const
+	{
+		uint64 fh = 0, rh = 0;
+		for (uint32 i = 0; i < len; ++i)
+		{
+			uchar c = (uchar)seq[i];
+			fh = swapbits033(rol1(fh)) ^ seed_tab[c];
+			if (i >= kmer_len)
+				fh ^= out_tab[(uchar)seq[i - kmer_len]];
+			if (both_strands)
+			{
+				rh ^= out_tab[3 - c];
+				if (i >= kmer_len)
+					rh ^= seed_tab[3 - (uchar)seq[i - kmer_len]];
+				rh = swapbits3263(ror1(rh));
+			}
+			if (i + 1 >= kmer_len)
+				f(i + 1 - kmer_len, both_strands && rh < fh ? rh : fh);
+		}
+	}
+};
+
+//************************************************************************************************************
+// CKmerSampler - FracMinHash subsampling of k-mers in stage 1: a k-mer is kept if its hash is <= 2^64/scale,
+// so about 1/scale of distinct k-mers (with all their occurrences) is counted.
+// The ntHash is mixed with a salt to be independent of the hash used by the singleton filter
+//************************************************************************************************************
+class CKmerSampler
+{
+	static const uint64 SAMPLE_SALT = 0x9e3779b97f4a7c15ull;
+
+	CNtKmerHasher hasher;
+	uint32 kmer_len;
+	uint64 max_hash;
+
+	FORCE_INLINE bool IsSampledHash(uint64 h) const
+	{
+		return CNtKmerHasher::mix(h ^ SAMPLE_SALT) <= max_hash;
+	}
+
+public:
+	CKmerSampler(uint64 scale, uint32 _kmer_len, bool both_strands) :
+		hasher(_kmer_len, both_strands), kmer_len(_kmer_len)
+	{
+		max_hash = scale > 1 ? ~0ull / scale : ~0ull;
+	}
+
+	//----------------------------------------------------------------------------------
+	// Call f(start, n_kmers) for each maximal run of consecutive sampled k-mers of a sequence of length at least k
+	template<typename F> FORCE_INLINE void ForEachSampledRun(const char* seq, uint32 len, F&& f) const
+	{
+		uint32 run_start = 0;
+		uint32 run_len = 0;
+		hasher.ForEachKmer(seq, len, [&](uint32 i, uint64 h) {
+			if (IsSampledHash(h))
+			{
+				if (!run_len)
+					run_start = i;
+				++run_len;
+			}
+			else if (run_len)
+			{
+				f(run_start, run_len);
+				run_len = 0;
+			}
+		});
+		if (run_len)
+			f(run_start, run_len);
+	}
+
+	//----------------------------------------------------------------------------------
+	// Check a single k-mer (kmer_len symbols)
+	FORCE_INLINE bool IsSampled(const char* kmer) const
+	{
+		bool sampled = false;
+		hasher.ForEachKmer(kmer, kmer_len, [&](uint32, uint64 h) {
+			sampled = IsSampledHash(h);
+		});
+		return sampled;
+	}
+};
+
+#endif
+
+// ***** EOF
@@ -0,0 +1,126 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#include "kmer_sketch.h"
+#include "kmer_hasher.h"
+#include "critical_error_handler.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+//************************************************************************************************************
+// CKmerSketch
+//************************************************************************************************************
+
+//----------------------------------------------------------------------------------
+CKmerSketch::CKmerSketch(const std::string& file_name, uint64 scale, uint32 kmer_len, uint32 prefix_len, uint64 suffix_bytes, uint64 counter_size, bool counter_big_endian, bool canonical) :
+	file_name(file_name),
+	scale(scale),
+	kmer_len(kmer_len),
+	prefix_len(prefix_len),
+	suffix_bytes(suffix_bytes),
+	counter_size(counter_size),
+	counter_big_endian(counter_big_endian),
+	canonical(canonical)
+{
+	max_hash = scale > 1 ? ~0ull / scale : ~0ull;
+	n_words = (kmer_len + 31) / 32;
+}
+
+//----------------------------------------------------------------------------------
+// Add a single k-mer given by its prefix and record (suffix and counter) if its hash is small enough
+void CKmerSketch::Add(uint64 prefix, const uchar* rec)
+{
+	uint64 words[KMER_WORDS] = {};
+
+	// suffix bytes do not cross words, byte j of suffix starts at bit 8 * (suffix_bytes - 1 - j)
+	for (uint64 j = 0; j < suffix_bytes; ++j)
+	{
+		uint64 pos = 8 * (suffix_bytes - 1 - j);
+		words[pos / 64] |= (uint64)rec[j] << (pos % 64);
+	}
+	if (prefix_len)
+	{
+		uint64 pos = 8 * suffix_bytes;
+		words[pos / 64] |= prefix << (pos % 64);
+		if (pos % 64 + 2 * prefix_len > 64)
+			words[pos / 64 + 1] |= prefix >> (64 - pos % 64);
+	}
+
+	uint64 h = CNtKmerHasher::mix(words[0]);
+	for (uint32 i = 1; i < n_words; ++i)
+		h = CNtKmerHasher::mix(h ^ words[i]);
+	if (h > max_hash)
+		return;
+
+	uint64 counter = 0;
+	const uchar* counter_bytes = rec + suffix_bytes;
+	if (!counter_size)
+		counter = 1;
+	else if (counter_big_endian)
+		for (uint64 i = 0; i < counter_size; ++i)
+			counter = (counter << 8) + counter_bytes[i];
+	else
+		for (int32 i = (int32)counter_size - 1; i >= 0; --i)
+			counter = (counter << 8) + counter_bytes[i];
+
+	hashes.emplace_back(h, counter);
+}
+
+//----------------------------------------------------------------------------------
+// Sort hashes and store the sketch in the file
+void CKmerSketch::Store()
+{
+	std::sort(hashes.begin(), hashes.end());
+
+	FILE* out = fopen(file_name.c_str(), "wb");
+	if (!out)
+	{
+		std::ostringstream ostr;
+		ostr << "Error: Cannot create " << file_name;
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+
+	uint32 counter_bytes = counter_size > 4 ? 8 : 4;
+	std::vector<uchar> buf;
+	auto store_number = [&buf](uint64 x, uint32 n_bytes) {
+		for (uint32 i = 0; i < n_bytes; ++i, x >>= 8)
+			buf.push_back(x & 0xFF);
+	};
+	buf.insert(buf.end(), { 'K', 'M', 'S', 'K' });
+	store_number(VERSION, 4);
+	store_number(kmer_len, 4);
+	store_number(canonical, 4);
+	store_number(counter_bytes, 4);
+	store_number(scale, 8);
+	store_number(hashes.size(), 8);
+
+	bool ok = true;
+	for (auto& e : hashes)
+	{
+		store_number(e.first, 8);
+		store_number(e.second, counter_bytes);
+		if (buf.size() >= (1 << 20))
+		{
+			ok = ok && fwrite(buf.data(), 1, buf.size(), out) == buf.size();
+			buf.clear();
+		}
+	}
+	ok = ok && fwrite(buf.data(), 1, buf.size(), out) == buf.size();
+	fclose(out);
+	if (!ok)
+	{
+		std::ostringstream ostr;
+		ostr << "Error: Cannot write to " << file_name;
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+}
+
+// ***** EOF
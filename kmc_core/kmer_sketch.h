@@ -0,0 +1,56 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _KMER_SKETCH_H
+#define _KMER_SKETCH_H
+
+#include "defs.h"
+#include <string>
+#include <vector>
+#include <utility>
+
+//************************************************************************************************************
+// CKmerSketch - FracMinHash (scaled) sketch of counted k-mers: k-mers of hash <= 2^64/scale with their
+// counters. The hash is the same as in kmc_tools distance -s<scale>: finalizer of MurmurHash3 chained over
+// 64-bit words of the k-mer (the least significant first), so the same k-mers are selected.
+// K-mers are given as records of completed bins: prefix (prefix_len symbols) and record of suffix bytes
+// (the most significant first) and counter (little endian for KMC layout, big endian for KFF layout).
+// File format (all numbers little endian):
+//   header : "KMSK", version, kmer_len, canonical, counter_bytes (uint32 each), scale, no. of hashes (uint64)
+//   records: sorted by hash: hash (uint64) and counter (counter_bytes)
+//************************************************************************************************************
+class CKmerSketch
+{
+	static const uint32 VERSION = 1;
+
+	std::string file_name;
+	uint64 scale;
+	uint64 max_hash;
+	uint32 kmer_len;
+	uint32 prefix_len;
+	uint64 suffix_bytes;
+	uint64 counter_size;
+	bool counter_big_endian;
+	bool canonical;
+	uint32 n_words;
+
+	std::vector<std::pair<uint64, uint64>> hashes;
+
+public:
+	CKmerSketch(const std::string& file_name, uint64 scale, uint32 kmer_len, uint32 prefix_len, uint64 suffix_bytes, uint64 counter_size, bool counter_big_endian, bool canonical);
+
+	void Add(uint64 prefix, const uchar* rec);
+	void Store();
+	uint64 Size() const { return hashes.size(); }
+};
+
+#endif
+
+// ***** EOF
@@ -0,0 +1,256 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#include "kmer_stream_writer.h"
+#include "critical_error_handler.h"
+#include <cstring>
+#include <sstream>
+
+//************************************************************************************************************
+// CKmerStreamWriter
+//************************************************************************************************************
+
+//----------------------------------------------------------------------------------
+CKmerStreamWriter::CKmerStreamWriter(const std::string& file_name, OutputType stream_type, uint32 kmer_len, uint32 lut_prefix_len, uint64 counter_size, uint64 cutoff_max, std::vector<uint64>& histogram, CKmerSketch* sketch) :
+	stream_type(stream_type),
+	kmer_len(kmer_len),
+	lut_prefix_len(lut_prefix_len),
+	counter_size(counter_size),
+	file_name(file_name),
+	histogram(histogram),
+	sketch(sketch)
+{
+	suffix_bytes = (kmer_len - lut_prefix_len) / 4;
+	rec_size = suffix_bytes + counter_size;
+	single_lut_mask = (1ull << (2 * lut_prefix_len)) - 1;
+	dump_counter_bytes = counter_size > 4 ? 8 : 4;
+
+	const char codes[] = { 'A', 'C', 'G', 'T' };
+	uint32 pos = 0;
+	for (uint32 byte = 0; byte < 256; ++byte)
+		for (int32 shift = 6; shift >= 0; shift -= 2)
+			ACGT[pos++] = codes[(byte >> shift) & 3];
+
+	if (stream_type == OutputType::HISTOGRAM)
+	{
+		uint64 max_counter = !counter_size ? 1 : counter_size >= 8 ? ~0ull : (1ull << (8 * counter_size)) - 1;
+		histogram.assign(MIN(cutoff_max, MIN(max_counter, HISTOGRAM_MAX_COUNTER_DEFAULT)) + 1, 0);
+	}
+	if (stream_type == OutputType::HISTOGRAM || stream_type == OutputType::KMC)
+		return;
+
+	out = file_name == "-" ? stdout : fopen(file_name.c_str(), "wb");
+	if (!out)
+	{
+		std::ostringstream ostr;
+		ostr << "Error: Cannot create " << file_name;
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+	out_buf.resize(OUT_BUF_SIZE);
+
+	if (stream_type == OutputType::BINARY_DUMP)
+	{
+		Write("KMCD", 4);
+		StoreNumber(VERSION, 4);
+		StoreNumber(kmer_len, 4);
+		StoreNumber(0b00011011, 4); //ACGT
+		StoreNumber((kmer_len + 3) / 4, 4);
+		StoreNumber(dump_counter_bytes, 4);
+		StoreNumber(0, 4); //layout: rows
+	}
+}
+
+//----------------------------------------------------------------------------------
+CKmerStreamWriter::~CKmerStreamWriter()
+{
+	if (out && out != stdout)
+		fclose(out);
+}
+
+//----------------------------------------------------------------------------------
+// Add LUT counts (not cumulated) of consecutive prefixes, decode suffixes waiting for them
+void CKmerStreamWriter::AddLut(const uint64* counts, uint64 n)
+{
+	if (stream_type == OutputType::HISTOGRAM && !sketch)
+		return;
+
+	if (lut_head == lut_left.size())
+	{
+		lut_left.clear();
+		lut_head = 0;
+	}
+	lut_left.insert(lut_left.end(), counts, counts + n);
+
+	if (!pending_suf.empty())
+	{
+		uint64 consumed = Consume(pending_suf.data(), pending_suf.size());
+		pending_suf.erase(pending_suf.begin(), pending_suf.begin() + consumed);
+	}
+}
+
+//----------------------------------------------------------------------------------
+// Add records of consecutive k-mers, those without LUT counts yet are kept until AddLut
+void CKmerStreamWriter::AddSuffixes(const uchar* data, uint64 size)
+{
+	if (stream_type == OutputType::HISTOGRAM && !sketch)
+	{
+		for (const uchar* rec = data; rec < data + size; rec += rec_size)
+			Store(0, rec);
+		return;
+	}
+
+	if (pending_suf.empty())
+	{
+		uint64 consumed = Consume(data, size);
+		pending_suf.assign(data + consumed, data + size);
+	}
+	else
+	{
+		pending_suf.insert(pending_suf.end(), data, data + size);
+		uint64 consumed = Consume(pending_suf.data(), pending_suf.size());
+		pending_suf.erase(pending_suf.begin(), pending_suf.begin() + consumed);
+	}
+}
+
+//----------------------------------------------------------------------------------
+// Decode as many records as there are LUT counts for
+// RET	: number of bytes consumed
+uint64 CKmerStreamWriter::Consume(const uchar* data, uint64 size)
+{
+	const uchar* rec = data;
+	const uchar* end = data + size / rec_size * rec_size;
+	while (lut_head < lut_left.size())
+	{
+		uint64& left = lut_left[lut_head];
+		for (; left && rec < end; --left, rec += rec_size)
+			Store(lut_idx & single_lut_mask, rec);
+		if (left)
+			break;
+		++lut_head;
+		++lut_idx;
+	}
+	if (lut_head == lut_left.size())
+	{
+		lut_left.clear();
+		lut_head = 0;
+	}
+	return rec - data;
+}
+
+//----------------------------------------------------------------------------------
+uint64 CKmerStreamWriter::Counter(const uchar* rec) const
+{
+	if (!counter_size)
+		return 1;
+	uint64 counter = 0;
+	for (int32 i = (int32)counter_size - 1; i >= 0; --i)
+		counter = (counter << 8) + rec[suffix_bytes + i];
+	return counter;
+}
+
+//----------------------------------------------------------------------------------
+// Store a single k-mer given by its prefix and record (suffix and counter)
+void CKmerStreamWriter::Store(uint64 prefix, const uchar* rec)
+{
+	if (sketch)
+		sketch->Add(prefix, rec);
+	if (stream_type == OutputType::KMC)
+		return;
+
+	uint64 counter = Counter(rec);
+	if (stream_type == OutputType::HISTOGRAM)
+	{
+		if (counter < histogram.size())
+			++histogram[counter];
+		return;
+	}
+
+	if (out_pos + kmer_len + 32 > OUT_BUF_SIZE)
+		Flush();
+	char* ptr = out_buf.data() + out_pos;
+	if (stream_type == OutputType::DUMP)
+	{
+		for (int32 i = (int32)lut_prefix_len - 1; i >= 0; --i)
+			*ptr++ = "ACGT"[(prefix >> (2 * i)) & 3];
+		for (uint64 i = 0; i < suffix_bytes; ++i, ptr += 4)
+			memcpy(ptr, ACGT + 4 * rec[i], 4);
+		*ptr++ = '\t';
+		char digits[24];
+		int32 n_digits = 0;
+		do
+			digits[n_digits++] = '0' + counter % 10;
+		while (counter /= 10);
+		while (n_digits)
+			*ptr++ = digits[--n_digits];
+		*ptr++ = '\n';
+	}
+	else
+	{
+		//suffix is a whole number of bytes, so prefix fills the leading bytes
+		for (int32 i = (int32)(lut_prefix_len + 3) / 4 - 1; i >= 0; --i)
+			*ptr++ = (char)((prefix >> (8 * i)) & 0xFF);
+		memcpy(ptr, rec, suffix_bytes);
+		ptr += suffix_bytes;
+		for (uint32 i = 0; i < dump_counter_bytes; ++i, counter >>= 8)
+			*ptr++ = (char)(counter & 0xFF);
+	}
+	out_pos = ptr - out_buf.data();
+}
+
+//----------------------------------------------------------------------------------
+void CKmerStreamWriter::StoreNumber(uint64 x, uint32 n_bytes)
+{
+	char bytes[8];
+	for (uint32 i = 0; i < n_bytes; ++i, x >>= 8)
+		bytes[i] = x & 0xFF;
+	Write(bytes, n_bytes);
+}
+
+//----------------------------------------------------------------------------------
+void CKmerStreamWriter::Write(const char* data, uint64 size)
+{
+	if (out_pos + size > OUT_BUF_SIZE)
+		Flush();
+	memcpy(out_buf.data() + out_pos, data, size);
+	out_pos += size;
+}
+
+//----------------------------------------------------------------------------------
+void CKmerStreamWriter::Flush()
+{
+	if (out_pos && fwrite(out_buf.data(), 1, out_pos, out) != out_pos)
+	{
+		std::ostringstream ostr;
+		ostr << "Error: Cannot write to " << file_name;
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+	out_pos = 0;
+}
+
+//----------------------------------------------------------------------------------
+// Write the rest of the output, all records must be decoded already
+void CKmerStreamWriter::Finish()
+{
+	if (!pending_suf.empty())
+	{
+		std::ostringstream ostr;
+		ostr << "Error: no LUT for " << pending_suf.size() / rec_size << " k-mers streamed to " << file_name;
+		CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+	}
+	if (!out)
+		return;
+	Flush();
+	fflush(out);
+	if (out != stdout)
+		fclose(out);
+	out = nullptr;
+}
+
+// ***** EOF
@@ -0,0 +1,82 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _KMER_STREAM_WRITER_H
+#define _KMER_STREAM_WRITER_H
+
+#include "defs.h"
+#include "params.h"
+#include "kmer_sketch.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+
+//************************************************************************************************************
+// CKmerStreamWriter - streams completed bins (in KMC layout: records of suffix and counter, LUT with the
+// number of records of each prefix) directly to the output instead of storing a database:
+//   DUMP        : text lines "<k-mer>\t<counter>\n" (as kmc_tools transform dump)
+//   BINARY_DUMP : header and rows of k-mer and counter (as kmc_tools transform dump -fbin)
+//   HISTOGRAM   : only counters are accumulated in the histogram, nothing is written. The histogram is sized
+//                 once for all counters from 0 to MIN(cutoff_max, max. counter of counter_size,
+//                 HISTOGRAM_MAX_COUNTER_DEFAULT), greater counters are not counted, the same as by
+//                 kmc_tools transform histogram for the database that would be stored
+//   KMC         : nothing is written (the database is stored by the completer), k-mers are only decoded for
+//                 the sketch
+// Each k-mer is also added to the sketch if given.
+// LUT counts and suffixes may be added in any order and in any pieces, records are decoded as soon as
+// the LUT counts for them are known. Output file name "-" means the standard output
+//************************************************************************************************************
+class CKmerStreamWriter
+{
+	static const uint64 OUT_BUF_SIZE = 1 << 20;
+	static const uint32 VERSION = 1;
+
+	OutputType stream_type;
+	uint32 kmer_len;
+	uint32 lut_prefix_len;
+	uint64 counter_size;
+	uint64 suffix_bytes;
+	uint64 rec_size;
+	uint64 single_lut_mask;
+	uint32 dump_counter_bytes;
+
+	std::string file_name;
+	FILE* out = nullptr;
+	std::vector<char> out_buf;
+	uint64 out_pos = 0;
+	char ACGT[1024];		//4 symbols of each byte of packed k-mer
+
+	std::vector<uint64> lut_left;		//LUT counts (of records not decoded yet) of consecutive prefixes
+	uint64 lut_head = 0;
+	uint64 lut_idx = 0;					//global index of LUT entry at lut_head
+	std::vector<uchar> pending_suf;		//records added before their LUT counts
+
+	std::vector<uint64>& histogram;
+	CKmerSketch* sketch;
+
+	uint64 Consume(const uchar* data, uint64 size);
+	uint64 Counter(const uchar* rec) const;
+	void Write(const char* data, uint64 size);
+	void Flush();
+	void StoreNumber(uint64 x, uint32 n_bytes);
+
+public:
+	CKmerStreamWriter(const std::string& file_name, OutputType stream_type, uint32 kmer_len, uint32 lut_prefix_len, uint64 counter_size, uint64 cutoff_max, std::vector<uint64>& histogram, CKmerSketch* sketch);
+	~CKmerStreamWriter();
+
+	void AddLut(const uint64* counts, uint64 n);
+	void AddSuffixes(const uchar* data, uint64 size);
+	void Store(uint64 prefix, const uchar* rec);
+	void Finish();
+};
+
+#endif
+
+// ***** EOF
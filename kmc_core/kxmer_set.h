@@ -13,128 +13,61 @@
 #include <tuple>
 #include <queue>
 #include "exception_aware_thread.h"
+#include "loser_tree.h"
 
 using namespace std;
 
 #define KXMER_SET_SIZE 1024 
 
-#define MAX_FOR_X_3 112
-
-template <unsigned SIZE>
-class CKXmerSet;
-
-template<bool> struct Range;
-
-template<unsigned SIZE, unsigned PARENT, typename = Range<true> >
-struct ParentFinder
-{
-	static uint32 Execute(CKXmerSet<SIZE>& ptr, const CKmer<SIZE>& kmer);
-};
-
-template<unsigned SIZE, unsigned PARENT>
-struct ParentFinder<SIZE, PARENT, Range<(PARENT < 56)> >
-{
-	FORCE_INLINE static uint32 Execute(CKXmerSet<SIZE>& ptr, const CKmer<SIZE>& kmer)
-	{
-		if (ptr.data[PARENT * 2].first < ptr.data[PARENT * 2 + 1].first)
-		{
-			if (ptr.data[PARENT * 2].first < kmer)
-			{
-				ptr.data[PARENT] = ptr.data[PARENT * 2];
-				return ParentFinder<SIZE, PARENT * 2>::Execute(ptr, kmer);
-			}
-		}
-		else
-		{
-			if (ptr.data[PARENT * 2 + 1].first < kmer)
-			{
-				ptr.data[PARENT] = ptr.data[PARENT * 2 + 1];
-				return ParentFinder<SIZE, PARENT * 2 + 1>::Execute(ptr, kmer);
-			}
-		}
-		return PARENT;
-	}
-};
-
-template<unsigned SIZE, unsigned PARENT>
-struct ParentFinder<SIZE, PARENT, Range<(PARENT == 56)> >
-{
-	FORCE_INLINE static uint32 Execute(CKXmerSet<SIZE>& ptr, const CKmer<SIZE>& kmer)
-	{
-		if (ptr.data[PARENT * 2].first < kmer)
-		{
-			ptr.data[PARENT] = ptr.data[PARENT * 2];
-			return PARENT * 2;
-		}
-		return PARENT;
-	}
-};
-
-template<unsigned SIZE, unsigned PARENT>
-struct ParentFinder<SIZE, PARENT, Range<(PARENT > 56)> >
-{
-	FORCE_INLINE static uint32 Execute(CKXmerSet<SIZE>& /*ptr*/, const CKmer<SIZE>& /*kmer*/)
-	{		
-		return PARENT;		
-	}
-};
-
 template <unsigned SIZE>
 class CKXmerSet
 {
 	typedef tuple<uint64, uint64, uint32> elem_desc_t; //start_pos, end_pos, shr
-	typedef pair<CKmer<SIZE>, uint32> heap_elem_t; //kxmer val, desc_id
 	elem_desc_t data_desc[KXMER_SET_SIZE];
-	
-public: 
-	heap_elem_t data[KXMER_SET_SIZE];
-private:
-	uint32 pos;
+	CLoserTree<CKmer<SIZE>> tree;
 	uint32 desc_pos;
+	bool tree_ready;
 	CKmer<SIZE> mask;
 	CKmer<SIZE>* buffer;
 
-	inline void update_heap()
+	inline void prepare_tree()
 	{
-		uint32 desc_id = data[1].second;
+		tree.init(desc_pos);
 		CKmer<SIZE> kmer;
+		for (uint32 i = 0; i < desc_pos; ++i)
+		{
+			kmer.from_kxmer(buffer[get<0>(data_desc[i])], get<2>(data_desc[i]), mask);
+			tree.set(i, kmer);
+		}
+		tree.build();
+		tree_ready = true;
+	}
+
+	inline void update_tree()
+	{
+		uint32 desc_id = tree.winner();
 		if (++get<0>(data_desc[desc_id]) < get<1>(data_desc[desc_id]))
 		{
+			CKmer<SIZE> kmer;
 			kmer.from_kxmer(buffer[get<0>(data_desc[desc_id])], get<2>(data_desc[desc_id]), mask);
+			tree.replace_winner(kmer);
 		}
 		else
-		{
-			kmer.set(data[--pos].first);
-			desc_id = data[pos].second;
-			data[pos].first.fill_T();		
-		}
-
-		uint32 parent = ParentFinder<SIZE, 1>::Execute(*this, kmer);
-
-		data[parent] = make_pair(kmer, desc_id);
+			tree.remove_winner();
 	}
 
 public:
 	CKXmerSet(uint32 kmer_len)
 	{
-		pos = 1;
 		mask.set_n_1(kmer_len * 2);
-		desc_pos = 0;		
+		desc_pos = 0;
+		tree_ready = false;
 	}	
 
 	inline void init_add(uint64 start_pos, uint64 end_pos, uint32 shr)
 	{		
-		data_desc[desc_pos] = make_tuple(start_pos, end_pos, shr);
-		data[pos].first.from_kxmer(buffer[start_pos], shr, mask);
-		data[pos].second = desc_pos;
-		uint32 child_pos = pos++;
-
-		while (child_pos > 1 && data[child_pos].first < data[child_pos / 2].first)
-		{
-			swap(data[child_pos], data[child_pos / 2]);
-			child_pos /= 2;
-		}
-		++desc_pos;
+		data_desc[desc_pos++] = make_tuple(start_pos, end_pos, shr);
+		tree_ready = false;
 	}
 	inline void set_buffer(CKmer<SIZE>* _buffer)
 	{
@@ -142,22 +75,19 @@ public:
 	}
 	inline void clear()
 	{
-		pos = 1;
 		desc_pos = 0;
-		for (uint32 i = 0; i < KXMER_SET_SIZE; ++i)
-		{
-			data[i].first.fill_T();
-			data[i].second = -1;
-		}
+		tree_ready = false;
 	}
 
 	inline bool get_min(uint64& _pos, CKmer<SIZE>& kmer)
 	{
-		if (pos <= 1)		
-			return false;				
-		kmer = data[1].first;
-		_pos = get<0>(data_desc[data[1].second]);
-		update_heap();
+		if (!tree_ready)
+			prepare_tree();
+		if (tree.empty())
+			return false;
+		kmer = tree.winner_key();
+		_pos = get<0>(data_desc[tree.winner()]);
+		update_tree();
 		
 		return true;
 	}
@@ -189,7 +119,75 @@ class CSubArrayDescGenerator
 	uint32* kxmer_counters;
 	uint64 n_kxmer_counters;
 	uint32 n_threads;
-public:	
+
+	//----------------------------------------------------------------------------------
+	// Find positions splitting sub arrays (from their current starts) so that the first part contains (about) target records
+	// The boundary is the largest k-mer K, such that the number of records smaller than K does not exceed target
+	// (the only exception is when a single k-mer takes more than target records, then it is put into the first part)
+	// Invariant: split positions for the boundary lie in [lo[i], hi[i]] of each sub array
+	void CoRank(const vector<SubArrayDesc>& descs, uint64 target, const CKmer<SIZE>& mask, vector<uint64>& lo)
+	{
+		uint32 n_descs = (uint32)descs.size();
+		lo.resize(n_descs);
+		vector<uint64> hi(n_descs), lb(n_descs), ub(n_descs);
+		for (uint32 i = 0; i < n_descs; ++i)
+		{
+			lo[i] = descs[i].start;
+			hi[i] = descs[i].end;
+		}
+		uint64 rank_lo = 0;
+
+		while (true)
+		{
+			uint32 pivot_id = 0;
+			for (uint32 i = 1; i < n_descs; ++i)
+				if (hi[i] - lo[i] > hi[pivot_id] - lo[pivot_id])
+					pivot_id = i;
+			if (hi[pivot_id] == lo[pivot_id])
+				break;
+
+			CKmer<SIZE> pivot;
+			pivot.from_kxmer(buffer[lo[pivot_id] + (hi[pivot_id] - lo[pivot_id]) / 2], descs[pivot_id].shr, mask);
+
+			uint64 rank_lb = 0, rank_ub = 0;
+			for (uint32 i = 0; i < n_descs; ++i)
+			{
+				uint32 shr = descs[i].shr;
+				lb[i] = std::lower_bound(buffer + lo[i], buffer + hi[i], pivot, [shr, &mask](const CKmer<SIZE>& k1, const CKmer<SIZE>& k2)
+				{
+					CKmer<SIZE> val;
+					val.from_kxmer(k1, shr, mask);
+					return val < k2;
+				}) - buffer;
+				ub[i] = std::upper_bound(buffer + lb[i], buffer + hi[i], pivot, [shr, &mask](const CKmer<SIZE>& k1, const CKmer<SIZE>& k2)
+				{
+					CKmer<SIZE> val;
+					val.from_kxmer(k2, shr, mask);
+					return k1 < val;
+				}) - buffer;
+				rank_lb += lb[i] - lo[i];
+				rank_ub += ub[i] - lo[i];
+			}
+
+			if (rank_lo + rank_ub <= target)		//all records up to pivot fit
+			{
+				lo.swap(ub);
+				rank_lo += rank_ub;
+			}
+			else if (rank_lo + rank_lb <= target)		//boundary is exactly at pivot
+			{
+				if (rank_lo + rank_lb == 0)		//records of pivot alone exceed target, do not produce empty part
+					lo.swap(ub);
+				else
+					lo.swap(lb);
+				break;
+			}
+			else
+				hi.swap(lb);
+		}
+	}
+
+public:
 	CSubArrayDescGenerator(uint32 kmer_len, uint32 n_parts, const vector<SubArrayDesc>& sub_array_descs, CKmer<SIZE>* buffer, uint32 cutoff_min, uint32 rec_len, uint32* kxmer_counters, uint64 n_kxmer_counters, uint32 n_threads) :
 		kmer_len(kmer_len),
 		n_parts(n_parts),
@@ -235,38 +233,32 @@ public:
 				cumsum[j] += to_add;
 		}
 
-		//find biggest
-		uint32 biggest_id = 0;
-		for (uint32 i = 0; i < sub_array_descs.size(); ++i)
-		{
-			if (sub_array_descs[i].end - sub_array_descs[i].start > sub_array_descs[biggest_id].end - sub_array_descs[biggest_id].start)
-				biggest_id = i;
-		}
-
-		uint64 start_in_biggest = 0;
+		//merge-path (co-ranking) partitioning: part boundaries are chosen so that each part holds the same number of input records,
+		//regardless of the distribution of prefixes. Records of the same k-mer never cross a part boundary
+		uint64 n_recs = 0;
+		for (auto& e : sub_array_descs)
+			n_recs += e.end - e.start;
 
 		vector<SubArrayDesc> sub_array_desc_copy(sub_array_descs.begin(), sub_array_descs.end());
 
 		CKmer<SIZE> mask;
-		mask.set_n_1(kmer_len * 2);		
-		while (parts_left > 1)
+		mask.set_n_1(kmer_len * 2);
+		uint64 n_recs_done = 0;
+		vector<uint64> split;
+		for (uint32 part_id = 1; part_id < n_parts; ++part_id)
 		{
-			uint64 end_in_biggest = (sub_array_desc_copy[biggest_id].end - sub_array_desc_copy[biggest_id].start - start_in_biggest) / parts_left + sub_array_desc_copy[biggest_id].start;
-			CKmer<SIZE> kmer;
-			kmer.from_kxmer(buffer[end_in_biggest], sub_array_desc_copy[biggest_id].shr, mask);
+			uint64 part_end = n_recs * part_id / n_parts;
+			uint64 target = part_end > n_recs_done ? part_end - n_recs_done : 0;
+
+			CoRank(sub_array_desc_copy, target, mask, split);
 
 			vector<SubArrayDesc> current;
-			for (auto& e : sub_array_desc_copy)
+			for (uint32 i = 0; i < sub_array_desc_copy.size(); ++i)
 			{
-				uint32 shr = e.shr;
-				uint64 new_end = std::lower_bound(buffer + e.start , buffer + e.end, kmer, [shr, mask](const CKmer<SIZE>& k1, const CKmer<SIZE>& k2)
-				{
-					CKmer<SIZE> val;
-					val.from_kxmer(k1, shr, mask);
-					return val < k2;
-				}) - buffer;
-				current.push_back({ e.start, new_end, shr, 0 });
-				e.start = new_end;
+				auto& e = sub_array_desc_copy[i];
+				current.push_back({ e.start, split[i], e.shr, 0 });
+				n_recs_done += split[i] - e.start;
+				e.start = split[i];
 			}
 
 			//count exact number of k-mers in each subarray of part						
@@ -0,0 +1,153 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _LOSER_TREE_H
+#define _LOSER_TREE_H
+
+#include "defs.h"
+#include <vector>
+#include <utility>
+
+//************************************************************************************************************
+// CLoserTree - tournament (loser) tree for multiway merging of sorted k-mer streams
+// Keys of the current leaders of all streams are kept contiguously (one KEY per leaf),
+// internal nodes keep only ids of losers, so selecting the next element costs one k-mer comparison per level
+// (instead of about two comparisons per level in a binary heap)
+// The streams are owned by the caller, which has to provide the next key of the winning stream (or mark it as exhausted)
+// KEY is a k-mer type (CKmer<SIZE> of kmc_core or kmc_tools) providing operator< and fill_T() (the largest key)
+//************************************************************************************************************
+template<typename KEY>
+class CLoserTree
+{
+	uint32 n_leaves;			//always power of 2
+	uint32 n_active;
+	std::vector<KEY> keys;
+	std::vector<uchar> exhausted;
+	std::vector<uint32> losers;	//losers[0] is the winner
+	std::vector<uint32> winners;	//used only while building
+
+	//a wins with b, exhausted leaves have key filled with T and lose with everything
+	FORCE_INLINE bool wins(uint32 a, uint32 b) const
+	{
+		return keys[a] < keys[b] || (exhausted[b] && !exhausted[a]);
+	}
+
+	FORCE_INLINE void replay(uint32 leaf)
+	{
+		uint32 winner = leaf;
+		for (uint32 node = (leaf + n_leaves) >> 1; node; node >>= 1)
+			if (wins(losers[node], winner))
+				std::swap(losers[node], winner);
+		losers[0] = winner;
+	}
+
+public:
+	CLoserTree() : n_leaves(0), n_active(0)
+	{
+	}
+
+	//----------------------------------------------------------------------------------
+	// Prepare for n streams, leaves are initially exhausted
+	void init(uint32 n)
+	{
+		n_leaves = 1;
+		while (n_leaves < n)
+			n_leaves <<= 1;
+		keys.resize(n_leaves);
+		exhausted.resize(n_leaves);
+		losers.resize(n_leaves);
+		for (uint32 i = 0; i < n_leaves; ++i)
+		{
+			keys[i].fill_T();
+			exhausted[i] = true;
+		}
+		n_active = 0;
+	}
+
+	//----------------------------------------------------------------------------------
+	// Set the first key of a stream (before build)
+	inline void set(uint32 leaf, const KEY& key)
+	{
+		keys[leaf] = key;
+		if (exhausted[leaf])
+		{
+			exhausted[leaf] = false;
+			++n_active;
+		}
+	}
+
+	//----------------------------------------------------------------------------------
+	// Play the initial tournament
+	void build()
+	{
+		winners.resize(2 * n_leaves);
+		for (uint32 i = 0; i < n_leaves; ++i)
+			winners[n_leaves + i] = i;
+		for (uint32 node = n_leaves - 1; node; --node)
+		{
+			uint32 a = winners[2 * node];
+			uint32 b = winners[2 * node + 1];
+			if (wins(b, a))
+				std::swap(a, b);
+			winners[node] = a;
+			losers[node] = b;
+		}
+		losers[0] = winners[1];
+	}
+
+	inline bool empty() const
+	{
+		return n_active == 0;
+	}
+
+	inline uint32 no_active() const
+	{
+		return n_active;
+	}
+
+	inline bool is_exhausted(uint32 leaf) const
+	{
+		return exhausted[leaf];
+	}
+
+	inline uint32 winner() const
+	{
+		return losers[0];
+	}
+
+	inline const KEY& winner_key() const
+	{
+		return keys[losers[0]];
+	}
+
+	//----------------------------------------------------------------------------------
+	// The winning stream advanced to the next key
+	inline void replace_winner(const KEY& key)
+	{
+		uint32 leaf = losers[0];
+		keys[leaf] = key;
+		replay(leaf);
+	}
+
+	//----------------------------------------------------------------------------------
+	// The winning stream has no more keys
+	inline void remove_winner()
+	{
+		uint32 leaf = losers[0];
+		keys[leaf].fill_T();
+		exhausted[leaf] = true;
+		--n_active;
+		replay(leaf);
+	}
+};
+
+#endif
+
+// ***** EOF
@@ -20,6 +20,7 @@
 #include <memory>
 #include "libs/ntHash/ntHashWrapper.h"
 #include "tmp_files_owner.h"
+#include "singleton_filter.h"
 
 using InputType = KMC::InputFileType;
 using OutputType = KMC::OutputFileType;
@@ -37,10 +38,16 @@ struct CKMCParams {
 	string output_file_name;
 	string working_directory;
 	InputType file_type;
-	OutputType output_type;
+	OutputType output_type;			// layout of completed bins (KMC also for stream outputs)
+	bool stream_output = false;		// completed bins are streamed as stream_type (DUMP, BINARY_DUMP, HISTOGRAM) instead of storing the database
+	OutputType stream_type = OutputType::KMC;
+	uint64 sketch_scale = 0;		// FracMinHash sketch of counted k-mers of hash <= 2^64/sketch_scale is stored in sketch_file_name (0 - no sketch)
+	string sketch_file_name;
 
 	string json_summary_file_name = "";
 	bool without_output = false;
+	bool lut_elias_fano = false;		// store LUT of KMC database Elias-Fano encoded (database version 0x201)
+	bool compress_suffixes = false;		// store compressed *.kmc_suf (database version 0x202, 0x203 with lut_elias_fano)
 
 	uint32 lut_prefix_len;
 
@@ -77,6 +84,7 @@ struct CKMCParams {
 	KMC::IProgressObserver* progressObserver;
 #ifdef DEVELOP_MODE
 	bool verbose_log;
+	bool force_big_bins = false;	// strict memory mode: process every bin as a big bin, sorted in small parts (for testing)
 #endif
 
 	int kmer_len;			// kmer length
@@ -88,6 +96,9 @@ struct CKMCParams {
 	bool homopolymer_compressed; //count homopolymer compressed k-mers
 	bool both_strands;		// find canonical representation of each k-mer
 	bool mem_mode;			// use RAM instead of disk
+	bool singleton_filter;	// do not pass to stage 2 k-mers occurring once (requires cutoff_min > 1)
+	int64 mem_singleton_filter;	// memory for the counting Bloom filter of the singleton filter
+	uint64 sample_scale = 0;	// count only k-mers of (ntHash based) hash <= 2^64/sample_scale (0 - count all k-mers)
 
 	int n_bins;				// number of bins;
 	int bin_part_size;		// size of a bin part; fixed: 2^15
@@ -181,10 +192,14 @@ struct CKMCQueues
 	std::unique_ptr<CMemoryPool> sm_pmm_merger_suff;
 	
 	std::unique_ptr<CCompletedBinsCollector> sm_cbc;
+	std::unique_ptr<CBigBinMergeRangesQueue> bbmrq;
 	std::unique_ptr<CSortersManager> sorters_manager;
 
 	std::unique_ptr<CntHashEstimator> ntHashEstimator;
 
+	std::unique_ptr<CSingletonFilter> singleton_filter;
+	std::unique_ptr<CSplittersBarrier> splitters_barrier;
+
 	std::unique_ptr<CTmpFilesOwner> tmp_files_owner;
 };
 
@@ -26,6 +26,8 @@
 #include <thread>
 #include <mutex>
 #include <algorithm>
+#include <memory>
+#include <vector>
 
 using namespace std;
 
@@ -372,6 +374,34 @@ public:
 	}
 };
 
+//************************************************************************************************************
+// CSplittersBarrier - splitters wait here until all of them processed the whole input (used by the singleton filter)
+//************************************************************************************************************
+class CSplittersBarrier
+{
+	int n_threads;
+	int n_arrived;
+
+	mutable mutex mtx;
+	CThrowingOnCancelConditionVariable cv;
+public:
+	CSplittersBarrier(int _n_threads)
+	{
+		lock_guard<mutex> lck(mtx);
+
+		n_threads = _n_threads;
+		n_arrived = 0;
+	}
+
+	void arrive_and_wait() {
+		unique_lock<mutex> lck(mtx);
+		if (++n_arrived == n_threads)
+			cv.notify_all();
+		else
+			cv.wait(lck, [this]{return n_arrived == n_threads; });
+	}
+};
+
 //************************************************************************************************************
 class CExpanderPackDesc
 {
@@ -2007,6 +2037,125 @@ public:
 };
 
 
+//************************************************************************************************************
+// CBigBinMergeRangesQueue - ranges of k-mer space of big bins (strict memory mode) to be merged concurrently
+// Ranges are given in order, the merged parts of each bin are pushed for storing range by range (in order)
+//************************************************************************************************************
+struct CBigBinSubBinDesc
+{
+	uint32 lut_prefix_len;
+	uint64 n_kmers;
+	FILE* file;
+	string name;
+	uint64 file_size;
+	vector<uint64> part_cumsum; //no. of k-mers before each part prefix
+};
+
+struct CBigBinMergeDesc
+{
+	int32 bin_id;
+	uint32 n_ranges;
+	uint32 part_prefix_len;
+	vector<CBigBinSubBinDesc> sub_bins;
+};
+
+struct CBigBinMergeRange
+{
+	std::shared_ptr<CBigBinMergeDesc> bin;
+	uint32 range_id;
+	uint64 part_start, part_end;
+};
+
+class CBigBinMergeRangesQueue
+{
+	//next range to store, no. of ranges, n_unique, n_cutoff_min, n_cutoff_max, n_total (of ranges that already passed the turn)
+	typedef std::tuple<uint32, uint32, uint64, uint64, uint64, uint64> bin_state_t;
+	list<CBigBinMergeRange> l;
+	map<int32, bin_state_t> bins; //state of a bin is removed when its last range passes the turn
+	mutable mutex mtx;
+	CThrowingOnCancelConditionVariable cv_pop, cv_turn;
+	bool splitting;
+	bool completed;
+
+public:
+	CBigBinMergeRangesQueue()
+	{
+		splitting = false;
+		completed = false;
+	}
+
+	//if there is no range to merge and no other thread is splitting a bin the caller is asked to split the next bin
+	bool pop(CBigBinMergeRange& range, bool& split_next_bin)
+	{
+		unique_lock<mutex> lck(mtx);
+		cv_pop.wait(lck, [this]{return !l.empty() || !splitting; });
+		split_next_bin = false;
+		if (!l.empty())
+		{
+			range = std::move(l.front());
+			l.pop_front();
+			return true;
+		}
+		if (completed)
+			return false;
+		splitting = split_next_bin = true;
+		return true;
+	}
+
+	void push(vector<CBigBinMergeRange>& ranges)
+	{
+		lock_guard<mutex> lck(mtx);
+		bins[ranges.front().bin->bin_id] = std::make_tuple(0u, (uint32)ranges.size(), 0ull, 0ull, 0ull, 0ull);
+		for (auto& r : ranges)
+			l.push_back(std::move(r));
+		splitting = false;
+		cv_pop.notify_all();
+	}
+
+	void mark_completed()
+	{
+		lock_guard<mutex> lck(mtx);
+		completed = true;
+		splitting = false;
+		cv_pop.notify_all();
+	}
+
+	void wait_for_turn(int32 bin_id, uint32 range_id)
+	{
+		unique_lock<mutex> lck(mtx);
+		cv_turn.wait(lck, [this, bin_id, range_id]{return get<0>(bins.at(bin_id)) == range_id; });
+	}
+
+	void pass_turn(int32 bin_id, uint64 n_unique, uint64 n_cutoff_min, uint64 n_cutoff_max, uint64 n_total)
+	{
+		lock_guard<mutex> lck(mtx);
+		auto it = bins.find(bin_id);
+		auto& bin = it->second;
+		if (++get<0>(bin) == get<1>(bin))
+		{
+			bins.erase(it);
+			return;
+		}
+		get<2>(bin) += n_unique;
+		get<3>(bin) += n_cutoff_min;
+		get<4>(bin) += n_cutoff_max;
+		get<5>(bin) += n_total;
+		cv_turn.notify_all();
+	}
+
+	//stats of ranges that already passed the turn
+	void get_stats(int32 bin_id, uint64& n_unique, uint64& n_cutoff_min, uint64& n_cutoff_max, uint64& n_total)
+	{
+		lock_guard<mutex> lck(mtx);
+		auto& bin = bins.at(bin_id);
+		n_unique = get<2>(bin);
+		n_cutoff_min = get<3>(bin);
+		n_cutoff_max = get<4>(bin);
+		n_total = get<5>(bin);
+	}
+};
+
+
 class CDiskLogger
 {
 	uint64 current;
@@ -24,6 +24,7 @@
 #include "first_dispatch.h"
 #include "intr_copy.h"
 #include "raduls.h"
+#include "bitonic_sort.h"
 
 #define IS_NARROW(x, y)	((x) < (y) * 16)
 
@@ -132,6 +133,10 @@ namespace RadulsSort
 	template<typename KMER_T>
 	inline void SmallSortDispatch(KMER_T* kmers, uint64 size)
 	{
+#if defined(__AVX2__)
+		if (size >= BITONIC_SORT_MIN_SIZE && size <= BITONIC_SORT_MAX_SIZE && BitonicSort::SortAVX2(kmers, size))
+			return;
+#endif
 		if (size <= get_insertion_sort_threshold(KMER_T::KMER_SIZE))
 			InsertionSortDispatch(kmers, (int)size);
 		else if (size <= get_shell_sort_threshold(KMER_T::KMER_SIZE))
@@ -60,7 +60,7 @@ public:
 		my_fseek(file, -12, SEEK_END);
 		uint32_t kmc_version;
 		fread(&kmc_version, sizeof(uint32), 1, file);
-		if (kmc_version != 0x200)
+		if (kmc_version < 0x200 || kmc_version > 0x203)
 		{
 			std::ostringstream ostr;
 			ostr << "currently only KMC databases in version 2 can be readed. If needed to read other version please post an GitHub issue.";
@@ -91,6 +91,16 @@ public:
 		auto single_prefix_array_size_bytes = (1ull << (2 * lut_prefix_len)) * sizeof(uint64_t);
 		auto n_prefixes_arrays = (tot_prefixes_size_bytes - sizeof(uint64_t)) / single_prefix_array_size_bytes; //n_bins
 
+		if (kmc_version & 0x1)
+		{
+			//Elias-Fano encoded LUT starts with the number of its elements (all LUTs and a guard)
+			uint64_t n_lut_recs;
+			my_fseek(file, 4, SEEK_SET);
+			fread(&n_lut_recs, sizeof(uint64_t), 1, file);
+			n_prefixes_arrays = (n_lut_recs - 1) >> (2 * lut_prefix_len);
+			my_fseek(file, map_start_pos, SEEK_SET);
+		}
+
 		if (n_bins != n_prefixes_arrays)
 		{
 			std::ostringstream ostr;
@@ -0,0 +1,284 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _SINGLETON_FILTER_H
+#define _SINGLETON_FILTER_H
+
+#include "defs.h"
+#include "critical_error_handler.h"
+#include "kmer_hasher.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+
+//************************************************************************************************************
+// CSingletonFilter - blocked counting Bloom filter used in stage 1 to recognize k-mers seen for the first time
+// Each 64-bit word contains 32 saturating 2-bit counters, a k-mer is mapped to a single word and to
+// SINGLETON_FILTER_N_HASHES counters inside it, so insertion is a single CAS on one word (conservative update).
+// The estimated count (minimum of the counters) is never lower than the true count, so a k-mer for which
+// the estimate is 1 after all the input was processed occurred exactly once
+// The part of the memory budget not used by the filter holds postponed spans in RAM only mode (see CMaybeSpansFile)
+//************************************************************************************************************
+class CSingletonFilter
+{
+	static const uint32 SINGLETON_FILTER_N_HASHES = 4;
+	static const uint64 SINGLETON_FILTER_MIN_WORDS = 1ull << 17;
+
+	std::unique_ptr<std::atomic<uint64>[]> words;
+	uint64 n_words;
+	uint64 words_mask;
+
+	CNtKmerHasher hasher;
+
+	std::atomic<uint32> n_streams;
+	std::atomic<int64> mem_spans_left;
+
+	static FORCE_INLINE uint32 shift(uint64 x, uint32 i)
+	{
+		return (uint32)((x >> (40 + 5 * i)) & 31) * 2;
+	}
+
+public:
+	CSingletonFilter(uint64 size_in_bytes, uint32 _kmer_len, bool _both_strands) :
+		hasher(_kmer_len, _both_strands), n_streams(0)
+	{
+		n_words = SINGLETON_FILTER_MIN_WORDS;
+		while (n_words * 2 * sizeof(uint64) <= size_in_bytes)
+			n_words *= 2;
+		words_mask = n_words - 1;
+		words.reset(new std::atomic<uint64>[n_words]);
+		for (uint64 i = 0; i < n_words; ++i)
+			words[i].store(0, std::memory_order_relaxed);
+		mem_spans_left = (int64)size_in_bytes - (int64)GetSize();
+	}
+
+	uint64 GetSize() const
+	{
+		return n_words * sizeof(uint64);
+	}
+
+	// Unique id of a splitter using the filter (used to name its temporary file)
+	uint32 RegisterStream()
+	{
+		return n_streams++;
+	}
+
+	// Reserve memory for a block of postponed spans kept in RAM, false if the budget is exhausted
+	bool ReserveSpansMem(uint64 size)
+	{
+		if (mem_spans_left.fetch_sub((int64)size) >= (int64)size)
+			return true;
+		mem_spans_left += size;
+		return false;
+	}
+
+	//----------------------------------------------------------------------------------
+	// Call f(i, hash) for each k-mer seq[i..i+k-1] of a sequence of symbol codes (0..3) of length at least k
+	// Canonical ntHash (the same value for a k-mer and its reverse complement) is used when counting canonical k-mers
+	template<typename F> FORCE_INLINE void ForEachKmer(const char* seq, uint32 len, F&& f) const
+	{
+		hasher.ForEachKmer(seq, len, [&](uint32 i, uint64 h) {
+			f(i, CNtKmerHasher::mix(h));
+		});
+	}
+
+	//----------------------------------------------------------------------------------
+	// Increment counters of a k-mer, returns the estimated count before the insertion (0 if the k-mer is new)
+	FORCE_INLINE uint32 Insert(uint64 h)
+	{
+		std::atomic<uint64>& word = words[h & words_mask];
+		uint64 old_val = word.load(std::memory_order_relaxed);
+		while (true)
+		{
+			uint32 c_min = 3;
+			for (uint32 i = 0; i < SINGLETON_FILTER_N_HASHES; ++i)
+				c_min = MIN(c_min, (uint32)(old_val >> shift(h, i)) & 3);
+			if (c_min == 3)
+				return c_min;
+
+			uint64 new_val = old_val;
+			for (uint32 i = 0; i < SINGLETON_FILTER_N_HASHES; ++i)
+			{
+				uint32 s = shift(h, i);
+				if (((old_val >> s) & 3) == c_min)
+					new_val = (new_val & ~(3ull << s)) | ((uint64)(c_min + 1) << s);
+			}
+			if (word.compare_exchange_weak(old_val, new_val, std::memory_order_relaxed))
+				return c_min;
+		}
+	}
+
+	//----------------------------------------------------------------------------------
+	// Estimated count of a k-mer (saturated at 3)
+	FORCE_INLINE uint32 Estimate(uint64 h) const
+	{
+		uint64 val = words[h & words_mask].load(std::memory_order_relaxed);
+		uint32 c_min = 3;
+		for (uint32 i = 0; i < SINGLETON_FILTER_N_HASHES; ++i)
+			c_min = MIN(c_min, (uint32)(val >> shift(h, i)) & 3);
+		return c_min;
+	}
+};
+
+//************************************************************************************************************
+// CMaybeSpansFile - per splitter stream of super-k-mer spans which k-mers were all seen for the first time
+// Record: bin id (4 bytes), no. of symbols (2 bytes), symbols packed 4 per byte
+// Records are grouped in blocks that are written (to disk or to memory in RAM only mode) as a whole
+// In RAM only mode blocks are kept in memory as long as the budget of the filter allows, the next ones go to disk
+//************************************************************************************************************
+class CMaybeSpansFile
+{
+	static const uint64 BLOCK_SIZE = 1ull << 20;
+
+	bool mem_mode;
+	CSingletonFilter& filter;
+	std::string name;
+	FILE* file = nullptr;
+
+	std::vector<uchar> block;
+	std::vector<std::vector<uchar>> mem_blocks;
+	std::vector<uint64> block_sizes;
+	uint64 n_recs = 0;
+
+	uint64 read_block_id = 0;
+	uint64 read_pos = 0;
+
+	void FlushBlock()
+	{
+		if (block.empty())
+			return;
+		if (mem_mode && filter.ReserveSpansMem(block.size()))
+			mem_blocks.push_back(block);
+		else
+		{
+			mem_mode = false;		//memory blocks precede disk blocks
+			if (!file)
+			{
+				file = fopen(name.c_str(), "wb+");
+				if (!file)
+				{
+					std::ostringstream ostr;
+					ostr << "Error: Cannot open temporary file " << name;
+					CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+				}
+			}
+			if (fwrite(block.data(), 1, block.size(), file) != block.size())
+			{
+				std::ostringstream ostr;
+				ostr << "Error: Cannot write to temporary file " << name;
+				CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+			}
+		}
+		block_sizes.push_back(block.size());
+		block.clear();
+	}
+
+	bool LoadBlock()
+	{
+		if (read_block_id >= block_sizes.size())
+			return false;
+		if (read_block_id < mem_blocks.size())
+			block = std::move(mem_blocks[read_block_id]);
+		else
+		{
+			block.resize(block_sizes[read_block_id]);
+			if (fread(block.data(), 1, block.size(), file) != block.size())
+			{
+				std::ostringstream ostr;
+				ostr << "Error: Cannot read temporary file " << name;
+				CCriticalErrorHandler::Inst().HandleCriticalError(ostr.str());
+			}
+		}
+		++read_block_id;
+		read_pos = 0;
+		return true;
+	}
+
+public:
+	CMaybeSpansFile(bool _mem_mode, const std::string& working_directory, CSingletonFilter& _filter) : mem_mode(_mem_mode), filter(_filter)
+	{
+		uint32 id = filter.RegisterStream();
+		name = working_directory;
+		if (!name.empty() && *name.rbegin() != '/' && *name.rbegin() != '\\')
+			name += "/";
+		name += "kmc_maybe_" + std::to_string(id) + ".bin";
+		block.reserve(BLOCK_SIZE);
+	}
+
+	~CMaybeSpansFile()
+	{
+		if (file)
+		{
+			fclose(file);
+			remove(name.c_str());
+		}
+	}
+
+	uint64 GetNRecs() const
+	{
+		return n_recs;
+	}
+
+	//----------------------------------------------------------------------------------
+	void Put(uint32 bin_id, const char* seq, uint32 len)
+	{
+		uint64 rec_size = 6 + (len + 3) / 4;
+		if (block.size() + rec_size > BLOCK_SIZE)
+			FlushBlock();
+		uint64 pos = block.size();
+		block.resize(pos + rec_size);
+		uchar* p = block.data() + pos;
+		memcpy(p, &bin_id, 4);
+		uint16_t len16 = (uint16_t)len;
+		memcpy(p + 4, &len16, 2);
+		p += 6;
+		memset(p, 0, (len + 3) / 4);
+		for (uint32 i = 0; i < len; ++i)
+			p[i >> 2] |= (uchar)(seq[i] << (6 - 2 * (i & 3)));
+		++n_recs;
+	}
+
+	//----------------------------------------------------------------------------------
+	// Finish writing and start reading from the beginning
+	void StartReading()
+	{
+		FlushBlock();
+		if (file)
+			rewind(file);
+		read_block_id = 0;
+		read_pos = 0;
+		block.clear();
+	}
+
+	//----------------------------------------------------------------------------------
+	bool Get(uint32& bin_id, char* seq, uint32& len)
+	{
+		if (read_pos >= block.size() && !LoadBlock())
+			return false;
+		const uchar* p = block.data() + read_pos;
+		uint16_t len16;
+		memcpy(&bin_id, p, 4);
+		memcpy(&len16, p + 4, 2);
+		len = len16;
+		p += 6;
+		for (uint32 i = 0; i < len; ++i)
+			seq[i] = (char)((p[i >> 2] >> (6 - 2 * (i & 3))) & 3);
+		read_pos += 6 + (len + 3) / 4;
+		return true;
+	}
+};
+
+#endif
+
+// ***** EOF
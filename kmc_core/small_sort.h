@@ -19,12 +19,28 @@ Date   : 2024-02-09
 #include <functional>
 #include <array>
 #include <string>
+#include <ostream>
+#include <mutex>
 #include <array>
 #include "defs.h"
 #include "kmer.h"
+#include "cpu_info.h"
 
 using namespace std;
 
+// Bitonic sorting networks for tiny arrays, implemented in small_sort_avx2.cpp (compiled with AVX2 enabled)
+// Return false if the array cannot be sorted this way (too large or unsupported k-mer size)
+#ifndef __aarch64__
+bool BitonicSortAVX2(CKmer<1>* ptr, uint32 size);
+bool BitonicSortAVX2(CKmer<2>* ptr, uint32 size);
+#endif
+
+template<unsigned SIZE>
+bool BitonicSortAVX2(CKmer<SIZE>* /*ptr*/, uint32 /*size*/)
+{
+	return false;
+}
+
 
 template<unsigned SIZE>
 class CSmallSort {
@@ -32,6 +48,7 @@ class CSmallSort {
 	
 	static vector<function<void(CKmer<SIZE> *, uint32)>> sorters;
 	static vector<function<void(CKmer<SIZE> *, uint32)>> algorithms;
+	static vector<string> algorithm_names;
 
 	static CKmer<SIZE> *arr, *arr_orig;
 	static vector<vector<double>> sorter_times;
@@ -43,6 +60,7 @@ class CSmallSort {
 	static void shell_sort_1_7(CKmer<SIZE> *ptr, uint32 size);
 	static void shell_sort_1_8(CKmer<SIZE> *ptr, uint32 size);
 	static void shell_sort_1_10(CKmer<SIZE> *ptr, uint32 size);
+	static void bitonic_sort(CKmer<SIZE> *ptr, uint32 size);
 
 	static void PrepareArray(void)
 	{
@@ -68,6 +86,7 @@ class CSmallSort {
 	static void EvaluateAlgorithms(uint32 max_small_size)
 	{
 		algorithms.clear();
+		algorithm_names.clear();
 
 		algorithms.push_back(CSmallSort::std_sort);
 		algorithms.push_back(CSmallSort::ins_sort_loop);
@@ -75,6 +94,15 @@ class CSmallSort {
 		algorithms.push_back(CSmallSort::shell_sort_1_7);
 		algorithms.push_back(CSmallSort::shell_sort_1_8);
 		algorithms.push_back(CSmallSort::shell_sort_1_10);
+		algorithm_names = { "std_sort", "ins_sort_loop", "ins_sort_hybrid", "shell_sort_1_7", "shell_sort_1_8", "shell_sort_1_10" };
+
+#ifndef __aarch64__
+		if (SIZE <= 2 && CCpuInfo::AVX2_Enabled())
+		{
+			algorithms.push_back(CSmallSort::bitonic_sort);
+			algorithm_names.push_back("bitonic_avx2");
+		}
+#endif
 
 		sorter_times.resize(max_small_size + 1);
 
@@ -176,6 +204,26 @@ public:
 	{
 		sorters[size](ptr, size);
 	}
+
+	// Micro-benchmark of all available algorithms, prints average time of sorting a single array of each size (in ns)
+	static void Benchmark(uint32 max_small_size, ostream& out)
+	{
+		PrepareArray();
+		EvaluateAlgorithms(max_small_size);
+		ReleaseArray();
+
+		out << "size";
+		for (auto& name : algorithm_names)
+			out << "\t" << name;
+		out << "\n";
+		for (uint32 part_size = 1; part_size <= max_small_size; ++part_size)
+		{
+			out << part_size;
+			for (auto t : sorter_times[part_size])
+				out << "\t" << t * 1e9;
+			out << "\n";
+		}
+	}
 };
 
 
@@ -188,6 +236,9 @@ vector<function<void(CKmer<SIZE> *, uint32)>> CSmallSort<SIZE>::sorters;
 template<unsigned SIZE>
 vector<function<void(CKmer<SIZE> *, uint32)>> CSmallSort<SIZE>::algorithms;
 
+template<unsigned SIZE>
+vector<string> CSmallSort<SIZE>::algorithm_names;
+
 template<unsigned SIZE>
 CKmer<SIZE> *CSmallSort<SIZE>::arr;
 
@@ -558,7 +609,12 @@ void CSmallSort<SIZE>::shell_sort_1_10(CKmer<SIZE>* ptr, uint32 size)
 	}
 }
 
-
+template<unsigned SIZE>
+void CSmallSort<SIZE>::bitonic_sort(CKmer<SIZE>* ptr, uint32 size)
+{
+	if (size < 2 || !BitonicSortAVX2(ptr, size))
+		ins_sort_hybrid(ptr, size);
+}
 
 #endif
 	
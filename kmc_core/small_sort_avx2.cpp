@@ -0,0 +1,24 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+  
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+  
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#include "small_sort.h"
+#include "bitonic_sort.h"
+
+bool BitonicSortAVX2(CKmer<1>* ptr, uint32 size)
+{
+	return BitonicSort::SortAVX2(ptr, size);
+}
+
+bool BitonicSortAVX2(CKmer<2>* ptr, uint32 size)
+{
+	return BitonicSort::SortAVX2(ptr, size);
+}
+
+// ***** EOF
@@ -51,6 +51,13 @@ CSplitter::CSplitter(CKMCParams &Params, CKMCQueues &Queues)
 	homopolymer_compressed = Params.homopolymer_compressed;
 
 	ntHashEstimator = Queues.ntHashEstimator.get();
+
+	singleton_filter = Queues.singleton_filter.get();
+	if (singleton_filter)
+		maybe_spans = std::make_unique<CMaybeSpansFile>(Params.mem_mode, Params.working_directory, *singleton_filter);
+
+	if (Params.sample_scale > 1)
+		sampler = std::make_unique<CKmerSampler>(Params.sample_scale, kmer_len, both_strands);
 }
 
 void CSplitter::InitBins(CKMCParams &Params, CKMCQueues &Queues)
@@ -552,6 +559,102 @@ bool CSplitter::ProcessReadsOnlyEstimate(uchar* _part, uint64 _part_size, ReadTy
 	return true;
 }
 
+//----------------------------------------------------------------------------------
+// Pass a super-k-mer to its bin, in subsampling mode only runs of sampled k-mers are passed
+void CSplitter::PutSpan(uint32 bin_no, char* seq, uint32 len)
+{
+	if (!sampler)
+	{
+		PutSampledSpan(bin_no, seq, len);
+		return;
+	}
+
+	sampler->ForEachSampledRun(seq, len, [&](uint32 run_start, uint32 run_len) {
+		PutSampledSpan(bin_no, seq + run_start, run_len + kmer_len - 1);
+	});
+}
+
+//----------------------------------------------------------------------------------
+// Pass a (sampled) super-k-mer to its bin, if singleton filter is used runs of k-mers seen for the first time
+// are postponed until the whole input is processed (see ResolveMaybeSpans)
+void CSplitter::PutSampledSpan(uint32 bin_no, char* seq, uint32 len)
+{
+	if (!singleton_filter)
+	{
+		bins[bin_no]->PutExtendedKmer(seq, len);
+		return;
+	}
+
+	uint32 run_start = 0;
+	uint32 run_len = 0;		//no. of consecutive k-mers of the same kind
+	bool run_new = false;
+	auto put_run = [&] {
+		if (run_new)
+			maybe_spans->Put(bin_no, seq + run_start, run_len + kmer_len - 1);
+		else
+			bins[bin_no]->PutExtendedKmer(seq + run_start, run_len + kmer_len - 1);
+	};
+
+	singleton_filter->ForEachKmer(seq, len, [&](uint32 i, uint64 h) {
+		bool is_new = singleton_filter->Insert(h) == 0;
+		if (run_len && is_new != run_new)
+		{
+			put_run();
+			run_len = 0;
+		}
+		if (!run_len)
+		{
+			run_start = i;
+			run_new = is_new;
+		}
+		++run_len;
+	});
+	put_run();
+}
+
+//----------------------------------------------------------------------------------
+// Pass to bins the postponed super-k-mers, k-mers occurring once in the whole input are dropped
+// Must be called when all splitters finished processing reads
+void CSplitter::ResolveMaybeSpans()
+{
+	if (!singleton_filter)
+		return;
+
+	char *seq;
+	pmm_reads->reserve(seq);
+
+	uint32 bin_no;
+	uint32 len;
+	maybe_spans->StartReading();
+	while (maybe_spans->Get(bin_no, seq, len))
+	{
+		uint32 run_start = 0;
+		uint32 run_len = 0;	//no. of consecutive k-mers occurring more than once
+		singleton_filter->ForEachKmer(seq, len, [&](uint32 i, uint64 h) {
+			if (singleton_filter->Estimate(h) > 1)
+			{
+				if (!run_len)
+					run_start = i;
+				++run_len;
+			}
+			else
+			{
+				++n_filtered_singletons;
+				if (run_len)
+				{
+					bins[bin_no]->PutExtendedKmer(seq + run_start, run_len + kmer_len - 1);
+					run_len = 0;
+				}
+			}
+		});
+		if (run_len)
+			bins[bin_no]->PutExtendedKmer(seq + run_start, run_len + kmer_len - 1);
+	}
+
+	pmm_reads->free(seq);
+	maybe_spans.reset();
+}
+
 //----------------------------------------------------------------------------------
 // Process the reads from the given FASTQ file part
 bool CSplitter::ProcessReads(uchar *_part, uint64 _part_size, ReadType read_type)
@@ -609,7 +712,7 @@ bool CSplitter::ProcessReads(uchar *_part, uint64 _part_size, ReadType read_type
 					if (len >= kmer_len)
 					{
 						bin_no = s_mapper->get_bin_id(current_signature.get());
-						bins[bin_no]->PutExtendedKmer(seq + i - len, len);
+						PutSpan(bin_no, seq + i - len, len);
 					}
 					len = 0;
 					++i;
@@ -621,7 +724,7 @@ bool CSplitter::ProcessReads(uchar *_part, uint64 _part_size, ReadType read_type
 					if (len >= kmer_len)
 					{
 						bin_no = s_mapper->get_bin_id(current_signature.get());
-						bins[bin_no]->PutExtendedKmer(seq + i - len, len);
+						PutSpan(bin_no, seq + i - len, len);
 						len = kmer_len - 1;
 					}
 					current_signature.set(end_mmer);
@@ -635,7 +738,7 @@ bool CSplitter::ProcessReads(uchar *_part, uint64 _part_size, ReadType read_type
 				else if (signature_start_pos + kmer_len - 1 < i)//need to find new signature
 				{
 					bin_no = s_mapper->get_bin_id(current_signature.get());
-					bins[bin_no]->PutExtendedKmer(seq + i - len, len);
+					PutSpan(bin_no, seq + i - len, len);
 					len = kmer_len - 1;
 					//looking for new signature
 					++signature_start_pos;
@@ -656,7 +759,7 @@ bool CSplitter::ProcessReads(uchar *_part, uint64 _part_size, ReadType read_type
 				if (len == kmer_len + 255) //one byte is used to store counter of additional symbols in extended k-mer
 				{
 					bin_no = s_mapper->get_bin_id(current_signature.get());
-					bins[bin_no]->PutExtendedKmer(seq + i + 1 - len, len);
+					PutSpan(bin_no, seq + i + 1 - len, len);
 					i -= kmer_len - 2;
 					len = 0;
 					break;
@@ -667,7 +770,7 @@ bool CSplitter::ProcessReads(uchar *_part, uint64 _part_size, ReadType read_type
 		if (len >= kmer_len)//last one in read
 		{
 			bin_no = s_mapper->get_bin_id(current_signature.get());
-			bins[bin_no]->PutExtendedKmer(seq + i - len, len);
+			PutSpan(bin_no, seq + i - len, len);
 		}
 	}
 
@@ -744,6 +847,9 @@ bool CSplitter::ProcessReadsSmallK(uchar *_part, uint64 _part_size, ReadType rea
 					continue;
 				}
 
+				if (sampler && !sampler->IsSampled(seq + i + 1 - kmer_len))
+					continue;
+
 				// Find canonical kmer representation
 				kmer_can = (kmer_str < kmer_rev) ? kmer_str : kmer_rev;
 
@@ -795,6 +901,9 @@ bool CSplitter::ProcessReadsSmallK(uchar *_part, uint64 _part_size, ReadType rea
 					continue;
 				}
 
+				if (sampler && !sampler->IsSampled(seq + i + 1 - kmer_len))
+					continue;
+
 				++small_k_buf.buf[kmer_str.data];
 				++total_kmers;
 			}
@@ -823,8 +932,10 @@ CWSplitter::CWSplitter(CKMCParams &Params, CKMCQueues &Queues)
 	pq = Queues.part_queue.get();
 	bpq = Queues.bpq.get();
 	pmm_fastq = Queues.pmm_fastq.get();
+	splitters_barrier = Queues.splitters_barrier.get();
 	spl = std::make_unique<CSplitter>(Params, Queues);
 	spl->InitBins(Params, Queues);
+	n_filtered_singletons = 0;
 }
 
 //----------------------------------------------------------------------------------
@@ -843,10 +954,16 @@ void CWSplitter::operator()()
 			pmm_fastq->free(part);
 		}
 	}
+	if (splitters_barrier)
+	{
+		splitters_barrier->arrive_and_wait();
+		spl->ResolveMaybeSpans();
+	}
 	spl->Complete();
 	bpq->mark_completed();
 
 	spl->GetTotal(n_reads);
+	n_filtered_singletons = spl->GetNFilteredSingletons();
 
 	spl.reset();
 }
@@ -867,6 +984,13 @@ void CWSplitter::GetTotal(uint64 &_n_reads)
 	_n_reads = n_reads;
 }
 
+//----------------------------------------------------------------------------------
+// Return the number of k-mers dropped by the singleton filter
+uint64 CWSplitter::GetNFilteredSingletons()
+{
+	return n_filtered_singletons;
+}
+
 
 //************************************************************************************************************
 // CWStatsSplitter class - wrapper for multithreading purposes
@@ -21,6 +21,8 @@
 #include <vector>
 #include "small_k_buf.h"
 #include "bam_utils.h"
+#include "singleton_filter.h"
+#include "kmer_hasher.h"
 
 using namespace std;
 
@@ -56,12 +58,21 @@ class CSplitter
 
 	CntHashEstimator* ntHashEstimator;
 
+	CSingletonFilter* singleton_filter;
+	std::unique_ptr<CMaybeSpansFile> maybe_spans;
+	uint64 n_filtered_singletons = 0;
+
+	std::unique_ptr<CKmerSampler> sampler;
+
 	bool GetSeqLongRead(char *seq, uint32 &seq_size, uchar header_marker);
 
 	bool GetSeq(char *seq, uint32 &seq_size, ReadType read_type);
 
 	void HomopolymerCompressSeq(char* seq, uint32 &seq_size);
 
+	void PutSpan(uint32 bin_no, char* seq, uint32 len);
+	void PutSampledSpan(uint32 bin_no, char* seq, uint32 len);
+
 public:
 	static uint32 MAX_LINE_SIZE;
 	
@@ -71,9 +82,11 @@ public:
 	bool ProcessReadsOnlyEstimate(uchar* _part, uint64 _part_size, ReadType read_type);
 	bool ProcessReads(uchar *_part, uint64 _part_size, ReadType read_type);
 	template<typename COUNTER_TYPE> bool ProcessReadsSmallK(uchar *_part, uint64 _part_size, ReadType read_type, CSmallKBuf<COUNTER_TYPE>& small_k_buf);
+	void ResolveMaybeSpans();
 	void Complete();
 	inline void GetTotal(uint64 &_n_reads);
 	inline uint64 GetTotalKmers();
+	uint64 GetNFilteredSingletons() { return n_filtered_singletons; }
 };
 
 //----------------------------------------------------------------------------------
@@ -99,14 +112,17 @@ class CWSplitter {
 	CPartQueue *pq;
 	CBinPartQueue *bpq;
 	CMemoryPool *pmm_fastq;
+	CSplittersBarrier *splitters_barrier;
 
 	std::unique_ptr<CSplitter> spl;
 	uint64 n_reads;
+	uint64 n_filtered_singletons;
 
 public:
 	CWSplitter(CKMCParams &Params, CKMCQueues &Queues);	
 	void operator()();
 	void GetTotal(uint64 &_n_reads);
+	uint64 GetNFilteredSingletons();
 	~CWSplitter();
 };
 
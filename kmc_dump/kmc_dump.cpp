@@ -12,8 +12,10 @@
 */
 
 #include <iostream>
+#include <thread>
 #include "../kmc_api/kmc_file.h"
 #include "nc_utils.h"
+#include "parallel_dump.h"
 
 
 void print_info(void);
@@ -41,10 +43,12 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
-	CKMCFile kmer_data_base;
 	int32 i;
 	uint32 min_count_to_set = 0;
 	uint32 max_count_to_set = 0;
+	uint32 n_threads = std::thread::hardware_concurrency();
+	CParallelDump::format_t format = CParallelDump::format_t::text;
+	bool gzip = false;
 	std::string input_file_name;
 	std::string output_file_name;
 
@@ -66,6 +70,16 @@ int main(int argc, char* argv[])
 				min_count_to_set = atoi(&argv[i][3]);
 			else if(strncmp(argv[i], "-cx", 3) == 0)
 					max_count_to_set = atoi(&argv[i][3]);
+			else if(strncmp(argv[i], "-t", 2) == 0)
+				n_threads = atoi(&argv[i][2]);
+			else if(strcmp(argv[i], "-gz") == 0)
+				gzip = true;
+			else if(strcmp(argv[i], "-fbin") == 0)
+				format = CParallelDump::format_t::rows;
+			else if(strcmp(argv[i], "-fcol") == 0)
+				format = CParallelDump::format_t::columns;
+			else if(strcmp(argv[i], "-ftext") == 0)
+				format = CParallelDump::format_t::text;
 		}
 		else
 			break;
@@ -89,54 +103,16 @@ int main(int argc, char* argv[])
 	setvbuf(out_file, NULL ,_IOFBF, 1 << 24);
 
 	//------------------------------------------------------------------------------
-	// Open kmer database for listing and print kmers within min_count and max_count
+	// List parts of kmer database by many threads and print kmers within min_count and max_count
 	//------------------------------------------------------------------------------
-
-	if (!kmer_data_base.OpenForListing(input_file_name))
-	{
-		print_info();
-		return EXIT_FAILURE ;
-	}
-	else
+	CParallelDump dump(input_file_name, out_file, n_threads, min_count_to_set, max_count_to_set, format, gzip);
+	if (!dump.Process())
 	{
-		uint32 _kmer_length;
-		uint32 _mode;
-		uint32 _counter_size;
-		uint32 _lut_prefix_length;
-		uint32 _signature_len;
-		uint32 _min_count;
-		uint64 _max_count;
-		uint64 _total_kmers;
-
-		kmer_data_base.Info(_kmer_length, _mode, _counter_size, _lut_prefix_length, _signature_len, _min_count, _max_count, _total_kmers);
-
-		
-		//std::string str;
-		char str[1024];
-		uint32 counter_len;
-		
-		CKmerAPI kmer_object(_kmer_length);
-		
-		if(min_count_to_set)
-		if (!(kmer_data_base.SetMinCount(min_count_to_set)))
-				return EXIT_FAILURE;
-		if(max_count_to_set)
-		if (!(kmer_data_base.SetMaxCount(max_count_to_set)))
-				return EXIT_FAILURE;	
-
-		uint64 counter;
-		while (kmer_data_base.ReadNextKmer(kmer_object, counter))
-		{
-			kmer_object.to_string(str);
-			str[_kmer_length] = '\t';
-			counter_len = CNumericConversions::Int2PChar(counter, (uchar*)str + _kmer_length + 1);
-			str[_kmer_length + 1 + counter_len] = '\n';
-			fwrite(str, 1, _kmer_length + counter_len + 2, out_file);
-		}
-	
 		fclose(out_file);
-		kmer_data_base.Close();
+		print_info();
+		return EXIT_FAILURE;
 	}
+	fclose(out_file);
 
 	return EXIT_SUCCESS; 
 }
@@ -151,7 +127,10 @@ void print_info(void)
 			  << "<kmc_database> - kmer_counter's output\n"
 			  << "Options:\n"
 			  << "-ci<value> - exclude k-mers occurring less than <value> times\n"
-			  << "-cx<value> - exclude k-mers occurring more of than <value> times\n";
+			  << "-cx<value> - exclude k-mers occurring more of than <value> times\n"
+			  << "-t<value> - number of threads (default: no. of CPU cores), the output does not depend on it\n"
+			  << "-f<text|bin|col> - output format (default: text), binary formats are the same as of kmc_tools transform dump\n"
+			  << "-gz - gzip compressed output\n";
 }
 
 // ***** EOF
@@ -0,0 +1,316 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  This file demonstrates the example usage of kmc_api software.
+  It lists parts of a database by many threads and prints kmers to an output file.
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#include <iostream>
+#include <thread>
+#include "parallel_dump.h"
+#include "nc_utils.h"
+#include "../kmc_api/kmc_file.h"
+#include "../3rd_party/cloudflare/zlib.h"
+
+//----------------------------------------------------------------------------------
+CParallelDump::CParallelDump(const std::string& input_file_name, FILE* out_file, uint32 n_threads, uint32 min_count, uint32 max_count, format_t format, bool gzip) :
+	input_file_name(input_file_name),
+	out_file(out_file),
+	n_threads(n_threads ? n_threads : 1),
+	min_count(min_count),
+	max_count(max_count),
+	format(format),
+	gzip(gzip)
+{
+	const char codes[] = { 'A', 'C', 'G', 'T' };
+	uint32 pos = 0;
+	for (uint32 byte = 0; byte < 256; ++byte)
+		for (int32 shift = 6; shift >= 0; shift -= 2)
+			ACGT[pos++] = codes[(byte >> shift) & 3];
+}
+
+//----------------------------------------------------------------------------------
+// Store k-mer (in the representation of CKMCFile::ReadNextKmers) in kmer_bytes bytes, the most significant first
+//----------------------------------------------------------------------------------
+void CParallelDump::StoreKmer(const uint64* kmer, char*& str) const
+{
+	for (int32 byte_no = kmer_bytes - 1; byte_no >= 0; --byte_no)
+		*str++ = (kmer[kmer_words - 1 - byte_no / 8] >> (8 * (byte_no % 8))) & 0xFF;
+}
+
+//----------------------------------------------------------------------------------
+// Store n_bytes of x, the least significant first
+//----------------------------------------------------------------------------------
+void CParallelDump::StoreNumber(uint64 x, uint32 n_bytes, char*& str)
+{
+	for (uint32 i = 0; i < n_bytes; ++i, x >>= 8)
+		*str++ = x & 0xFF;
+}
+
+//----------------------------------------------------------------------------------
+// Convert k-mer (in the representation of CKMCFile::ReadNextKmers) and its counter into a line of output
+// IN	: kmer - words of k-mer
+//		  count - counter of k-mer
+// OUT	: str - the line
+// RET	: the length of the line
+//----------------------------------------------------------------------------------
+uint32 CParallelDump::FormatText(const uint64* kmer, uint64 count, char* str) const
+{
+	char* ptr = str;
+	//the first byte may contain less than 4 symbols
+	for (int32 byte_no = kmer_bytes - 1; byte_no >= 0; --byte_no)
+	{
+		uint64 byte = (kmer[kmer_words - 1 - byte_no / 8] >> (8 * (byte_no % 8))) & 0xFF;
+		const char* symbols = ACGT + 4 * byte;
+		if (byte_no == (int32)kmer_bytes - 1)
+		{
+			for (uint32 i = 4 - in_first_byte; i < 4; ++i)
+				*ptr++ = symbols[i];
+			continue;
+		}
+		memcpy(ptr, symbols, 4);
+		ptr += 4;
+	}
+	*ptr++ = '\t';
+	ptr += CNumericConversions::Int2PChar(count, (uchar*)ptr);
+	*ptr++ = '\n';
+	return static_cast<uint32>(ptr - str);
+}
+
+//----------------------------------------------------------------------------------
+// Convert a batch of k-mers and their counters into output format
+// RET	: the number of bytes stored in str
+//----------------------------------------------------------------------------------
+uint64 CParallelDump::FormatBatch(const uint64* kmers, const uint64* counts, uint64 n, char* str) const
+{
+	char* ptr = str;
+	switch (format)
+	{
+	case format_t::text:
+		for (uint64 i = 0; i < n; ++i)
+			ptr += FormatText(kmers + i * kmer_words, counts[i], ptr);
+		break;
+	case format_t::rows:
+		for (uint64 i = 0; i < n; ++i)
+		{
+			StoreKmer(kmers + i * kmer_words, ptr);
+			StoreNumber(counts[i], counter_bytes, ptr);
+		}
+		break;
+	case format_t::columns:
+		StoreNumber(n, 4, ptr);
+		for (uint64 i = 0; i < n; ++i)
+			StoreKmer(kmers + i * kmer_words, ptr);
+		for (uint64 i = 0; i < n; ++i)
+			StoreNumber(counts[i], counter_bytes, ptr);
+		break;
+	}
+	return ptr - str;
+}
+
+//----------------------------------------------------------------------------------
+// Replace buf by a gzip member containing it
+//----------------------------------------------------------------------------------
+void CParallelDump::Compress(std::vector<char>& buf, std::vector<char>& tmp)
+{
+	z_stream stream{};
+	if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		std::cerr << "Error: cannot initialize gzip compression\n";
+		exit(1);
+	}
+	tmp.resize(deflateBound(&stream, buf.size()));
+	stream.next_in = (Bytef*)buf.data();
+	stream.avail_in = static_cast<uInt>(buf.size());
+	stream.next_out = (Bytef*)tmp.data();
+	stream.avail_out = static_cast<uInt>(tmp.size());
+	if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
+	{
+		std::cerr << "Error: gzip compression failed\n";
+		exit(1);
+	}
+	tmp.resize(stream.total_out);
+	deflateEnd(&stream);
+	buf.swap(tmp);
+}
+
+//----------------------------------------------------------------------------------
+// Pass a buffer of formatted k-mers of a part to the writer. Waits if the part is not written currently and
+// it has already enough buffers queued
+//----------------------------------------------------------------------------------
+void CParallelDump::PushBuf(uint32 part_id, std::vector<char>& buf, bool last)
+{
+	std::unique_lock<std::mutex> lck(mtx);
+	cv_space.wait(lck, [this, part_id] {return part_id == writing_part || parts[part_id].bufs.size() < MAX_QUEUED_BUFS; });
+	parts[part_id].bufs.push_back(std::move(buf));
+	if (last)
+		parts[part_id].finished = true;
+	if (part_id == writing_part)
+		cv_write.notify_one();
+}
+
+//----------------------------------------------------------------------------------
+// Apply cutoffs given by the user, print an error if they are outside of the range stored in the database
+// RET	: true - if successful
+//----------------------------------------------------------------------------------
+bool CParallelDump::SetCutoffs(CKMCFile& kmer_data_base) const
+{
+	uint32 db_min_count = kmer_data_base.GetMinCount();
+	uint64 db_max_count = kmer_data_base.GetMaxCount();
+	if ((min_count && !kmer_data_base.SetMinCount(min_count)) || (max_count && !kmer_data_base.SetMaxCount(max_count)))
+	{
+		std::cerr << "Error: wrong cutoffs, counters in " << input_file_name << " are in range [" << db_min_count << ", " << db_max_count << "]\n";
+		return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------
+void CParallelDump::ListPart(uint32 part_id)
+{
+	CKMCFile kmer_data_base;
+	if (!kmer_data_base.OpenForListing(input_file_name, part_id, n_parts))
+	{
+		std::cerr << "Error: cannot open " << input_file_name << "\n";
+		exit(1);
+	}
+	if (!SetCutoffs(kmer_data_base))
+		exit(1);
+
+	const uint64 max_batch_len = 4 + BATCH_SIZE * (uint64)(kmer_length + 22);
+	std::vector<uint64> kmers(BATCH_SIZE * kmer_words);
+	std::vector<uint64> counts(BATCH_SIZE);
+	std::vector<char> buf(BUF_SIZE), tmp;
+	uint64 buf_pos = 0;
+
+	uint64 n_read;
+	while ((n_read = kmer_data_base.ReadNextKmers(kmers.data(), counts.data(), BATCH_SIZE)) != 0)
+	{
+		if (buf_pos + max_batch_len > BUF_SIZE)
+		{
+			buf.resize(buf_pos);
+			if (gzip)
+				Compress(buf, tmp);
+			PushBuf(part_id, buf, false);
+			buf.resize(BUF_SIZE);
+			buf_pos = 0;
+		}
+		buf_pos += FormatBatch(kmers.data(), counts.data(), n_read, buf.data() + buf_pos);
+	}
+	buf.resize(buf_pos);
+	if (gzip && buf_pos)
+		Compress(buf, tmp);
+	PushBuf(part_id, buf, true);
+	kmer_data_base.Close();
+}
+
+//----------------------------------------------------------------------------------
+void CParallelDump::ListParts()
+{
+	uint32 part_id;
+	while ((part_id = next_part++) < n_parts)
+		ListPart(part_id);
+}
+
+//----------------------------------------------------------------------------------
+void CParallelDump::WriteParts()
+{
+	std::vector<char> buf;
+	std::unique_lock<std::mutex> lck(mtx);
+	while (writing_part < n_parts)
+	{
+		part_t& part = parts[writing_part];
+		cv_write.wait(lck, [&part] {return !part.bufs.empty() || part.finished; });
+		if (part.bufs.empty())
+		{
+			++writing_part;
+			cv_space.notify_all();
+			continue;
+		}
+		buf = std::move(part.bufs.front());
+		part.bufs.pop_front();
+		cv_space.notify_all();
+		lck.unlock();
+		Write(buf);
+		lck.lock();
+	}
+}
+
+//----------------------------------------------------------------------------------
+void CParallelDump::Write(const std::vector<char>& buf)
+{
+	if (fwrite(buf.data(), 1, buf.size(), out_file) != buf.size())
+	{
+		std::cerr << "Error: cannot write to output file\n";
+		exit(1);
+	}
+}
+
+//----------------------------------------------------------------------------------
+void CParallelDump::WriteHeader()
+{
+	std::vector<char> buf(28), tmp;
+	char* ptr = buf.data();
+	memcpy(ptr, "KMCD", 4);
+	ptr += 4;
+	StoreNumber(VERSION, 4, ptr);
+	StoreNumber(kmer_length, 4, ptr);
+	StoreNumber(0b00011011, 4, ptr); //ACGT
+	StoreNumber(kmer_bytes, 4, ptr);
+	StoreNumber(counter_bytes, 4, ptr);
+	StoreNumber(format == format_t::columns, 4, ptr);
+	if (gzip)
+		Compress(buf, tmp);
+	Write(buf);
+}
+
+//----------------------------------------------------------------------------------
+bool CParallelDump::Process()
+{
+	{
+		CKMCFile kmer_data_base;
+		if (!kmer_data_base.OpenForListing(input_file_name))
+			return false;
+		CKMCFileInfo info;
+		kmer_data_base.Info(info);
+		//checked before any thread starts, so an error is reported once and nothing is written
+		bool cutoffs_ok = SetCutoffs(kmer_data_base);
+		kmer_data_base.Close();
+		if (!cutoffs_ok)
+			return false;
+		kmer_length = info.kmer_length;
+		counter_bytes = info.counter_size > 4 ? 8 : 4;
+	}
+	kmer_words = (kmer_length + 31) / 32;
+	kmer_bytes = (kmer_length + 3) / 4;
+	in_first_byte = kmer_length % 4 ? kmer_length % 4 : 4;
+	if (format != format_t::text)
+		WriteHeader();
+
+	n_parts = N_PARTS;
+	parts.resize(n_parts);
+
+	std::vector<std::thread> threads;
+	for (uint32 i = 0; i < n_threads; ++i)
+		threads.emplace_back(&CParallelDump::ListParts, this);
+	WriteParts();
+	for (auto& th : threads)
+		th.join();
+
+	//gzip file must contain at least one member
+	if (gzip && ftell(out_file) == 0)
+	{
+		std::vector<char> buf, tmp;
+		Compress(buf, tmp);
+		Write(buf);
+	}
+	return true;
+}
+
+// ***** EOF
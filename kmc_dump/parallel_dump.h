@@ -0,0 +1,104 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  This file demonstrates the example usage of kmc_api software.
+  It lists parts of a database by many threads and prints kmers to an output file.
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _PARALLEL_DUMP_H
+#define _PARALLEL_DUMP_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include "../kmc_api/kmer_defs.h"
+
+class CKMCFile;
+
+//************************************************************************************************************
+// CParallelDump - each thread lists its parts of the database (disjoint ranges of LUT, see
+// CKMCFile::OpenForListing) and formats k-mers into private buffers (compressed by the same thread if gzip
+// is used). Buffers are written by a separate thread in order of parts. The database is always split into the same
+// parts, so the output is byte-identical for any number of threads.
+// Binary formats are the same as of kmc_tools transform dump (all numbers little endian):
+//   header : "KMCD", version, kmer_len, encoding of symbols, kmer_bytes, counter_bytes, layout (0 - rows,
+//            1 - columns) (uint32 each)
+//   rows   : for each k-mer: k-mer (kmer_bytes, most significant byte first) and counter (counter_bytes)
+//   columns: chunks of at most 1024 k-mers: no. of k-mers (uint32), k-mers (kmer_bytes each), counters
+//            (counter_bytes each)
+// With gzip the header and each buffer are separate gzip members
+//************************************************************************************************************
+class CParallelDump
+{
+public:
+	enum class format_t { text, rows, columns };
+
+private:
+	static const uint32 N_PARTS = 256; //independent of the number of threads, so are buffers, gzip members and chunks
+	static const uint32 BUF_SIZE = 1 << 20;
+	static const uint32 MAX_QUEUED_BUFS = 4; //per part, except the one being written
+	static const uint32 BATCH_SIZE = 1 << 10; //in k-mers, a single batch always fits in a buffer
+	static const uint32 VERSION = 1;
+
+	struct part_t
+	{
+		std::deque<std::vector<char>> bufs;
+		bool finished = false;
+	};
+
+	std::string input_file_name;
+	FILE* out_file;
+	uint32 n_threads;
+	uint32 min_count, max_count;
+	format_t format;
+	bool gzip;
+
+	uint32 kmer_length = 0;
+	uint32 kmer_words = 0;
+	uint32 kmer_bytes = 0;
+	uint32 in_first_byte = 0;
+	uint32 counter_bytes = 0;
+	char ACGT[1024]; //4 symbols of each byte of packed k-mer
+
+	uint32 n_parts = 0;
+	std::atomic<uint32> next_part{0};
+	std::vector<part_t> parts;
+	uint32 writing_part = 0;
+	std::mutex mtx;
+	std::condition_variable cv_write, cv_space;
+
+	bool SetCutoffs(CKMCFile& kmer_data_base) const;
+	void ListPart(uint32 part_id);
+	void ListParts();
+	void WriteParts();
+	void PushBuf(uint32 part_id, std::vector<char>& buf, bool last);
+	void Write(const std::vector<char>& buf);
+	void WriteHeader();
+	uint32 FormatText(const uint64* kmer, uint64 count, char* str) const;
+	uint64 FormatBatch(const uint64* kmers, const uint64* counts, uint64 n, char* str) const;
+	void StoreKmer(const uint64* kmer, char*& str) const;
+	static void StoreNumber(uint64 x, uint32 n_bytes, char*& str);
+	static void Compress(std::vector<char>& buf, std::vector<char>& tmp);
+
+public:
+	// IN	: min_count, max_count - cutoffs (0 - not set)
+	//		  gzip - output compressed with gzip
+	CParallelDump(const std::string& input_file_name, FILE* out_file, uint32 n_threads, uint32 min_count, uint32 max_count, format_t format, bool gzip);
+
+	// RET	: true - if successful
+	bool Process();
+};
+
+#endif
+
+// ***** EOF
@@ -0,0 +1,187 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#include "kmc_client.h"
+#include <cstring>
+#include <sys/un.h>
+
+//----------------------------------------------------------------------------------
+CKMCClient::~CKMCClient()
+{
+	Close();
+}
+
+//----------------------------------------------------------------------------------
+// Connect to a server
+// IN	: socket_path - path of the server's socket
+// RET	: true		  - if successful
+//----------------------------------------------------------------------------------
+bool CKMCClient::Connect(const std::string& socket_path)
+{
+	Close();
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(addr.sun_path))
+		return false;
+	strcpy(addr.sun_path, socket_path.c_str());
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+	if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------
+void CKMCClient::Close()
+{
+	if (fd >= 0)
+		close(fd);
+	fd = -1;
+	max_response_sizes.clear();
+}
+
+//----------------------------------------------------------------------------------
+// Send a request. Auxiliary function.
+// RET	: id of the request, 0 on error
+//----------------------------------------------------------------------------------
+uint64 CKMCClient::SendRequest(server_op op, uint32 db_id, const std::vector<uchar>& request_payload)
+{
+	if (fd < 0 || request_payload.size() > KMC_SERVER_MAX_PAYLOAD)
+		return 0;
+	server_request_header_t header{ KMC_SERVER_MAGIC, (uint32)op, db_id, 0, ++next_id, request_payload.size() };
+	if (!socket_write_all(fd, &header, sizeof(header)) || !socket_write_all(fd, request_payload.data(), request_payload.size()))
+	{
+		Close();
+		return 0;
+	}
+	max_response_sizes.push_back(server_max_response_size(op, request_payload.size()));
+	return header.id;
+}
+
+//----------------------------------------------------------------------------------
+// Receive the next response into payload. Auxiliary function.
+// RET	: true - if the response was received and its status is ok
+//----------------------------------------------------------------------------------
+bool CKMCClient::ReceiveResponse(server_op op)
+{
+	if (fd < 0 || max_response_sizes.empty())
+		return false;
+	uint64 max_size = max_response_sizes.front();
+	max_response_sizes.pop_front();
+	server_response_header_t header;
+	if (!socket_read_all(fd, &header, sizeof(header)) || header.magic != KMC_SERVER_MAGIC || header.op != (uint32)op ||
+		header.payload_size > max_size)
+	{
+		Close();
+		return false;
+	}
+	payload.resize(header.payload_size);
+	if (!socket_read_all(fd, payload.data(), payload.size()))
+	{
+		Close();
+		return false;
+	}
+	last_status = (server_status)header.status;
+	return last_status == server_status::ok;
+}
+
+//----------------------------------------------------------------------------------
+bool CKMCClient::Info(uint32 db_id, server_db_info_t& info)
+{
+	if (!SendRequest(server_op::info, db_id, {}) || !ReceiveResponse(server_op::info) || payload.size() != sizeof(info))
+		return false;
+	memcpy(&info, payload.data(), sizeof(info));
+	return true;
+}
+
+//----------------------------------------------------------------------------------
+bool CKMCClient::CheckKmers(uint32 db_id, const std::vector<std::string>& kmers, std::vector<uint64>& counts)
+{
+	return SendCheckKmers(db_id, kmers) && ReceiveCheckKmers(counts);
+}
+
+//----------------------------------------------------------------------------------
+bool CKMCClient::GetCountersForReads(uint32 db_id, const std::vector<std::string>& reads, std::vector<uint64>& offsets, std::vector<uint32>& counters)
+{
+	return SendCountersForReads(db_id, reads) && ReceiveCountersForReads(offsets, counters);
+}
+
+//----------------------------------------------------------------------------------
+// Send k-mers to check, all k-mers must be of the length of k-mers of the database
+// RET	: id of the request, 0 on error
+//----------------------------------------------------------------------------------
+uint64 CKMCClient::SendCheckKmers(uint32 db_id, const std::vector<std::string>& kmers)
+{
+	std::vector<uchar> request_payload;
+	for (auto& kmer : kmers)
+		request_payload.insert(request_payload.end(), kmer.begin(), kmer.end());
+	return SendRequest(server_op::check_kmers, db_id, request_payload);
+}
+
+//----------------------------------------------------------------------------------
+bool CKMCClient::ReceiveCheckKmers(std::vector<uint64>& counts)
+{
+	if (!ReceiveResponse(server_op::check_kmers))
+		return false;
+	counts.resize(payload.size() / sizeof(uint64));
+	memcpy(counts.data(), payload.data(), counts.size() * sizeof(uint64));
+	return true;
+}
+
+//----------------------------------------------------------------------------------
+// Send reads to get counters of their k-mers
+// RET	: id of the request, 0 on error
+//----------------------------------------------------------------------------------
+uint64 CKMCClient::SendCountersForReads(uint32 db_id, const std::vector<std::string>& reads)
+{
+	uint64 n_reads = reads.size();
+	std::vector<uchar> request_payload(sizeof(n_reads) + n_reads * sizeof(uint32));
+	memcpy(request_payload.data(), &n_reads, sizeof(n_reads));
+	for (uint64 i = 0; i < n_reads; ++i)
+	{
+		uint32 len = (uint32)reads[i].size();
+		memcpy(request_payload.data() + sizeof(n_reads) + i * sizeof(uint32), &len, sizeof(len));
+	}
+	for (auto& read : reads)
+		request_payload.insert(request_payload.end(), read.begin(), read.end());
+	return SendRequest(server_op::counters_for_reads, db_id, request_payload);
+}
+
+//----------------------------------------------------------------------------------
+bool CKMCClient::ReceiveCountersForReads(std::vector<uint64>& offsets, std::vector<uint32>& counters)
+{
+	if (!ReceiveResponse(server_op::counters_for_reads))
+		return false;
+	if (payload.size() < sizeof(uint64))
+		return false;
+
+	// the number of reads, n_reads + 1 offsets (the last one is the number of counters), counters
+	uint64 n_reads;
+	memcpy(&n_reads, payload.data(), sizeof(n_reads));
+	if (n_reads + 2 > payload.size() / sizeof(uint64))
+		return false;
+	offsets.resize(n_reads + 1);
+	memcpy(offsets.data(), payload.data() + sizeof(n_reads), offsets.size() * sizeof(uint64));
+	uint64 counters_pos = (n_reads + 2) * sizeof(uint64);
+	if (payload.size() - counters_pos != offsets.back() * sizeof(uint32))
+		return false;
+	counters.resize(offsets.back());
+	memcpy(counters.data(), payload.data() + counters_pos, counters.size() * sizeof(uint32));
+	return true;
+}
+
+// ***** EOF
@@ -0,0 +1,71 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _KMC_CLIENT_H
+#define _KMC_CLIENT_H
+
+#include "kmc_server_protocol.h"
+#include <string>
+#include <vector>
+#include <deque>
+
+//************************************************************************************************************
+// CKMCClient - client of kmc_server
+// Synchronous calls (Info, CheckKmers, GetCountersForReads) send a request and wait for its response.
+// For pipelining Send* calls only send a request and return its id, responses must be received
+// with the matching Receive* calls in the order of requests.
+// Requests larger than KMC_SERVER_MAX_PAYLOAD are not sent, responses larger than allowed for their requests
+// are treated as errors
+//************************************************************************************************************
+class CKMCClient
+{
+	int fd = -1;
+	uint64 next_id = 0;
+	server_status last_status = server_status::ok;
+	std::vector<uchar> payload;
+	std::deque<uint64> max_response_sizes;		//of requests sent and not received yet
+
+	uint64 SendRequest(server_op op, uint32 db_id, const std::vector<uchar>& request_payload);
+	bool ReceiveResponse(server_op op);
+
+public:
+	CKMCClient() = default;
+	CKMCClient(const CKMCClient&) = delete;
+	CKMCClient& operator=(const CKMCClient&) = delete;
+	~CKMCClient();
+
+	// Connect to a server listening on socket_path
+	bool Connect(const std::string& socket_path);
+
+	void Close();
+
+	// Status of the last received response
+	server_status GetLastStatus() const noexcept { return last_status; }
+
+	// Get parameters of a database
+	bool Info(uint32 db_id, server_db_info_t& info);
+
+	// Get counters of k-mers (0 for absent k-mers)
+	bool CheckKmers(uint32 db_id, const std::vector<std::string>& kmers, std::vector<uint64>& counts);
+
+	// Get counters of all k-mers of reads, counters of the i-th read are counters[offsets[i]], ..., counters[offsets[i + 1] - 1]
+	bool GetCountersForReads(uint32 db_id, const std::vector<std::string>& reads, std::vector<uint64>& offsets, std::vector<uint32>& counters);
+
+	// Pipelined variants, Send* return the id of a request (0 on error)
+	uint64 SendCheckKmers(uint32 db_id, const std::vector<std::string>& kmers);
+	bool ReceiveCheckKmers(std::vector<uint64>& counts);
+
+	uint64 SendCountersForReads(uint32 db_id, const std::vector<std::string>& reads);
+	bool ReceiveCountersForReads(std::vector<uint64>& offsets, std::vector<uint32>& counters);
+};
+
+#endif
+
+// ***** EOF
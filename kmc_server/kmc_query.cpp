@@ -0,0 +1,226 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  This file demonstrates the example usage of the kmc_server client library.
+  It sends k-mers or reads from an input file to kmc_server and prints their counters.
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#include <iostream>
+#include <fstream>
+#include <deque>
+#include <cstring>
+#include <cstdlib>
+#include "kmc_client.h"
+
+#define KMC_QUERY_BATCH_SIZE (1 << 16)		// lines per request
+#define KMC_QUERY_BATCH_BYTES (KMC_SERVER_MAX_PAYLOAD / 4)	// bytes of lines per request (a request may exceed it by one line)
+#define KMC_QUERY_MAX_LINE (KMC_SERVER_MAX_PAYLOAD / 2)
+#define KMC_QUERY_MAX_IN_FLIGHT 4			// requests sent before their responses are received
+
+void print_info(void);
+
+//----------------------------------------------------------------------------------
+// Check if --help or --version was used
+bool help_or_version(int argc, char** argv)
+{
+	const std::string version = "--version";
+	const std::string help = "--help";
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i] == version || argv[i] == help)
+			return true;
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------------
+// Write results of a batch of k-mers
+void write_kmers(std::ostream& out, const std::vector<std::string>& kmers, const std::vector<uint64>& counts)
+{
+	for (size_t i = 0; i < kmers.size(); ++i)
+		out << kmers[i] << '\t' << counts[i] << '\n';
+}
+
+//----------------------------------------------------------------------------------
+// Write results of a batch of reads, counters of a read in a single line
+void write_reads(std::ostream& out, const std::vector<uint64>& offsets, const std::vector<uint32>& counters)
+{
+	for (size_t i = 0; i + 1 < offsets.size(); ++i)
+	{
+		for (uint64 j = offsets[i]; j < offsets[i + 1]; ++j)
+		{
+			if (j > offsets[i])
+				out << ' ';
+			out << counters[j];
+		}
+		out << '\n';
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 1 || help_or_version(argc, argv))
+	{
+		print_info();
+		return 0;
+	}
+
+	uint32 db_id = 0;
+	bool reads_mode = false;
+	bool info_only = false;
+	int32 i;
+	for (i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] == '-')
+		{
+			if (strncmp(argv[i], "-d", 2) == 0)
+				db_id = atoi(&argv[i][2]);
+			else if (strcmp(argv[i], "-r") == 0)
+				reads_mode = true;
+			else if (strcmp(argv[i], "-i") == 0)
+				info_only = true;
+			else
+			{
+				std::cerr << "Error: unknown option " << argv[i] << "\n";
+				print_info();
+				return EXIT_FAILURE;
+			}
+		}
+		else
+			break;
+	}
+
+	if (argc - i < (info_only ? 1 : 3))
+	{
+		print_info();
+		return EXIT_FAILURE;
+	}
+
+	CKMCClient client;
+	if (!client.Connect(argv[i]))
+	{
+		std::cerr << "Error: cannot connect to " << argv[i] << "\n";
+		return EXIT_FAILURE;
+	}
+
+	server_db_info_t info;
+	if (!client.Info(db_id, info))
+	{
+		std::cerr << "Error: cannot get info of database " << db_id << "\n";
+		return EXIT_FAILURE;
+	}
+
+	if (info_only)
+	{
+		std::cout << "databases    : " << info.n_dbs << "\n"
+				  << "k            : " << info.kmer_length << "\n"
+				  << "both strands : " << (info.both_strands ? "yes" : "no") << "\n"
+				  << "counter size : " << info.counter_size << "\n"
+				  << "min count    : " << info.min_count << "\n"
+				  << "max count    : " << info.max_count << "\n"
+				  << "total k-mers : " << info.total_kmers << "\n";
+		return EXIT_SUCCESS;
+	}
+
+	std::ifstream in(argv[i + 1]);
+	if (!in)
+	{
+		std::cerr << "Error: cannot open " << argv[i + 1] << "\n";
+		return EXIT_FAILURE;
+	}
+	std::ofstream out(argv[i + 2], std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "Error: cannot open " << argv[i + 2] << "\n";
+		return EXIT_FAILURE;
+	}
+
+	//------------------------------------------------------------------------------
+	// Send batches of lines, up to KMC_QUERY_MAX_IN_FLIGHT requests are pipelined
+	//------------------------------------------------------------------------------
+	std::deque<std::vector<std::string>> in_flight;
+	std::vector<uint64> counts, offsets;
+	std::vector<uint32> counters;
+	bool input_end = false;
+	std::string line;
+	while (!input_end || !in_flight.empty())
+	{
+		if (!input_end && in_flight.size() < KMC_QUERY_MAX_IN_FLIGHT)
+		{
+			std::vector<std::string> batch;
+			uint64 batch_bytes = 0;
+			while (batch.size() < KMC_QUERY_BATCH_SIZE && batch_bytes < KMC_QUERY_BATCH_BYTES)
+			{
+				if (!std::getline(in, line))
+				{
+					input_end = true;
+					break;
+				}
+				if (!line.empty() && line.back() == '\r')
+					line.pop_back();
+				if (!reads_mode && line.size() != info.kmer_length)
+				{
+					std::cerr << "Error: wrong length of k-mer " << line << "\n";
+					return EXIT_FAILURE;
+				}
+				if (line.size() > KMC_QUERY_MAX_LINE)
+				{
+					std::cerr << "Error: too long line (" << line.size() << " symbols, max. " << KMC_QUERY_MAX_LINE << ")\n";
+					return EXIT_FAILURE;
+				}
+				batch_bytes += line.size() + sizeof(uint32);
+				batch.push_back(line);
+			}
+			if (batch.empty())
+				continue;
+			if (!(reads_mode ? client.SendCountersForReads(db_id, batch) : client.SendCheckKmers(db_id, batch)))
+			{
+				std::cerr << "Error: cannot send a request\n";
+				return EXIT_FAILURE;
+			}
+			in_flight.push_back(std::move(batch));
+			continue;
+		}
+
+		bool ok = reads_mode ? client.ReceiveCountersForReads(offsets, counters) : client.ReceiveCheckKmers(counts);
+		if (!ok)
+		{
+			std::cerr << "Error: query failed (status " << (uint32)client.GetLastStatus() << ")\n";
+			return EXIT_FAILURE;
+		}
+		if (reads_mode)
+			write_reads(out, offsets, counters);
+		else
+			write_kmers(out, in_flight.front(), counts);
+		in_flight.pop_front();
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// -------------------------------------------------------------------------
+// Print execution options
+// -------------------------------------------------------------------------
+void print_info(void)
+{
+	std::cout << "KMC query ver. " << KMC_VER << " (" << KMC_DATE << ")\n"
+			  << "\nUsage:\nkmc_query [options] <socket_path> <input_file> <output_file>\n"
+			  << "kmc_query -i [-d<id>] <socket_path>\n"
+			  << "Sends queries to kmc_server.\n"
+			  << "Parameters:\n"
+			  << "<socket_path> - socket of kmc_server\n"
+			  << "<input_file> - k-mers (or reads with -r), one per line\n"
+			  << "<output_file> - k-mers and their counters (or counters of all k-mers of each read in a line with -r)\n"
+			  << "Options:\n"
+			  << "-d<id> - id of a database (position on the command line of kmc_server), default: 0\n"
+			  << "-r - input contains reads\n"
+			  << "-i - print parameters of a database\n";
+}
+
+// ***** EOF
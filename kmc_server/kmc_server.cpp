@@ -0,0 +1,453 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  This file contains a server keeping KMC databases loaded and answering queries
+  of local clients over a Unix domain socket (protocol in kmc_server_protocol.h).
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "../kmc_api/kmc_file.h"
+#include "kmc_server_protocol.h"
+
+#define KMC_SERVER_MAX_QUEUED_BYTES (1ull << 30)
+
+void print_info(void);
+
+static std::string socket_path;
+
+//----------------------------------------------------------------------------------
+void remove_socket_and_exit(int /*sig*/)
+{
+	unlink(socket_path.c_str());
+	_exit(0);
+}
+
+//************************************************************************************************************
+// CServerConnection - a single client connection
+// Requests are read by a separate thread (so a pipelining client is never blocked on sending while the server
+// sends responses) and processed in order, each connection has its own query handles of all databases
+//************************************************************************************************************
+class CServerConnection
+{
+	struct request_t
+	{
+		server_request_header_t header;
+		std::vector<uchar> payload;
+	};
+
+	int fd;
+	const std::vector<std::unique_ptr<CKMCFile>>& dbs;
+	std::vector<CKMCQuery> queries;
+
+	std::mutex mtx;
+	std::condition_variable cv_requests, cv_space;
+	std::deque<request_t> requests;
+	uint64 queued_bytes = 0;
+	bool input_end = false;
+	bool stop = false;
+
+	// Buffers reused between requests
+	std::vector<CKmerAPI> kmers;
+	std::vector<uint64> counts;
+	std::vector<uint32> read_counters;
+	std::vector<uchar> response;
+	std::string tmp;
+
+	void ReadRequests();
+	bool ValidRequestSize(const server_request_header_t& header) const;
+	bool PopRequest(request_t& request);
+	server_status Process(const request_t& request);
+	server_status ProcessInfo(uint32 db_id);
+	server_status ProcessCheckKmers(uint32 db_id, const std::vector<uchar>& payload);
+	server_status ProcessCountersForReads(uint32 db_id, const std::vector<uchar>& payload);
+
+public:
+	CServerConnection(int _fd, const std::vector<std::unique_ptr<CKMCFile>>& _dbs) : fd(_fd), dbs(_dbs)
+	{
+		for (auto& db : dbs)
+			queries.emplace_back(*db);
+	}
+
+	void Run();
+};
+
+//----------------------------------------------------------------------------------
+// Check the size of a request payload against its operation before the payload is read
+bool CServerConnection::ValidRequestSize(const server_request_header_t& header) const
+{
+	if (header.payload_size > KMC_SERVER_MAX_PAYLOAD)
+		return false;
+	switch ((server_op)header.op)
+	{
+	case server_op::info:
+		return header.payload_size == 0;
+	case server_op::check_kmers:
+		return header.db_id >= dbs.size() || header.payload_size % dbs[header.db_id]->KmerLength() == 0;
+	case server_op::counters_for_reads:
+		return header.payload_size >= sizeof(uint64);
+	default:
+		return true;		//unknown operation is reported in the response
+	}
+}
+
+//----------------------------------------------------------------------------------
+// Read requests from the socket until the end of stream or a protocol error
+void CServerConnection::ReadRequests()
+{
+	while (true)
+	{
+		request_t request;
+		bool ok = socket_read_all(fd, &request.header, sizeof(request.header));
+		if (ok && (request.header.magic != KMC_SERVER_MAGIC || !ValidRequestSize(request.header)))
+		{
+			std::cerr << "Warning: invalid request, closing connection\n";
+			ok = false;
+		}
+		if (ok)
+		{
+			request.payload.resize(request.header.payload_size);
+			ok = socket_read_all(fd, request.payload.data(), request.payload.size());
+		}
+
+		std::unique_lock<std::mutex> lck(mtx);
+		if (!ok)
+		{
+			input_end = true;
+			cv_requests.notify_one();
+			return;
+		}
+		cv_space.wait(lck, [this] { return stop || queued_bytes < KMC_SERVER_MAX_QUEUED_BYTES; });
+		if (stop)
+			return;
+		queued_bytes += request.payload.size();
+		requests.push_back(std::move(request));
+		cv_requests.notify_one();
+	}
+}
+
+//----------------------------------------------------------------------------------
+bool CServerConnection::PopRequest(request_t& request)
+{
+	std::unique_lock<std::mutex> lck(mtx);
+	cv_requests.wait(lck, [this] { return input_end || !requests.empty(); });
+	if (requests.empty())
+		return false;
+	request = std::move(requests.front());
+	requests.pop_front();
+	queued_bytes -= request.payload.size();
+	cv_space.notify_one();
+	return true;
+}
+
+//----------------------------------------------------------------------------------
+void CServerConnection::Run()
+{
+	std::thread reader([this] { ReadRequests(); });
+
+	request_t request;
+	while (PopRequest(request))
+	{
+		response.clear();
+		server_status status = Process(request);
+		if (status != server_status::ok)
+			response.clear();
+
+		server_response_header_t header{ KMC_SERVER_MAGIC, request.header.op, (uint32)status, 0, request.header.id, response.size() };
+		if (!socket_write_all(fd, &header, sizeof(header)) || !socket_write_all(fd, response.data(), response.size()))
+			break;
+	}
+
+	{
+		std::lock_guard<std::mutex> lck(mtx);
+		stop = true;
+		cv_space.notify_one();
+	}
+	shutdown(fd, SHUT_RDWR);
+	reader.join();
+	close(fd);
+}
+
+//----------------------------------------------------------------------------------
+server_status CServerConnection::Process(const request_t& request)
+{
+	if (request.header.db_id >= dbs.size())
+		return server_status::unknown_db;
+
+	switch ((server_op)request.header.op)
+	{
+	case server_op::info:
+		return ProcessInfo(request.header.db_id);
+	case server_op::check_kmers:
+		return ProcessCheckKmers(request.header.db_id, request.payload);
+	case server_op::counters_for_reads:
+		return ProcessCountersForReads(request.header.db_id, request.payload);
+	default:
+		return server_status::unknown_op;
+	}
+}
+
+//----------------------------------------------------------------------------------
+server_status CServerConnection::ProcessInfo(uint32 db_id)
+{
+	CKMCFileInfo info;
+	dbs[db_id]->Info(info);
+
+	server_db_info_t db_info{};
+	db_info.n_dbs = (uint32)dbs.size();
+	db_info.kmer_length = info.kmer_length;
+	db_info.both_strands = info.both_strands;
+	db_info.counter_size = info.counter_size;
+	db_info.min_count = info.min_count;
+	db_info.max_count = info.max_count;
+	db_info.total_kmers = info.total_kmers;
+
+	response.resize(sizeof(db_info));
+	memcpy(response.data(), &db_info, sizeof(db_info));
+	return server_status::ok;
+}
+
+//----------------------------------------------------------------------------------
+// K-mers are looked up in the canonical form if the database contains canonical k-mers
+server_status CServerConnection::ProcessCheckKmers(uint32 db_id, const std::vector<uchar>& payload)
+{
+	uint32 kmer_len = dbs[db_id]->KmerLength();
+	bool canonical = dbs[db_id]->GetBothStrands();
+	if (payload.size() % kmer_len)
+		return server_status::bad_request;
+
+	uint64 n = payload.size() / kmer_len;
+	if (kmers.size() < n)
+		kmers.resize(n, CKmerAPI(kmer_len));
+
+	std::vector<char> valid(n);
+	CKmerAPI rev_kmer(kmer_len);
+	for (uint64 i = 0; i < n; ++i)
+	{
+		tmp.assign((const char*)payload.data() + i * kmer_len, kmer_len);
+		valid[i] = kmers[i].from_string(tmp);
+		if (valid[i] && canonical)
+		{
+			rev_kmer = kmers[i];
+			rev_kmer.reverse();
+			if (rev_kmer < kmers[i])
+				kmers[i] = rev_kmer;
+		}
+	}
+
+	counts.resize(n);
+	queries[db_id].CheckKmers(kmers.data(), n, counts.data());
+	for (uint64 i = 0; i < n; ++i)
+		if (!valid[i])
+			counts[i] = 0;
+
+	response.resize(n * sizeof(uint64));
+	memcpy(response.data(), counts.data(), response.size());
+	return server_status::ok;
+}
+
+//----------------------------------------------------------------------------------
+server_status CServerConnection::ProcessCountersForReads(uint32 db_id, const std::vector<uchar>& payload)
+{
+	uint64 kmer_len = dbs[db_id]->KmerLength();
+
+	uint64 n_reads;
+	if (payload.size() < sizeof(n_reads))
+		return server_status::bad_request;
+	memcpy(&n_reads, payload.data(), sizeof(n_reads));
+	if (n_reads > (payload.size() - sizeof(n_reads)) / sizeof(uint32))
+		return server_status::bad_request;
+
+	const uchar* lengths_ptr = payload.data() + sizeof(n_reads);
+	const char* reads_ptr = (const char*)lengths_ptr + n_reads * sizeof(uint32);
+
+	// The number of reads and offsets of counters of reads
+	response.resize((n_reads + 2) * sizeof(uint64));
+	memcpy(response.data(), &n_reads, sizeof(uint64));
+	uint64 reads_size = 0;
+	uint64 n_counters = 0;
+	for (uint64 i = 0; i < n_reads; ++i)
+	{
+		uint32 len;
+		memcpy(&len, lengths_ptr + i * sizeof(uint32), sizeof(len));
+		memcpy(response.data() + (i + 1) * sizeof(uint64), &n_counters, sizeof(uint64));
+		reads_size += len;
+		n_counters += len >= kmer_len ? len - kmer_len + 1 : 0;
+	}
+	memcpy(response.data() + (n_reads + 1) * sizeof(uint64), &n_counters, sizeof(uint64));
+	if (reads_size != payload.size() - (uint64)(reads_ptr - (const char*)payload.data()))
+		return server_status::bad_request;
+
+	uint64 counters_pos = response.size();
+	response.resize(counters_pos + n_counters * sizeof(uint32));
+	for (uint64 i = 0; i < n_reads; ++i)
+	{
+		uint32 len;
+		memcpy(&len, lengths_ptr + i * sizeof(uint32), sizeof(len));
+		uint64 n_read_counters = len >= kmer_len ? len - kmer_len + 1 : 0;
+		tmp.assign(reads_ptr, len);
+		reads_ptr += len;
+
+		read_counters.clear();
+		queries[db_id].GetCountersForRead(tmp, read_counters);
+		read_counters.resize(n_read_counters, 0);
+		memcpy(response.data() + counters_pos, read_counters.data(), n_read_counters * sizeof(uint32));
+		counters_pos += n_read_counters * sizeof(uint32);
+	}
+	return server_status::ok;
+}
+
+//----------------------------------------------------------------------------------
+// Check if --help or --version was used
+bool help_or_version(int argc, char** argv)
+{
+	const std::string version = "--version";
+	const std::string help = "--help";
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i] == version || argv[i] == help)
+			return true;
+	}
+	return false;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 1 || help_or_version(argc, argv))
+	{
+		print_info();
+		return 0;
+	}
+
+	CKMCFile::ra_mode mode = CKMCFile::ra_mode::read;
+	int32 i;
+	for (i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] == '-')
+		{
+			if (strcmp(argv[i], "-m") == 0)
+				mode = CKMCFile::ra_mode::mmap_populate;
+			else
+			{
+				std::cerr << "Error: unknown option " << argv[i] << "\n";
+				print_info();
+				return EXIT_FAILURE;
+			}
+		}
+		else
+			break;
+	}
+
+	if (argc - i < 2)
+	{
+		print_info();
+		return EXIT_FAILURE;
+	}
+
+	socket_path = argv[i++];
+
+	//------------------------------------------------------------------------------
+	// Load databases
+	//------------------------------------------------------------------------------
+	std::vector<std::unique_ptr<CKMCFile>> dbs;
+	for (; i < argc; ++i)
+	{
+		dbs.emplace_back(new CKMCFile);
+		if (!dbs.back()->OpenForRA(argv[i], mode))
+		{
+			std::cerr << "Error: cannot open database " << argv[i] << "\n";
+			return EXIT_FAILURE;
+		}
+		std::cerr << "Database " << dbs.size() - 1 << ": " << argv[i] << "\n";
+	}
+
+	//------------------------------------------------------------------------------
+	// Listen for connections
+	//------------------------------------------------------------------------------
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(addr.sun_path))
+	{
+		std::cerr << "Error: socket path is too long\n";
+		return EXIT_FAILURE;
+	}
+	strcpy(addr.sun_path, socket_path.c_str());
+
+	struct stat st;
+	if (stat(socket_path.c_str(), &st) == 0)
+	{
+		if (!S_ISSOCK(st.st_mode))
+		{
+			std::cerr << "Error: " << socket_path << " exists and is not a socket\n";
+			return EXIT_FAILURE;
+		}
+		unlink(socket_path.c_str());
+	}
+
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0)
+	{
+		std::cerr << "Error: cannot listen on " << socket_path << ": " << strerror(errno) << "\n";
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, remove_socket_and_exit);
+	signal(SIGTERM, remove_socket_and_exit);
+
+	std::cerr << "Listening on " << socket_path << "\n";
+
+	while (true)
+	{
+		int fd = accept(listen_fd, nullptr, nullptr);
+		if (fd < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			std::cerr << "Error: accept failed: " << strerror(errno) << "\n";
+			break;
+		}
+		std::thread([fd, &dbs] {
+			CServerConnection connection(fd, dbs);
+			connection.Run();
+		}).detach();
+	}
+
+	close(listen_fd);
+	unlink(socket_path.c_str());
+	return EXIT_FAILURE;
+}
+
+// -------------------------------------------------------------------------
+// Print execution options
+// -------------------------------------------------------------------------
+void print_info(void)
+{
+	std::cout << "KMC server ver. " << KMC_VER << " (" << KMC_DATE << ")\n"
+			  << "\nUsage:\nkmc_server [options] <socket_path> <kmc_database_1> [<kmc_database_2> ...]\n"
+			  << "Keeps databases loaded and answers queries of local clients (e.g. kmc_query) over a Unix domain socket.\n"
+			  << "Databases are identified by their positions (0, 1, ...) in the command line.\n"
+			  << "Parameters:\n"
+			  << "<socket_path> - path of the socket to create\n"
+			  << "<kmc_database_i> - kmer_counter's output\n"
+			  << "Options:\n"
+			  << "-m - memory map databases (the page cache is shared with other processes) instead of reading them\n";
+}
+
+// ***** EOF
@@ -0,0 +1,130 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _KMC_SERVER_PROTOCOL_H
+#define _KMC_SERVER_PROTOCOL_H
+
+#include "../kmc_api/kmer_defs.h"
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+//************************************************************************************************************
+// Binary protocol of kmc_server (over a Unix domain socket, native byte order as both sides run on one host)
+//
+// Each request is a request_header_t followed by payload_size bytes of payload, each response is
+// a response_header_t followed by its payload. A client may send many requests without waiting for responses
+// (pipelining), responses are sent in the order of requests and carry the id of the request.
+//
+// Payloads:
+//   info:               request  - empty
+//                       response - server_db_info_t of the database db_id
+//   check_kmers:        request  - n k-mers of the database's length (ACGT), without separators
+//                       response - n counters (uint64), 0 for absent k-mers (or k-mers with other symbols)
+//   counters_for_reads: request  - the number of reads (uint64), lengths of reads (uint32 each), reads without separators
+//                       response - the number of reads (uint64), n_reads + 1 offsets (uint64) of counters of consecutive reads,
+//                                  counters (uint32) of all k-mers of all reads (as in CKMCFile::GetCountersForRead)
+// Request payloads are limited to KMC_SERVER_MAX_PAYLOAD bytes (larger queries must be split by clients),
+// a response payload is at most 8 times larger than its request payload (plus 16 bytes)
+//************************************************************************************************************
+#define KMC_SERVER_MAGIC 0x514D434Bu	// "KMCQ"
+#define KMC_SERVER_MAX_PAYLOAD (1ull << 26)
+
+enum class server_op : uint32 { info = 0, check_kmers = 1, counters_for_reads = 2 };
+
+enum class server_status : uint32 { ok = 0, unknown_op = 1, unknown_db = 2, bad_request = 3 };
+
+struct server_request_header_t
+{
+	uint32 magic;
+	uint32 op;
+	uint32 db_id;
+	uint32 reserved;
+	uint64 id;
+	uint64 payload_size;
+};
+
+struct server_response_header_t
+{
+	uint32 magic;
+	uint32 op;
+	uint32 status;
+	uint32 reserved;
+	uint64 id;
+	uint64 payload_size;
+};
+
+struct server_db_info_t
+{
+	uint32 n_dbs;			// the number of databases served
+	uint32 kmer_length;
+	uint32 both_strands;
+	uint32 counter_size;
+	uint32 min_count;
+	uint32 reserved;
+	uint64 max_count;
+	uint64 total_kmers;
+};
+
+//----------------------------------------------------------------------------------
+// Max. size of the response payload to a request (counters of check_kmers and counters_for_reads take
+// at most 8 bytes per byte of the request)
+inline uint64 server_max_response_size(server_op op, uint64 request_payload_size)
+{
+	if (op == server_op::info)
+		return sizeof(server_db_info_t);
+	return 8 * request_payload_size + 16;
+}
+
+//----------------------------------------------------------------------------------
+// Read exactly size bytes from a socket, false on error or end of stream
+inline bool socket_read_all(int fd, void* data, uint64 size)
+{
+	uchar* ptr = (uchar*)data;
+	while (size)
+	{
+		ssize_t n = read(fd, ptr, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		ptr += n;
+		size -= n;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------
+// Write exactly size bytes to a socket, false on error
+inline bool socket_write_all(int fd, const void* data, uint64 size)
+{
+#ifdef MSG_NOSIGNAL
+	const int flags = MSG_NOSIGNAL;
+#else
+	const int flags = 0;
+#endif
+	const uchar* ptr = (const uchar*)data;
+	while (size)
+	{
+		ssize_t n = send(fd, ptr, size, flags);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		ptr += n;
+		size -= n;
+	}
+	return true;
+}
+
+#endif
+
+// ***** EOF
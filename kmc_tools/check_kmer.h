@@ -14,6 +14,8 @@
 #include "config.h"
 #include "kmer.h"
 #include "../kmc_api/mmer.h"
+#include "../kmc_api/elias_fano.h"
+#include "../kmc_api/compressed_suffixes.h"
 #include <string>
 
 template<unsigned SIZE>
@@ -26,6 +28,8 @@ class CKmerCheck
 	uint64 max_prefix;
 	uint32 record_size;
 	FILE* prefix_file = nullptr, *suffix_file = nullptr;
+	CEliasFano lut_ef;		//for databases with Elias-Fano encoded LUT
+	std::unique_ptr<CCompressedSuffixReader> compressed_reader;		//for databases with compressed *.kmc_suf
 	
 	std::unique_ptr<uchar[]> rec;
 
@@ -47,6 +51,35 @@ class CKmerCheck
 
 		uint32 cutoff_range = input_desc.cutoff_max - input_desc.cutoff_min;
 
+		auto get_counter = [&](uchar* tmp) -> uint32
+		{
+			uint32 counter = 0;
+			for (uint32 i = 0; i < header.counter_size; ++i)
+			{
+				counter += (((uint32)*tmp++) << (i << 3));
+			}
+			if (counter - input_desc.cutoff_min < cutoff_range)
+				return counter;
+			return 0;
+		};
+
+		if (compressed_reader)
+		{
+			//records of a single prefix are decoded one by one, there are usually few of them
+			compressed_reader->Seek(lower);
+			for (uint64 i = lower; i <= upper && compressed_reader->Read(rec.get(), record_size) == record_size; ++i)
+			{
+				uchar* tmp = rec.get();
+				CKmer<SIZE> suffix;
+				suffix.load(tmp, record_size - header.counter_size);
+				if (kmer_suffix < suffix)
+					break;
+				if (!(suffix < kmer_suffix))
+					return get_counter(tmp);
+			}
+			return 0;
+		}
+
 		auto read_at = [](FILE* file, uint64 pos, uchar* &tmp, uint32 record_size, uint32 counter_size) -> CKmer<SIZE>
 		{
 			my_fseek(file, pos, SEEK_SET);
@@ -70,18 +103,7 @@ class CKmerCheck
 				upper = middle - 1;
 			}
 			else
-			{
-				uint32 counter = 0;
-				for (uint32 i = 0; i < header.counter_size; ++i)
-				{
-					counter += (((uint32)*tmp++) << (i << 3));
-				}
-				if (counter - input_desc.cutoff_min < cutoff_range)
-				{					
-					return counter;
-				}
-				break;
-			}
+				return get_counter(tmp);
 		}
 		
 		return 0;
@@ -130,6 +152,14 @@ class CKmerCheck
 			uint32 prefix_arry_size = (1 << 2 * header.lut_prefix_len)*(uint32)sizeof(uint64);
 			fread(&prefix_array, sizeof(uint32), 1, prefix_file);
 
+			if (header.IsLutEliasFano())
+			{
+				uint64 lut_pos = ((uint64)prefix_array << (2 * header.lut_prefix_len)) + prefix;
+				lower = lut_ef.Get(lut_pos);
+				upper = lut_ef.Get(lut_pos + 1);
+				return;
+			}
+
 			uint64 prefix_pos = 4 + prefix_arry_size*prefix_array + sizeof(uint64)*prefix;
 			my_fseek(prefix_file, prefix_pos, SEEK_SET);
 
@@ -168,6 +198,26 @@ public:
 		setvbuf(prefix_file, NULL, _IOFBF, (1ULL << 26));
 		setvbuf(suffix_file, NULL, _IOFBF, (1ULL << 26));
 
+		if (header.IsLutEliasFano())
+		{
+			my_fseek(prefix_file, 4, SEEK_SET);
+			if (!lut_ef.Load(prefix_file))
+			{
+				std::cerr << "Error: cannot read LUT from : " << (file_src + ".kmc_pre") << "\n";
+				exit(1);
+			}
+		}
+
+		if (header.IsCompressed())
+		{
+			compressed_reader = std::make_unique<CCompressedSuffixReader>();
+			if (!compressed_reader->Open(suffix_file, header.kmer_len, header.lut_prefix_len, header.counter_size, header.total_kmers))
+			{
+				std::cerr << "Error: cannot read : " << (file_src + ".kmc_suf") << "\n";
+				exit(1);
+			}
+		}
+
 		max_prefix = (1 << (2 * header.lut_prefix_len)) - 1;
 		record_size = (header.kmer_len - header.lut_prefix_len) / 4 + header.counter_size;
 		rec = std::make_unique<uchar[]>(record_size);
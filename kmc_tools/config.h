@@ -53,12 +53,39 @@ struct CDescBase
 	CDescBase() = default;
 };
 
+//************************************************************************************************************
+// CKmerRange - range of k-mers which prefixes of prefix_len symbols are in [begin, end). The default one
+// (prefix_len == 0) covers all k-mers. Used for range partitioning of simple and complex operations
+//************************************************************************************************************
+struct CKmerRange
+{
+	uint32 prefix_len = 0;
+	uint64 begin = 0;
+	uint64 end = 1;
+
+	//the first prefix of lut_prefix_len symbols of k-mers in the range
+	uint64 FirstPrefix(uint32 lut_prefix_len) const
+	{
+		if (lut_prefix_len >= prefix_len)
+			return begin << 2 * (lut_prefix_len - prefix_len);
+		return begin >> 2 * (prefix_len - lut_prefix_len);
+	}
+
+	//the prefix of lut_prefix_len symbols following the range, lut_prefix_len must not be lower than prefix_len
+	uint64 EndPrefix(uint32 lut_prefix_len) const
+	{
+		return end << 2 * (lut_prefix_len - prefix_len);
+	}
+};
+
 //************************************************************************************************************
 // CInputDesc - description of a single input KMC database.
 //************************************************************************************************************
 struct CInputDesc : public CDescBase
 {	
 	uint32 threads = 0; //for kmc2 input
+	CKmerRange range; //only k-mers from this range are read (sorted mode of KMC1 and KMC2 databases)
+	int32 progress_id = -1; //percent progress item shared by all ranges of the input, -1 means reader registers its own
 	CInputDesc(const std::string& file_src) :
 		CDescBase(file_src)
 	{
@@ -116,6 +143,9 @@ struct CTransformOutputDesc : public COutputDesc
 	enum class OpType { HISTOGRAM, DUMP, SORT, REDUCE, COMPACT, SET_COUNTS };
 	OpType op_type;
 	bool sorted_output = false; //only for dump operation, rest is sorted anyway (except histo which does not print k-mers at all)
+	enum class DumpFormat { TEXT, ROWS, COLUMNS };
+	DumpFormat dump_format = DumpFormat::TEXT; //only for dump operation
+	bool dump_gzip = false; //only for dump operation
 	CTransformOutputDesc(OpType op_type) :op_type(op_type)
 	{ }
 };
@@ -155,6 +185,27 @@ struct CCheckParams
 	std::string kmer;
 };
 
+struct CIndexParams
+{
+	uint32 sample_step = 16;
+};
+
+struct CMatrixParams
+{
+	std::string file_src;
+	bool counts = false; //counters instead of presence bits
+	uint32 counter_bytes = 0; //0 means it is not set yet
+	uint32 min_samples = 1;
+	uint32 max_samples = 0; //0 means it is not set yet
+	uint32 block_size = 1 << 16; //no. of k-mers in a single block of output
+};
+
+struct CDistanceParams
+{
+	std::string output_prefix;
+	uint64 scale = 1; //FracMinHash scale, 1 means all k-mers are used
+};
+
 
 //************************************************************************************************************
 // CConfig - configuration of current application run. Singleton class.
@@ -162,13 +213,17 @@ struct CCheckParams
 class CConfig
 {
 public:	
-	enum class Mode { UNDEFINED, COMPLEX, COMPARE, FILTER, SIMPLE_SET, TRANSFORM, INFO, CHECK };
+	enum class Mode { UNDEFINED, COMPLEX, COMPARE, FILTER, SIMPLE_SET, TRANSFORM, INFO, CHECK, INDEX, MATRIX, MATRIX_CHECK, DISTANCE };
 	uint32 avaiable_threads;
+	uint32 n_ranges = 1; //no. of k-mer ranges processed in parallel by simple and complex operations
 	uint32 kmer_len = 0;
 	Mode mode = Mode::UNDEFINED;
 	bool verbose = false;	
 	std::vector<CInputDesc> input_desc;
 	std::vector<CKmerFileHeader> headers;
+
+	std::vector<CKmerRange> ranges; //for range partitioning only
+	std::vector<std::vector<CInputDesc>> ranges_input_desc; //input_desc limited to each of ranges
 		
 	COutputDesc output_desc; //complex only?
 
@@ -176,6 +231,9 @@ public:
 
 	CFilteringParams filtering_params; //for filter operation only	
 	CCheckParams check_params; // for check operation only
+	CIndexParams index_params; // for index operation only
+	CMatrixParams matrix_params; // for matrix and matrix_check operations only
+	CDistanceParams distance_params; // for distance operation only
 
 	std::vector<CTransformOutputDesc> transform_output_desc;
 
@@ -198,7 +256,7 @@ public:
 
 	bool IsSeparateThreadForMainProcessingNeeded()
 	{
-		return mode == Mode::SIMPLE_SET || mode == Mode::COMPLEX || mode == Mode::COMPARE;
+		return mode == Mode::SIMPLE_SET || mode == Mode::COMPLEX || mode == Mode::COMPARE || mode == Mode::MATRIX || mode == Mode::DISTANCE;
 	}
 
 	std::string GetOperationName()
@@ -219,6 +277,14 @@ public:
 			return "transform";
 		case CConfig::Mode::CHECK:
 			return "check";
+		case CConfig::Mode::INDEX:
+			return "index";
+		case CConfig::Mode::MATRIX:
+			return "matrix";
+		case CConfig::Mode::MATRIX_CHECK:
+			return "matrix_check";
+		case CConfig::Mode::DISTANCE:
+			return "distance";
 		default:
 			return "";
 		}
@@ -280,10 +346,17 @@ public:
 				  << "  simple               - performs set operation on two KMC's databases\n"
 				  << "  complex              - performs set operation on multiple KMC's databases\n"
 				  << "  filter               - filter out reads with too small number of k-mers\n"
+				  << "  matrix               - builds k-mer x sample matrix of presence or counters for multiple KMC's databases\n"
+				  << "  matrix_check         - prints counters (or presence) of a k-mer in all samples of a matrix built by matrix operation\n"
+				  << "                         kmc_tools matrix_check <matrix_file> <kmer>\n"
+				  << "  distance             - computes pairwise Jaccard, containment and Mash distance matrices of multiple KMC's databases\n"
+				  << "  index                - builds secondary index (*.kmc_idx) speeding up random access queries of KMC API\n"
+				  << "                         kmc_tools index [-s<sample_step>] <input> (default sample_step: 16)\n"
 				  << " global parameters:\n"
 				  << "  -t<value>            - total number of threads (default: no. of CPU cores)\n"
 				  << "  -v                   - enable verbose mode (shows some information) (default: false)\n"
 				  << "  -hp                  - hide percentage progress (default: false)\n"
+				  << "  -p<value>            - number of disjoint k-mer ranges processed in parallel by simple and complex operations (default: 1)\n"
 				  << "Example:\n"
 				  << "kmc_tools simple db1 -ci3 db2 -ci5 -cx300 union db1_union_db2 -ci10\n"
 				  << "For detailed help of concrete operation type operation name without parameters:\n"
@@ -374,6 +447,13 @@ public:
 
 				  << " For dump operation there are additional oper_params:\n"
 				  << "  -s - sorted output\n"
+				  << "  -f<text|bin|col> - output format (default: text):\n"
+				  << "     text - lines of k-mer and counter separated by tab\n"
+				  << "     bin  - header followed by records of packed k-mer (2 bits per symbol, most significant byte first) and 4-byte counter\n"
+				  << "     col  - header followed by chunks of at most 65536 k-mers: no. of k-mers (4 bytes), packed k-mers, 4-byte counters\n"
+				  << "     (the header is \"KMCD\" followed by version, k-mer length, encoding of symbols, bytes per k-mer, bytes per counter\n"
+				  << "     and layout (0 - bin, 1 - col), all numbers are 4-byte little endian)\n"
+				  << "  -gz - gzip compressed output (packs are compressed in parallel)\n"
 				  << "Example:\n"
 				  << "kmc_tools transform db reduce err_kmers -cx10 reduce valid_kmers -ci11 histogram histo.txt dump dump.txt\n";
 	}
@@ -411,6 +491,11 @@ public:
 				  << "oper - one of {*,-,~,+}, which refers to {intersect, kmers_subtract, counters_subtract, union}\n"
 				  << "operator * has the highest priority. Other operators has equal priorities. Order of operations can be changed with parentheses\n"
 				  << "for {*,~,+} it is possible to redefine counter calculation mode ([c_mode]). Available values: min, max, diff, sum, left, right (detailet description available in simple help message)\n"
+				  << "ref_input may also be an operation on many arguments (each argument is an expression), performed in a single pass over all of them:\n"
+				  << "  union [c_mode](<expr1>, <expr2>, ...)           - k-mers present in any argument (default c_mode: sum)\n"
+				  << "  intersect [c_mode](<expr1>, <expr2>, ...)       - k-mers present in all arguments (default c_mode: min)\n"
+				  << "  atleast [c_mode](<m>, <expr1>, <expr2>, ...)    - k-mers present in at least <m> arguments (default c_mode: sum)\n"
+				  << "  for these operations c_mode is one of min, max, sum and counters are computed over arguments containing a k-mer\n"
 				  << "output_params are:\n"
 				  << "  -ci<value> - exclude k-mers occurring less than <value> times \n"
 				  << "  -cx<value> - exclude k-mers occurring more of than <value> times\n"
@@ -424,11 +509,74 @@ public:
 				  << "|set3 = kmc_o3 -ci10 -cx100                                      __|\n"
 				  << "|OUTPUT:                                                        |  /\n"
 				  << "|result = (set3 + min set1) * right set2                        | / \n"
-				  << "|_______________________________________________________________|/  \n";
+				  << "|_______________________________________________________________|/  \n"
+				  << "Example of operations on many arguments (OUTPUT section):\n"
+				  << "result = atleast max(2, set1, set2, set3) - union(set4, set5, set6)\n";
 		
 	}
 };
 
+class CMatrixUsageDisplayer : public CUsageDisplayer
+{
+public:
+	CMatrixUsageDisplayer() : CUsageDisplayer("matrix")
+	{}
+	void Display() const override
+	{
+		std::cout << " The '" << name << "' operation merges many databases in a single pass and writes k-mer x sample matrix. General syntax:\n"
+				  << " kmc_tools " << name << " [matrix_params] <output> <input1> [input1_params] <input2> [input2_params] ...\n"
+				  << " output - path to output file\n"
+				  << " input1, input2, ... - paths to databases generated by KMC, @<file> stands for all databases listed in <file> (one per line)\n"
+				  << " matrix_params:\n"
+				  << "  -c         - store counters instead of presence bits\n"
+				  << "  -cb<value> - no. of bytes of a single counter (1-4), greater counters are saturated (default: max. counter size of inputs)\n"
+				  << "  -sm<value> - exclude k-mers present in less than <value> samples (default: 1)\n"
+				  << "  -sx<value> - exclude k-mers present in more than <value> samples (default: no. of inputs)\n"
+				  << "  -b<value>  - no. of k-mers in a single block (default: 65536)\n"
+				  << " For each input there are additional parameters:\n"
+				  << "  -ci<value> - exclude k-mers occurring less than <value> times \n"
+				  << "  -cx<value> - exclude k-mers occurring more of than <value> times\n"
+				  << " Output is a binary file (all numbers little endian):\n"
+				  << "  header: \"KMCM\", version, kmer_len, encoding, no. of samples, counter bytes (0 for presence), k-mer bytes, row bytes,\n"
+				  << "          block size (uint32 each), for each sample: length and path (uint32 and chars)\n"
+				  << "  blocks: k-mers (k-mer bytes each, most significant first) followed by their rows (bit s of row is presence in sample s,\n"
+				  << "          or counter bytes per sample)\n"
+				  << "  block index: for each block its first k-mer, offset and no. of k-mers (uint64 each)\n"
+				  << "  footer: no. of blocks, no. of k-mers, offset of block index (uint64 each), \"KMCM\"\n"
+				  << " A single k-mer may be looked up with: kmc_tools matrix_check <matrix_file> <kmer>\n"
+				  << "Example:\n"
+				  << "kmc_tools matrix -sm2 matrix.kmc_mat sample1 sample2 -ci2 sample3\n"
+				  << "kmc_tools matrix -c -cb2 counts.kmc_mat @samples.txt\n";
+	}
+};
+
+class CDistanceUsageDisplayer : public CUsageDisplayer
+{
+public:
+	CDistanceUsageDisplayer() : CUsageDisplayer("distance")
+	{}
+	void Display() const override
+	{
+		std::cout << " The '" << name << "' operation merges many databases in a single pass and computes similarities of each pair of them. General syntax:\n"
+				  << " kmc_tools " << name << " [distance_params] <output_prefix> <input1> [input1_params] <input2> [input2_params] ...\n"
+				  << " output_prefix - prefix of output files: <output_prefix>.jaccard, <output_prefix>.containment, <output_prefix>.mash\n"
+				  << " input1, input2, ... - paths to databases generated by KMC, @<file> stands for all databases listed in <file> (one per line)\n"
+				  << " distance_params:\n"
+				  << "  -s<value> - FracMinHash scale, only k-mers of hash at most 2^64/<value> are used (default: 1 - exact values)\n"
+				  << " For each input there are additional parameters:\n"
+				  << "  -ci<value> - exclude k-mers occurring less than <value> times \n"
+				  << "  -cx<value> - exclude k-mers occurring more of than <value> times\n"
+				  << " Outputs are tab separated matrices, cell (i, j) is:\n"
+				  << "  jaccard     - |Ai & Aj| / |Ai | Aj|\n"
+				  << "  containment - |Ai & Aj| / |Ai|\n"
+				  << "  mash        - -ln(2J / (1 + J)) / k, where J is Jaccard index (1 if J = 0)\n"
+				  << " Hash of a k-mer is MurmurHash3 finalizer applied to 64-bit words of its 2-bit encoding (least significant word first,\n"
+				  << " each word xored with hash of preceding ones)\n"
+				  << "Example:\n"
+				  << "kmc_tools distance -s1000 samples @samples.txt\n";
+	}
+};
+
 class CFilterUsageDisplayer : public CUsageDisplayer
 {
 public:
@@ -486,6 +634,13 @@ public:
 		case CConfig::Mode::TRANSFORM:
 			desc = std::make_unique<CTransformOperationUsageDisplayer>();
 			break;
+		case CConfig::Mode::MATRIX:
+		case CConfig::Mode::MATRIX_CHECK:
+			desc = std::make_unique<CMatrixUsageDisplayer>();
+			break;
+		case CConfig::Mode::DISTANCE:
+			desc = std::make_unique<CDistanceUsageDisplayer>();
+			break;
 		default:
 			desc = std::make_unique<CGeneralUsageDisplayer>();
 			break;
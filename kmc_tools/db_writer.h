@@ -21,6 +21,11 @@ public:
 	virtual void MultiOptputAddResultPart(COutputBundle<SIZE>& bundle) = 0;
 	virtual void MultiOptputAddResultPart(CBundle<SIZE>& bundle) = 0;
 	virtual void MultiOptputFinish() = 0;
+
+	//range partitioning: writer of results of the part_id-th of disjoint, increasing k-mer ranges,
+	//results of all the parts are concatenated into the output by FinishParts
+	virtual CDbWriter<SIZE>* CreatePartWriter(uint32 part_id, const CKmerRange& range, CBundle<SIZE>* bundle) = 0;
+	virtual void FinishParts() = 0;
 	virtual ~CDbWriter() = default;
 };
 #endif
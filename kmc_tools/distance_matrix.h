@@ -0,0 +1,171 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _DISTANCE_MATRIX_H
+#define _DISTANCE_MATRIX_H
+
+#include "defs.h"
+#include "config.h"
+#include "operations.h"
+#include "db_reader_factory.h"
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//************************************************************************************************************
+// CDistanceMatrix - merges all sorted inputs in a single pass and counts k-mers shared by each pair of
+// inputs. With FracMinHash scale only k-mers of hash at most 2^64/scale are counted.
+// K-mers present in the same set of inputs are counted together (pattern_cache), so the cost of pairs
+// is paid once per distinct set instead of once per k-mer
+//************************************************************************************************************
+template<unsigned SIZE> class CDistanceMatrix
+{
+	static const uint32 PATTERN_CACHE_SIZE = 1 << 18;
+
+	CConfig& config;
+	const CDistanceParams& params;
+	uint32 n_samples;
+	uint64 max_hash;
+
+	std::vector<uint64> sizes;
+	std::vector<uint64> shared; //upper triangle (with diagonal) of n_samples x n_samples matrix
+	std::unordered_map<std::string, uint64> pattern_cache; //sorted ids of inputs (uint32 each) -> no. of k-mers
+
+	uint64& shared_count(uint32 i, uint32 j)
+	{
+		//row i of the upper triangle starts after rows 0..i-1 of lengths n, n-1, ...
+		return shared[(uint64)i * n_samples - (uint64)i * (i - 1) / 2 + (j - i)];
+	}
+
+	void flush_patterns()
+	{
+		for (auto& pattern : pattern_cache)
+		{
+			const uint32* ids = reinterpret_cast<const uint32*>(pattern.first.data());
+			uint32 n_ids = static_cast<uint32>(pattern.first.size() / sizeof(uint32));
+			for (uint32 a = 0; a < n_ids; ++a)
+				for (uint32 b = a + 1; b < n_ids; ++b)
+					shared_count(ids[a], ids[b]) += pattern.second;
+		}
+		pattern_cache.clear();
+	}
+
+	void write_matrix(const std::string& file_name, double(CDistanceMatrix::*value)(uint32, uint32))
+	{
+		FILE* file = fopen(file_name.c_str(), "w");
+		if (!file)
+		{
+			std::cerr << "Error: cannot open file: " << file_name << "\n";
+			exit(1);
+		}
+		fprintf(file, "#");
+		for (auto& desc : config.input_desc)
+			fprintf(file, "\t%s", desc.file_src.c_str());
+		fprintf(file, "\n");
+		for (uint32 i = 0; i < n_samples; ++i)
+		{
+			fprintf(file, "%s", config.input_desc[i].file_src.c_str());
+			for (uint32 j = 0; j < n_samples; ++j)
+				fprintf(file, "\t%.6g", (this->*value)(i, j));
+			fprintf(file, "\n");
+		}
+		if (ferror(file))
+		{
+			std::cerr << "Error while writing to " << file_name << "\n";
+			exit(1);
+		}
+		fclose(file);
+	}
+
+	double jaccard(uint32 i, uint32 j)
+	{
+		uint64 common = shared_count(MIN(i, j), MAX(i, j));
+		uint64 total = sizes[i] + sizes[j] - common;
+		return total ? (double)common / total : 0.0;
+	}
+
+	double containment(uint32 i, uint32 j)
+	{
+		return sizes[i] ? (double)shared_count(MIN(i, j), MAX(i, j)) / sizes[i] : 0.0;
+	}
+
+	double mash(uint32 i, uint32 j)
+	{
+		double J = jaccard(i, j);
+		if (J == 0.0)
+			return 1.0;
+		if (J >= 1.0) //identical sets, -log(1) would be printed as -0
+			return 0.0;
+		return -log(2.0 * J / (1.0 + J)) / config.kmer_len;
+	}
+
+public:
+	CDistanceMatrix() :
+		config(CConfig::GetInstance()),
+		params(config.distance_params)
+	{
+		n_samples = static_cast<uint32>(config.input_desc.size());
+		max_hash = params.scale > 1 ? ~0ull / params.scale : ~0ull;
+		sizes.resize(n_samples);
+		shared.resize((uint64)n_samples * (n_samples + 1) / 2);
+	}
+
+	bool Process()
+	{
+		std::vector<CBundle<SIZE>*> inputs;
+		for (uint32 i = 0; i < n_samples; ++i)
+			inputs.push_back(new CBundle<SIZE>(db_reader_factory<SIZE>(config.headers[i], config.input_desc[i], KmerDBOpenMode::sorted)));
+
+		CBundlesLoserTree<SIZE> tree(inputs);
+		std::vector<uint32> ids;
+		std::string key;
+		while (!tree.Finished())
+		{
+			CKmer<SIZE> kmer = tree.TopKmer();
+			bool sampled = max_hash == ~0ull || kmer_hash(kmer) <= max_hash;
+			ids.clear();
+			do
+			{
+				ids.push_back(tree.Top());
+				tree.Pop();
+			} while (!tree.Finished() && tree.TopKmer() == kmer);
+
+			if (!sampled)
+				continue;
+			for (auto id : ids)
+				++sizes[id];
+			if (ids.size() < 2)
+				continue;
+			std::sort(ids.begin(), ids.end());
+			key.assign(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(uint32));
+			++pattern_cache[key];
+			if (pattern_cache.size() >= PATTERN_CACHE_SIZE)
+				flush_patterns();
+		}
+		flush_patterns();
+		for (auto input : inputs)
+			delete input;
+
+		for (uint32 i = 0; i < n_samples; ++i)
+			shared_count(i, i) = sizes[i];
+
+		write_matrix(params.output_prefix + ".jaccard", &CDistanceMatrix::jaccard);
+		write_matrix(params.output_prefix + ".containment", &CDistanceMatrix::containment);
+		write_matrix(params.output_prefix + ".mash", &CDistanceMatrix::mash);
+		return true;
+	}
+};
+
+#endif
+
+// ***** EOF
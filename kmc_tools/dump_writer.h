@@ -14,7 +14,12 @@
 #include "kmer.h"
 #include "nc_utils.h"
 #include "config.h"
+#include "queues.h"
+#include "../3rd_party/cloudflare/zlib.h"
 #include <fstream>
+#include <thread>
+#include <memory>
+#include <vector>
 
 
 //wrapper to simplify interface
@@ -57,28 +62,49 @@ public:
 	}
 };
 
+//************************************************************************************************************
+// CDumpWriterBase - writes k-mers as text or in binary format. K-mers are collected in packs, if there is more
+// than one thread packs are formatted (and compressed) by formatter threads and a writer thread writes them
+// in order of packs, so the output is the same for any number of threads.
+// Binary format (all numbers little endian):
+//   header : "KMCD", version, kmer_len, encoding of symbols, kmer_bytes, counter_bytes, layout (0 - rows,
+//            1 - columns) (uint32 each)
+//   rows   : for each k-mer: k-mer (kmer_bytes, most significant byte first) and counter (counter_bytes)
+//   columns: chunks of at most 2^16 k-mers: no. of k-mers (uint32), k-mers (kmer_bytes each), counters
+//            (counter_bytes each)
+// With gzip the header and each pack are separate gzip members, so the file may be decompressed by any gzip
+// tool and its content is the same as without gzip
+//************************************************************************************************************
 template<unsigned SIZE>
 class CDumpWriterBase
 {
-	static const uint32 OVERHEAD_SIZE = 1000;
+	static const uint32 PACK_SIZE = 1 << 16; //in k-mers
+	static const uint32 VERSION = 1;
+	static const uint32 COUNTER_BYTES = 4;
 
-	uint32 counter_len;
-	
 	std::string& file_src;
 	uint64 cutoff_max;
 	uint32 cutoff_min;	
 	uint32 counter_max;
+	CTransformOutputDesc::DumpFormat format;
+	bool gzip;
 	
 	uint32 kmer_len;
 	uint32 kmer_bytes;
 	CConfig& config;
 	uint32 in_first_byte;
-	char* buf;
-	uint32 buf_size;
-	uint32 buf_pos;
 
 	FILE* file = nullptr;
 
+	uint32 n_formatters = 0;
+	CBundleData<SIZE> pack;
+	uint64 n_packs = 0;
+	std::vector<char> out_buf, gzip_buf;
+	std::unique_ptr<COrderedQueue<CBundleData<SIZE>>> pack_queue;
+	std::unique_ptr<COrderedQueue<std::vector<char>>> out_queue;
+	std::vector<std::thread> formatters;
+	std::thread writer;
+
 	struct DumpOpt
 	{
 		char* opt_ACGT;
@@ -108,7 +134,7 @@ class CDumpWriterBase
 
 	}opt;
 
-	void kmerToStr(CKmer<SIZE>& kmer, char* kmer_str)
+	void kmerToStr(CKmer<SIZE>& kmer, char* kmer_str) const
 	{
 		//first byte
 		char* base = opt.opt_ACGT + 4 * kmer.get_byte(kmer_bytes - 1) + 4 - in_first_byte;
@@ -125,6 +151,148 @@ class CDumpWriterBase
 		}
 	}
 
+	static void storeUint32(uint32 x, char* ptr)
+	{
+		for (uint32 i = 0; i < 4; ++i, x >>= 8)
+			ptr[i] = x & 0xFF;
+	}
+
+	void formatText(CBundleData<SIZE>& kmers, std::vector<char>& out) const
+	{
+		out.resize((uint64)kmers.NRecLeft() * (kmer_len + 12));
+		char* ptr = out.data();
+		for (; !kmers.Empty(); kmers.Pop())
+		{
+			kmerToStr(kmers.TopKmer(), ptr);
+			ptr += kmer_len;
+			*ptr++ = '\t';
+			ptr += CNumericConversions::Int2PChar(kmers.TopCounter(), (uchar*)ptr);
+			*ptr++ = '\n';
+		}
+		out.resize(ptr - out.data());
+	}
+
+	void formatRows(CBundleData<SIZE>& kmers, std::vector<char>& out) const
+	{
+		out.resize((uint64)kmers.NRecLeft() * (kmer_bytes + COUNTER_BYTES));
+		uchar* ptr = (uchar*)out.data();
+		for (; !kmers.Empty(); kmers.Pop())
+		{
+			kmers.TopKmer().store(ptr, kmer_bytes);
+			storeUint32(kmers.TopCounter(), (char*)ptr);
+			ptr += COUNTER_BYTES;
+		}
+	}
+
+	void formatColumns(CBundleData<SIZE>& kmers, std::vector<char>& out) const
+	{
+		uint32 n_kmers = kmers.NRecLeft();
+		out.resize(4 + (uint64)n_kmers * (kmer_bytes + COUNTER_BYTES));
+		storeUint32(n_kmers, out.data());
+		uchar* kmers_ptr = (uchar*)out.data() + 4;
+		char* counters_ptr = out.data() + 4 + (uint64)n_kmers * kmer_bytes;
+		for (; !kmers.Empty(); kmers.Pop())
+		{
+			kmers.TopKmer().store(kmers_ptr, kmer_bytes);
+			storeUint32(kmers.TopCounter(), counters_ptr);
+			counters_ptr += COUNTER_BYTES;
+		}
+	}
+
+	//out is replaced by a gzip member containing it
+	void compress(std::vector<char>& out, std::vector<char>& tmp) const
+	{
+		z_stream stream{};
+		if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			std::cerr << "Error: cannot initialize gzip compression\n";
+			exit(1);
+		}
+		tmp.resize(deflateBound(&stream, out.size()));
+		stream.next_in = (Bytef*)out.data();
+		stream.avail_in = static_cast<uInt>(out.size());
+		stream.next_out = (Bytef*)tmp.data();
+		stream.avail_out = static_cast<uInt>(tmp.size());
+		if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
+		{
+			std::cerr << "Error: gzip compression failed\n";
+			exit(1);
+		}
+		tmp.resize(stream.total_out);
+		deflateEnd(&stream);
+		out.swap(tmp);
+	}
+
+	void formatPack(CBundleData<SIZE>& kmers, std::vector<char>& out, std::vector<char>& tmp) const
+	{
+		switch (format)
+		{
+		case CTransformOutputDesc::DumpFormat::TEXT:
+			formatText(kmers, out);
+			break;
+		case CTransformOutputDesc::DumpFormat::ROWS:
+			formatRows(kmers, out);
+			break;
+		case CTransformOutputDesc::DumpFormat::COLUMNS:
+			formatColumns(kmers, out);
+			break;
+		}
+		if (gzip)
+			compress(out, tmp);
+	}
+
+	void formatterThread()
+	{
+		CBundleData<SIZE> kmers(0);
+		std::vector<char> out, tmp;
+		uint64 id;
+		while (pack_queue->pop(id, kmers))
+		{
+			formatPack(kmers, out, tmp);
+			out_queue->push(id, std::move(out));
+		}
+	}
+
+	void writerThread()
+	{
+		std::vector<char> out;
+		while (out_queue->pop(out))
+			write(out.data(), out.size());
+	}
+
+	void write(const char* data, uint64 size)
+	{
+		if (fwrite(data, 1, size, file) != size)
+		{
+			std::cerr << "Error while writing to " << file_src << "\n";
+			exit(1);
+		}
+	}
+
+	void writeHeader()
+	{
+		uint32 header[] = { 0, VERSION, kmer_len, get_encoding(), kmer_bytes, COUNTER_BYTES, format == CTransformOutputDesc::DumpFormat::COLUMNS };
+		out_buf.resize(sizeof(header));
+		for (uint32 i = 1; i < sizeof(header) / sizeof(uint32); ++i)
+			storeUint32(header[i], out_buf.data() + 4 * i);
+		memcpy(out_buf.data(), "KMCD", 4);
+		if (gzip)
+			compress(out_buf, gzip_buf);
+		write(out_buf.data(), out_buf.size());
+	}
+
+	void sendPack()
+	{
+		if (n_formatters)
+			pack_queue->push(n_packs++, std::move(pack));
+		else
+		{
+			formatPack(pack, out_buf, gzip_buf);
+			write(out_buf.data(), out_buf.size());
+		}
+		pack = CBundleData<SIZE>(PACK_SIZE);
+	}
+
 protected:
 	void Init()
 	{
@@ -134,9 +302,18 @@ protected:
 			std::cerr << "Error: cannot open file: " << file_src << "\n";
 			exit(1);
 		}
-		buf_pos = 0;
-		buf_size = DUMP_BUF_SIZE;
-		buf = new char[buf_size];
+		if (format != CTransformOutputDesc::DumpFormat::TEXT)
+			writeHeader();
+		pack = CBundleData<SIZE>(PACK_SIZE);
+		n_formatters = config.avaiable_threads > 1 ? config.avaiable_threads - 1 : 0;
+		if (n_formatters)
+		{
+			pack_queue = std::make_unique<COrderedQueue<CBundleData<SIZE>>>(2 * n_formatters);
+			out_queue = std::make_unique<COrderedQueue<std::vector<char>>>(2 * n_formatters);
+			for (uint32 i = 0; i < n_formatters; ++i)
+				formatters.emplace_back(&CDumpWriterBase::formatterThread, this);
+			writer = std::thread(&CDumpWriterBase::writerThread, this);
+		}
 	}
 
 	void ProcessKmer(CKmer<SIZE>& kmer, uint32 counter)
@@ -146,29 +323,34 @@ protected:
 		{
 			if (counter > counter_max)
 				counter = counter_max;
-			kmerToStr(kmer, buf + buf_pos);
-			buf[buf_pos + kmer_len] = '\t';
-			counter_len = CNumericConversions::Int2PChar(counter, (uchar*)(buf + buf_pos + kmer_len + 1));
-			buf[buf_pos + kmer_len + 1 + counter_len] = '\n';
-			buf_pos += kmer_len + 2 + counter_len;
-			if (buf_pos + OVERHEAD_SIZE > buf_size)
-			{
-				fwrite(buf, 1, buf_pos, file);
-				buf_pos = 0;
-			}
+			pack.Insert(kmer, counter);
+			if (pack.Full())
+				sendPack();
 		}
 	}
 
 	void Finish()
 	{		
-		if (buf_pos)
+		if (!pack.Empty())
+			sendPack();
+		if (n_formatters)
+		{
+			pack_queue->mark_completed();
+			for (auto& th : formatters)
+				th.join();
+			formatters.clear();
+			out_queue->mark_completed();
+			writer.join();
+		}
+		//gzip file must contain at least one member
+		if (gzip && ftell(file) == 0)
 		{
-			fwrite(buf, 1, buf_pos, file);
-			buf_pos = 0;
+			out_buf.clear();
+			compress(out_buf, gzip_buf);
+			write(out_buf.data(), out_buf.size());
 		}
 
 		fclose(file);
-		delete[] buf;
 	}
 
 	uint8_t get_encoding()
@@ -180,12 +362,15 @@ protected:
 
 
 protected:
-	CDumpWriterBase(std::string& file_src, uint64 cutoff_max, uint32 cutoff_min, uint32 counter_max) :
+	CDumpWriterBase(std::string& file_src, uint64 cutoff_max, uint32 cutoff_min, uint32 counter_max, CTransformOutputDesc::DumpFormat format, bool gzip) :
 		file_src(file_src),
 		cutoff_max(cutoff_max),
 		cutoff_min(cutoff_min),
 		counter_max(counter_max),
+		format(format),
+		gzip(gzip),
 		config(CConfig::GetInstance()),
+		pack(0),
 		opt(get_encoding())
 	{
 		kmer_len = config.headers.front().kmer_len;
@@ -202,7 +387,7 @@ class CDumpWriter : public CDumpWriterBase<SIZE>
 	KMCDB& kmcdb;
 public:
 	CDumpWriter(KMCDB& kmcdb) :
-		CDumpWriterBase<SIZE>(CConfig::GetInstance().output_desc.file_src, CConfig::GetInstance().output_desc.cutoff_max, CConfig::GetInstance().output_desc.cutoff_min, CConfig::GetInstance().output_desc.counter_max),
+		CDumpWriterBase<SIZE>(CConfig::GetInstance().output_desc.file_src, CConfig::GetInstance().output_desc.cutoff_max, CConfig::GetInstance().output_desc.cutoff_min, CConfig::GetInstance().output_desc.counter_max, CTransformOutputDesc::DumpFormat::TEXT, false),
 		kmcdb(kmcdb)		
 	{
 
@@ -228,7 +413,7 @@ class CDumpWriterForTransform : public CDumpWriterBase<SIZE>
 public:
 	CDumpWriterForTransform(CTransformOutputDesc& output_desc)
 		:
-		CDumpWriterBase<SIZE>(output_desc.file_src, output_desc.cutoff_max, output_desc.cutoff_min, output_desc.counter_max)
+		CDumpWriterBase<SIZE>(output_desc.file_src, output_desc.cutoff_max, output_desc.cutoff_min, output_desc.counter_max, output_desc.dump_format, output_desc.dump_gzip)
 	{
 
 	}
@@ -17,6 +17,7 @@
 #include <sstream>
 #include <memory>
 #include "db_reader_factory.h"
+#include "kmer_probe.h"
 
 //************************************************************************************************************
 // CExpressionNode - Base abstract class representing expression node. In first stage of algorithm from
@@ -39,7 +40,11 @@ public:
 		return right;
 	}
 
-	virtual CBundle<SIZE>* GetExecutionRoot() = 0;
+	//input_desc - descriptions of inputs (config.input_desc or its copy limited to a range of k-mers)
+	virtual CBundle<SIZE>* GetExecutionRoot(const std::vector<CInputDesc>& input_desc) = 0;
+
+	//upper bound of no. of k-mers in the result, used to find inputs which are cheaper to probe than to read
+	virtual uint64 EstimatedSize() const = 0;
 
 	void AddLeftChild(CExpressionNode* child)
 	{
@@ -91,10 +96,21 @@ protected:
 	CExpressionNode* left, *right;
 };
 
+template<unsigned SIZE> class CInputNode;
+
 template<unsigned SIZE> class COperNode : public CExpressionNode<SIZE> 
 {
 protected:
 	CounterOpType counter_op_type;
+
+	//returns an input which should be probed instead of streamed if the other argument is small enough
+	static CInputNode<SIZE>* probed_input(CExpressionNode<SIZE>* large, CExpressionNode<SIZE>* small)
+	{
+		auto input = dynamic_cast<CInputNode<SIZE>*>(large);
+		if (input && CKmerProbe<SIZE>::IsPreferred(CConfig::GetInstance().headers[input->DescPos()], small->EstimatedSize()))
+			return input;
+		return nullptr;
+	}
 public:
 	COperNode(CounterOpType counter_op_type) :counter_op_type(counter_op_type)
 	{
@@ -115,9 +131,13 @@ public:
 	CUnionNode():COperNode<SIZE>(CounterOpType::SUM)
 	{
 	}
-	CBundle<SIZE>* GetExecutionRoot() override
+	CBundle<SIZE>* GetExecutionRoot(const std::vector<CInputDesc>& input_desc) override
 	{
-		return new CBundle<SIZE>(new CUnion<SIZE>(this->left->GetExecutionRoot(), this->right->GetExecutionRoot(), this->counter_op_type));
+		return new CBundle<SIZE>(new CUnion<SIZE>(this->left->GetExecutionRoot(input_desc), this->right->GetExecutionRoot(input_desc), this->counter_op_type));
+	}
+	uint64 EstimatedSize() const override
+	{
+		return this->left->EstimatedSize() + this->right->EstimatedSize();
 	}
 #ifdef ENABLE_DEBUG
 	void Info() override
@@ -137,9 +157,15 @@ public:
 	CKmersSubtractionNode() :COperNode<SIZE>(CounterOpType::NONE)
 	{
 	}
-	CBundle<SIZE>* GetExecutionRoot() override
+	CBundle<SIZE>* GetExecutionRoot(const std::vector<CInputDesc>& input_desc) override
+	{
+		if (auto large = this->probed_input(this->right, this->left))
+			return new CBundle<SIZE>(new CProbeOper<SIZE>(this->left->GetExecutionRoot(input_desc), true, input_desc[large->DescPos()], CProbeOper<SIZE>::OpType::KMERS_SUBTRACT, this->counter_op_type));
+		return new CBundle<SIZE>(new CKmersSubtract<SIZE>(this->left->GetExecutionRoot(input_desc), this->right->GetExecutionRoot(input_desc)));
+	}
+	uint64 EstimatedSize() const override
 	{
-		return new CBundle<SIZE>(new CKmersSubtract<SIZE>(this->left->GetExecutionRoot(), this->right->GetExecutionRoot()));
+		return this->left->EstimatedSize();
 	}
 #ifdef ENABLE_DEBUG
 	void Info() override
@@ -157,9 +183,15 @@ public:
 		COperNode<SIZE>(CounterOpType::DIFF)
 	{
 	}
-	CBundle<SIZE>* GetExecutionRoot() override
+	CBundle<SIZE>* GetExecutionRoot(const std::vector<CInputDesc>& input_desc) override
+	{
+		if (auto large = this->probed_input(this->right, this->left))
+			return new CBundle<SIZE>(new CProbeOper<SIZE>(this->left->GetExecutionRoot(input_desc), true, input_desc[large->DescPos()], CProbeOper<SIZE>::OpType::COUNTERS_SUBTRACT, this->counter_op_type));
+		return new CBundle<SIZE>(new CCountersSubtract<SIZE>(this->left->GetExecutionRoot(input_desc), this->right->GetExecutionRoot(input_desc), this->counter_op_type));
+	}
+	uint64 EstimatedSize() const override
 	{
-		return new CBundle<SIZE>(new CCountersSubtract<SIZE>(this->left->GetExecutionRoot(), this->right->GetExecutionRoot(), this->counter_op_type));
+		return this->left->EstimatedSize();
 	}
 #ifdef ENABLE_DEBUG
 	void Info() override
@@ -178,9 +210,17 @@ public:
 		COperNode<SIZE>(CounterOpType::MIN)
 	{
 	}
-	CBundle<SIZE>* GetExecutionRoot() override
+	CBundle<SIZE>* GetExecutionRoot(const std::vector<CInputDesc>& input_desc) override
 	{		
-		return new CBundle<SIZE>(new CIntersection<SIZE>(this->left->GetExecutionRoot(), this->right->GetExecutionRoot(), this->counter_op_type));
+		if (auto large = this->probed_input(this->right, this->left))
+			return new CBundle<SIZE>(new CProbeOper<SIZE>(this->left->GetExecutionRoot(input_desc), true, input_desc[large->DescPos()], CProbeOper<SIZE>::OpType::INTERSECT, this->counter_op_type));
+		if (auto large = this->probed_input(this->left, this->right))
+			return new CBundle<SIZE>(new CProbeOper<SIZE>(this->right->GetExecutionRoot(input_desc), false, input_desc[large->DescPos()], CProbeOper<SIZE>::OpType::INTERSECT, this->counter_op_type));
+		return new CBundle<SIZE>(new CIntersection<SIZE>(this->left->GetExecutionRoot(input_desc), this->right->GetExecutionRoot(input_desc), this->counter_op_type));
+	}
+	uint64 EstimatedSize() const override
+	{
+		return MIN(this->left->EstimatedSize(), this->right->EstimatedSize());
 	}
 #ifdef ENABLE_DEBUG
 	void Info() override
@@ -190,6 +230,60 @@ public:
 #endif
 };
 
+//************************************************************************************************************
+// CNaryOperNode - represents node for N argument's operation (union, intersect, atleast). Arguments are kept
+// in args instead of left and right children
+//************************************************************************************************************
+template<unsigned SIZE> class CNaryOperNode : public COperNode<SIZE>
+{
+	std::string name;
+	uint32 min_inputs = 1;
+	std::vector<CExpressionNode<SIZE>*> args;
+public:
+	CNaryOperNode(const std::string& name, CounterOpType counter_op_type) :
+		COperNode<SIZE>(counter_op_type), name(name)
+	{
+	}
+	void AddArgument(CExpressionNode<SIZE>* arg)
+	{
+		args.push_back(arg);
+	}
+	uint32 NoOfArguments() const
+	{
+		return static_cast<uint32>(args.size());
+	}
+	//k-mer must be present in at least min_inputs arguments to be in the result
+	void SetMinInputs(uint32 _min_inputs)
+	{
+		min_inputs = _min_inputs;
+	}
+	CBundle<SIZE>* GetExecutionRoot(const std::vector<CInputDesc>& input_desc) override
+	{
+		std::vector<CBundle<SIZE>*> inputs;
+		for (auto arg : args)
+			inputs.push_back(arg->GetExecutionRoot(input_desc));
+		return new CBundle<SIZE>(new CNaryOper<SIZE>(std::move(inputs), min_inputs, this->counter_op_type));
+	}
+	uint64 EstimatedSize() const override
+	{
+		uint64 sum = 0;
+		for (auto arg : args)
+			sum += arg->EstimatedSize();
+		return sum / min_inputs;
+	}
+#ifdef ENABLE_DEBUG
+	void Info() override
+	{
+		std::cout << name << "(" << args.size() << " args, at least " << min_inputs << ")";
+	}
+#endif
+	~CNaryOperNode() override
+	{
+		for (auto arg : args)
+			delete arg;
+	}
+};
+
 //************************************************************************************************************
 // CInputNode - represents node (leaf) - KMC1 or KMC2 database
 //************************************************************************************************************
@@ -200,12 +294,20 @@ public:
 	CInputNode(uint32 desc_pos) : desc_pos(desc_pos)
 	{
 	}
-	CBundle<SIZE>* GetExecutionRoot() override
+	CBundle<SIZE>* GetExecutionRoot(const std::vector<CInputDesc>& input_desc) override
 	{		
 		CConfig& config = CConfig::GetInstance();
-		CInput<SIZE>* db = db_reader_factory<SIZE>(config.headers[desc_pos], config.input_desc[desc_pos], KmerDBOpenMode::sorted);		
+		CInput<SIZE>* db = db_reader_factory<SIZE>(config.headers[desc_pos], input_desc[desc_pos], KmerDBOpenMode::sorted);		
 		return new CBundle<SIZE>(db);
 	}
+	uint64 EstimatedSize() const override
+	{
+		return CConfig::GetInstance().headers[desc_pos].total_kmers;
+	}
+	uint32 DescPos() const
+	{
+		return desc_pos;
+	}
 
 #ifdef ENABLE_DEBUG
 	void Info() override
@@ -15,6 +15,7 @@ Date   : 2024-02-09
 
 #include "../kmc_core/kff_writer.h"
 #include "defs.h"
+#include <memory>
 
 
 template<unsigned SIZE> class CKFFDbWriter : public CDbWriter<SIZE>
@@ -23,15 +24,29 @@ template<unsigned SIZE> class CKFFDbWriter : public CDbWriter<SIZE>
 	uint64 kmer_bytes;
 	uint64 rec_bytes;
 	CBundle<SIZE>* bundle;
-	CKFFWriter kff_writer;
+	std::unique_ptr<CKFFWriter> kff_writer;
 	COutputDesc& output_desc;
 	uchar* buff;	
 	uint64 buff_size;
 	uint64 buff_pos;
+
+	//for range partitioning, a part writer stores records in a temporary file
+	FILE* part_file = nullptr;
+	std::string part_file_name;
+	std::vector<std::unique_ptr<CKFFDbWriter<SIZE>>> parts;
 	
 	void store_buff()
 	{
-		kff_writer.StoreSectionPart(buff, buff_pos);
+		if (part_file)
+		{
+			if (fwrite(buff, rec_bytes, buff_pos, part_file) != buff_pos)
+			{
+				std::cerr << "Error while writing to " << part_file_name << "\n";
+				exit(1);
+			}
+		}
+		else
+			kff_writer->StoreSectionPart(buff, buff_pos);
 		buff_pos = 0;
 	}
 
@@ -47,14 +62,54 @@ template<unsigned SIZE> class CKFFDbWriter : public CDbWriter<SIZE>
 
 	void start()
 	{
-		kff_writer.InitSection();
+		if (!part_file)
+			kff_writer->InitSection();
 	}
 
 	void finish()
 	{
 		if (buff_pos != 0)
 			store_buff();
-		kff_writer.FinishSection();		
+		if (part_file)
+			fclose(part_file);
+		else
+			kff_writer->FinishSection();		
+	}
+
+	void append_part(CKFFDbWriter<SIZE>& part)
+	{
+		FILE* file = fopen(part.part_file_name.c_str(), "rb");
+		if (!file)
+		{
+			std::cerr << "Error: cannot open file : " << part.part_file_name << "\n";
+			exit(1);
+		}
+		setvbuf(file, NULL, _IONBF, 0);
+		while ((buff_pos = fread(buff, rec_bytes, buff_size, file)) != 0)
+			store_buff();
+		fclose(file);
+		remove(part.part_file_name.c_str());
+	}
+
+	//part writer
+	CKFFDbWriter(CKFFDbWriter<SIZE>& parent, CBundle<SIZE>* bundle) :
+		counter_size(parent.counter_size),
+		kmer_bytes(parent.kmer_bytes),
+		rec_bytes(parent.rec_bytes),
+		bundle(bundle),
+		output_desc(parent.output_desc),
+		part_file_name(parent.output_desc.file_src + ".kff.part" + std::to_string(parent.parts.size()))
+	{
+		part_file = fopen(part_file_name.c_str(), "wb");
+		if (!part_file)
+		{
+			std::cerr << "Error: cannot open file : " << part_file_name << "\n";
+			exit(1);
+		}
+		setvbuf(part_file, NULL, _IONBF, 0);
+		buff = new uchar[KFF_DB_WRITER_BUFF_BYTES];
+		buff_size = KFF_DB_WRITER_BUFF_BYTES / rec_bytes;
+		buff_pos = 0;
 	}
 
 	bool canonical()
@@ -75,14 +130,14 @@ public:
 		kmer_bytes((CConfig::GetInstance().kmer_len + 3) / 4),
 		rec_bytes(kmer_bytes + counter_size),
 		bundle(bundle),
-		kff_writer(
+		kff_writer(std::make_unique<CKFFWriter>(
 			output_desc.file_src + ".kff",
 			canonical(),
 			CConfig::GetInstance().kmer_len,
 			counter_size,
 			output_desc.cutoff_min,
 			output_desc.cutoff_max,
-			output_desc.encoding),
+			output_desc.encoding)),
 		output_desc(output_desc)
 	{
 		buff = new uchar[KFF_DB_WRITER_BUFF_BYTES];
@@ -146,6 +201,29 @@ public:
 	{
 		finish();
 	}
+
+	CDbWriter<SIZE>* CreatePartWriter(uint32 part_id, const CKmerRange& /*range*/, CBundle<SIZE>* bundle) override
+	{
+		if (part_id != parts.size())
+		{
+			std::cerr << "Error: this should never happen, please contact authors: " << __FILE__ << "\t" << __LINE__ << "\n";
+			exit(1);
+		}
+		parts.emplace_back(new CKFFDbWriter<SIZE>(*this, bundle));
+		return parts.back().get();
+	}
+
+	void FinishParts() override
+	{
+		start();
+		for (auto& part : parts)
+		{
+			append_part(*part);
+			part.reset();
+		}
+		parts.clear();
+		finish();
+	}
 };
 
 #endif
\ No newline at end of file
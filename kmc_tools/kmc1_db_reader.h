@@ -244,6 +244,7 @@ private:
 
 	uint64 kmers_left_for_current_prefix;
 	uint64 total_kmers_left;
+	uint64 end_kmer; //number of k-mers preceding the end of the range to read
 
 	const CInputDesc& desc;
 
@@ -297,6 +298,7 @@ private:
 	bool fill_suffix();
 
 	void open_files();
+	uint64 read_lut_value(uint64 prefix);
 
 	void allocate_buffers()
 	{
@@ -324,7 +326,7 @@ template<unsigned SIZE> CKMC1DbReader<SIZE>::CKMC1DbReader(const CKmerFileHeader
 	circular_queue(DEFAULT_CIRCULAL_QUEUE_CAPACITY),
 	suffix_queue(DEFAULT_CIRCULAL_QUEUE_CAPACITY)
 {
-	progress_id = percent_progress.RegisterItem(header.total_kmers);
+	progress_id = desc.progress_id >= 0 ? desc.progress_id : percent_progress.RegisterItem(header.total_kmers);
 
 	prefix_file = suffix_file = nullptr;
 	suffix_bytes = (header.kmer_len - header.lut_prefix_len) / 4;
@@ -332,23 +334,32 @@ template<unsigned SIZE> CKMC1DbReader<SIZE>::CKMC1DbReader(const CKmerFileHeader
 	suffix_buff_size = SUFFIX_BUFF_BYTES / record_size * record_size;
 	prefix_buff_size = PREFIX_BUFF_BYTES / sizeof(uint64);
 
-	uint64 suffix_left_to_read = header.total_kmers * record_size;
+	open_files();
+
+	//only prefixes from the range are read (all of them by default)
+	uint64 first_prefix = desc.range.FirstPrefix(header.lut_prefix_len);
+	uint64 end_prefix = desc.range.EndPrefix(header.lut_prefix_len);
+	uint64 first_kmer = first_prefix ? read_lut_value(first_prefix) : 0;
+	end_kmer = end_prefix < (1ull << header.lut_prefix_len * 2) ? read_lut_value(end_prefix) : header.total_kmers;
+	my_fseek(prefix_file, 4 + (first_prefix + 1) * sizeof(uint64), SEEK_SET);
+	my_fseek(suffix_file, 4 + first_kmer * record_size, SEEK_SET);
+
+	uint64 suffix_left_to_read = (end_kmer - first_kmer) * record_size;
 
 	if (suffix_left_to_read < suffix_buff_size)
 		suffix_buff_size = suffix_left_to_read;
 
 	
 
-	prefix_left_to_read = (1 << header.lut_prefix_len * 2) - 1;
+	prefix_left_to_read = end_prefix - first_prefix - 1;
 
 	if (prefix_left_to_read < prefix_buff_size)
-		prefix_buff_size = prefix_left_to_read;
+		prefix_buff_size = MAX(1, prefix_left_to_read); //place for guard
 
 	prefix_bytes = (header.lut_prefix_len + 3) / 4;
 
 	kmer_bytes = prefix_bytes + suffix_bytes;
 
-	open_files();
 	allocate_buffers();
 
 	suff_buff_queue = new CSuffBufQueue(4, suffix_buff_size);
@@ -359,9 +370,11 @@ template<unsigned SIZE> CKMC1DbReader<SIZE>::CKMC1DbReader(const CKmerFileHeader
 	reload_pref_buff();
 	reload_suf_buff();
 
-	total_kmers_left = header.total_kmers;
+	kmers_left_for_current_prefix = prefix_buff[0] - first_kmer;
+	total_kmers_left = end_kmer - first_kmer;
 
 	current_prefix.clear();
+	current_prefix.set_bits(suffix_bytes * 8, header.lut_prefix_len * 2, first_prefix);
 	suffix_number = 0;
 
 
@@ -422,7 +435,7 @@ template<unsigned SIZE> void CKMC1DbReader<SIZE>::reload_pref_buff()
 	prefix_buff_pos = 0;
 	if (to_read == 0)
 	{
-		prefix_buff[0] = header.total_kmers;//guard		
+		prefix_buff[0] = end_kmer;//guard		
 		return;
 	}
 
@@ -434,7 +447,7 @@ template<unsigned SIZE> void CKMC1DbReader<SIZE>::reload_pref_buff()
 	prefix_left_to_read -= to_read;
 	if (to_read < prefix_buff_size)
 	{
-		prefix_buff[to_read] = header.total_kmers;//guard
+		prefix_buff[to_read] = end_kmer;//guard
 	}
 	kmers_left_for_current_prefix = prefix_buff[0];
 }
@@ -513,6 +526,19 @@ template<unsigned SIZE> void CKMC1DbReader<SIZE>::open_files()
 
 }
 
+/*****************************************************************************************************************************/
+template<unsigned SIZE> uint64 CKMC1DbReader<SIZE>::read_lut_value(uint64 prefix)
+{
+	uint64 value;
+	my_fseek(prefix_file, 4 + prefix * sizeof(uint64), SEEK_SET);
+	if (fread(&value, sizeof(uint64), 1, prefix_file) != 1)
+	{
+		std::cerr << "Error: some error while reading " << prefix_file_name << "\n";
+		exit(1);
+	}
+	return value;
+}
+
 /*****************************************************************************************************************************/
 template<unsigned SIZE> bool CKMC1DbReader<SIZE>::fill_suffix()
 {
@@ -18,6 +18,7 @@ Date   : 2024-02-09
 
 #include <string>
 #include <vector>
+#include <memory>
 
 //************************************************************************************************************
 // CKMC1SuffixFileWriter - thread for writing suffixes' parts
@@ -60,6 +61,8 @@ public:
 	bool Process() override;
 
 private:
+	CKMC1DbWriter(CKMC1DbWriter<SIZE>& parent, const CKmerRange& range, CBundle<SIZE>* bundle); //part writer
+
 	static const uint32 PRE_BUFF_SIZE_BYTES = KMC1_DB_WRITER_PREFIX_BUFF_BYTES;
 	static const uint32 SUF_BUFF_SIZE_BYTES = KMC1_DB_WRITER_SUFFIX_BUFF_BYTES;
 
@@ -87,6 +90,17 @@ private:
 
 	template<typename T> void write_header_part(T data);
 	void calc_lut_prefix_len();
+	void init_buffers();
+
+	//for range partitioning, a part writer stores suffixes in a temporary file and LUT in memory
+	bool is_part = false;
+	std::string part_file_name;
+	uint32 part_first_prefix = 0;
+	std::vector<uint64> part_lut; //values for prefixes following part_first_prefix
+	std::vector<std::unique_ptr<CKMC1DbWriter<SIZE>>> parts;
+
+	inline void add_lut_value(uint64 value);
+	void append_part(CKMC1DbWriter<SIZE>& part);
 
 
 	CCircularQueue<SIZE> bundles_queue;
@@ -103,6 +117,8 @@ public:
 	void MultiOptputAddResultPart(CBundle<SIZE>& bundle) override;
 	void MultiOptputFinish() override;
 
+	CDbWriter<SIZE>* CreatePartWriter(uint32 part_id, const CKmerRange& range, CBundle<SIZE>* bundle) override;
+	void FinishParts() override;
 };
 
 /*****************************************************************************************************************************/
@@ -151,23 +167,32 @@ bundles_queue(DEFAULT_CIRCULAL_QUEUE_CAPACITY)
 
 	calc_lut_prefix_len();
 
-	counter_size = MIN(BYTE_LOG(output_desc.counter_max), BYTE_LOG(output_desc.cutoff_max));
-	if (output_desc.counter_value)
-		counter_size = BYTE_LOG(output_desc.counter_value);
-	suffix_rec_bytes = (config.kmer_len - lut_prefix_len) / 4 + counter_size;
-	current_prefix = 0;
-	added_kmers = 0;
-	pre_buff_size = PRE_BUFF_SIZE_BYTES / sizeof(uint64);
-	suf_buff_size = SUF_BUFF_SIZE_BYTES / suffix_rec_bytes;
-	suf_pos = pre_pos = 0;
-
-	pre_buff = new uint64[pre_buff_size];
+	init_buffers();
 	pre_buff[pre_pos++] = 0;
-	suf_buff = new uchar[suf_buff_size * suffix_rec_bytes];
+}
 
+/*****************************************************************************************************************************/
+template <unsigned SIZE> CKMC1DbWriter<SIZE>::CKMC1DbWriter(CKMC1DbWriter<SIZE>& parent, const CKmerRange& range, CBundle<SIZE>* bundle) :
+config(parent.config),
+output_desc(parent.output_desc),
+bundle(bundle),
+bundles_queue(DEFAULT_CIRCULAL_QUEUE_CAPACITY)
+{
+	is_part = true;
+	part_file_name = output_desc.file_src + ".kmc_suf.part" + std::to_string(parent.parts.size());
+	kmc_pre = NULL;
+	kmc_suf = fopen(part_file_name.c_str(), "wb");
 
-	suf_buf_queue.init(suf_buff_size * suffix_rec_bytes, SUFFIX_WRITE_QUEUE_CAPACITY);
+	if (!kmc_suf)
+	{
+		std::cerr << "Error: cannot open file : " << part_file_name << "\n";
+		exit(1);
+	}
+	setvbuf(kmc_suf, NULL, _IONBF, 0);
 
+	lut_prefix_len = parent.lut_prefix_len;
+	init_buffers();
+	current_prefix = part_first_prefix = (uint32)range.FirstPrefix(lut_prefix_len);
 }
 
 /*****************************************************************************************************************************/
@@ -267,6 +292,31 @@ template<unsigned SIZE> void CKMC1DbWriter<SIZE>::MultiOptputFinish()
 	finish_writing();
 }
 
+/*****************************************************************************************************************************/
+template<unsigned SIZE> CDbWriter<SIZE>* CKMC1DbWriter<SIZE>::CreatePartWriter(uint32 part_id, const CKmerRange& range, CBundle<SIZE>* bundle)
+{
+	if (part_id != parts.size())
+	{
+		std::cerr << "Error: this should never happen, please contact authors: " << __FILE__ << "\t" << __LINE__ << "\n";
+		exit(1);
+	}
+	parts.emplace_back(new CKMC1DbWriter<SIZE>(*this, range, bundle));
+	return parts.back().get();
+}
+
+/*****************************************************************************************************************************/
+template<unsigned SIZE> void CKMC1DbWriter<SIZE>::FinishParts()
+{
+	start_writing();
+	for (auto& part : parts)
+	{
+		append_part(*part);
+		part.reset();
+	}
+	parts.clear();
+	finish_writing();
+}
+
 /*****************************************************************************************************************************/
 template<unsigned SIZE> CKMC1DbWriter<SIZE>::~CKMC1DbWriter()
 {
@@ -295,6 +345,8 @@ template <unsigned SIZE> template <typename T> void CKMC1DbWriter<SIZE>::write_h
 /*****************************************************************************************************************************/
 template<unsigned SIZE> void CKMC1DbWriter<SIZE>::start_writing()
 {
+	if (is_part)
+		return;
 	if (fwrite("KMCP", 1, 4, kmc_pre) != 4)
 	{
 		std::cerr << "Error while writing starting KMCP marker";
@@ -310,6 +362,12 @@ template<unsigned SIZE> void CKMC1DbWriter<SIZE>::start_writing()
 /*****************************************************************************************************************************/
 template<unsigned SIZE> void CKMC1DbWriter<SIZE>::finish_writing()
 {
+	if (is_part)
+	{
+		store_pre_buf();
+		fclose(kmc_suf);
+		return;
+	}
 	uint32 max_prefix = (1 << 2 * lut_prefix_len);
 	while (current_prefix < max_prefix - 1)
 	{
@@ -406,6 +464,12 @@ template<unsigned SIZE> void CKMC1DbWriter<SIZE>::add_kmer(CKmer<SIZE>& kmer, ui
 /*****************************************************************************************************************************/
 template<unsigned SIZE> void CKMC1DbWriter<SIZE>::store_pre_buf()
 {
+	if (is_part)
+	{
+		part_lut.insert(part_lut.end(), pre_buff, pre_buff + pre_pos);
+		pre_pos = 0;
+		return;
+	}
 	if (fwrite(pre_buff, sizeof(uint64), pre_pos, kmc_pre) != pre_pos)
 	{
 		std::cerr << "Error while writing to kmc_pre file\n";
@@ -414,6 +478,45 @@ template<unsigned SIZE> void CKMC1DbWriter<SIZE>::store_pre_buf()
 	pre_pos = 0;
 }
 
+/*****************************************************************************************************************************/
+template<unsigned SIZE> void CKMC1DbWriter<SIZE>::add_lut_value(uint64 value)
+{
+	pre_buff[pre_pos++] = value;
+	++current_prefix;
+	if (pre_pos == pre_buff_size)
+		store_pre_buf();
+}
+
+/*****************************************************************************************************************************/
+template<unsigned SIZE> void CKMC1DbWriter<SIZE>::append_part(CKMC1DbWriter<SIZE>& part)
+{
+	//LUT values of a part are relative to its first prefix and the number of k-mers of preceding parts
+	while (current_prefix < part.part_first_prefix)
+		add_lut_value(added_kmers);
+	for (auto value : part.part_lut)
+		add_lut_value(added_kmers + value);
+	added_kmers += part.added_kmers;
+
+	FILE* part_file = fopen(part.part_file_name.c_str(), "rb");
+	if (!part_file)
+	{
+		std::cerr << "Error: cannot open file : " << part.part_file_name << "\n";
+		exit(1);
+	}
+	setvbuf(part_file, NULL, _IONBF, 0);
+	uint64 readed;
+	while ((readed = fread(suf_buff, 1, suf_buff_size * suffix_rec_bytes, part_file)) != 0)
+	{
+		if (fwrite(suf_buff, 1, readed, kmc_suf) != readed)
+		{
+			std::cerr << "Error while writing to kmc_suf file\n";
+			exit(1);
+		}
+	}
+	fclose(part_file);
+	remove(part.part_file_name.c_str());
+}
+
 /*****************************************************************************************************************************/
 template<unsigned SIZE> void CKMC1DbWriter<SIZE>::send_suf_buf_to_queue()
 {
@@ -421,6 +524,26 @@ template<unsigned SIZE> void CKMC1DbWriter<SIZE>::send_suf_buf_to_queue()
 	suf_pos = 0;
 }
 
+/*****************************************************************************************************************************/
+template<unsigned SIZE> void CKMC1DbWriter<SIZE>::init_buffers()
+{
+	counter_size = MIN(BYTE_LOG(output_desc.counter_max), BYTE_LOG(output_desc.cutoff_max));
+	if (output_desc.counter_value)
+		counter_size = BYTE_LOG(output_desc.counter_value);
+	suffix_rec_bytes = (config.kmer_len - lut_prefix_len) / 4 + counter_size;
+	current_prefix = 0;
+	added_kmers = 0;
+	pre_buff_size = PRE_BUFF_SIZE_BYTES / sizeof(uint64);
+	suf_buff_size = SUF_BUFF_SIZE_BYTES / suffix_rec_bytes;
+	suf_pos = pre_pos = 0;
+
+	pre_buff = new uint64[pre_buff_size];
+	suf_buff = new uchar[suf_buff_size * suffix_rec_bytes];
+
+
+	suf_buf_queue.init(suf_buff_size * suffix_rec_bytes, SUFFIX_WRITE_QUEUE_CAPACITY);
+}
+
 /*****************************************************************************************************************************/
 template<unsigned SIZE> void CKMC1DbWriter<SIZE>::calc_lut_prefix_len()
 {
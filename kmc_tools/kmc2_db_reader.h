@@ -24,6 +24,8 @@ Date   : 2024-02-09
 #include <algorithm>
 #include <condition_variable>
 #include "kff_kmc2_reader_utils.h"
+#include "../kmc_api/elias_fano.h"
+#include "../kmc_api/compressed_suffixes.h"
 
 //Forward declaration
 template<unsigned SIZE> class CKMC2DbReaderSorted;
@@ -168,10 +170,14 @@ class CSufBinReader
 {
 	CBinBufProvider<SIZE>& bin_provider;
 	FILE* suf_file;
+	CCompressedSuffixReader* compressed_reader;		//for compressed *.kmc_suf, nullptr otherwise
+	uint32 rec_size;
 public:
-	CSufBinReader(CBinBufProvider<SIZE>& bin_provider, FILE* suf_file) :
+	CSufBinReader(CBinBufProvider<SIZE>& bin_provider, FILE* suf_file, CCompressedSuffixReader* compressed_reader, uint32 rec_size) :
 		bin_provider(bin_provider),
-		suf_file(suf_file)
+		suf_file(suf_file),
+		compressed_reader(compressed_reader),
+		rec_size(rec_size)
 	{
 
 	}
@@ -184,8 +190,15 @@ public:
 
 		while (bin_provider.get_next_to_read(bin_id, file_pos, buf, size))
 		{
-			my_fseek(suf_file, file_pos, SEEK_SET);
-			if (fread(buf, 1, size, suf_file) != size)
+			bool ok;
+			if (compressed_reader)		//positions are given in uncompressed *.kmc_suf
+				ok = compressed_reader->Seek((file_pos - 4) / rec_size) && compressed_reader->Read(buf, size) == size;
+			else
+			{
+				my_fseek(suf_file, file_pos, SEEK_SET);
+				ok = fread(buf, 1, size, suf_file) == size;
+			}
+			if (!ok)
 			{
 				std::cerr << "Error while reading suffix file\n";
 				exit(1);
@@ -415,9 +428,11 @@ private:
 	const CInputDesc& desc;
 	uint64* LUTS = nullptr;
 	uint32 lut_size = 0;
+	uint64 first_prefix = 0;
 	uint32 suffix_bytes;
 	uint32 record_size;
 	FILE* kmc_suf;
+	std::unique_ptr<CCompressedSuffixReader> compressed_suffix_reader;
 
 	friend class CBin<SIZE>;
 	std::vector<CBin<SIZE>> bins;
@@ -474,6 +489,7 @@ protected:
 
 	FILE* suffix_file;
 	std::string suffix_file_name;
+	std::unique_ptr<CCompressedSuffixReader> compressed_suffix_reader;		//for compressed *.kmc_suf
 };
 
 
@@ -499,6 +515,8 @@ private:
 	uint64 prefix_mask;
 
 	uint64* prefix_buff = nullptr;
+	std::unique_ptr<CEliasFano> lut_ef;		//for databases with Elias-Fano encoded LUT
+	uint64 lut_ef_pos = 1;					//the next LUT element to decode, the first one is skipped as it must be 0
 	int a;
 };
 
@@ -573,6 +591,7 @@ max_prefix(kmc2_db.lut_size - 1)
 	record_size = suffix_bytes + counter_size;
 
 	prefix.clear();
+	prefix.set_bits(suffix_bytes * 8, kmc2_db.header.lut_prefix_len * 2, kmc2_db.first_prefix);
 	is_little_endian = CConfig::GetInstance().IsLittleEndian();
 	counter_mask = (uint32)((1ull << (counter_size << 3)) - 1);
 }
@@ -1412,9 +1431,11 @@ template<unsigned SIZE> CKMC2DbReaderSorted<SIZE>::CKMC2DbReaderSorted(const CKm
 	desc(desc)
 {
 	LUTS = nullptr;
-	lut_size = 1 << 2 * header.lut_prefix_len;
-	uint32 lut_recs = (1 << 2 * header.lut_prefix_len) * header.no_of_bins + 1;
-	LUTS = new uint64[lut_recs];
+	//only prefixes from the range are read (all of them by default), for each bin LUT is followed by the value of the next prefix
+	uint64 whole_lut_size = 1ull << 2 * header.lut_prefix_len;
+	first_prefix = desc.range.FirstPrefix(header.lut_prefix_len);
+	lut_size = (uint32)(desc.range.EndPrefix(header.lut_prefix_len) - first_prefix);
+	LUTS = new uint64[(uint64)(lut_size + 1) * header.no_of_bins];
 	suffix_bytes = (header.kmer_len - header.lut_prefix_len) / 4;
 	record_size = suffix_bytes + header.counter_size;
 	if (!LUTS)
@@ -1432,10 +1453,28 @@ template<unsigned SIZE> CKMC2DbReaderSorted<SIZE>::CKMC2DbReaderSorted(const CKm
 	}
 
 	my_fseek(kmc_pre, 4, SEEK_SET);
-	if (fread(LUTS, sizeof(uint64), lut_recs, kmc_pre) != lut_recs)
+	if (header.IsLutEliasFano())
 	{
-		std::cerr << "Some error occured while reading LUTS from kmc2 prefix file \n";
-		exit(1);
+		CEliasFano lut_ef;
+		if (!lut_ef.Load(kmc_pre) || lut_ef.Size() != whole_lut_size * header.no_of_bins + 1)
+		{
+			std::cerr << "Some error occured while reading LUTS from kmc2 prefix file \n";
+			exit(1);
+		}
+		for (uint32 i = 0; i < header.no_of_bins; ++i)
+			lut_ef.Decode(i * whole_lut_size + first_prefix, lut_size + 1, LUTS + (uint64)i * (lut_size + 1));
+	}
+	else
+	{
+		for (uint32 i = 0; i < header.no_of_bins; ++i)
+		{
+			my_fseek(kmc_pre, 4 + (i * whole_lut_size + first_prefix) * sizeof(uint64), SEEK_SET);
+			if (fread(LUTS + (uint64)i * (lut_size + 1), sizeof(uint64), lut_size + 1, kmc_pre) != lut_size + 1)
+			{
+				std::cerr << "Some error occured while reading LUTS from kmc2 prefix file \n";
+				exit(1);
+			}
+		}
 	}
 	fclose(kmc_pre);
 
@@ -1448,16 +1487,25 @@ template<unsigned SIZE> CKMC2DbReaderSorted<SIZE>::CKMC2DbReaderSorted(const CKm
 		exit(1);
 	}
 	setvbuf(kmc_suf, NULL, _IONBF, 0);
+	if (header.IsCompressed())
+	{
+		compressed_suffix_reader = std::make_unique<CCompressedSuffixReader>();
+		if (!compressed_suffix_reader->Open(kmc_suf, header.kmer_len, header.lut_prefix_len, header.counter_size, header.total_kmers))
+		{
+			std::cerr << "Error: cannot read compressed kmc2 suffix file\n";
+			exit(1);
+		}
+	}
 
 	bins.reserve(header.no_of_bins);
 	for (uint32 i = 0; i < header.no_of_bins; ++i)
-		bins.emplace_back(i, LUTS + i * lut_size, *this);
+		bins.emplace_back(i, LUTS + (uint64)i * (lut_size + 1), *this);
 
 	//starting threads
 
 	bin_provider.init(bins);
 
-	suf_bin_reader = new CSufBinReader<SIZE>(bin_provider, kmc_suf);
+	suf_bin_reader = new CSufBinReader<SIZE>(bin_provider, kmc_suf, compressed_suffix_reader.get(), record_size);
 	suf_bin_reader_th = std::thread(std::ref(*suf_bin_reader));
 
 	uint32 n_threads = desc.threads;
@@ -1687,6 +1735,16 @@ template<unsigned SIZE> void CKCM2DbReaderSeqCounter_Base<SIZE>::open_files()
 	}
 
 	my_fseek(suffix_file, 4, SEEK_SET); //skip KMCS	
+
+	if (header.IsCompressed())
+	{
+		compressed_suffix_reader = std::make_unique<CCompressedSuffixReader>();
+		if (!compressed_suffix_reader->Open(suffix_file, header.kmer_len, header.lut_prefix_len, header.counter_size, header.total_kmers))
+		{
+			std::cerr << "Error: some error while reading " << suffix_file_name << "\n";
+			exit(1);
+		}
+	}
 }
 
 /*****************************************************************************************************************************/
@@ -1695,7 +1753,7 @@ template<unsigned SIZE> bool CKCM2DbReaderSeqCounter_Base<SIZE>::reload_suf_buff
 	uint64 to_read = MIN(suffix_left_to_read, suffix_buff_size);
 	if (to_read == 0)
 		return false;
-	uint64 readed = fread(suffix_buff, 1, to_read, suffix_file);
+	uint64 readed = compressed_suffix_reader ? compressed_suffix_reader->Read(suffix_buff, to_read) : fread(suffix_buff, 1, to_read, suffix_file);
 	if (readed != to_read)
 	{
 		std::cerr << "Error: some error while reading " << suffix_file_name << "\n";
@@ -1728,6 +1786,16 @@ CKCM2DbReaderSeqCounter_Base<SIZE>(header, desc)
 		exit(1);
 	}
 	setvbuf(prefix_file, NULL, _IONBF, 0);
+	if (header.IsLutEliasFano())
+	{
+		my_fseek(prefix_file, 4, SEEK_SET);
+		lut_ef = std::make_unique<CEliasFano>();
+		if (!lut_ef->Load(prefix_file))
+		{
+			std::cerr << "Error: some error while reading " << prefix_file_name << "\n";
+			exit(1);
+		}
+	}
 	my_fseek(prefix_file, 4 + sizeof(uint64), SEEK_SET);//skip KMCP and first value as it must be 0
 
 	signle_bin_size = 1 << 2 * header.lut_prefix_len;
@@ -1838,7 +1906,12 @@ template<unsigned SIZE> void CKMC2DbReaderSequential<SIZE>::reload_pref_buff()
 {
 	uint64 to_read = MIN(this->prefix_left_to_read, this->prefix_buff_size);
 	this->prefix_buff_pos = 0;
-	if (fread(prefix_buff, sizeof(uint64), to_read, prefix_file) != to_read)
+	if (lut_ef)
+	{
+		lut_ef->Decode(lut_ef_pos, to_read, prefix_buff);
+		lut_ef_pos += to_read;
+	}
+	else if (fread(prefix_buff, sizeof(uint64), to_read, prefix_file) != to_read)
 	{
 		std::cerr << "Error: some error while reading " << prefix_file_name << "\n";
 		exit(1);
@@ -1921,7 +1994,7 @@ template<unsigned SIZE> void CKMC2DbReaderCountersOnly<SIZE>::allocate_buffers()
 template<unsigned SIZE> CKMC2DbReader<SIZE>::CKMC2DbReader(const CKmerFileHeader& header, const CInputDesc& desc, CPercentProgress& percent_progress, KmerDBOpenMode open_mode) :
 	percent_progress(percent_progress)
 {
-	progress_id = percent_progress.RegisterItem(header.total_kmers);
+	progress_id = desc.progress_id >= 0 ? desc.progress_id : percent_progress.RegisterItem(header.total_kmers);
 	switch (open_mode)
 	{
 	case KmerDBOpenMode::sorted:
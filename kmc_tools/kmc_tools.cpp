@@ -26,6 +26,11 @@
 #include "db_reader_factory.h"
 #include "db_writer_factory.h"
 #include "kff_random_access.h"
+#include "range_partitioning.h"
+#include "matrix_writer.h"
+#include "matrix_reader.h"
+#include "distance_matrix.h"
+#include "kmer_probe.h"
 #ifdef ENABLE_LOGGER
 #include "develop.h"
 #endif
@@ -44,7 +49,7 @@ template<unsigned SIZE> class CTools
 
 		vector<CDbWriter<SIZE>*> kmc_db_writers;
 		vector<CBundle<SIZE>*> bundles;
-		vector<CDumpWriterForTransform<SIZE>> dump_writers;
+		vector<unique_ptr<CDumpWriterForTransform<SIZE>>> dump_writers;
 		vector<CHistogramWriterForTransform> histogram_writers;
 
 		for (auto& desc : config.transform_output_desc)
@@ -60,8 +65,8 @@ template<unsigned SIZE> class CTools
 				bundles.push_back(new CBundle<SIZE>(nullptr));
 				break;
 			case CTransformOutputDesc::OpType::DUMP:
-				dump_writers.emplace_back(desc);
-				dump_writers.back().Init();
+				dump_writers.push_back(make_unique<CDumpWriterForTransform<SIZE>>(desc));
+				dump_writers.back()->Init();
 				break;
 			case CTransformOutputDesc::OpType::HISTOGRAM:
 				histogram_writers.emplace_back(desc);
@@ -87,7 +92,7 @@ template<unsigned SIZE> class CTools
 				for (auto& out : histogram_writers)
 					out.PutCounter(counter);
 				for (auto& out : dump_writers)
-					out.PutKmer(kmer, counter);
+					out->PutKmer(kmer, counter);
 			}
 		}
 		else 
@@ -99,7 +104,7 @@ template<unsigned SIZE> class CTools
 				for (auto& out : histogram_writers)
 					out.PutCounter(tmp_bundle.TopCounter());
 				for (auto& out : dump_writers)
-					out.PutKmer(tmp_bundle.TopKmer(), tmp_bundle.TopCounter());
+					out->PutKmer(tmp_bundle.TopKmer(), tmp_bundle.TopCounter());
 
 				for (uint32 i = 0; i < bundles.size(); ++i)
 				{
@@ -123,7 +128,7 @@ template<unsigned SIZE> class CTools
 		for (auto& out : histogram_writers)
 			out.Finish();
 		for (auto& out : dump_writers)		
-			out.Finish();			
+			out->Finish();			
 		
 		for (auto& out : kmc_db_writers)
 		{
@@ -153,6 +158,9 @@ template<unsigned SIZE> class CTools
 				<< "signature length  :  " << header.signature_len << "\n"
 				<< "number of bins    :  " << header.no_of_bins << "\n"
 				<< "lut_prefix_len    :  " << header.lut_prefix_len << "\n";
+			if (header.kmer_file_type == KmerFileType::KMC2)
+				std::cout << "LUT               :  " << (header.IsLutEliasFano() ? "Elias-Fano encoded" : "plain") << "\n"
+						  << "suffixes          :  " << (header.IsCompressed() ? "compressed" : "plain") << "\n";
 		}
 		else if (header.kmer_file_type == KmerFileType::KFF1)
 		{
@@ -342,37 +350,91 @@ template<unsigned SIZE> class CTools
 		return true;
 	}
 
-	bool simple_set()
+	//returns index of input which should be probed instead of streamed or -1
+	int32 simple_set_probed_input()
 	{
-		CInput<SIZE> *db1, *db2;
-
-		db1 = db_reader_factory<SIZE>(config.headers[0], config.input_desc[0], KmerDBOpenMode::sorted);
-		db2 = db_reader_factory<SIZE>(config.headers[1], config.input_desc[1], KmerDBOpenMode::sorted);
-		
-		CBundle<SIZE> input1(db1), input2(db2);
+		for (uint32 large = 0; large < 2; ++large)
+		{
+			uint32 small = 1 - large;
+			if (CKmerProbe<SIZE>::IsPreferred(config.headers[large], config.headers[small].total_kmers) &&
+				CSimpleProbeOperation<SIZE>::IsApplicable(config.simple_output_desc, small == 0))
+				return large;
+		}
+		return -1;
+	}
 
+	void simple_set_process(const vector<CInputDesc>& input_desc, vector<CDbWriter<SIZE>*>& writers, int32 probed_input)
+	{
 		vector<COutputBundle<SIZE>*> output_bundles;
 		
-		vector<CDbWriter<SIZE>*> writers;
-
 		for (uint32 i = 0; i < config.simple_output_desc.size(); ++i)
 		{
-			writers.push_back(db_writer_factory<SIZE>(config.simple_output_desc[i]));
-			writers.back()->MultiOptputInit();
-			output_bundles.push_back(new COutputBundle<SIZE>(config.simple_output_desc[i].op_type, config.simple_output_desc[i].counter_op, *writers.back()));
+			writers[i]->MultiOptputInit();
+			output_bundles.push_back(new COutputBundle<SIZE>(config.simple_output_desc[i].op_type, config.simple_output_desc[i].counter_op, *writers[i]));
 		}
 
-		CSimpleOperation<SIZE> op(&input1, &input2, output_bundles);
-		op.Process();
+		if (probed_input >= 0)
+		{
+			uint32 small = 1 - probed_input;
+			CBundle<SIZE> small_input(db_reader_factory<SIZE>(config.headers[small], input_desc[small], KmerDBOpenMode::sorted));
+			CKmerProbe<SIZE> large_input(input_desc[probed_input]);
+			CSimpleProbeOperation<SIZE> op(&small_input, small == 0, large_input, output_bundles);
+			op.Process();
+		}
+		else
+		{
+			CInput<SIZE> *db1, *db2;
+
+			db1 = db_reader_factory<SIZE>(config.headers[0], input_desc[0], KmerDBOpenMode::sorted);
+			db2 = db_reader_factory<SIZE>(config.headers[1], input_desc[1], KmerDBOpenMode::sorted);
+
+			CBundle<SIZE> input1(db1), input2(db2);
+
+			CSimpleOperation<SIZE> op(&input1, &input2, output_bundles);
+			op.Process();
+		}
 
 		for (auto& writer : writers)
-		{
 			writer->MultiOptputFinish();
-			delete writer;
-		}
 
 		for (auto o : output_bundles)
 			delete o;
+	}
+
+	bool simple_set()
+	{
+		vector<CDbWriter<SIZE>*> writers;
+
+		for (uint32 i = 0; i < config.simple_output_desc.size(); ++i)
+			writers.push_back(db_writer_factory<SIZE>(config.simple_output_desc[i]));
+
+		int32 probed_input = simple_set_probed_input();
+		if (probed_input >= 0 && config.verbose)
+			cerr << "Info: " << config.input_desc[probed_input].file_src << " is probed for k-mers of the other input instead of being read\n";
+
+		if (CRangePartitioning().Prepare())
+		{
+			//each range is processed independently, results are concatenated by writers
+			vector<thread> range_threads;
+			for (uint32 r = 0; r < config.ranges.size(); ++r)
+			{
+				vector<CDbWriter<SIZE>*> part_writers;
+				for (auto& writer : writers)
+					part_writers.push_back(writer->CreatePartWriter(r, config.ranges[r], nullptr));
+				range_threads.emplace_back([this, r, part_writers, probed_input]() mutable {
+					simple_set_process(config.ranges_input_desc[r], part_writers, probed_input);
+				});
+			}
+			for (auto& th : range_threads)
+				th.join();
+			for (auto& writer : writers)
+				writer->FinishParts();
+		}
+		else
+			simple_set_process(config.input_desc, writers, probed_input);
+
+		for (auto& writer : writers)
+			delete writer;
 
 		return true;
 	}
@@ -380,7 +442,30 @@ template<unsigned SIZE> class CTools
 	bool complex()
 	{
 		CExpressionNode<SIZE>* expression_root = parameters_parser.GetExpressionRoot<SIZE>();
-		auto t = expression_root->GetExecutionRoot();
+		if (CRangePartitioning().Prepare())
+		{
+			//each range is processed by its own copy of execution tree, results are concatenated by writer
+			auto writer = db_writer_factory<SIZE>(config.output_desc);
+			vector<CBundle<SIZE>*> roots;
+			vector<thread> range_threads;
+			for (uint32 r = 0; r < config.ranges.size(); ++r)
+			{
+				roots.push_back(expression_root->GetExecutionRoot(config.ranges_input_desc[r]));
+				auto part_writer = writer->CreatePartWriter(r, config.ranges[r], roots.back());
+				range_threads.emplace_back([part_writer] {
+					part_writer->Process();
+				});
+			}
+			delete expression_root;
+			for (auto& th : range_threads)
+				th.join();
+			for (auto t : roots)
+				delete t;
+			writer->FinishParts();
+			delete writer;
+			return true;
+		}
+		auto t = expression_root->GetExecutionRoot(config.input_desc);
 		delete expression_root;
 		auto writer = db_writer_factory<SIZE>(config.output_desc, t);
 		writer->Process();
@@ -412,6 +497,38 @@ template<unsigned SIZE> class CTools
 		}
 	}
 
+	bool index()
+	{
+		const auto& header = config.headers.front();
+		if (header.kmer_file_type != KmerFileType::KMC1 && header.kmer_file_type != KmerFileType::KMC2)
+		{
+			std::cerr << "Error: index can be built only for KMC database\n";
+			exit(1);
+		}
+		if (header.IsCompressed())
+		{
+			std::cerr << "Error: index is not needed for a database with compressed *.kmc_suf, it has its own skip pointers\n";
+			exit(1);
+		}
+		const std::string& file_src = config.input_desc.front().file_src;
+		if (!CKMCFile::BuildIndex(file_src, config.index_params.sample_step))
+		{
+			std::cerr << "Error: cannot build index of " << file_src << "\n";
+			exit(1);
+		}
+		return true;
+	}
+
+	bool matrix()
+	{
+		return CMatrixWriter<SIZE>().Process();
+	}
+
+	bool distance()
+	{
+		return CDistanceMatrix<SIZE>().Process();
+	}
+
 	bool transform()
 	{
 		bool kmers_needed = false;
@@ -538,6 +655,18 @@ public:
 		{
 			return check();
 		}
+		else if (config.mode == CConfig::Mode::INDEX)
+		{
+			return index();
+		}
+		else if (config.mode == CConfig::Mode::MATRIX)
+		{
+			return matrix();
+		}
+		else if (config.mode == CConfig::Mode::DISTANCE)
+		{
+			return distance();
+		}
 		else if(config.mode == CConfig::Mode::COMPLEX)
 		{
 			return complex();
@@ -624,6 +753,19 @@ public:
 	}
 };
 
+//----------------------------------------------------------------------------------
+// Print counters (or presence) of a k-mer in all samples of a matrix, tab separated (zeros if the k-mer is absent)
+void matrix_check()
+{
+	CConfig& config = CConfig::GetInstance();
+	CMatrixReader reader(config.matrix_params.file_src);
+	std::vector<uint32> counters;
+	reader.Lookup(config.check_params.kmer, counters);
+	for (uint32 i = 0; i < counters.size(); ++i)
+		std::cout << (i ? "\t" : "") << counters[i];
+	std::cout << "\n";
+}
+
 //----------------------------------------------------------------------------------
 // Check if --help or --version was used
 bool help_or_version(int argc, char** argv)
@@ -653,6 +795,11 @@ int main(int argc, char**argv)
 
 	CParametersParser params_parser(argc, argv);
 	params_parser.Parse();
+	if (CConfig::GetInstance().mode == CConfig::Mode::MATRIX_CHECK) //matrix is not a KMC database, there are no inputs to validate
+	{
+		matrix_check();
+		return 0;
+	}
 	if (params_parser.validate_input_dbs())
 	{
 		params_parser.SetThreads();
@@ -59,6 +59,7 @@ template<unsigned SIZE> struct CKmer {
 	inline bool operator<(const CKmer<SIZE> &x)const;
 
 	inline void clear(void);
+	inline void fill_T();
 
 	inline char get_symbol(int p);
 
@@ -271,6 +272,13 @@ template<unsigned SIZE> inline void CKmer<SIZE>::clear(void)
 #endif
 }
 
+// *********************************************************************
+template<unsigned SIZE> inline void CKmer<SIZE>::fill_T()
+{
+	for (uint32 i = 0; i < SIZE; ++i)
+		data[i] = ~0ull;
+}
+
 // *********************************************************************
 template<unsigned SIZE> inline uint64 CKmer<SIZE>::remove_suffix(const uint32 n) const
 {
@@ -427,6 +435,7 @@ template<> struct CKmer<1> {
 	bool operator<(const CKmer<1> &x)const;
 
 	void clear(void);
+	inline void fill_T();
 
 	inline char get_symbol(int p);
 
@@ -536,6 +545,12 @@ inline void CKmer<1>::clear(void)
 	data = 0ull;
 }
 
+// *********************************************************************
+inline void CKmer<1>::fill_T()
+{
+	data = ~0ull;
+}
+
 // *********************************************************************
 inline uint64 CKmer<1>::remove_suffix(const uint32 n) const
 {
@@ -645,6 +660,39 @@ void CKmer<1>::set_prefix(CKmer<1>& rhs, uint32 /*suffix_bytes*/)
 {
 	data += rhs.data;
 }
+
+// *********************************************************************
+// 64-bit words of k-mer, the least significant first
+template<unsigned SIZE> inline const unsigned long long* kmer_words(const CKmer<SIZE>& kmer)
+{
+	return kmer.data;
+}
+
+// *********************************************************************
+inline const unsigned long long* kmer_words(const CKmer<1>& kmer)
+{
+	return &kmer.data;
+}
+
+// *********************************************************************
+// Finalizer of MurmurHash3 chained over 64-bit words of k-mer, the least significant first. The same hash
+// (with the same finalizer, CNtKmerHasher::mix) selects k-mers of FracMinHash sketches stored by kmc (see CKmerSketch)
+template<unsigned SIZE> inline uint64 kmer_hash(const CKmer<SIZE>& kmer)
+{
+	auto mix = [](uint64 x) {
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdull;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ull;
+		x ^= x >> 33;
+		return x;
+	};
+	const unsigned long long* words = kmer_words(kmer);
+	uint64 h = mix(words[0]);
+	for (uint32 i = 1; i < SIZE; ++i)
+		h = mix(h ^ words[i]);
+	return h;
+}
 #endif
 
 // ***** EOF
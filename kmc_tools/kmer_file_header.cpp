@@ -69,7 +69,7 @@ CKmerFileHeader::CKmerFileHeader(std::string file_name)
 	my_fseek(file, -12, SEEK_END);
 	load_uint(file, db_version);
 
-	kmer_file_type = db_version == 0x200 ? KmerFileType::KMC2 : KmerFileType::KMC1;
+	kmer_file_type = (db_version >= 0x200 && db_version <= 0x203) ? KmerFileType::KMC2 : KmerFileType::KMC1;
 
 	my_fseek(file, 0LL - (header_offset + 8), SEEK_END);
 	load_uint(file, kmer_len);
@@ -91,9 +91,18 @@ CKmerFileHeader::CKmerFileHeader(std::string file_name)
 	uint32_t max_count_hi;
 	load_uint(file, max_count_hi);
 	max_count = (((uint64_t)max_count_hi) << 32) + max_count_lo;
+
+	if (IsLutEliasFano())
+	{
+		//Elias-Fano encoded LUT starts with the number of its elements (all LUTs and a guard)
+		my_fseek(file, 4, SEEK_SET);
+		uint64 n_lut_recs;
+		load_uint(file, n_lut_recs);
+		no_of_bins = (uint32)((n_lut_recs - 1) >> (2 * lut_prefix_len));
+	}
 	fclose(file);
 
-	if (kmer_file_type == KmerFileType::KMC2)
+	if (kmer_file_type == KmerFileType::KMC2 && !IsLutEliasFano())
 	{
 		uint32 single_lut_size = (1ull << (2 * lut_prefix_len)) * sizeof(uint64);
 		uint32 map_size = ((1 << 2 * signature_len) + 1) * sizeof(uint32);
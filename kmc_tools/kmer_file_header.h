@@ -45,7 +45,7 @@ public:
 	uint64 max_count = 0;
 	uint64 total_kmers = 0;
 	bool both_strands = true;
-	uint32 db_version = 0;
+	uint32 db_version = 0;			// 0 - kmc1, 0x200 - kmc2, 0x201 - kmc2 with Elias-Fano encoded LUT, 0x202 - kmc2 with compressed *.kmc_suf, 0x203 - both
 	uint32 header_offset = 0;
 	
 	uint32 no_of_bins = 0; //only for kmc2
@@ -60,6 +60,16 @@ public:
 		return kmer_file_type;
 	}
 
+	bool IsLutEliasFano() const
+	{
+		return kmer_file_type == KmerFileType::KMC2 && (db_version & 0x1);
+	}
+
+	bool IsCompressed() const
+	{
+		return kmer_file_type == KmerFileType::KMC2 && (db_version & 0x2);
+	}
+
 	uint8_t GetEncoding() const
 	{
 		switch (kmer_file_type)
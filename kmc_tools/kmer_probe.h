@@ -0,0 +1,253 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _KMER_PROBE_H
+#define _KMER_PROBE_H
+
+#include "defs.h"
+#include "config.h"
+#include "kmer.h"
+#include "bundle.h"
+#include "operations.h"
+#include "../kmc_api/kmc_file.h"
+#include <vector>
+#include <memory>
+#include <iostream>
+
+//************************************************************************************************************
+// CKmerProbe - random access lookups of k-mers in KMC database. Files are memory mapped, so only pages of
+// probed LUT ranges are read. It is used instead of streaming the database if the other input of intersection
+// or subtraction is much smaller, so the operation takes time proportional to the small input
+//************************************************************************************************************
+template<unsigned SIZE> class CKmerProbe
+{
+	static const uint64 MIN_SIZE_RATIO = 256;
+
+	CKMCFile kmc_file;
+	uint32 cutoff_min;
+	uint64 cutoff_max;
+	std::vector<CKmerAPI> api_kmers;
+	std::vector<uint64> counts;
+	std::vector<uint64> words; //k-mer in the layout of CKmerAPI::to_long
+
+public:
+	static const uint32 BATCH_SIZE = 1 << 14;
+
+	//true if the database should be probed instead of streamed when the other input contains at most small_size k-mers
+	static bool IsPreferred(const CKmerFileHeader& header, uint64 small_size)
+	{
+		if (header.kmer_file_type != KmerFileType::KMC1 && header.kmer_file_type != KmerFileType::KMC2)
+			return false;
+		return header.total_kmers / MIN_SIZE_RATIO >= MAX(small_size, 1ull);
+	}
+
+	CKmerProbe(const CInputDesc& desc) :
+		cutoff_min(desc.cutoff_min),
+		cutoff_max(desc.cutoff_max),
+		api_kmers(BATCH_SIZE, CKmerAPI(CConfig::GetInstance().kmer_len)),
+		counts(BATCH_SIZE),
+		words(SIZE)
+	{
+		if (!kmc_file.OpenForRA(desc.file_src, CKMCFile::ra_mode::mmap))
+		{
+			std::cerr << "Error: cannot open " << desc.file_src << " for random access\n";
+			exit(1);
+		}
+		//cutoffs are applied in Check as in the streaming reader, they may be outside of the range stored in the database
+	}
+
+	//counters[i] is a counter of kmers[i] or 0 if it is absent, n <= BATCH_SIZE
+	void Check(const CKmer<SIZE>* kmers, uint32 n, uint32* counters)
+	{
+		for (uint32 i = 0; i < n; ++i)
+		{
+			//CKmerAPI::from_long expects the most significant word first
+			const unsigned long long* kmer_data = kmer_words(kmers[i]);
+			for (uint32 j = 0; j < SIZE; ++j)
+				words[j] = kmer_data[SIZE - 1 - j];
+			api_kmers[i].from_long(words.data());
+		}
+		kmc_file.CheckKmers(api_kmers.data(), n, counts.data());
+		for (uint32 i = 0; i < n; ++i)
+			counters[i] = counts[i] >= cutoff_min && counts[i] <= cutoff_max ? (uint32)MIN(counts[i], (uint64)0xFFFFFFFFull) : 0;
+	}
+};
+
+//************************************************************************************************************
+// CSmallSideBatch - batch of k-mers of the small input together with their counters in the probed database
+//************************************************************************************************************
+template<unsigned SIZE> class CSmallSideBatch
+{
+public:
+	std::vector<CKmer<SIZE>> kmers;
+	std::vector<uint32> counters;
+	std::vector<uint32> large_counters;
+	uint32 size = 0;
+
+	CSmallSideBatch() :
+		kmers(CKmerProbe<SIZE>::BATCH_SIZE),
+		counters(CKmerProbe<SIZE>::BATCH_SIZE),
+		large_counters(CKmerProbe<SIZE>::BATCH_SIZE)
+	{
+	}
+
+	//returns false if the small input is finished
+	bool Load(CBundle<SIZE>* small, CKmerProbe<SIZE>& large)
+	{
+		size = 0;
+		while (size < CKmerProbe<SIZE>::BATCH_SIZE && !small->Finished())
+		{
+			kmers[size] = small->TopKmer();
+			counters[size] = small->TopCounter();
+			small->Pop();
+			++size;
+		}
+		large.Check(kmers.data(), size, large_counters.data());
+		return size != 0;
+	}
+};
+
+//************************************************************************************************************
+// CProbeOper - intersection, k-mers subtraction or counters subtraction driven by the small input, k-mers of
+// the small input are probed in the large database. For subtractions the small input must be the first one
+//************************************************************************************************************
+template<unsigned SIZE> class CProbeOper : public CInput<SIZE>
+{
+public:
+	enum class OpType { INTERSECT, KMERS_SUBTRACT, COUNTERS_SUBTRACT };
+
+private:
+	CBundle<SIZE>* small;
+	bool small_is_first;
+	std::unique_ptr<CKmerProbe<SIZE>> large;
+	OpType op_type;
+	CounterOpType counter_op_type;
+	CSmallSideBatch<SIZE> batch;
+	uint32 batch_pos = 0;
+
+	void emit(CBundle<SIZE>& bundle, uint32 i)
+	{
+		uint32 small_counter = batch.counters[i];
+		uint32 large_counter = batch.large_counters[i];
+		if (!large_counter)
+		{
+			if (op_type != OpType::INTERSECT)
+				bundle.Insert(batch.kmers[i], small_counter);
+			return;
+		}
+		if (op_type == OpType::KMERS_SUBTRACT)
+			return;
+		uint32 counter;
+		if (counter_for_equals(counter_op_type, small_is_first ? small_counter : large_counter, small_is_first ? large_counter : small_counter, counter))
+			bundle.Insert(batch.kmers[i], counter);
+	}
+
+public:
+	CProbeOper(CBundle<SIZE>* small, bool small_is_first, const CInputDesc& large_desc, OpType op_type, CounterOpType counter_op_type) :
+		small(small), small_is_first(small_is_first), large(std::make_unique<CKmerProbe<SIZE>>(large_desc)), op_type(op_type), counter_op_type(counter_op_type)
+	{
+	}
+
+	void NextBundle(CBundle<SIZE>& bundle) override
+	{
+		while (true)
+		{
+			for (; batch_pos < batch.size; ++batch_pos)
+			{
+				if (bundle.Full())
+					return;
+				emit(bundle, batch_pos);
+			}
+			batch_pos = 0;
+			if (!batch.Load(small, *large))
+				break;
+		}
+		this->finished = true;
+	}
+
+	void IgnoreRest() override
+	{
+		if (!small->Finished())
+			small->IgnoreRest();
+	}
+
+	~CProbeOper() override
+	{
+		delete small;
+	}
+};
+
+//************************************************************************************************************
+// CSimpleProbeOperation - simple operation driven by the small input, k-mers of the small input are probed in
+// the large database. Applicable only if no output needs k-mers present in the large database only
+//************************************************************************************************************
+template<unsigned SIZE> class CSimpleProbeOperation
+{
+	CBundle<SIZE>* small;
+	bool small_is_first;
+	CKmerProbe<SIZE>& large;
+	std::vector<COutputBundle<SIZE>*>& outputs;
+
+public:
+	static bool IsApplicable(const std::vector<CSimpleOutputDesc>& output_desc, bool small_is_first)
+	{
+		for (auto& desc : output_desc)
+		{
+			auto op = desc.op_type;
+			if (op == CSimpleOutputDesc::OpType::INTERSECT)
+				continue;
+			if (small_is_first && (op == CSimpleOutputDesc::OpType::KMERS_SUBTRACTION || op == CSimpleOutputDesc::OpType::COUNTERS_SUBTRACTION))
+				continue;
+			if (!small_is_first && (op == CSimpleOutputDesc::OpType::REVERSE_KMERS_SUBTRACTION || op == CSimpleOutputDesc::OpType::REVERSE_COUNTERS_SUBTRACTION))
+				continue;
+			return false;
+		}
+		return true;
+	}
+
+	CSimpleProbeOperation(CBundle<SIZE>* small, bool small_is_first, CKmerProbe<SIZE>& large, std::vector<COutputBundle<SIZE>*>& outputs) :
+		small(small), small_is_first(small_is_first), large(large), outputs(outputs)
+	{
+	}
+
+	void Process()
+	{
+		CSmallSideBatch<SIZE> batch;
+		while (batch.Load(small, large))
+		{
+			for (uint32 i = 0; i < batch.size; ++i)
+			{
+				uint32 small_counter = batch.counters[i];
+				uint32 large_counter = batch.large_counters[i];
+				uint32 counter1 = small_is_first ? small_counter : large_counter;
+				uint32 counter2 = small_is_first ? large_counter : small_counter;
+				for (auto output : outputs)
+				{
+					auto op = output->GetOpType();
+					if (!large_counter)
+					{
+						if (op != CSimpleOutputDesc::OpType::INTERSECT)
+							output->InsertAndSendIfFull(batch.kmers[i], small_counter);
+					}
+					else if (op == CSimpleOutputDesc::OpType::INTERSECT || op == CSimpleOutputDesc::OpType::COUNTERS_SUBTRACTION)
+						output->InsertAndSendIfFull(batch.kmers[i], output->GetCounter(counter1, counter2));
+					else if (op == CSimpleOutputDesc::OpType::REVERSE_COUNTERS_SUBTRACTION)
+						output->InsertAndSendIfFull(batch.kmers[i], output->GetCounter(counter2, counter1));
+				}
+			}
+		}
+		for (auto output : outputs)
+			output->NotifyFinish();
+	}
+};
+
+#endif
+
+// ***** EOF
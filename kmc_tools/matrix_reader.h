@@ -0,0 +1,199 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _MATRIX_READER_H
+#define _MATRIX_READER_H
+
+#include "defs.h"
+#include <vector>
+#include <string>
+#include <cstring>
+#include <iostream>
+
+//************************************************************************************************************
+// CMatrixReader - random access to k-mer x sample matrix written by CMatrixWriter (see there for the layout).
+// Only the block index is kept in memory. A k-mer is looked up by binary search over first k-mers of blocks
+// and then over k-mers of a single block, k-mers are compared as byte strings (most significant byte first)
+//************************************************************************************************************
+class CMatrixReader
+{
+	static const uint32 VERSION = 1;
+	static const uint32 FOOTER_SIZE = 3 * 8 + 4;
+
+	std::string file_src;
+	FILE* file = nullptr;
+	uint32 kmer_len;
+	uint32 encoding;
+	uint32 n_samples;
+	uint32 counter_bytes; //0 - presence bits
+	uint32 kmer_bytes;
+	uint32 row_bytes;
+	uint64 n_blocks;
+	uint64 n_kmers;
+
+	std::vector<uchar> index; //for each block: first k-mer, offset and no. of k-mers
+	uint32 index_rec_bytes;
+	std::vector<uchar> block_kmers;
+	std::vector<uchar> row;
+
+	void error(const char* msg)
+	{
+		std::cerr << "Error: " << msg << ": " << file_src << "\n";
+		exit(1);
+	}
+
+	void read_at(uint64 pos, void* data, uint64 size)
+	{
+		if (my_fseek(file, pos, SEEK_SET) != 0 || fread(data, 1, size, file) != size)
+			error("cannot read matrix file");
+	}
+
+	static uint64 load_uint(const uchar* ptr, uint32 n_bytes)
+	{
+		uint64 x = 0;
+		for (uint32 i = 0; i < n_bytes; ++i)
+			x += (uint64)ptr[i] << (8 * i);
+		return x;
+	}
+
+	const uchar* index_rec(uint64 block_id) const
+	{
+		return index.data() + block_id * index_rec_bytes;
+	}
+
+public:
+	CMatrixReader(const std::string& file_src) : file_src(file_src)
+	{
+		file = fopen(file_src.c_str(), "rb");
+		if (!file)
+			error("cannot open file");
+
+		uchar header[9 * 4];
+		read_at(0, header, sizeof(header));
+		if (memcmp(header, "KMCM", 4) != 0 || load_uint(header + 4, 4) != VERSION)
+			error("not a k-mer matrix (or unsupported version)");
+		kmer_len = (uint32)load_uint(header + 8, 4);
+		encoding = (uint32)load_uint(header + 12, 4);
+		n_samples = (uint32)load_uint(header + 16, 4);
+		counter_bytes = (uint32)load_uint(header + 20, 4);
+		kmer_bytes = (uint32)load_uint(header + 24, 4);
+		row_bytes = (uint32)load_uint(header + 28, 4);
+		if (!kmer_len || kmer_bytes != (kmer_len + 3) / 4 || counter_bytes > 4 ||
+			row_bytes != (counter_bytes ? n_samples * counter_bytes : (n_samples + 7) / 8))
+			error("corrupted header of matrix file");
+
+		my_fseek(file, 0, SEEK_END);
+		uint64 file_size = my_ftell(file);
+		if (file_size < sizeof(header) + FOOTER_SIZE)
+			error("corrupted matrix file");
+		uchar footer[FOOTER_SIZE];
+		read_at(file_size - FOOTER_SIZE, footer, FOOTER_SIZE);
+		n_blocks = load_uint(footer, 8);
+		n_kmers = load_uint(footer + 8, 8);
+		uint64 index_pos = load_uint(footer + 16, 8);
+		index_rec_bytes = kmer_bytes + 2 * 8;
+		if (memcmp(footer + 24, "KMCM", 4) != 0 || index_pos + n_blocks * index_rec_bytes != file_size - FOOTER_SIZE)
+			error("corrupted footer of matrix file");
+
+		index.resize(n_blocks * index_rec_bytes);
+		read_at(index_pos, index.data(), index.size());
+		row.resize(row_bytes);
+	}
+
+	~CMatrixReader()
+	{
+		fclose(file);
+	}
+
+	uint32 NoOfSamples() const
+	{
+		return n_samples;
+	}
+
+	uint64 NoOfKmers() const
+	{
+		return n_kmers;
+	}
+
+	//----------------------------------------------------------------------------------
+	// Counters (or 0/1 for presence) of a k-mer in all samples, returns false if the k-mer is not in the matrix
+	bool Lookup(const std::string& kmer, std::vector<uint32>& counters)
+	{
+		counters.assign(n_samples, 0);
+		if (kmer.length() != kmer_len)
+		{
+			std::cerr << "Error: invalid k-mer length\n";
+			exit(1);
+		}
+		int codes[256];
+		for (uint32 i = 0; i < 256; ++i)
+			codes[i] = -1;
+		codes['A'] = codes['a'] = (encoding >> 6) & 3;
+		codes['C'] = codes['c'] = (encoding >> 4) & 3;
+		codes['G'] = codes['g'] = (encoding >> 2) & 3;
+		codes['T'] = codes['t'] = encoding & 3;
+
+		//2 bits per symbol, right aligned, most significant byte first (as stored by CKmer::store)
+		std::vector<uchar> key(kmer_bytes);
+		for (uint32 i = 0; i < kmer_len; ++i)
+		{
+			int d = codes[(uchar)kmer[i]];
+			if (d < 0)
+			{
+				std::cerr << "Error: invalid k-mer format\n";
+				exit(1);
+			}
+			uint32 bit_pos = 2 * (kmer_len - 1 - i);
+			key[kmer_bytes - 1 - bit_pos / 8] |= d << (bit_pos % 8);
+		}
+
+		//last block with the first k-mer not greater than the key
+		uint64 lower = 0, upper = n_blocks;
+		while (lower < upper)
+		{
+			uint64 middle = (lower + upper) / 2;
+			if (memcmp(index_rec(middle), key.data(), kmer_bytes) <= 0)
+				lower = middle + 1;
+			else
+				upper = middle;
+		}
+		if (!lower)
+			return false;
+		const uchar* rec = index_rec(lower - 1);
+		uint64 block_pos = load_uint(rec + kmer_bytes, 8);
+		uint64 block_n_kmers = load_uint(rec + kmer_bytes + 8, 8);
+
+		block_kmers.resize(block_n_kmers * kmer_bytes);
+		read_at(block_pos, block_kmers.data(), block_kmers.size());
+		lower = 0;
+		upper = block_n_kmers;
+		while (lower < upper)
+		{
+			uint64 middle = (lower + upper) / 2;
+			int cmp = memcmp(block_kmers.data() + middle * kmer_bytes, key.data(), kmer_bytes);
+			if (cmp < 0)
+				lower = middle + 1;
+			else if (cmp > 0)
+				upper = middle;
+			else
+			{
+				read_at(block_pos + block_n_kmers * kmer_bytes + middle * row_bytes, row.data(), row_bytes);
+				for (uint32 s = 0; s < n_samples; ++s)
+					counters[s] = counter_bytes ? (uint32)load_uint(row.data() + s * counter_bytes, counter_bytes) : (row[s >> 3] >> (s & 7)) & 1;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+#endif
+
+// ***** EOF
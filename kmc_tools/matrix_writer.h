@@ -0,0 +1,203 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _MATRIX_WRITER_H
+#define _MATRIX_WRITER_H
+
+#include "defs.h"
+#include "config.h"
+#include "operations.h"
+#include "db_reader_factory.h"
+#include <vector>
+#include <cstring>
+#include <iostream>
+
+//************************************************************************************************************
+// CMatrixWriter - merges all sorted inputs in a single pass and writes k-mer x sample matrix.
+// Layout of the output file (all numbers little endian):
+//   header     : "KMCM", version, kmer_len, encoding, n_samples, counter_bytes (0 - presence bits), kmer_bytes,
+//                row_bytes, block_size (uint32 each), for each sample: length of path (uint32) and path
+//   blocks     : k-mers of the block (kmer_bytes each, most significant byte first, so they are ordered as
+//                byte strings) followed by rows of these k-mers (row_bytes each)
+//   block index: for each block: its first k-mer (kmer_bytes), offset and no. of k-mers (uint64 each)
+//   footer     : n_blocks, n_kmers, offset of block index (uint64 each), "KMCM"
+// A k-mer is looked up by binary search over the block index and then over k-mers of a single block (CMatrixReader).
+//************************************************************************************************************
+template<unsigned SIZE> class CMatrixWriter
+{
+	static const uint32 VERSION = 1;
+
+	CConfig& config;
+	const CMatrixParams& params;
+	uint32 n_samples;
+	uint32 kmer_bytes;
+	uint32 row_bytes;
+
+	FILE* file = nullptr;
+	uint64 file_pos = 0;
+
+	std::vector<uchar> block_kmers;
+	std::vector<uchar> block_rows;
+	uint32 block_n_kmers = 0;
+
+	std::vector<uchar> index;
+	uint64 n_blocks = 0;
+	uint64 n_kmers = 0;
+
+	void write(const void* data, uint64 size)
+	{
+		if (fwrite(data, 1, size, file) != size)
+		{
+			std::cerr << "Error while writing to " << params.file_src << "\n";
+			exit(1);
+		}
+		file_pos += size;
+	}
+
+	void write_uint32(uint32 x)
+	{
+		uchar buf[4];
+		for (uint32 i = 0; i < 4; ++i, x >>= 8)
+			buf[i] = x & 0xFF;
+		write(buf, 4);
+	}
+
+	void write_uint64(uint64 x)
+	{
+		uchar buf[8];
+		for (uint32 i = 0; i < 8; ++i, x >>= 8)
+			buf[i] = x & 0xFF;
+		write(buf, 8);
+	}
+
+	void append_uint64(std::vector<uchar>& vec, uint64 x)
+	{
+		for (uint32 i = 0; i < 8; ++i, x >>= 8)
+			vec.push_back(x & 0xFF);
+	}
+
+	void write_header()
+	{
+		write("KMCM", 4);
+		write_uint32(VERSION);
+		write_uint32(config.kmer_len);
+		write_uint32(config.headers.front().GetEncoding());
+		write_uint32(n_samples);
+		write_uint32(params.counts ? params.counter_bytes : 0);
+		write_uint32(kmer_bytes);
+		write_uint32(row_bytes);
+		write_uint32(params.block_size);
+		for (auto& desc : config.input_desc)
+		{
+			write_uint32(static_cast<uint32>(desc.file_src.size()));
+			write(desc.file_src.data(), desc.file_src.size());
+		}
+	}
+
+	void flush_block()
+	{
+		if (!block_n_kmers)
+			return;
+		index.insert(index.end(), block_kmers.begin(), block_kmers.begin() + kmer_bytes);
+		append_uint64(index, file_pos);
+		append_uint64(index, block_n_kmers);
+		write(block_kmers.data(), (uint64)block_n_kmers * kmer_bytes);
+		write(block_rows.data(), (uint64)block_n_kmers * row_bytes);
+		++n_blocks;
+		block_n_kmers = 0;
+	}
+
+	void write_footer()
+	{
+		uint64 index_pos = file_pos;
+		write(index.data(), index.size());
+		write_uint64(n_blocks);
+		write_uint64(n_kmers);
+		write_uint64(index_pos);
+		write("KMCM", 4);
+	}
+
+	void set_counter(uchar* row, uint32 sample, uint32 counter)
+	{
+		if (!params.counts)
+		{
+			row[sample >> 3] |= 1 << (sample & 7);
+			return;
+		}
+		if (params.counter_bytes < 4)
+			counter = MIN(counter, (1u << (8 * params.counter_bytes)) - 1);
+		uchar* ptr = row + (uint64)sample * params.counter_bytes;
+		for (uint32 i = 0; i < params.counter_bytes; ++i, counter >>= 8)
+			ptr[i] = counter & 0xFF;
+	}
+
+public:
+	CMatrixWriter() :
+		config(CConfig::GetInstance()),
+		params(config.matrix_params)
+	{
+		n_samples = static_cast<uint32>(config.input_desc.size());
+		kmer_bytes = (config.kmer_len + 3) / 4;
+		row_bytes = params.counts ? n_samples * params.counter_bytes : (n_samples + 7) / 8;
+		block_kmers.resize((uint64)params.block_size * kmer_bytes);
+		block_rows.resize((uint64)params.block_size * row_bytes);
+	}
+
+	bool Process()
+	{
+		file = fopen(params.file_src.c_str(), "wb");
+		if (!file)
+		{
+			std::cerr << "Error: cannot open file: " << params.file_src << "\n";
+			exit(1);
+		}
+		setvbuf(file, nullptr, _IOFBF, 1 << 24);
+		write_header();
+
+		std::vector<CBundle<SIZE>*> inputs;
+		for (uint32 i = 0; i < n_samples; ++i)
+			inputs.push_back(new CBundle<SIZE>(db_reader_factory<SIZE>(config.headers[i], config.input_desc[i], KmerDBOpenMode::sorted)));
+
+		CBundlesLoserTree<SIZE> tree(inputs);
+		while (tree.NoOfActive() >= params.min_samples)
+		{
+			//row is built in place and dropped if the k-mer does not pass the filter
+			uchar* row = block_rows.data() + (uint64)block_n_kmers * row_bytes;
+			memset(row, 0, row_bytes);
+			CKmer<SIZE> kmer = tree.TopKmer();
+			uint32 n_present = 0;
+			do
+			{
+				set_counter(row, tree.Top(), tree.TopCounter());
+				++n_present;
+				tree.Pop();
+			} while (!tree.Finished() && tree.TopKmer() == kmer);
+
+			if (n_present < params.min_samples || n_present > params.max_samples)
+				continue;
+			kmer.store(block_kmers.data(), block_n_kmers * kmer_bytes, kmer_bytes);
+			++n_kmers;
+			if (++block_n_kmers == params.block_size)
+				flush_block();
+		}
+		tree.IgnoreRest();
+		flush_block();
+		write_footer();
+		fclose(file);
+
+		for (auto input : inputs)
+			delete input;
+		return true;
+	}
+};
+
+#endif
+
+// ***** EOF
@@ -22,7 +22,41 @@
 
 #include <iostream>
 #include <vector>
+#include <memory>
 #include "bundle.h"
+#include "../kmc_core/loser_tree.h"
+
+//----------------------------------------------------------------------------------
+// Counter of a k-mer present in both inputs of 2 argument's operation (counter1 from the first one).
+// Returns false if the k-mer is absent in the result
+inline bool counter_for_equals(CounterOpType counter_op_type, uint32 counter1, uint32 counter2, uint32& counter)
+{
+	switch (counter_op_type)
+	{
+	case CounterOpType::MIN:
+		counter = MIN(counter1, counter2);
+		return true;
+	case CounterOpType::MAX:
+		counter = MAX(counter1, counter2);
+		return true;
+	case CounterOpType::SUM:
+		counter = counter1 + counter2;
+		return true;
+	case CounterOpType::DIFF:
+		counter = counter1 - counter2;
+		return counter1 > counter2;
+	case CounterOpType::FROM_DB1:
+		counter = counter1;
+		return true;
+	case CounterOpType::FROM_DB2:
+		counter = counter2;
+		return true;
+	case CounterOpType::NONE:
+		return false;
+	default:
+		return false;
+	}
+}
 
 //************************************************************************************************************
 // C2ArgOper - abstract class representing 2 argument's operation
@@ -39,32 +73,9 @@ public:
 	}
 	void EqualsToOuputBundle(CBundle<SIZE>& output_bundle)
 	{
-		switch (counter_op_type)
-		{
-		case CounterOpType::MIN:
-			output_bundle.Insert(input1->TopKmer(), MIN(input1->TopCounter(), input2->TopCounter()));
-			break;
-		case CounterOpType::MAX:
-			output_bundle.Insert(input1->TopKmer(), MAX(input1->TopCounter(), input2->TopCounter()));
-			break;
-		case CounterOpType::SUM:
-			output_bundle.Insert(input1->TopKmer(), input1->TopCounter() + input2->TopCounter());
-			break;
-		case CounterOpType::DIFF:
-			if (input1->TopCounter() > input2->TopCounter())
-				output_bundle.Insert(input1->TopKmer(), input1->TopCounter() - input2->TopCounter());
-			break;
-		case CounterOpType::FROM_DB1:
-			output_bundle.Insert(input1->TopKmer(), input1->TopCounter());
-			break;
-		case CounterOpType::FROM_DB2:
-			output_bundle.Insert(input1->TopKmer(), input2->TopCounter());
-			break;
-		case CounterOpType::NONE:
-			break;
-		default:
-			break;
-		}
+		uint32 counter;
+		if (counter_for_equals(counter_op_type, input1->TopCounter(), input2->TopCounter(), counter))
+			output_bundle.Insert(input1->TopKmer(), counter);
 	}
 	void IgnoreRest() override
 	{		
@@ -255,6 +266,139 @@ public:
 	}
 };
 
+//************************************************************************************************************
+// CBundlesLoserTree - loser tree (CLoserTree of kmc_core) over sorted input bundles. Top() is the input containing
+// the smallest k-mer, all inputs containing this k-mer are returned one after another by subsequent Pop() calls
+//************************************************************************************************************
+template<unsigned SIZE> class CBundlesLoserTree
+{
+	const std::vector<CBundle<SIZE>*>& inputs;
+	CLoserTree<CKmer<SIZE>> tree;
+
+public:
+	CBundlesLoserTree(const std::vector<CBundle<SIZE>*>& inputs) : inputs(inputs)
+	{
+		tree.init(static_cast<uint32>(inputs.size()));
+		for (uint32 i = 0; i < inputs.size(); ++i)
+			if (!inputs[i]->Finished())
+				tree.set(i, inputs[i]->TopKmer());
+		tree.build();
+	}
+
+	uint32 NoOfActive() const
+	{
+		return tree.no_active();
+	}
+
+	bool Finished() const
+	{
+		return tree.empty();
+	}
+
+	uint32 Top() const
+	{
+		return tree.winner();
+	}
+
+	CKmer<SIZE>& TopKmer() const
+	{
+		return inputs[tree.winner()]->TopKmer();
+	}
+
+	uint32 TopCounter() const
+	{
+		return inputs[tree.winner()]->TopCounter();
+	}
+
+	void Pop()
+	{
+		CBundle<SIZE>* input = inputs[tree.winner()];
+		input->Pop();
+		if (input->Finished())
+			tree.remove_winner();
+		else
+			tree.replace_winner(input->TopKmer());
+	}
+
+	void IgnoreRest()
+	{
+		for (uint32 i = 0; i < inputs.size(); ++i)
+			if (!tree.is_exhausted(i))
+				inputs[i]->IgnoreRest();
+		tree.init(0); //no active inputs
+	}
+};
+
+//************************************************************************************************************
+// CNaryOper - implementation of N argument's operation on k-mer's sets. All inputs are merged in a single
+// pass with a loser tree. A k-mer is in the result if it is present in at least min_inputs inputs
+// (1 - union, number of inputs - intersection), its counter is aggregated (SUM, MIN or MAX) over these inputs
+//************************************************************************************************************
+template<unsigned SIZE> class CNaryOper : public CInput<SIZE>
+{
+	std::vector<CBundle<SIZE>*> inputs;
+	std::unique_ptr<CBundlesLoserTree<SIZE>> tree; //created with the first bundle, as it reads data of inputs
+	uint32 min_inputs;
+	CounterOpType counter_op_type;
+
+	void aggregate(uint32& counter, uint32 n_equal, uint32 input_counter)
+	{
+		if (!n_equal)
+			counter = input_counter;
+		else if (counter_op_type == CounterOpType::MIN)
+			counter = MIN(counter, input_counter);
+		else if (counter_op_type == CounterOpType::MAX)
+			counter = MAX(counter, input_counter);
+		else
+			counter += input_counter;
+	}
+
+public:
+	CNaryOper(std::vector<CBundle<SIZE>*>&& _inputs, uint32 min_inputs, CounterOpType counter_op_type) :
+		inputs(std::move(_inputs)), min_inputs(min_inputs), counter_op_type(counter_op_type)
+	{
+	}
+
+	void NextBundle(CBundle<SIZE>& bundle) override
+	{
+		if (!tree)
+			tree = std::make_unique<CBundlesLoserTree<SIZE>>(inputs);
+		while (tree->NoOfActive() >= min_inputs)
+		{
+			if (bundle.Full())
+				return;
+			CKmer<SIZE> kmer = tree->TopKmer();
+			uint32 counter = 0;
+			uint32 n_equal = 0;
+			do
+			{
+				aggregate(counter, n_equal++, tree->TopCounter());
+				tree->Pop();
+			} while (!tree->Finished() && tree->TopKmer() == kmer);
+
+			if (n_equal >= min_inputs)
+				bundle.Insert(kmer, counter);
+		}
+		tree->IgnoreRest();
+		this->finished = true;
+	}
+
+	void IgnoreRest() override
+	{
+		if (tree)
+			tree->IgnoreRest();
+		else
+			for (auto input : inputs)
+				input->IgnoreRest();
+	}
+
+	~CNaryOper() override
+	{
+		for (auto input : inputs)
+			delete input;
+	}
+};
+
 template<unsigned SIZE> class CComparer 
 {
 	CBundle<SIZE>* input1, *input2;
@@ -29,6 +29,11 @@
 // term_op -> TERMINATOR
 // argument -> VARIABLE
 // argument -> OPEN_BRACKET expr CLOSE_BRACKET
+// argument -> NARY_OPER modifier OPEN_BRACKET nary_args CLOSE_BRACKET
+// argument -> AT_LEAST modifier OPEN_BRACKET VARIABLE(number) COMMA nary_args CLOSE_BRACKET
+// nary_args -> expr COMMA expr nary_args_tail
+// nary_args_tail -> COMMA expr nary_args_tail
+// nary_args_tail -> TERMINATOR
 // This code is based on: https://github.com/mikailsheikh/cogitolearning-examples/tree/master/CogPar
 /*****************************************************************************************************************************/
 
@@ -39,6 +44,7 @@ template<unsigned SIZE> class COutputParser
 	Token curr_token;
 	void nextToken();
 	CExpressionNode<SIZE>* argument();
+	CExpressionNode<SIZE>* nary_argument();
 	CExpressionNode<SIZE>* term_op(CExpressionNode<SIZE>* left);
 	CExpressionNode<SIZE>* term();
 	CExpressionNode<SIZE>* sum_op(CExpressionNode<SIZE>* left);
@@ -118,9 +124,89 @@ template<unsigned SIZE> CExpressionNode<SIZE>* COutputParser<SIZE>::argument()
 		nextToken();
 		return res;
 	}
+	else if (curr_token.second == TokenType::NARY_UNION_OPER || curr_token.second == TokenType::NARY_INTERSECTION_OPER || curr_token.second == TokenType::NARY_AT_LEAST_OPER)
+		return nary_argument();
 	return nullptr;
 }
 
+/*****************************************************************************************************************************/
+template<unsigned SIZE> CExpressionNode<SIZE>* COutputParser<SIZE>::nary_argument()
+{
+	TokenType type = curr_token.second;
+	std::string name = curr_token.first;
+	CNaryOperNode<SIZE>* res = new CNaryOperNode<SIZE>(name, type == TokenType::NARY_INTERSECTION_OPER ? CounterOpType::MIN : CounterOpType::SUM);
+	nextToken();
+	if (curr_token.second != TokenType::PARENTHESIS_OPEN &&
+		curr_token.second != TokenType::MIN_MODIFIER && curr_token.second != TokenType::MAX_MODIFIER && curr_token.second != TokenType::SUM_MODIFIER)
+	{
+		std::cerr << "Error: only min, max and sum counter calculation modes are allowed for " << name << ", but " << curr_token.first << " found\n";
+		exit(1);
+	}
+	modifier(res);
+	if (curr_token.second != TokenType::PARENTHESIS_OPEN)
+	{
+		std::cerr << "Error: open parenthesis expected after " << name << "\n";
+		exit(1);
+	}
+	nextToken();
+
+	uint32 min_inputs = 0;
+	if (type == TokenType::NARY_AT_LEAST_OPER)
+	{
+		if (curr_token.second != TokenType::VARIABLE || curr_token.first.empty() || curr_token.first.find_first_not_of("0123456789") != std::string::npos)
+		{
+			std::cerr << "Error: number of inputs expected as the first argument of " << name << ", but " << curr_token.first << " found\n";
+			exit(1);
+		}
+		min_inputs = static_cast<uint32>(std::stoul(curr_token.first));
+		nextToken();
+		if (curr_token.second != TokenType::COMMA)
+		{
+			std::cerr << "Error: comma expected, but " << curr_token.first << " found\n";
+			exit(1);
+		}
+		nextToken();
+	}
+
+	while (true)
+	{
+		CExpressionNode<SIZE>* arg = expr();
+		if (!arg)
+		{
+			std::cerr << "Error: argument of " << name << " expected, but " << curr_token.first << " found\n";
+			exit(1);
+		}
+		res->AddArgument(arg);
+		if (curr_token.second != TokenType::COMMA)
+			break;
+		nextToken();
+	}
+	if (curr_token.second != TokenType::PARENTHESIS_CLOSE)
+	{
+		std::cerr << "Error: close  parenthesis expected, but " << curr_token.first << " found\n";
+		exit(1);
+	}
+	nextToken();
+
+	uint32 n_args = res->NoOfArguments();
+	if (n_args < 2)
+	{
+		std::cerr << "Error: " << name << " requires at least 2 arguments\n";
+		exit(1);
+	}
+	if (type == TokenType::NARY_UNION_OPER)
+		min_inputs = 1;
+	else if (type == TokenType::NARY_INTERSECTION_OPER)
+		min_inputs = n_args;
+	else if (min_inputs < 1 || min_inputs > n_args)
+	{
+		std::cerr << "Error: first argument of " << name << " must be in range [1, " << n_args << "]\n";
+		exit(1);
+	}
+	res->SetMinInputs(min_inputs);
+	return res;
+}
+
 /*****************************************************************************************************************************/
 template<unsigned SIZE> CExpressionNode<SIZE>* COutputParser<SIZE>::term_op(CExpressionNode<SIZE>* left)
 {
@@ -10,6 +10,7 @@
 
 #include "parameters_parser.h"
 #include <iostream>
+#include <fstream>
 using namespace std;
 
 
@@ -83,6 +84,16 @@ void CParametersParser::parse_global_params()
 			config.percent_progress.Hide();
 			continue;
 		}
+		else if (strncmp(argv[pos], "-p", 2) == 0)
+		{
+			if (strlen(argv[pos]) < 3 || atoi(argv[pos] + 2) < 1)
+			{
+				std::cerr << "Error: -p require positive value\n";
+				exit(1);
+			}
+			config.n_ranges = atoi(argv[pos] + 2);
+			continue;
+		}
 		else
 		{
 			std::cerr << "Error: unknown global option " << argv[pos] << "\n";
@@ -235,6 +246,134 @@ void CParametersParser::read_check_params()
 	config.check_params.kmer = argv[pos++];
 }
 
+void CParametersParser::read_index_params()
+{
+	while (pos < argc && strncmp(argv[pos], "-s", 2) == 0)
+	{
+		int sample_step = atoi(argv[pos] + 2);
+		if (sample_step < 1)
+		{
+			std::cerr << "Error: wrong value of sample step: " << argv[pos] << "\n";
+			exit(1);
+		}
+		config.index_params.sample_step = sample_step;
+		++pos;
+	}
+}
+
+void CParametersParser::read_matrix_params()
+{
+	while (pos < argc && strncmp(argv[pos], "-", 1) == 0)
+	{
+		if (strcmp(argv[pos], "-c") == 0)
+			config.matrix_params.counts = true;
+		else if (strncmp(argv[pos], "-cb", 3) == 0)
+		{
+			int counter_bytes = atoi(argv[pos] + 3);
+			if (counter_bytes < 1 || counter_bytes > 4)
+			{
+				cerr << "Error: wrong value of counter bytes: " << argv[pos] << ", allowed values: 1-4\n";
+				exit(1);
+			}
+			config.matrix_params.counter_bytes = counter_bytes;
+			config.matrix_params.counts = true;
+		}
+		else if (strncmp(argv[pos], "-sm", 3) == 0)
+			config.matrix_params.min_samples = replace_zero(atoi(argv[pos] + 3), "-sm", 1);
+		else if (strncmp(argv[pos], "-sx", 3) == 0)
+			config.matrix_params.max_samples = replace_zero(atoi(argv[pos] + 3), "-sx", 1);
+		else if (strncmp(argv[pos], "-b", 2) == 0)
+			config.matrix_params.block_size = replace_zero(atoi(argv[pos] + 2), "-b", 1);
+		else
+		{
+			cerr << "Error: Unknow parameter for matrix operation: " << argv[pos] << "\n";
+			exit(1);
+		}
+		++pos;
+	}
+	if (pos >= argc)
+	{
+		cerr << "Error: output file missed\n";
+		exit(1);
+	}
+	config.matrix_params.file_src = argv[pos++];
+}
+
+void CParametersParser::read_matrix_check_params()
+{
+	if (pos + 2 != argc)
+	{
+		cerr << "Error: matrix_check operation requires matrix file and k-mer to check\n";
+		exit(1);
+	}
+	config.matrix_params.file_src = argv[pos++];
+	config.check_params.kmer = argv[pos++];
+}
+
+void CParametersParser::read_input_list(const char* list_file_name)
+{
+	ifstream list_file(list_file_name);
+	if (!list_file)
+	{
+		cerr << "Error: cannot open file: " << list_file_name << "\n";
+		exit(1);
+	}
+	string line;
+	while (getline(list_file, line))
+	{
+		auto first = line.find_first_not_of(" \t\r");
+		if (first == string::npos)
+			continue;
+		auto last = line.find_last_not_of(" \t\r");
+		config.input_desc.push_back(CInputDesc(line.substr(first, last - first + 1)));
+	}
+}
+
+void CParametersParser::read_distance_params()
+{
+	while (pos < argc && strncmp(argv[pos], "-", 1) == 0)
+	{
+		if (strncmp(argv[pos], "-s", 2) == 0)
+		{
+			char* end;
+			config.distance_params.scale = strtoull(argv[pos] + 2, &end, 10);
+			if (*end || config.distance_params.scale == 0)
+			{
+				cerr << "Error: wrong value of scale: " << argv[pos] << "\n";
+				exit(1);
+			}
+		}
+		else
+		{
+			cerr << "Error: Unknow parameter for distance operation: " << argv[pos] << "\n";
+			exit(1);
+		}
+		++pos;
+	}
+	if (pos >= argc)
+	{
+		cerr << "Error: output prefix missed\n";
+		exit(1);
+	}
+	config.distance_params.output_prefix = argv[pos++];
+}
+
+void CParametersParser::read_many_input_desc()
+{
+	while (pos < argc)
+	{
+		if (argv[pos][0] == '@')
+			read_input_list(argv[pos++] + 1);
+		else
+			read_input_desc();
+	}
+	if (config.input_desc.empty())
+	{
+		cerr << "Error: Input database source missed\n";
+		exit(1);
+	}
+}
+
 void CParametersParser::read_input_desc()
 {
 	if (pos >= argc)
@@ -358,6 +497,29 @@ bool CParametersParser::read_output_for_transform()
 				exit(1);
 			}
 		}		
+		else if (strncmp(argv[pos], "-f", 2) == 0 || strcmp(argv[pos], "-gz") == 0)
+		{
+			auto& desc = config.transform_output_desc.back();
+			if (desc.op_type != CTransformOutputDesc::OpType::DUMP)
+			{
+				cerr << "Error: " << argv[pos] << " parameter allowed only for dump operation\n";
+				Usage();
+				exit(1);
+			}
+			if (strcmp(argv[pos], "-gz") == 0)
+				desc.dump_gzip = true;
+			else if (strcmp(argv[pos] + 2, "text") == 0)
+				desc.dump_format = CTransformOutputDesc::DumpFormat::TEXT;
+			else if (strcmp(argv[pos] + 2, "bin") == 0)
+				desc.dump_format = CTransformOutputDesc::DumpFormat::ROWS;
+			else if (strcmp(argv[pos] + 2, "col") == 0)
+				desc.dump_format = CTransformOutputDesc::DumpFormat::COLUMNS;
+			else
+			{
+				cerr << "Error: unknown dump format: " << argv[pos] + 2 << "\n";
+				exit(1);
+			}
+		}
 		else
 		{
 			cerr << "Error: unknown operation parameter: " << argv[pos] <<"\n";
@@ -633,6 +795,22 @@ void CParametersParser::Parse()
 	{
 		config.mode = CConfig::Mode::CHECK;
 	}
+	else if (strcmp(argv[pos], "index") == 0)
+	{
+		config.mode = CConfig::Mode::INDEX;
+	}
+	else if (strcmp(argv[pos], "matrix") == 0)
+	{
+		config.mode = CConfig::Mode::MATRIX;
+	}
+	else if (strcmp(argv[pos], "matrix_check") == 0)
+	{
+		config.mode = CConfig::Mode::MATRIX_CHECK;
+	}
+	else if (strcmp(argv[pos], "distance") == 0)
+	{
+		config.mode = CConfig::Mode::DISTANCE;
+	}
 	else
 	{
 		cerr << "Error: Unknow mode: " << argv[pos] << "\n";
@@ -706,11 +884,35 @@ void CParametersParser::Parse()
 		read_input_desc();
 		read_check_params();		
 	}
+	else if (config.mode == CConfig::Mode::INDEX)
+	{
+		read_index_params();
+		read_input_desc();
+		if (pos < argc)
+		{
+			cerr << "Error: Unknow parameter for index operation: " << argv[pos] << "\n";
+			exit(1);
+		}
+	}
 	else if (config.mode == CConfig::Mode::COMPARE)
 	{
 		read_input_desc();
 		read_input_desc();
 	}
+	else if (config.mode == CConfig::Mode::MATRIX)
+	{
+		read_matrix_params();
+		read_many_input_desc();
+	}
+	else if (config.mode == CConfig::Mode::MATRIX_CHECK)
+	{
+		read_matrix_check_params();
+	}
+	else if (config.mode == CConfig::Mode::DISTANCE)
+	{
+		read_distance_params();
+		read_many_input_desc();
+	}
 }
 
 uint32 CParametersParser::get_min_cutoff_min()
@@ -848,7 +1050,25 @@ bool CParametersParser::validate_input_dbs()
 	}
 
 	//update output description if it was not set with parameters
-	if (config.mode == CConfig::Mode::SIMPLE_SET)
+	if (config.mode == CConfig::Mode::MATRIX)
+	{
+		CMatrixParams& params = config.matrix_params;
+		uint32 n_samples = static_cast<uint32>(config.input_desc.size());
+		if (params.max_samples == 0 || params.max_samples > n_samples)
+			params.max_samples = n_samples;
+		if (params.min_samples > params.max_samples)
+		{
+			cerr << "Error: -sm" << params.min_samples << " is greater than -sx" << params.max_samples << "\n";
+			return false;
+		}
+		if (params.counts && params.counter_bytes == 0)
+		{
+			params.counter_bytes = 1;
+			for (auto& header : config.headers)
+				params.counter_bytes = MAX(params.counter_bytes, MIN(4u, header.counter_size));
+		}
+	}
+	else if (config.mode == CConfig::Mode::SIMPLE_SET)
 	{
 		uint32 min_cutoff_min = get_min_cutoff_min();
 		uint64 max_cutoff_max = get_max_cutoff_max();
@@ -29,6 +29,12 @@ class CParametersParser
 	void read_output_fastq_desc();
 	void read_input_desc();
 	void read_check_params();
+	void read_index_params();
+	void read_matrix_params();
+	void read_matrix_check_params();
+	void read_distance_params();
+	void read_input_list(const char* list_file_name);
+	void read_many_input_desc();
 	void read_filter_params();
 	bool read_output_desc_for_simple();
 	bool read_output_for_transform();
@@ -26,9 +26,11 @@ uint32 CPercentProgress::RegisterItem(const std::string& name, uint64 max_value)
 }
 
 /*****************************************************************************************************************************/
-uint32 CPercentProgress::RegisterItem(uint64 max_value)
+uint32 CPercentProgress::RegisterItem(uint64 max_value, uint32 n_parts)
 {
+	std::lock_guard<std::mutex> lck(mtx);
 	items.emplace_back("in" + std::to_string(items.size() + 1), max_value);
+	items.back().parts_left = n_parts;
 	display();
 	return static_cast<uint32>(items.size() - 1);
 }
@@ -47,6 +49,7 @@ void CPercentProgress::UpdateItem(uint32 id)
 /*****************************************************************************************************************************/
 void CPercentProgress::UpdateItem(uint32 id, uint32 offset)
 {
+	std::lock_guard<std::mutex> lck(mtx);
 	items[id].cur_val += offset;
 	uint32 prev = items[id].cur_percent;
 	if (items[id].max_val)
@@ -60,6 +63,12 @@ void CPercentProgress::UpdateItem(uint32 id, uint32 offset)
 /*****************************************************************************************************************************/
 void CPercentProgress::Complete(uint32 id)
 {
+	std::lock_guard<std::mutex> lck(mtx);
+	if (items[id].parts_left > 1)
+	{
+		--items[id].parts_left;
+		return;
+	}
 	if (items[id].cur_percent != 100)
 	{
 		items[id].cur_percent = 100;
@@ -14,6 +14,7 @@
 #include "defs.h"
 #include <vector>
 #include <string>
+#include <mutex>
 //************************************************************************************************************
 // CPercentProgress - class to display progress of reading inputs
 //************************************************************************************************************
@@ -30,14 +31,16 @@ class CPercentProgress
 
 		uint32 to_next_update;
 		uint32 to_next_update_pattern;
+		uint32 parts_left = 1;
 	public:
 		CDisplayItem(const std::string name, uint64 max_val);
 	};
 	std::vector<CDisplayItem> items;
+	std::mutex mtx; //items read in parts (range partitioning) are updated by many threads
 	void display();
 public:
 	uint32 RegisterItem(const std::string& name, uint64 max_value);
-	uint32 RegisterItem(uint64 max_value);
+	uint32 RegisterItem(uint64 max_value, uint32 n_parts = 1); //item read in n_parts parts is completed when all the parts are
 	void UpdateItem(uint32 id);
 	void Complete(uint32 id);
 	void UpdateItem(uint32 id, uint32 offset);
@@ -18,6 +18,7 @@
 #include <condition_variable>
 #include <list>
 #include <queue>
+#include <map>
 
 
 
@@ -396,6 +397,64 @@ public:
 };
 
 
+//************************************************************************************************************
+// COrderedQueue - queue of numbered elements, pop returns them in order of their numbers (ids). Push of an
+// element which is max_ahead or more ids ahead of the next one to pop waits, so the queue never grows above
+// max_ahead elements and a producer of the next element is never blocked
+//************************************************************************************************************
+template<typename T> class COrderedQueue
+{
+	std::map<uint64, T> content;
+	uint64 next_id = 0;
+	uint64 max_ahead;
+	bool completed = false;
+
+	mutable std::mutex mtx;
+	std::condition_variable cv_push, cv_pop;
+public:
+	COrderedQueue(uint64 max_ahead) : max_ahead(max_ahead)
+	{
+	}
+
+	void push(uint64 id, T&& elem)
+	{
+		std::unique_lock<std::mutex> lck(mtx);
+		cv_push.wait(lck, [this, id]{return id < next_id + max_ahead; });
+		content.emplace(id, std::move(elem));
+		if (id == next_id)
+			cv_pop.notify_all();
+	}
+
+	bool pop(T& elem)
+	{
+		uint64 id;
+		return pop(id, elem);
+	}
+
+	bool pop(uint64& id, T& elem)
+	{
+		std::unique_lock<std::mutex> lck(mtx);
+		cv_pop.wait(lck, [this]{return (!content.empty() && content.begin()->first == next_id) || (completed && content.empty()); });
+		if (content.empty())
+			return false;
+		id = next_id++;
+		elem = std::move(content.begin()->second);
+		content.erase(content.begin());
+		cv_push.notify_all();
+		if (!content.empty() && content.begin()->first == next_id)
+			cv_pop.notify_all();
+		return true;
+	}
+
+	//all elements were pushed
+	void mark_completed()
+	{
+		std::lock_guard<std::mutex> lck(mtx);
+		completed = true;
+		cv_pop.notify_all();
+	}
+};
+
 struct CFilteringQueues
 {
 	CInputFilesQueue *input_files_queue;
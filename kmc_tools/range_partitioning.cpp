@@ -0,0 +1,166 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#include "range_partitioning.h"
+#include "../kmc_api/elias_fano.h"
+#include <iostream>
+#include <numeric>
+using namespace std;
+
+
+/*****************************************************************************************************************************/
+/******************************************************** CONSTRUCTOR ********************************************************/
+/*****************************************************************************************************************************/
+
+/*****************************************************************************************************************************/
+CRangePartitioning::CRangePartitioning() :
+	config(CConfig::GetInstance()),
+	prefix_len(MAX_PREFIX_LEN)
+{
+}
+
+/*****************************************************************************************************************************/
+/********************************************************** PUBLIC ***********************************************************/
+/*****************************************************************************************************************************/
+
+/*****************************************************************************************************************************/
+bool CRangePartitioning::Prepare()
+{
+	config.ranges.clear();
+	config.ranges_input_desc.clear();
+	if (config.n_ranges < 2)
+		return false;
+
+	//ranges must be expressible in prefixes of LUTs of all inputs
+	for (auto& header : config.headers)
+	{
+		if (header.kmer_file_type != KmerFileType::KMC1 && header.kmer_file_type != KmerFileType::KMC2)
+		{
+			if (config.verbose)
+				cerr << "Warning: k-mer ranges are supported for KMC databases only, -p" << config.n_ranges << " will be ignored\n";
+			return false;
+		}
+		prefix_len = MIN(prefix_len, header.lut_prefix_len);
+	}
+
+	kmers_per_prefix.assign(1ull << 2 * prefix_len, 0);
+	for (uint32 i = 0; i < config.headers.size(); ++i)
+		add_kmers_per_prefix(config.headers[i], config.input_desc[i]);
+
+	make_ranges();
+	if (config.ranges.size() < 2)
+	{
+		config.ranges.clear();
+		return false;
+	}
+
+	uint32 n_ranges = static_cast<uint32>(config.ranges.size());
+	if (config.verbose)
+		cerr << "Info: k-mers split into " << n_ranges << " ranges of prefixes of " << prefix_len << " symbols\n";
+
+	//each range has its own readers, so threads of inputs are shared among ranges
+	for (auto& desc : config.input_desc)
+		desc.threads = MAX(1, desc.threads / n_ranges);
+	for (uint32 i = 0; i < config.headers.size(); ++i)
+		config.input_desc[i].progress_id = config.percent_progress.RegisterItem(config.headers[i].total_kmers, n_ranges);
+
+	config.ranges_input_desc.resize(n_ranges, config.input_desc);
+	for (uint32 r = 0; r < n_ranges; ++r)
+		for (auto& desc : config.ranges_input_desc[r])
+			desc.range = config.ranges[r];
+
+	return true;
+}
+
+/*****************************************************************************************************************************/
+/********************************************************** PRIVATE **********************************************************/
+/*****************************************************************************************************************************/
+
+/*****************************************************************************************************************************/
+void CRangePartitioning::add_kmers_per_prefix(const CKmerFileHeader& header, const CInputDesc& desc)
+{
+	uint64 lut_size = 1ull << 2 * header.lut_prefix_len;
+	uint32 shift = 2 * (header.lut_prefix_len - prefix_len);
+
+	//KMC2 LUT contains LUTs of all bins and the total number of k-mers, it is missing in KMC1 LUT
+	uint64 n_values = header.kmer_file_type == KmerFileType::KMC2 ? lut_size * header.no_of_bins + 1 : lut_size;
+
+	string kmc_pre_file_name = desc.file_src + ".kmc_pre";
+	FILE* kmc_pre = fopen(kmc_pre_file_name.c_str(), "rb");
+	if (!kmc_pre)
+	{
+		cerr << "Error: cannot open file: " << kmc_pre_file_name << "\n";
+		exit(1);
+	}
+	setvbuf(kmc_pre, NULL, _IONBF, 0);
+	my_fseek(kmc_pre, 4, SEEK_SET);
+
+	CEliasFano lut_ef;
+	bool is_ef = header.kmer_file_type == KmerFileType::KMC2 && header.IsLutEliasFano();
+	if (is_ef && (!lut_ef.Load(kmc_pre) || lut_ef.Size() != n_values))
+	{
+		cerr << "Error: some error while reading " << kmc_pre_file_name << "\n";
+		exit(1);
+	}
+
+	vector<uint64> lut(LUT_CHUNK_SIZE);
+	uint64 prev = 0;
+	for (uint64 pos = 0; pos < n_values; )
+	{
+		uint64 to_read = MIN(n_values - pos, (uint64)LUT_CHUNK_SIZE);
+		if (is_ef)
+			lut_ef.Decode(pos, to_read, lut.data());
+		else if (fread(lut.data(), sizeof(uint64), to_read, kmc_pre) != to_read)
+		{
+			cerr << "Error: some error while reading " << kmc_pre_file_name << "\n";
+			exit(1);
+		}
+		//value at pos ends the prefix (pos - 1) % lut_size
+		for (uint64 i = 0; i < to_read; ++i, ++pos)
+		{
+			if (pos)
+				kmers_per_prefix[((pos - 1) % lut_size) >> shift] += lut[i] - prev;
+			prev = lut[i];
+		}
+	}
+	if (header.kmer_file_type == KmerFileType::KMC1)
+		kmers_per_prefix.back() += header.total_kmers - prev;
+
+	fclose(kmc_pre);
+}
+
+/*****************************************************************************************************************************/
+void CRangePartitioning::make_ranges()
+{
+	//the r-th range ends at the first prefix at which the number of k-mers of preceding ranges reaches total * (r + 1) / n_ranges
+	uint64 total = accumulate(kmers_per_prefix.begin(), kmers_per_prefix.end(), 0ull);
+	uint64 n_prefixes = kmers_per_prefix.size();
+	CKmerRange range;
+	range.prefix_len = prefix_len;
+	range.begin = 0;
+	uint64 sum = 0;
+	for (uint64 prefix = 0; prefix < n_prefixes && config.ranges.size() + 1 < config.n_ranges; ++prefix)
+	{
+		sum += kmers_per_prefix[prefix];
+		if (sum * config.n_ranges >= total * (config.ranges.size() + 1))
+		{
+			range.end = prefix + 1;
+			config.ranges.push_back(range);
+			range.begin = range.end;
+		}
+	}
+	if (range.begin < n_prefixes)
+	{
+		range.end = n_prefixes;
+		config.ranges.push_back(range);
+	}
+}
+
+// ***** EOF
@@ -0,0 +1,43 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+#ifndef _RANGE_PARTITIONING_H
+#define _RANGE_PARTITIONING_H
+
+#include "defs.h"
+#include "config.h"
+#include <vector>
+
+//************************************************************************************************************
+// CRangePartitioning - splits k-mers into disjoint ranges of prefixes (see CKmerRange), so that simple and
+// complex operations may be performed independently (in parallel) for each range. Bounds of ranges are chosen
+// (from LUTs of input databases) to balance the number of input k-mers per range
+//************************************************************************************************************
+class CRangePartitioning
+{
+	static const uint32 MAX_PREFIX_LEN = 8;
+	static const uint32 LUT_CHUNK_SIZE = 1 << 20;
+
+	CConfig& config;
+	uint32 prefix_len;
+	std::vector<uint64> kmers_per_prefix;
+
+	void add_kmers_per_prefix(const CKmerFileHeader& header, const CInputDesc& desc);
+	void make_ranges();
+public:
+	CRangePartitioning();
+
+	//Sets ranges and ranges_input_desc of config. Returns false if the operation should be performed as a whole
+	bool Prepare();
+};
+
+#endif
+
+// ***** EOF
@@ -16,23 +16,29 @@
 
 CTokenizer::CTokenizer()
 {
-	token_patterns.resize(13);
+	token_patterns.resize(17);
 	token_patterns[0] = std::make_pair("^(\\()", TokenType::PARENTHESIS_OPEN);
 	token_patterns[1] = std::make_pair("^(\\))", TokenType::PARENTHESIS_CLOSE);
 	token_patterns[2] = std::make_pair("^(\\-)", TokenType::STRICT_MINUS_OPER);
 	token_patterns[3] = std::make_pair("^(\\~)", TokenType::COUNTER_MINUS_OPER);
 	token_patterns[4] = std::make_pair("^(\\+)", TokenType::PLUS_OPER);
 	token_patterns[5] = std::make_pair("^(\\*)", TokenType::MUL_OPER);
+	token_patterns[6] = std::make_pair("^(,)", TokenType::COMMA);
 	
 	//those are keywords
-	token_patterns[6] = std::make_pair("^(min)", TokenType::MIN_MODIFIER);
-	token_patterns[7] = std::make_pair("^(max)", TokenType::MAX_MODIFIER);
-	token_patterns[8] = std::make_pair("^(diff)", TokenType::DIFF_MODIFIER);
-	token_patterns[9] = std::make_pair("^(sum)", TokenType::SUM_MODIFIER);
-	token_patterns[10] = std::make_pair("^(left)", TokenType::LEFT_MODIFIER);
-	token_patterns[11] = std::make_pair("^(right)", TokenType::RIGHT_MODIFIER);
+	token_patterns[7] = std::make_pair("^(min)", TokenType::MIN_MODIFIER);
+	token_patterns[8] = std::make_pair("^(max)", TokenType::MAX_MODIFIER);
+	token_patterns[9] = std::make_pair("^(diff)", TokenType::DIFF_MODIFIER);
+	token_patterns[10] = std::make_pair("^(sum)", TokenType::SUM_MODIFIER);
+	token_patterns[11] = std::make_pair("^(left)", TokenType::LEFT_MODIFIER);
+	token_patterns[12] = std::make_pair("^(right)", TokenType::RIGHT_MODIFIER);
 
-	token_patterns[12] = std::make_pair("^(\\w*)", TokenType::VARIABLE);
+	//N argument's operations, whole words only, so they do not clash with names of inputs like union1
+	token_patterns[13] = std::make_pair("^(union)\\b", TokenType::NARY_UNION_OPER);
+	token_patterns[14] = std::make_pair("^(intersect)\\b", TokenType::NARY_INTERSECTION_OPER);
+	token_patterns[15] = std::make_pair("^(atleast)\\b", TokenType::NARY_AT_LEAST_OPER);
+
+	token_patterns[16] = std::make_pair("^(\\w*)", TokenType::VARIABLE);
 }
 
 
@@ -43,7 +49,7 @@ CTokenizer::CTokenizer()
 
 const std::set<std::string>& CTokenizer::GetKeywords()
 {
-	static std::set<std::string> keywords = {"min", "max", "sum", "diff", "left", "right"}; //related to tokens created in CTokenizer ctor
+	static std::set<std::string> keywords = {"min", "max", "sum", "diff", "left", "right", "union", "intersect", "atleast"}; //related to tokens created in CTokenizer ctor
 	return keywords;
 }
 
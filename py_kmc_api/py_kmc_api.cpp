@@ -2,6 +2,8 @@
 #include <pybind11/operators.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
+#include <pybind11/numpy.h>
+#include <algorithm>
 #include <kmc_file.h>
 
 namespace py = pybind11;
@@ -70,11 +72,32 @@ PYBIND11_MODULE(py_kmc_api, m) {
 		
 
 
-	py::class_<CKMCFile>(m, "KMCFile")
+	py::class_<CKMCFile> kmc_file(m, "KMCFile");
+
+	py::enum_<CKMCFile::ra_mode>(kmc_file, "RAMode")
+		.value("read", CKMCFile::ra_mode::read)
+		.value("mmap", CKMCFile::ra_mode::mmap)
+		.value("mmap_populate", CKMCFile::ra_mode::mmap_populate);
+
+	kmc_file
 		.def(py::init<>())
-		.def("OpenForRA", &CKMCFile::OpenForRA)
-		.def("OpenForListing", &CKMCFile::OpenForListing)
+		.def("OpenForRA", [](CKMCFile& ptr, const std::string& file_name) { return ptr.OpenForRA(file_name); })
+		.def("OpenForRA", [](CKMCFile& ptr, const std::string& file_name, CKMCFile::ra_mode mode) { return ptr.OpenForRA(file_name, mode); })
+		.def("OpenForListing", [](CKMCFile& ptr, const std::string& file_name) { return ptr.OpenForListing(file_name); })
+		.def("OpenForListing", [](CKMCFile& ptr, const std::string& file_name, uint32 part_id, uint32 n_parts) { return ptr.OpenForListing(file_name, part_id, n_parts); })
 		.def("ReadNextKmer", [](CKMCFile& ptr, CKmerAPI& kmer, Count& count) {return ptr.ReadNextKmer(kmer, count.value); })
+		// Fill (in place) rows of kmers (uint64 array of shape (n, (k + 31) // 32)) and counts (uint64 array of n elements)
+		// with next k-mers (as in KmerAPI.to_long) and their counters, return the number of k-mers read
+		.def("ReadNextKmers", [](CKMCFile& ptr, py::array_t<uint64, py::array::c_style> kmers, py::array_t<uint64, py::array::c_style> counts) {
+			uint64 n_words = (ptr.KmerLength() + 31) / 32;
+			if (kmers.size() % n_words)
+				throw py::value_error("the size of kmers must be a multiple of (k + 31) // 32");
+			uint64 max = (std::min)((uint64)kmers.size() / n_words, (uint64)counts.size());
+			uint64* kmers_data = kmers.mutable_data();
+			uint64* counts_data = counts.mutable_data();
+			py::gil_scoped_release release;
+			return ptr.ReadNextKmers(kmers_data, counts_data, max);
+		}, py::arg("kmers").noconvert(), py::arg("counts").noconvert())
 		.def("Close", &CKMCFile::Close)
 		.def("SetMinCount", &CKMCFile::SetMinCount)
 		.def("GetMinCount", &CKMCFile::GetMinCount)
@@ -86,13 +109,61 @@ PYBIND11_MODULE(py_kmc_api, m) {
 		.def("RestartListing", &CKMCFile::RestartListing)
 		.def("Eof", &CKMCFile::Eof)
 		.def("CheckKmer", [](CKMCFile& ptr, CKmerAPI& kmer, Count& count) { return ptr.CheckKmer(kmer, count.value); })
+		.def("CheckKmers", [](CKMCFile& ptr, const std::vector<CKmerAPI>& kmers) {
+			std::vector<uint64> counts;
+			ptr.CheckKmers(kmers, counts);
+			return counts;
+		})
 		.def("IsKmer", &CKMCFile::IsKmer)
+		.def_static("BuildIndex", &CKMCFile::BuildIndex, py::arg("file_name"), py::arg("sample_step") = 16)
+		.def("HasIndex", &CKMCFile::HasIndex)
 		.def("ResetMinMaxCounts", &CKMCFile::ResetMinMaxCounts)
 		.def("Info", [](CKMCFile& ptr, CKMCFileInfo& info) {return ptr.Info(info); })
 		.def("Info", [](CKMCFile& ptr) { CKMCFileInfo info; ptr.Info(info); return info; })
 		.def("GetCountersForRead", [](CKMCFile& ptr, const std::string& read, CountVec& counters) {
 			return ptr.GetCountersForRead(read, counters.value);
 		})
+		// Counters of k-mers of many reads as a single uint32 array and offsets (n_reads + 1 elements) of reads' counters in it
+		.def("GetCountersForReads", [](CKMCFile& ptr, const std::vector<std::string>& reads) {
+			uint64 kmer_len = ptr.KmerLength();
+			py::array_t<uint64> offsets(reads.size() + 1);
+			uint64* offsets_data = offsets.mutable_data();
+			offsets_data[0] = 0;
+			for (size_t i = 0; i < reads.size(); ++i)
+				offsets_data[i + 1] = offsets_data[i] + (reads[i].size() >= kmer_len ? reads[i].size() - kmer_len + 1 : 0);
+			py::array_t<uint32> counters(offsets_data[reads.size()]);
+			uint32* counters_data = counters.mutable_data();
+			{
+				py::gil_scoped_release release;
+				std::vector<uint32> read_counters;
+				for (size_t i = 0; i < reads.size(); ++i)
+				{
+					read_counters.clear();
+					ptr.GetCountersForRead(reads[i], read_counters);
+					uint64 n = offsets_data[i + 1] - offsets_data[i];
+					std::fill(std::copy_n(read_counters.begin(), (std::min)(n, (uint64)read_counters.size()), counters_data + offsets_data[i]), counters_data + offsets_data[i + 1], 0);
+				}
+			}
+			return py::make_tuple(counters, offsets);
+		})
+		;
+
+	py::class_<CKMCQuery>(m, "KMCQuery")
+		.def(py::init<const CKMCFile&>(), py::keep_alive<1, 2>())
+		.def("SetMinCount", &CKMCQuery::SetMinCount)
+		.def("GetMinCount", &CKMCQuery::GetMinCount)
+		.def("SetMaxCount", &CKMCQuery::SetMaxCount)
+		.def("GetMaxCount", &CKMCQuery::GetMaxCount)
+		.def("CheckKmer", [](CKMCQuery& ptr, CKmerAPI& kmer, Count& count) { return ptr.CheckKmer(kmer, count.value); })
+		.def("CheckKmers", [](CKMCQuery& ptr, const std::vector<CKmerAPI>& kmers) {
+			std::vector<uint64> counts;
+			ptr.CheckKmers(kmers, counts);
+			return counts;
+		})
+		.def("IsKmer", &CKMCQuery::IsKmer)
+		.def("GetCountersForRead", [](CKMCQuery& ptr, const std::string& read, CountVec& counters) {
+			return ptr.GetCountersForRead(read, counters.value);
+		})
 		;
 		
 }
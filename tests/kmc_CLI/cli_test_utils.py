@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+'''
+Helpers shared by CLI tests: deterministic random input data, running tools and reading their outputs.
+'''
+
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+def parse_args(usage_extra = ""):
+    ''' Return path of the directory with binaries (kmc, kmc_tools, kmc_dump, ...) given in the command line. '''
+    if len(sys.argv) < 2:
+        print("Usage: {} <bin_dir>{}".format(sys.argv[0], usage_extra))
+        sys.exit(1)
+    return os.path.abspath(sys.argv[1])
+
+def work_dir():
+    ''' Create a temporary working directory and make it current. '''
+    path = tempfile.mkdtemp(prefix = "kmc_test_")
+    os.chdir(path)
+    return path
+
+def random_genome(length, seed):
+    rnd = random.Random(seed)
+    return "".join(rnd.choice("ACGT") for _ in range(length))
+
+def save_reads(file_name, genome, n_reads, read_len, seed, error_rate = 0.01):
+    ''' Sample reads (both strands, with substitutions and some Ns) from a genome and store them in FASTQ. '''
+    rnd = random.Random(seed)
+    comp = {'A': 'T', 'C': 'G', 'G': 'C', 'T': 'A'}
+    with open(file_name, "w") as f:
+        for i in range(n_reads):
+            pos = rnd.randrange(0, len(genome) - read_len + 1)
+            read = list(genome[pos:pos + read_len])
+            for j in range(read_len):
+                r = rnd.random()
+                if r < error_rate:
+                    read[j] = rnd.choice("ACGT")
+                elif r < error_rate * 1.1:
+                    read[j] = 'N'
+            read = "".join(read)
+            if rnd.random() < 0.5:
+                read = "".join(comp.get(c, 'N') for c in reversed(read))
+            f.write("@r{}\n{}\n+\n{}\n".format(i, read, "I" * read_len))
+
+def run(command, expected_rc = 0):
+    ''' Run a command (list of arguments), exit if its return code is not as expected, return stdout. '''
+    proc = subprocess.run(command, stdout = subprocess.PIPE, stderr = subprocess.PIPE)
+    if proc.returncode != expected_rc:
+        print("Error: {} returned {} (expected {})".format(" ".join(command), proc.returncode, expected_rc))
+        print(proc.stderr.decode("utf-8", "replace"))
+        sys.exit(1)
+    return proc.stdout
+
+def kmc(bin_dir, params, input, output, tmp = "."):
+    run([os.path.join(bin_dir, "kmc"), "-hp", "-m2", "-t2"] + params + [input, output, tmp])
+
+def kmc_tools(bin_dir, params, expected_rc = 0):
+    return run([os.path.join(bin_dir, "kmc_tools"), "-hp"] + params, expected_rc)
+
+def read_dump(file_name):
+    ''' Read a text dump (k-mer, tab, counter) into a dict. '''
+    res = {}
+    with open(file_name) as f:
+        for line in f:
+            kmer, count = line.split()
+            res[kmer] = int(count)
+    return res
+
+def dump(bin_dir, db, file_name = None):
+    ''' Dump a KMC database with kmc_tools transform and return it as a dict. '''
+    if file_name is None:
+        file_name = db + ".dump"
+    kmc_tools(bin_dir, ["transform", db, "dump", file_name])
+    return read_dump(file_name)
+
+def check(condition, message):
+    if not condition:
+        print("Error: " + message)
+        sys.exit(1)
+
+def files_equal(a, b):
+    with open(a, "rb") as fa, open(b, "rb") as fb:
+        return fa.read() == fb.read()
@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+'''
+Test of big bins of strict memory mode: develop switch --force-big-bins makes every bin big and split into many
+sub bins merged concurrently in ranges by several mergers. The database, streamed text dump and statistics must be the
+same as of a normal run, and no sub bin files may be left in the temporary directory.
+'''
+
+import json
+import os
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+os.makedirs("tmp", exist_ok = True)
+
+def stats(file_name):
+    with open(file_name) as f:
+        s = json.load(f)["Stats"]
+    return [s[key] for key in ["#k-mers_below_min_threshold", "#k-mers_above_max_threshold", "#Unique_k-mers",
+                               "#Unique_counted_k-mers", "#Total no. of k-mers"]]
+
+genome = random_genome(200000, 1)
+save_reads("reads.fq", genome, 40000, 100, 2)
+for k, params in [(25, ["-ci2"]), (31, ["-ci1", "-cx40"]), (45, ["-ci2", "-cs200"]), (70, ["-ci2"])]:
+    params = ["-k{}".format(k)] + params
+    tag = "k{}".format(k)
+    kmc(bin_dir, params + ["-j{}.n.json".format(tag)], "reads.fq", tag + ".n", "tmp")
+    expected = dump(bin_dir, tag + ".n")
+    check(len(expected) > 1000, "too small database for {}".format(params))
+
+    for out, mode in [(tag + ".b", []), (tag + ".txt", ["-otxt"])]:
+        run([os.path.join(bin_dir, "kmc"), "-hp", "-m2", "-t4", "-sm", "-smme3", "--force-big-bins"] + params + mode +
+            ["-j{}.json".format(out), "reads.fq", out, "tmp"])
+        result = read_dump(out) if mode else dump(bin_dir, out)
+        check(result == expected, "output with big bins differs from normal one for {} {}".format(params, mode))
+        check(stats(out + ".json") == stats(tag + ".n.json"), "statistics with big bins differ for {} {}".format(params, mode))
+        check(os.listdir("tmp") == [], "files left in tmp directory for {} {}: {}".format(params, mode, os.listdir("tmp")))
+
+print("kmc big bins test OK")
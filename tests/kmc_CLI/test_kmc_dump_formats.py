@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+'''
+Test of dump formats of kmc_tools transform dump and kmc_dump: binary rows, columnar chunks and their gzip
+compressed versions are decoded and compared with the text dump (k-mers, counters and their order).
+'''
+
+import gzip
+import os
+import struct
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+
+def read_text(file_name):
+    ''' Return list of (k-mer, counter) of a text dump, in order of the file. '''
+    with open(file_name) as f:
+        return [(kmer, int(count)) for kmer, count in (line.split() for line in f)]
+
+def decode_kmer(data, kmer_len, symbols):
+    x = int.from_bytes(data, "big")
+    return "".join(symbols[(x >> (2 * (kmer_len - 1 - i))) & 3] for i in range(kmer_len))
+
+def read_binary(file_name, k, layout, max_chunk):
+    ''' Return list of (k-mer, counter) of a binary (rows or columns) dump, check its header and layout. '''
+    with open(file_name, "rb") as f:
+        data = f.read()
+    check(data[:4] == b"KMCD", "wrong magic of " + file_name)
+    version, kmer_len, encoding, kmer_bytes, counter_bytes, file_layout = struct.unpack_from("<6I", data, 4)
+    check(version == 1 and kmer_len == k and kmer_bytes == (k + 3) // 4 and counter_bytes == 4 and file_layout == layout,
+          "wrong header of " + file_name)
+    symbols = {(encoding >> (6 - 2 * i)) & 3: c for i, c in enumerate("ACGT")}
+    res = []
+    pos = 28
+    if layout == 0:
+        rec_bytes = kmer_bytes + counter_bytes
+        check((len(data) - pos) % rec_bytes == 0, "wrong size of " + file_name)
+        for pos in range(pos, len(data), rec_bytes):
+            res.append((decode_kmer(data[pos:pos + kmer_bytes], kmer_len, symbols),
+                        int.from_bytes(data[pos + kmer_bytes:pos + rec_bytes], "little")))
+        return res
+    while pos < len(data):
+        n = struct.unpack_from("<I", data, pos)[0]
+        check(0 < n <= max_chunk, "wrong size of chunk in " + file_name)
+        kmers = pos + 4
+        counters = kmers + n * kmer_bytes
+        for i in range(n):
+            res.append((decode_kmer(data[kmers + i * kmer_bytes:kmers + (i + 1) * kmer_bytes], kmer_len, symbols),
+                        int.from_bytes(data[counters + i * counter_bytes:counters + (i + 1) * counter_bytes], "little")))
+        pos = counters + n * counter_bytes
+    check(pos == len(data), "truncated chunk in " + file_name)
+    return res
+
+def check_gzip(file_name, plain_name):
+    ''' Compressed file must consist of gzip members which content is the same as the plain file. '''
+    with open(file_name, "rb") as f:
+        data = f.read()
+    check(data[:2] == b"\x1f\x8b", file_name + " is not gzip compressed")
+    with open(plain_name, "rb") as f:
+        check(gzip.decompress(data) == f.read(), "decompressed {} differs from {}".format(file_name, plain_name))
+
+genome = random_genome(60000, 1)
+save_reads("reads.fq", genome, 12000, 100, 2)
+for k in [25, 28, 55]:
+    db = "db{}".format(k)
+    kmc(bin_dir, ["-k{}".format(k), "-ci1"], "reads.fq", db)
+    for cutoffs in [[], ["-ci2", "-cx30"]]:
+        tag = "{}{}".format(db, "".join(cutoffs))
+        kmc_tools(bin_dir, ["transform", db] + cutoffs + ["dump", tag + ".tt",
+                  "dump", "-fbin", tag + ".tb", "dump", "-fcol", tag + ".tc",
+                  "dump", "-gz", tag + ".tt.gz", "dump", "-fbin", "-gz", tag + ".tb.gz", "dump", "-fcol", "-gz", tag + ".tc.gz"])
+        for fmt in ["text", "bin", "col"]:
+            for gz in [[], ["-gz"]]:
+                run([os.path.join(bin_dir, "kmc_dump"), "-t4", "-f" + fmt] + gz + cutoffs + [db, "{}.d{}{}".format(tag, fmt[0], ".gz" if gz else "")])
+
+        text = read_text(tag + ".tt")
+        check(len(text) > 1000 and text == read_text(tag + ".dt"), "text dumps of {} differ".format(tag))
+        if cutoffs:
+            check(all(2 <= c <= 30 for _, c in text), "cutoffs not applied in " + tag)
+        for tool, max_chunk in [("t", 1 << 16), ("d", 1 << 10)]:
+            check(read_binary("{}.{}b".format(tag, tool), k, 0, max_chunk) == text, "binary rows of {}.{} differ from text".format(tag, tool))
+            check(read_binary("{}.{}c".format(tag, tool), k, 1, max_chunk) == text, "columns of {}.{} differ from text".format(tag, tool))
+            for fmt in "tbc":
+                check_gzip("{}.{}{}.gz".format(tag, tool, fmt), "{}.{}{}".format(tag, tool, fmt))
+
+# empty result: header only (and a single empty gzip member for text)
+kmc_tools(bin_dir, ["transform", "db25", "-ci1000000", "dump", "-fbin", "empty.b", "dump", "-gz", "empty.t.gz"])
+check(read_binary("empty.b", 25, 0, 0) == [], "non empty binary dump")
+with open("empty.t.gz", "rb") as f:
+    check(gzip.decompress(f.read()) == b"", "non empty gzip text dump")
+
+print("dump formats test OK")
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+'''
+Test of kmc_dump: output must be byte-identical for any number of threads in all formats (also with gzip), cutoffs
+outside of the range stored in the database must be reported with the same error for any number of threads.
+Database of unsupported version (or with a LUT not matching its version) must be rejected without a crash.
+'''
+
+import os
+import shutil
+import struct
+import subprocess
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+
+genome = random_genome(50000, 1)
+save_reads("reads.fq", genome, 10000, 100, 2)
+for k in [25, 45]:
+    db = "db{}".format(k)
+    kmc(bin_dir, ["-k{}".format(k), "-ci2"], "reads.fq", db)
+    expected = dump(bin_dir, db)
+
+    for cutoffs in [[], ["-ci3", "-cx20"]]:
+        for fmt in ["-ftext", "-fbin", "-fcol"]:
+            for gz in [[], ["-gz"]]:
+                outputs = []
+                for t in [1, 2, 3, 8]:
+                    out = "{}{}{}{}.t{}".format(db, "".join(cutoffs), fmt, "".join(gz), t)
+                    run([os.path.join(bin_dir, "kmc_dump"), "-t{}".format(t), fmt] + gz + cutoffs + [db, out])
+                    outputs.append(out)
+                for out in outputs[1:]:
+                    check(files_equal(out, outputs[0]), "{} differs from {}".format(out, outputs[0]))
+        text = read_dump("{}{}-ftext.t1".format(db, "".join(cutoffs)))
+        if cutoffs:
+            check(text == {kmer: c for kmer, c in expected.items() if 3 <= c <= 20}, "wrong text dump of {} with cutoffs".format(db))
+        else:
+            check(text == expected, "wrong text dump of " + db)
+
+    for cutoffs in [["-ci1"], ["-cx2000000000"], ["-ci10", "-cx5"]]:
+        errors = []
+        for t in [1, 4]:
+            proc = subprocess.run([os.path.join(bin_dir, "kmc_dump"), "-t{}".format(t)] + cutoffs + [db, "wrong.txt"], stdout = subprocess.PIPE, stderr = subprocess.PIPE)
+            check(proc.returncode != 0, "wrong cutoffs {} accepted with -t{}".format(" ".join(cutoffs), t))
+            check(os.path.getsize("wrong.txt") == 0, "output written for wrong cutoffs {} with -t{}".format(" ".join(cutoffs), t))
+            errors.append(proc.stderr)
+        check(errors[0] == errors[1] and errors[0].startswith(b"Error: wrong cutoffs"), "errors of wrong cutoffs {} differ: {}".format(" ".join(cutoffs), errors))
+
+# version word is stored just before the header position at the end of .kmc_pre
+for version in [0x204, 0x201]:
+    bad = "bad{:x}".format(version)
+    shutil.copy("db25.kmc_suf", bad + ".kmc_suf")
+    with open("db25.kmc_pre", "rb") as f:
+        data = bytearray(f.read())
+    struct.pack_into("<I", data, len(data) - 12, version)
+    with open(bad + ".kmc_pre", "wb") as f:
+        f.write(data)
+    for t in [1, 4]:
+        proc = subprocess.run([os.path.join(bin_dir, "kmc_dump"), "-t{}".format(t), bad, bad + ".txt"], stdout = subprocess.PIPE, stderr = subprocess.PIPE)
+        check(proc.returncode == 1, "database of version 0x{:x} with -t{}: exit code {}".format(version, t, proc.returncode))
+
+print("kmc_dump threads test OK")
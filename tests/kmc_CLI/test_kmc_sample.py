@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+'''
+Test of subsampled counting (kmc --sample<scale>): the sampled database must be a subset of the full one with the
+same counters, of size close to 1/scale of it, the same for any number of threads. Histogram estimation (-e) of
+subsampled k-mers must be rejected.
+'''
+
+import os
+import subprocess
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+os.makedirs("tmp", exist_ok = True)
+
+genome = random_genome(100000, 1)
+save_reads("reads.fq", genome, 20000, 100, 2)
+scale = 8
+for k, params in [(9, ["-ci1"]), (25, ["-ci1"]), (25, ["-ci2", "-sm"]), (31, ["-ci2", "--singleton-filter"]), (45, ["-ci1", "-b"])]:
+    params = ["-k{}".format(k)] + params
+    tag = "k{}{}".format(k, "".join(params[1:]))
+    kmc(bin_dir, params, "reads.fq", tag, "tmp")
+    full = dump(bin_dir, tag)
+    kmc(bin_dir, params + ["--sample{}".format(scale)], "reads.fq", tag + ".s", "tmp")
+    sampled = dump(bin_dir, tag + ".s")
+
+    check(all(full.get(kmer) == c for kmer, c in sampled.items()), "sampled k-mers of {} are not a subset of all k-mers with the same counters".format(params))
+    check(len(full) / (2 * scale) < len(sampled) < 2 * len(full) / scale,
+          "wrong size of sample of {}: {} of {} k-mers".format(params, len(sampled), len(full)))
+
+    run([os.path.join(bin_dir, "kmc"), "-hp", "-m2", "-t4"] + params + ["--sample{}".format(scale), "reads.fq", tag + ".t4", "tmp"])
+    check(dump(bin_dir, tag + ".t4") == sampled, "sample of {} depends on the number of threads".format(params))
+
+proc = subprocess.run([os.path.join(bin_dir, "kmc"), "-hp", "-m2", "-k25", "-e", "--sample{}".format(scale), "reads.fq", "est.txt", "tmp"],
+                      stdout = subprocess.PIPE, stderr = subprocess.PIPE)
+check(b"Error: -e can not be used with --sample" in proc.stderr and not os.path.exists("est.txt"), "-e with --sample was not rejected")
+
+print("kmc sample test OK")
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+'''
+Loopback test of kmc_server and kmc_query: counters of k-mers and reads returned by the server must be equal
+to the ones from the database dump, invalid requests must close only their connection.
+'''
+
+import os
+import socket
+import struct
+import subprocess
+import sys
+import time
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+
+k = 25
+genome = random_genome(20000, 1)
+save_reads("reads.fq", genome, 4000, 100, 2)
+kmc(bin_dir, ["-k{}".format(k), "-ci1"], "reads.fq", "db")
+kmers = dump(bin_dir, "db")
+
+comp = {'A': 'T', 'C': 'G', 'G': 'C', 'T': 'A'}
+def canonical(kmer):
+    rev = "".join(comp[c] for c in reversed(kmer))
+    return min(kmer, rev)
+
+socket_path = os.path.abspath("kmc.sock")
+server = subprocess.Popen([os.path.join(bin_dir, "kmc_server"), socket_path, "db"], stderr = subprocess.PIPE)
+try:
+    for _ in range(100):
+        if os.path.exists(socket_path):
+            break
+        time.sleep(0.1)
+    check(os.path.exists(socket_path), "server did not start")
+
+    # invalid requests: 4 GB payload, non-empty payload of info, k-mers of wrong length
+    MAGIC = 0x514D434B
+    for op, payload_size in [(1, 1 << 32), (0, 8), (1, k + 1)]:
+        s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        s.connect(socket_path)
+        s.sendall(struct.pack("=IIIIQQ", MAGIC, op, 0, 0, 1, payload_size))
+        s.settimeout(10)
+        check(s.recv(1) == b"", "invalid request (op {}, payload {}) was accepted".format(op, payload_size))
+        s.close()
+    check(server.poll() is None, "server stopped after invalid requests")
+
+    # k-mers: present ones and some absent ones
+    queries = list(kmers.keys())[::3] + [random_genome(k, seed) for seed in range(100, 200)]
+    with open("kmers.txt", "w") as f:
+        f.write("".join(q + "\n" for q in queries))
+    run([os.path.join(bin_dir, "kmc_query"), socket_path, "kmers.txt", "kmers.res"])
+    with open("kmers.res") as f:
+        res = [line.split() for line in f]
+    check(len(res) == len(queries), "wrong number of results")
+    for q, (kmer, count) in zip(queries, res):
+        check(kmer == q and int(count) == kmers.get(canonical(q), 0), "wrong counter of " + q)
+
+    # reads
+    reads = [genome[i:i + 150] for i in range(0, 10000, 97)]
+    with open("reads.txt", "w") as f:
+        f.write("".join(r + "\n" for r in reads))
+    run([os.path.join(bin_dir, "kmc_query"), "-r", socket_path, "reads.txt", "reads.res"])
+    with open("reads.res") as f:
+        res = [list(map(int, line.split())) for line in f]
+    check(len(res) == len(reads), "wrong number of reads")
+    for read, counters in zip(reads, res):
+        expected = [kmers.get(canonical(read[i:i + k]), 0) for i in range(len(read) - k + 1)]
+        check(counters == expected, "wrong counters of read " + read)
+finally:
+    server.terminate()
+    server.wait()
+
+print("kmc_server test OK")
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+'''
+Test of FracMinHash sketch stored by kmc --sketch<scale>: the sketch is recomputed from the dump of the database
+counted with the same parameters (hash of each k-mer kept if not greater than 2^64/scale) and compared with the
+.sketch file for each kind of output (KMC database, KFF, streamed dump, strict memory mode, small k).
+'''
+
+import os
+import struct
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+os.makedirs("tmp", exist_ok = True)
+
+MASK = (1 << 64) - 1
+
+def mix(x):
+    ''' Finalizer of MurmurHash3 (fmix64). '''
+    x ^= x >> 33
+    x = (x * 0xff51afd7ed558ccd) & MASK
+    x ^= x >> 33
+    x = (x * 0xc4ceb9fe1a85ec53) & MASK
+    x ^= x >> 33
+    return x
+
+def kmer_hash(kmer):
+    ''' fmix64 chained over 64-bit words of the k-mer (2 bits per symbol), the least significant word first. '''
+    x = 0
+    for c in kmer:
+        x = 4 * x + "ACGT".index(c)
+    words = [(x >> (64 * i)) & MASK for i in range((len(kmer) + 31) // 32)]
+    h = mix(words[0])
+    for w in words[1:]:
+        h = mix(h ^ w)
+    return h
+
+def read_sketch(file_name):
+    ''' Return header fields and list of (hash, counter) of a sketch file. '''
+    with open(file_name, "rb") as f:
+        data = f.read()
+    magic, version, kmer_len, canonical, counter_bytes, scale, n = struct.unpack_from("<4s4I2Q", data, 0)
+    check(magic == b"KMSK" and version == 1, "wrong header of " + file_name)
+    rec_bytes = 8 + counter_bytes
+    check(len(data) == 36 + n * rec_bytes, "wrong size of " + file_name)
+    records = []
+    for pos in range(36, len(data), rec_bytes):
+        records.append((struct.unpack_from("<Q", data, pos)[0], int.from_bytes(data[pos + 8:pos + rec_bytes], "little")))
+    return (kmer_len, canonical, scale), records
+
+genome = random_genome(50000, 1)
+save_reads("reads.fq", genome, 10000, 100, 2)
+scale = 20
+for k, params in [(7, []), (11, []), (25, []), (25, ["-b"]), (40, ["-ci1", "-cs100"]), (70, [])]:
+    params = ["-k{}".format(k)] + params
+    tag = "k{}{}".format(k, "".join(params[1:]))
+    kmc(bin_dir, params, "reads.fq", tag, "tmp")
+    max_hash = MASK // scale
+    expected = sorted((h, c) for h, c in ((kmer_hash(kmer), c) for kmer, c in dump(bin_dir, tag).items()) if h <= max_hash)
+    check(len(expected) > 0, "empty expected sketch for {}".format(params))
+
+    for mode, out in [([], tag + ".s"), (["-okff"], tag + ".kff"), (["-otxt"], tag + ".txt"), (["-sm"], tag + ".sm")]:
+        kmc(bin_dir, params + mode + ["--sketch{}".format(scale)], "reads.fq", out, "tmp")
+        header, records = read_sketch(out + ".sketch")
+        check(header == (k, 0 if "-b" in params else 1, scale), "wrong header of sketch for {} {}".format(params, mode))
+        check(records == expected, "sketch for {} {} differs from the one of dump".format(params, mode))
+
+print("kmc sketch test OK")
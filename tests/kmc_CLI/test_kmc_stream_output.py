@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+'''
+Test of output streamed by kmc instead of a database (-otxt, -obin, -ohist): text and binary dumps must contain
+the same k-mers and counters as kmc_dump of the database counted with the same parameters, histogram must be
+equal to the one of kmc_tools transform histogram of this database (line by line, every value up to the cutoff).
+'''
+
+import os
+import struct
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+os.makedirs("tmp", exist_ok = True)
+
+def read_binary(file_name, k):
+    ''' Return dict: k-mer -> counter of a binary dump (rows layout). '''
+    with open(file_name, "rb") as f:
+        data = f.read()
+    check(data[:4] == b"KMCD", "wrong magic of " + file_name)
+    version, kmer_len, encoding, kmer_bytes, counter_bytes, layout = struct.unpack_from("<6I", data, 4)
+    check(version == 1 and kmer_len == k and kmer_bytes == (k + 3) // 4 and layout == 0, "wrong header of " + file_name)
+    symbols = {(encoding >> (6 - 2 * i)) & 3: c for i, c in enumerate("ACGT")}
+    rec_bytes = kmer_bytes + counter_bytes
+    check((len(data) - 28) % rec_bytes == 0, "wrong size of " + file_name)
+    res = {}
+    for pos in range(28, len(data), rec_bytes):
+        x = int.from_bytes(data[pos:pos + kmer_bytes], "big")
+        kmer = "".join(symbols[(x >> (2 * (k - 1 - i))) & 3] for i in range(k))
+        check(kmer not in res, "duplicated k-mer in " + file_name)
+        res[kmer] = int.from_bytes(data[pos + kmer_bytes:pos + rec_bytes], "little")
+    return res
+
+genome = random_genome(40000, 1)
+save_reads("reads.fq", genome, 8000, 100, 2)
+cases = [(7, []), (25, []), (25, ["-sm"]), (31, ["-ci1", "-cx50"]), (40, ["-cs100"]), (28, ["-cs1000", "-sm"])]
+for i, (k, params) in enumerate(cases):
+    params = ["-k{}".format(k)] + params
+    tag = "c{}".format(i)
+    kmc(bin_dir, params, "reads.fq", tag, "tmp")
+    run([os.path.join(bin_dir, "kmc_dump"), tag, tag + ".ref"])
+    expected = read_dump(tag + ".ref")
+    check(len(expected) > 0, "empty database of case {}".format(params))
+    kmc_tools(bin_dir, ["transform", tag, "histogram", tag + ".ref.hist"])
+
+    kmc(bin_dir, params + ["-otxt"], "reads.fq", tag + ".txt", "tmp")
+    check(read_dump(tag + ".txt") == expected, "-otxt differs from kmc_dump for {}".format(params))
+    stdout = run([os.path.join(bin_dir, "kmc"), "-hp", "-m2", "-t2", "-otxt"] + params + ["reads.fq", "-", "tmp"])
+    check(sorted(stdout.decode().splitlines()) == sorted(open(tag + ".txt").read().splitlines()), "-otxt to stdout differs for {}".format(params))
+
+    kmc(bin_dir, params + ["-obin"], "reads.fq", tag + ".bin", "tmp")
+    check(read_binary(tag + ".bin", k) == expected, "-obin differs from kmc_dump for {}".format(params))
+
+    kmc(bin_dir, params + ["-ohist"], "reads.fq", tag + ".hist", "tmp")
+    check(files_equal(tag + ".hist", tag + ".ref.hist"), "-ohist differs from kmc_tools histogram for {}".format(params))
+
+print("kmc stream output test OK")
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+'''
+Test of kmc_tools distance on a fixture with known values: samples are built of records with disjoint sets of k-mers,
+so Jaccard, containment and Mash distances follow from the numbers of shared records. Jaccard of FracMinHash (-s<scale>)
+is compared with the one of the sketches stored by kmc --sketch<scale> for the same samples.
+'''
+
+import math
+import struct
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+
+k = 31
+n_kmers = 70 # per record
+records = [random_genome(n_kmers + k - 1, seed) for seed in range(1, 5)]
+samples = {"a": [0, 1], "b": [1, 2], "c": [0], "d": [0, 1], "e": [3]}
+for name, ids in samples.items():
+    with open(name + ".fa", "w") as f:
+        f.write("".join(">r{}\n{}\n".format(i, records[i]) for i in ids))
+    kmc(bin_dir, ["-k{}".format(k), "-ci1", "-fm"], name + ".fa", name)
+names = sorted(samples)
+kmc_tools(bin_dir, ["distance", "dist"] + names)
+
+def read_matrix(file_name):
+    with open(file_name) as f:
+        lines = [line.rstrip("\n").split("\t") for line in f]
+    check(lines[0] == ["#"] + names and [line[0] for line in lines[1:]] == names, "wrong labels in " + file_name)
+    return [line[1:] for line in lines[1:]]
+
+jaccard = read_matrix("dist.jaccard")
+containment = read_matrix("dist.containment")
+mash = read_matrix("dist.mash")
+for i, x in enumerate(names):
+    for j, y in enumerate(names):
+        a, b = set(samples[x]), set(samples[y])
+        J = len(a & b) / len(a | b)
+        C = len(a & b) / len(a)
+        M = 1.0 if J == 0 else -math.log(2 * J / (1 + J)) / k
+        check(abs(float(jaccard[i][j]) - J) < 1e-5, "Jaccard of {} and {} is {}, expected {}".format(x, y, jaccard[i][j], J))
+        check(abs(float(containment[i][j]) - C) < 1e-5, "containment of {} in {} is {}, expected {}".format(x, y, containment[i][j], C))
+        check(abs(float(mash[i][j]) - M) < 1e-5, "Mash distance of {} and {} is {}, expected {}".format(x, y, mash[i][j], M))
+        if J == 1:
+            check(jaccard[i][j] == "1" and containment[i][j] == "1" and mash[i][j] == "0",
+                  "identical samples {} and {}: {} {} {}".format(x, y, jaccard[i][j], containment[i][j], mash[i][j]))
+
+# known values: a and b share 1 of 3 records, c is contained in a
+check(jaccard[0][1] == "0.333333" and containment[0][1] == "0.5" and containment[2][0] == "1" and containment[0][2] == "0.5",
+      "unexpected values of the fixture")
+
+def read_sketch_hashes(file_name):
+    ''' Return set of hashes of a sketch file. '''
+    with open(file_name, "rb") as f:
+        data = f.read()
+    magic, version, kmer_len, canonical, counter_bytes, scale, n = struct.unpack_from("<4s4I2Q", data, 0)
+    check(magic == b"KMSK" and len(data) == 36 + n * (8 + counter_bytes), "wrong sketch file " + file_name)
+    return set(struct.unpack_from("<Q", data, 36 + i * (8 + counter_bytes))[0] for i in range(n))
+
+# FracMinHash: overlapping parts of a genome, k-mers of hash at most 2^64/scale are used by both tools
+scale = 10
+genome = random_genome(60000, 5)
+for name, part in [("x", genome[:40000]), ("y", genome[20000:])]:
+    with open(name + ".fa", "w") as f:
+        f.write(">{}\n{}\n".format(name, part))
+for k in [27, 45]:
+    for name in ["x", "y"]:
+        kmc(bin_dir, ["-k{}".format(k), "-ci1", "-fm", "--sketch{}".format(scale)], name + ".fa", "{}{}".format(name, k))
+    kmc_tools(bin_dir, ["distance", "-s{}".format(scale), "sdist{}".format(k), "x{}".format(k), "y{}".format(k)])
+    x, y = read_sketch_hashes("x{}.sketch".format(k)), read_sketch_hashes("y{}.sketch".format(k))
+    check(len(x) > 1000 and len(y) > 1000, "too small sketches for k = {}".format(k))
+    J = len(x & y) / len(x | y)
+    with open("sdist{}.jaccard".format(k)) as f:
+        value = float(f.read().splitlines()[1].split("\t")[2])
+    check(abs(value - J) < 1e-5, "FracMinHash Jaccard for k = {} is {}, expected {} from sketches".format(k, value, J))
+
+print("kmc_tools distance test OK")
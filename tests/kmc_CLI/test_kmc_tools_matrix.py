@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+'''
+Test of kmc_tools matrix: the matrix file is parsed and compared with per-sample dumps, single k-mers are looked up
+with kmc_tools matrix_check (block index) and compared with the dumps as well.
+'''
+
+import random
+import struct
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+
+k = 31
+genome = random_genome(20000, 1)
+save_reads("s0.fq", genome, 3000, 100, 2)
+save_reads("s1.fq", genome[5000:], 3000, 100, 3)
+save_reads("s2.fq", genome[:12000], 2000, 100, 4)
+save_reads("s3.fq", random_genome(3000, 5) + genome[8000:10000], 1000, 100, 6)
+samples = ["s0", "s1", "s2", "s3"]
+for s in samples:
+    kmc(bin_dir, ["-k{}".format(k), "-ci1"], s + ".fq", s)
+dumps = [dump(bin_dir, s) for s in samples]
+dumps[1] = {kmer: count for kmer, count in dumps[1].items() if count >= 2} # -ci2 below
+
+def parse_matrix(file_name):
+    ''' Return dict: k-mer -> list of values of samples of a matrix file. '''
+    with open(file_name, "rb") as f:
+        data = f.read()
+    check(data[:4] == b"KMCM" and data[-4:] == b"KMCM", "wrong magic of " + file_name)
+    version, kmer_len, encoding, n_samples, counter_bytes, kmer_bytes, row_bytes, block_size = struct.unpack_from("<8I", data, 4)
+    check(version == 1 and kmer_len == k and n_samples == len(samples), "wrong header of " + file_name)
+    pos = 36
+    for s in samples:
+        path_len = struct.unpack_from("<I", data, pos)[0]
+        check(data[pos + 4:pos + 4 + path_len].decode() == s, "wrong path of sample in " + file_name)
+        pos += 4 + path_len
+    n_blocks, n_kmers, index_pos = struct.unpack_from("<3Q", data, len(data) - 28)
+    symbols = {(encoding >> (6 - 2 * i)) & 3: c for i, c in enumerate("ACGT")}
+    res = {}
+    prev = None
+    for b in range(n_blocks):
+        rec = index_pos + b * (kmer_bytes + 16)
+        first = data[rec:rec + kmer_bytes]
+        offset, block_n_kmers = struct.unpack_from("<2Q", data, rec + kmer_bytes)
+        check(offset == pos and 0 < block_n_kmers <= block_size and (block_n_kmers == block_size or b + 1 == n_blocks), "wrong block index of " + file_name)
+        check(data[offset:offset + kmer_bytes] == first, "wrong first k-mer of block in index of " + file_name)
+        rows = offset + block_n_kmers * kmer_bytes
+        for i in range(block_n_kmers):
+            kmer_data = data[offset + i * kmer_bytes:offset + (i + 1) * kmer_bytes]
+            check(prev is None or prev < kmer_data, "k-mers are not sorted in " + file_name)
+            prev = kmer_data
+            x = int.from_bytes(kmer_data, "big")
+            kmer = "".join(symbols[(x >> (2 * (kmer_len - 1 - j))) & 3] for j in range(kmer_len))
+            row = data[rows + i * row_bytes:rows + (i + 1) * row_bytes]
+            if counter_bytes:
+                res[kmer] = [int.from_bytes(row[s * counter_bytes:(s + 1) * counter_bytes], "little") for s in range(n_samples)]
+            else:
+                res[kmer] = [(row[s >> 3] >> (s & 7)) & 1 for s in range(n_samples)]
+        pos = rows + block_n_kmers * row_bytes
+    check(pos == index_pos and len(res) == n_kmers, "wrong layout of " + file_name)
+    return res
+
+def expected_matrix(min_samples, max_samples, counter_bytes):
+    res = {}
+    for kmer in set().union(*dumps):
+        row = [d.get(kmer, 0) for d in dumps]
+        n_present = sum(1 for x in row if x)
+        if min_samples <= n_present <= max_samples:
+            if counter_bytes:
+                res[kmer] = [min(x, (1 << (8 * counter_bytes)) - 1) for x in row]
+            else:
+                res[kmer] = [1 if x else 0 for x in row]
+    return res
+
+inputs = ["s0", "s1", "-ci2", "s2", "s3"]
+configs = [("p", [], 1, 4, 0),
+           ("p2", ["-sm2", "-b100"], 2, 4, 0),
+           ("c", ["-c", "-sx3", "-b1000"], 1, 3, 4),
+           ("c1", ["-cb1", "-sm2", "-sx2", "-b7"], 2, 2, 1)]
+for name, params, min_samples, max_samples, counter_bytes in configs:
+    kmc_tools(bin_dir, ["matrix"] + params + [name + ".mat"] + inputs)
+    matrix = parse_matrix(name + ".mat")
+    expected = expected_matrix(min_samples, max_samples, counter_bytes)
+    check(len(expected) > 0 and matrix == expected, "matrix {} differs from dumps".format(name))
+
+    # lookups: first and last k-mers, random present ones and absent ones
+    kmers = sorted(matrix.keys())
+    rnd = random.Random(len(name))
+    queries = kmers[:2] + kmers[-2:] + rnd.sample(kmers, 20) + [random_genome(k, seed) for seed in range(100, 110)]
+    absent = sorted(kmer for kmer in set().union(*dumps) if kmer not in matrix)
+    queries += rnd.sample(absent, min(10, len(absent)))
+    for q in queries:
+        res = list(map(int, kmc_tools(bin_dir, ["matrix_check", name + ".mat", q]).split()))
+        check(res == matrix.get(q, [0] * len(samples)), "matrix_check of {} in {} returned {}".format(q, name, res))
+
+kmc_tools(bin_dir, ["matrix_check", "p.mat", "ACGT"], expected_rc = 1)
+kmc_tools(bin_dir, ["matrix_check", "s0.kmc_pre", "A" * k], expected_rc = 1)
+
+print("kmc_tools matrix test OK")
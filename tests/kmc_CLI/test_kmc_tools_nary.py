@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+'''
+Test of n-ary operations of kmc_tools complex mode (union, intersect, atleast): results must be equal to chains of
+binary operations (or to the sets computed from dumps for atleast), invalid numbers of arguments must be rejected.
+'''
+
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+
+genome = random_genome(30000, 1)
+save_reads("a.fq", genome, 5000, 100, 2)
+save_reads("b.fq", genome[5000:], 4000, 100, 3)
+save_reads("c.fq", genome[:20000], 3000, 100, 4)
+save_reads("d.fq", random_genome(5000, 5) + genome[10000:15000], 2000, 100, 6)
+
+k = 25
+names = ["a", "b", "c", "d"]
+for name in names:
+    kmc(bin_dir, ["-k{}".format(k), "-ci1"], name + ".fq", name)
+dumps = [dump(bin_dir, name) for name in names]
+
+def complex_op(out, expression, params = []):
+    with open(out + ".txt", "w") as f:
+        f.write("INPUT:\nA = a\nB = b\nC = c -ci2\nD = d\nOUTPUT:\n{} = {}\n".format(out, expression))
+    kmc_tools(bin_dir, ["-t4"] + params + ["complex", out + ".txt"])
+    return dump(bin_dir, out)
+
+# n-ary operations vs chains of binary operations
+pairs = [("union(A, B, C, D)", "A + B + C + D"),
+         ("union max(A, B, C)", "A + max B + max C"),
+         ("intersect(A, B, C)", "A * B * C"),
+         ("intersect sum(A, B, C, D)", "A * sum B * sum C * sum D"),
+         ("union(A * B, C) - intersect max(B, D)", "(A * B + C) - (B * max D)")]
+for i, (nary, binary) in enumerate(pairs):
+    res = complex_op("n{}".format(i), nary)
+    check(len(res) > 0, "empty result of " + nary)
+    check(res == complex_op("b{}".format(i), binary), "{} differs from {}".format(nary, binary))
+    check(res == complex_op("n{}p".format(i), nary, ["-p5"]), "{} differs for -p5".format(nary))
+
+# atleast vs sets computed from dumps (C has cutoff 2)
+dumps[2] = {kmer: count for kmer, count in dumps[2].items() if count >= 2}
+for min_inputs, mode, aggregate in [(2, "", sum), (3, " min", min), (4, " max", max), (1, "", sum)]:
+    res = complex_op("l{}".format(min_inputs), "atleast{}({}, A, B, C, D)".format(mode, min_inputs))
+    expected = {}
+    for kmer in set().union(*dumps):
+        counts = [d[kmer] for d in dumps if kmer in d]
+        if len(counts) >= min_inputs:
+            expected[kmer] = aggregate(counts)
+    check(len(expected) > 0 and res == expected, "wrong result of atleast{}({}, ...)".format(mode, min_inputs))
+
+# invalid numbers of arguments
+for expression in ["atleast(3, A, B)", "atleast(0, A, B)", "union(A)", "intersect(A)", "atleast(1, A)"]:
+    with open("invalid.txt", "w") as f:
+        f.write("INPUT:\nA = a\nB = b\nOUTPUT:\nX = {}\n".format(expression))
+    kmc_tools(bin_dir, ["complex", "invalid.txt"], expected_rc = 1)
+
+print("kmc_tools n-ary operations test OK")
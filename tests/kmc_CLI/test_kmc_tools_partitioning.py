@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+'''
+Test of range partitioning (-p) of kmc_tools: results of simple operations (KMC and KFF output) and complex
+operations must be byte-identical for any number of ranges.
+'''
+
+import glob
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+
+genome = random_genome(30000, 1)
+save_reads("a.fq", genome, 6000, 100, 2)
+save_reads("b.fq", genome[10000:], 4000, 100, 3)
+
+for k in [25, 55]:
+    kmc(bin_dir, ["-k{}".format(k), "-ci1"], "a.fq", "a")
+    kmc(bin_dir, ["-k{}".format(k), "-ci1"], "b.fq", "b")
+
+    outputs = ["i", "u", "s", "c", "rs", "uk"]
+    for p in [1, 3, 8, 64]:
+        kmc_tools(bin_dir, ["-t4", "-p{}".format(p), "simple", "a", "b",
+                            "intersect", "i{}".format(p), "-ocmax",
+                            "union", "u{}".format(p),
+                            "kmers_subtract", "s{}".format(p),
+                            "counters_subtract", "c{}".format(p),
+                            "reverse_kmers_subtract", "rs{}".format(p), "-ci2",
+                            "union", "uk{}".format(p), "-okff"])
+        with open("complex.txt", "w") as f:
+            f.write("INPUT:\nA = a\nB = b -ci2\nC = u1\nOUTPUT:\nR{} = (A + B) * C - B\n".format(p))
+        kmc_tools(bin_dir, ["-t4", "-p{}".format(p), "complex", "complex.txt"])
+
+    for p in [3, 8, 64]:
+        for o in outputs + ["R"]:
+            if o == "uk":
+                check(files_equal("uk{}.kff".format(p), "uk1.kff"), "k{}: KFF output of -p{} differs".format(k, p))
+                continue
+            for ext in [".kmc_pre", ".kmc_suf"]:
+                check(files_equal("{}{}{}".format(o, p, ext), "{}1{}".format(o, ext)),
+                      "k{}: {} of -p{} differs from -p1 ({})".format(k, o, p, ext))
+    check(len(dump(bin_dir, "u1")) > 0 and len(dump(bin_dir, "R1")) > 0, "k{}: empty results".format(k))
+    check(not glob.glob("*.part*"), "temporary files of ranges were not removed")
+
+print("kmc_tools partitioning test OK")
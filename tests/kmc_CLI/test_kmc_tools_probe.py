@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+'''
+Test of operations on inputs of skewed sizes, where the large database is probed for k-mers of the small one instead
+of being read: results of intersect, kmers_subtract and counters_subtract (simple and complex mode) must be equal to
+the ones computed from dumps for any cutoffs of the large input, including ones outside of the range stored in it.
+'''
+
+import os
+import subprocess
+from cli_test_utils import *
+
+bin_dir = parse_args()
+work_dir()
+
+k = 25
+genome = random_genome(100000, 1)
+save_reads("large.fq", genome, 20000, 100, 2, error_rate = 0.02)
+# small input (less than 1/256 of the large one): part of the genome and k-mers absent in the large input
+save_reads("small.fq", genome[1000:1125] + random_genome(125, 3), 80, 100, 4, error_rate = 0)
+kmc(bin_dir, ["-k{}".format(k), "-ci2"], "large.fq", "large")
+kmc(bin_dir, ["-k{}".format(k), "-ci1"], "small.fq", "small")
+large = dump(bin_dir, "large")
+small = dump(bin_dir, "small")
+
+def probed(params):
+    ''' Run kmc_tools in verbose mode and return True if any input was probed. '''
+    proc = subprocess.run([os.path.join(bin_dir, "kmc_tools"), "-hp", "-v"] + params, stdout = subprocess.PIPE, stderr = subprocess.PIPE)
+    check(proc.returncode == 0, "kmc_tools {} failed: {}".format(" ".join(params), proc.stderr.decode()))
+    return b"is probed" in proc.stderr
+
+def expected(op, large_ci, large_cx):
+    l = {kmer: c for kmer, c in large.items() if large_ci <= c <= large_cx}
+    if op == "intersect":
+        return {kmer: min(c, l[kmer]) for kmer, c in small.items() if kmer in l}
+    if op == "kmers_subtract":
+        return {kmer: c for kmer, c in small.items() if kmer not in l}
+    res = {kmer: c - l.get(kmer, 0) for kmer, c in small.items()}
+    return {kmer: c for kmer, c in res.items() if c > 0}
+
+ops = ["intersect", "kmers_subtract", "counters_subtract"]
+complex_ops = {"intersect": "*", "kmers_subtract": "-", "counters_subtract": "~"}
+for large_params, large_ci, large_cx in [([], 2, 10 ** 9), (["-ci1"], 1, 10 ** 9), (["-cx2000000000"], 2, 2 * 10 ** 9),
+                                         (["-ci1", "-cx2000000000"], 1, 2 * 10 ** 9), (["-ci3", "-cx16"], 3, 16)]:
+    tag = "".join(large_params)
+    params = ["simple", "small", "large"] + large_params
+    for op in ops:
+        params += [op, op + tag, "-ci1", "-cx2000000000"]
+    check(probed(params), "large input was not probed ({})".format(tag))
+
+    for op in ops:
+        with open("complex.txt", "w") as f:
+            f.write("INPUT:\nS = small\nL = large {}\nOUTPUT:\n".format(" ".join(large_params)))
+            f.write("c{}{} = S {} L\nOUTPUT_PARAMS:\n-ci1 -cx2000000000\n".format(op, tag, complex_ops[op]))
+        kmc_tools(bin_dir, ["complex", "complex.txt"])
+
+    for op in ops:
+        exp = expected(op, large_ci, large_cx)
+        check(len(exp) > 0, "empty expected result of {} {}".format(op, tag))
+        check(dump(bin_dir, op + tag) == exp, "wrong result of {} {}".format(op, tag))
+        check(dump(bin_dir, "c" + op + tag) == exp, "wrong result of complex {} {}".format(op, tag))
+
+# the small input second: only intersection is driven by the small input
+kmc_tools(bin_dir, ["simple", "large", "-ci1", "small", "intersect", "ri", "-ci1"])
+check(dump(bin_dir, "ri") == expected("intersect", 1, 10 ** 9), "wrong result of intersect with the large input first")
+
+print("kmc_tools probe test OK")
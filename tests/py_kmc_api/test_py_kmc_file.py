@@ -111,7 +111,7 @@ def _generate_not_existing_kmers(kmers, kmer_len):
                 absent_kmers.append(inc_kmer)
     return absent_kmers
 
-def _run_kmc(cutoff_min, kmer_len, memory, sig_len, reads_src):
+def _run_kmc(cutoff_min, kmer_len, memory, sig_len, reads_src, db_name = 'kmc_db', extra_params = ()):
     ''' Runs kmc. '''
     if init_sys_path.is_linux() or init_sys_path.is_mac():
         kmc_path = os.path.join(os.path.dirname(__file__), '../../bin/kmc')
@@ -125,9 +125,10 @@ def _run_kmc(cutoff_min, kmer_len, memory, sig_len, reads_src):
                      '-ci{}'.format(cutoff_min),
                      '-k{}'.format(kmer_len),
                      '-m{}'.format(memory),
-                     '-p{}'.format(sig_len),
-                     reads_src,
-                     'kmc_db',
+                     '-p{}'.format(sig_len)] +
+                    list(extra_params) +
+                    [reads_src,
+                     db_name,
                      '.'
                     ])
     
@@ -138,10 +139,13 @@ def _open_for_listing():
     assert kmc_file.OpenForListing('kmc_db')
     return kmc_file
 
-def _open_for_ra():
+def _open_for_ra(mode = None):
     ''' Open kmc database for random access and check if opened sucessfully. '''
     kmc_file = pka.KMCFile()
-    assert kmc_file.OpenForRA('kmc_db')
+    if mode is None:
+        assert kmc_file.OpenForRA('kmc_db')
+    else:
+        assert kmc_file.OpenForRA('kmc_db', mode)
     return kmc_file
 
 def test_info(create_kmc_db):
@@ -171,6 +175,72 @@ def test_kmc_file_next_kmer(create_kmc_db):
         res[str(kmer)] = counter.value
     assert res == pattern
 
+def test_kmc_file_next_kmer_parts(create_kmc_db):
+    '''
+    Test if parts of a database opened for listing are disjoint
+    and together contain all counted k-mers in the order of the whole database.
+    '''
+    kmer = pka.KmerAPI(create_kmc_db['kmer_len'])
+    counter = pka.Count()
+    kmc_file = _open_for_listing()
+    whole = []
+    while kmc_file.ReadNextKmer(kmer, counter):
+        whole.append((str(kmer), counter.value))
+    for n_parts in [1, 2, 3, 8]:
+        parts = []
+        for part_id in range(n_parts):
+            kmc_file = pka.KMCFile()
+            assert kmc_file.OpenForListing('kmc_db', part_id, n_parts)
+            part = []
+            while kmc_file.ReadNextKmer(kmer, counter):
+                part.append((str(kmer), counter.value))
+            assert kmc_file.KmerCount() == len(part)
+            parts += part
+        assert parts == whole
+    assert not pka.KMCFile().OpenForListing('kmc_db', 2, 2)
+
+def test_kmc_file_next_kmers(create_kmc_db):
+    '''
+    Test if ReadNextKmers fills NumPy arrays with the same k-mers
+    (in to_long representation) and counters as ReadNextKmer.
+    '''
+    np = pytest.importorskip('numpy')
+    kmer_len = create_kmc_db['kmer_len']
+    n_words = (kmer_len + 31) // 32
+    kmc_file = _open_for_listing()
+    counter = pka.Count()
+    kmer = pka.KmerAPI(kmer_len)
+    long_kmer = pka.LongKmerRepresentation()
+    expected = []
+    while kmc_file.ReadNextKmer(kmer, counter):
+        kmer.to_long(long_kmer)
+        expected.append((list(long_kmer.value), counter.value))
+
+    kmc_file = _open_for_listing()
+    kmers = np.zeros((3, n_words), dtype=np.uint64)
+    counts = np.zeros(3, dtype=np.uint64)
+    res = []
+    while True:
+        n = kmc_file.ReadNextKmers(kmers, counts)
+        if n == 0:
+            break
+        res += [(list(kmers[i]), counts[i]) for i in range(n)]
+    assert res == expected
+
+def test_get_counters_for_reads(create_kmc_db):
+    ''' Test if GetCountersForReads gives the same counters as GetCountersForRead. '''
+    pytest.importorskip('numpy')
+    kmer_len = create_kmc_db['kmer_len']
+    reads = ["GGCATTGCATGCAGTNNCAGTCATGCAGTCAGGCAGTCATGGCATGCGTAAACGACGATCAGTCATGGTCGAG",
+             "A" * (kmer_len - 1)] + list(create_kmc_db['kmers'].keys())
+    kmc_file = _open_for_ra()
+    counters, offsets = kmc_file.GetCountersForReads(reads)
+    assert len(offsets) == len(reads) + 1
+    for i, read in enumerate(reads):
+        res = pka.CountVec()
+        kmc_file.GetCountersForRead(read, res)
+        assert list(counters[offsets[i]:offsets[i + 1]]) == res.value
+
 def test_get_counters_for_read(create_kmc_db):
     ''' Test case for GetCountersForRead method of KMCFile. '''
     kmers = create_kmc_db['kmers']
@@ -216,3 +286,220 @@ def test_check_kmer(create_kmc_db):
     for kmer_str in absent_kmers:
         kmer.from_string(kmer_str)
         assert not kmc_file.CheckKmer(kmer, counter)
+
+def test_check_kmers(create_kmc_db):
+    '''
+    Test case for CheckKmers method.
+
+    Check if batched lookups give the same counters as single ones,
+    absent k-mers should have counter 0.
+    '''
+    kmers = create_kmc_db['kmers']
+    kmer_len = create_kmc_db['kmer_len']
+    absent_kmers = create_kmc_db['absent_kmers']
+    kmc_file = _open_for_ra()
+    queries = []
+    for kmer_str in list(kmers.keys()) + list(absent_kmers):
+        kmer = pka.KmerAPI(kmer_len)
+        kmer.from_string(kmer_str)
+        queries.append(kmer)
+    counts = kmc_file.CheckKmers(queries)
+    assert counts == list(kmers.values()) + [0] * len(absent_kmers)
+
+def test_check_kmers_empty_db(create_kmc_db):
+    '''
+    Test case for CheckKmers method on an empty database (all k-mers below the cutoff).
+
+    All k-mers should be absent.
+    '''
+    kmers = create_kmc_db['kmers']
+    kmer_len = create_kmc_db['kmer_len']
+    _run_kmc(100000, kmer_len, 2, create_kmc_db['sig_len'], 'input.fastq', 'kmc_db_empty')
+    try:
+        kmc_file = pka.KMCFile()
+        assert kmc_file.OpenForRA('kmc_db_empty')
+        assert kmc_file.Info().total_kmers == 0
+        queries = []
+        for kmer_str in list(kmers.keys()) + list(create_kmc_db['absent_kmers']):
+            kmer = pka.KmerAPI(kmer_len)
+            kmer.from_string(kmer_str)
+            queries.append(kmer)
+        assert kmc_file.CheckKmers(queries) == [0] * len(queries)
+        assert kmc_file.CheckKmers([]) == []
+        assert kmc_file.Close()
+    finally:
+        os.remove('kmc_db_empty.kmc_pre')
+        os.remove('kmc_db_empty.kmc_suf')
+
+def test_check_kmer_with_index(create_kmc_db):
+    '''
+    Test case for CheckKmer and GetCountersForRead methods
+    when the database has a secondary index.
+    '''
+    kmers = create_kmc_db['kmers']
+    kmer_len = create_kmc_db['kmer_len']
+    kmer = pka.KmerAPI(kmer_len)
+    counter = pka.Count()
+    assert pka.KMCFile.BuildIndex('kmc_db', 2)
+    try:
+        kmc_file = _open_for_ra()
+        assert kmc_file.HasIndex()
+        for kmer_str, count in kmers.items():
+            kmer.from_string(kmer_str)
+            assert kmc_file.CheckKmer(kmer, counter)
+            assert counter.value == count
+        for kmer_str in create_kmc_db['absent_kmers']:
+            kmer.from_string(kmer_str)
+            assert not kmc_file.CheckKmer(kmer, counter)
+        for kmer_str in kmers.keys():
+            res = pka.CountVec()
+            assert kmc_file.GetCountersForRead(kmer_str, res)
+            assert res.value == [kmers[kmer_str]]
+        assert kmc_file.Close()
+    finally:
+        os.remove('kmc_db.kmc_idx')
+
+def test_stale_index(create_kmc_db):
+    '''
+    Test case for an index of a different database with the same number of k-mers.
+
+    Such index must not be used.
+    '''
+    kmer_len = create_kmc_db['kmer_len']
+    complement = {'A': 'T', 'C': 'G', 'G': 'C', 'T': 'A', 'N': 'N'}
+    reads = []
+    with open('input.fastq') as f:
+        for i, line in enumerate(f):
+            if i % 4 == 1:
+                reads.append(''.join(complement[c] for c in reversed(line.strip())))
+    _save_reads_as_fastq(reads, 'input_rc.fastq')
+    kmers_rc = {}
+    for read in reads:
+        for start in range(0, len(read) - kmer_len + 1):
+            kmer_str = read[start:start+kmer_len]
+            if 'N' not in kmer_str:
+                kmers_rc[kmer_str] = kmers_rc.get(kmer_str, 0) + 1
+    _run_kmc(1, kmer_len, 2, create_kmc_db['sig_len'], 'input.fastq', 'kmc_db_fwd', ['-b'])
+    _run_kmc(1, kmer_len, 2, create_kmc_db['sig_len'], 'input_rc.fastq', 'kmc_db_rc', ['-b'])
+    try:
+        assert pka.KMCFile.BuildIndex('kmc_db_fwd', 2)
+        os.replace('kmc_db_fwd.kmc_idx', 'kmc_db_rc.kmc_idx')
+        kmc_file = pka.KMCFile()
+        assert kmc_file.OpenForRA('kmc_db_rc')
+        assert kmc_file.Info().total_kmers == len(kmers_rc)
+        assert not kmc_file.HasIndex()
+        kmer = pka.KmerAPI(kmer_len)
+        counter = pka.Count()
+        for kmer_str, count in kmers_rc.items():
+            kmer.from_string(kmer_str)
+            assert kmc_file.CheckKmer(kmer, counter)
+            assert counter.value == count
+        assert kmc_file.Close()
+    finally:
+        for name in ['input_rc.fastq', 'kmc_db_rc.kmc_idx']:
+            if os.path.exists(name):
+                os.remove(name)
+        for db in ['kmc_db_fwd', 'kmc_db_rc']:
+            os.remove(db + '.kmc_pre')
+            os.remove(db + '.kmc_suf')
+
+def test_check_kmer_mmap(create_kmc_db):
+    '''
+    Test case for CheckKmer and GetCountersForRead methods
+    when the database is memory mapped.
+    '''
+    kmers = create_kmc_db['kmers']
+    kmer_len = create_kmc_db['kmer_len']
+    kmer = pka.KmerAPI(kmer_len)
+    counter = pka.Count()
+    for mode in [pka.KMCFile.RAMode.mmap, pka.KMCFile.RAMode.mmap_populate]:
+        kmc_file = _open_for_ra(mode)
+        for kmer_str, count in kmers.items():
+            kmer.from_string(kmer_str)
+            assert kmc_file.CheckKmer(kmer, counter)
+            assert counter.value == count
+        absent_kmers = create_kmc_db['absent_kmers']
+        for kmer_str in absent_kmers:
+            kmer.from_string(kmer_str)
+            assert not kmc_file.CheckKmer(kmer, counter)
+        for kmer_str in kmers.keys():
+            res = pka.CountVec()
+            assert kmc_file.GetCountersForRead(kmer_str, res)
+            assert res.value == [kmers[kmer_str]]
+        assert kmc_file.Close()
+
+def test_kmc_query(create_kmc_db):
+    '''
+    Test case for KMCQuery handles.
+
+    Handles share a single database and have their own counter thresholds.
+    '''
+    kmers = create_kmc_db['kmers']
+    kmer_len = create_kmc_db['kmer_len']
+    kmer = pka.KmerAPI(kmer_len)
+    counter = pka.Count()
+    kmc_file = _open_for_ra()
+    query = pka.KMCQuery(kmc_file)
+    filtered = pka.KMCQuery(kmc_file)
+    max_count = max(kmers.values())
+    assert filtered.SetMinCount(max_count)
+    assert filtered.GetMinCount() == max_count
+    for kmer_str, count in kmers.items():
+        kmer.from_string(kmer_str)
+        assert query.CheckKmer(kmer, counter)
+        assert counter.value == count
+        assert filtered.IsKmer(kmer) == (count == max_count)
+        res = pka.CountVec()
+        assert query.GetCountersForRead(kmer_str, res)
+        assert res.value == [count]
+    for kmer_str in create_kmc_db['absent_kmers']:
+        kmer.from_string(kmer_str)
+        assert not query.IsKmer(kmer)
+    assert kmc_file.Close()
+
+@pytest.mark.parametrize('db_params', [['--lut-ef'], ['--compress-suf'], ['--lut-ef', '--compress-suf']])
+def test_db_versions(create_kmc_db, db_params):
+    '''
+    Test case for databases with Elias-Fano encoded LUT (--lut-ef) and compressed suffixes (--compress-suf).
+
+    Listing, random access and parts of the database must give the same results as for the default format.
+    '''
+    kmers = create_kmc_db['kmers']
+    kmer_len = create_kmc_db['kmer_len']
+    _run_kmc(1, kmer_len, 2, create_kmc_db['sig_len'], 'input.fastq', 'kmc_db_ef', db_params)
+    try:
+        kmer = pka.KmerAPI(kmer_len)
+        counter = pka.Count()
+        kmc_file = pka.KMCFile()
+        assert kmc_file.OpenForListing('kmc_db_ef')
+        assert kmc_file.Info().total_kmers == len(kmers)
+        res = {}
+        while kmc_file.ReadNextKmer(kmer, counter):
+            res[str(kmer)] = counter.value
+        assert res == kmers
+        assert kmc_file.Close()
+
+        for n_parts in [2, 3]:
+            res = {}
+            for part_id in range(n_parts):
+                kmc_file = pka.KMCFile()
+                assert kmc_file.OpenForListing('kmc_db_ef', part_id, n_parts)
+                while kmc_file.ReadNextKmer(kmer, counter):
+                    res[str(kmer)] = counter.value
+            assert res == kmers
+
+        kmc_file = pka.KMCFile()
+        assert kmc_file.OpenForRA('kmc_db_ef')
+        for kmer_str, count in kmers.items():
+            kmer.from_string(kmer_str)
+            assert kmc_file.CheckKmer(kmer, counter)
+            assert counter.value == count
+        for kmer_str in create_kmc_db['absent_kmers']:
+            kmer.from_string(kmer_str)
+            assert not kmc_file.CheckKmer(kmer, counter)
+        assert kmc_file.SetMinCount(2)
+        assert kmc_file.KmerCount() == len([c for c in kmers.values() if c >= 2])
+        assert kmc_file.Close()
+    finally:
+        os.remove('kmc_db_ef.kmc_pre')
+        os.remove('kmc_db_ef.kmc_suf')
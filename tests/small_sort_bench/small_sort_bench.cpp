@@ -0,0 +1,37 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+  
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+  
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+// Micro-benchmark of sorting algorithms for tiny arrays of k-mers (insertion sorts, shell sorts, std::sort and
+// AVX2 bitonic networks if supported by the CPU)
+// Usage: small_sort_bench [max_size]
+// For each array size the average time (in ns) of sorting a single array is printed for each algorithm
+
+#include "../../kmc_core/small_sort.h"
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+	uint32 max_size = 64;
+	if (argc > 1)
+		max_size = atoi(argv[1]);
+	if (max_size < 1)
+	{
+		std::cerr << "Usage: small_sort_bench [max_size]\n";
+		return 1;
+	}
+
+	std::cout << "AVX2: " << (CCpuInfo::AVX2_Enabled() ? "yes" : "no") << "\n";
+	std::cout << "\nk <= 32 (CKmer<1>)\n";
+	CSmallSort<1>::Benchmark(max_size, std::cout);
+	std::cout << "\n32 < k <= 64 (CKmer<2>)\n";
+	CSmallSort<2>::Benchmark(max_size, std::cout);
+
+	return 0;
+}
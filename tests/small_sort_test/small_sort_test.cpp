@@ -0,0 +1,124 @@
+/*
+  This file is a part of KMC software distributed under GNU GPL 3 licence.
+  The homepage of the KMC project is http://sun.aei.polsl.pl/kmc
+
+  Authors: Sebastian Deorowicz, Agnieszka Debudaj-Grabysz, Marek Kokot
+
+  Version: 3.2.4
+  Date   : 2024-02-09
+*/
+
+// Correctness test of sorting of tiny arrays of k-mers: AVX2 bitonic networks (if supported by the CPU) and
+// the sorters selected by CSmallSort are compared with std::sort on random arrays of every supported size
+// Usage: small_sort_test [n_trials]
+// Returns 0 if all arrays were sorted correctly
+
+#include "../../kmc_core/small_sort.h"
+#include "../../kmc_core/bitonic_sort.h"
+#include <iostream>
+
+//----------------------------------------------------------------------------------
+// Random k-mers, values of the most significant word are drawn from a small range in some arrays to get duplicates
+template<unsigned SIZE>
+void RandomArray(std::vector<CKmer<SIZE>>& v, uint32 size, std::mt19937_64& mt, uint64 range)
+{
+	v.resize(size);
+	for (auto& x : v)
+	{
+		x.clear();
+		for (uint32 j = 0; j < SIZE; ++j)
+			x.random_init(j, j + 1 == SIZE ? mt() % range : mt());
+	}
+}
+
+//----------------------------------------------------------------------------------
+template<unsigned SIZE>
+bool Equal(std::vector<CKmer<SIZE>>& a, std::vector<CKmer<SIZE>>& b)
+{
+	for (uint32 i = 0; i < a.size(); ++i)
+		if (!(a[i] == b[i]))
+			return false;
+	return true;
+}
+
+//----------------------------------------------------------------------------------
+template<unsigned SIZE>
+bool TestBitonic(uint32 n_trials)
+{
+	std::mt19937_64 mt(SIZE);
+	std::vector<CKmer<SIZE>> v, expected;
+	const uint64 ranges[] = { 2, 16, ~0ull };
+
+	for (uint32 size = 0; size <= BITONIC_SORT_MAX_SIZE; ++size)
+		for (auto range : ranges)
+			for (uint32 trial = 0; trial < n_trials; ++trial)
+			{
+				RandomArray(v, size, mt, range);
+				expected = v;
+				std::sort(expected.begin(), expected.end());
+				if (!BitonicSortAVX2(v.data(), size))
+				{
+					std::cerr << "Error: bitonic sort (CKmer<" << SIZE << ">) refused array of size " << size << "\n";
+					return false;
+				}
+				if (!Equal(v, expected))
+				{
+					std::cerr << "Error: bitonic sort (CKmer<" << SIZE << ">) failed for array of size " << size << "\n";
+					return false;
+				}
+			}
+	return true;
+}
+
+//----------------------------------------------------------------------------------
+template<unsigned SIZE>
+bool TestSmallSort(uint32 n_trials, uint32 max_size)
+{
+	std::mt19937_64 mt(SIZE + 100);
+	std::vector<CKmer<SIZE>> v, expected;
+
+	CSmallSort<SIZE>::Adjust(max_size);
+	for (uint32 size = 1; size <= max_size; ++size)
+		for (uint32 trial = 0; trial < n_trials; ++trial)
+		{
+			RandomArray(v, size, mt, trial % 2 ? 16 : ~0ull);
+			expected = v;
+			std::sort(expected.begin(), expected.end());
+			CSmallSort<SIZE>::Sort(v.data(), size);
+			if (!Equal(v, expected))
+			{
+				std::cerr << "Error: small sort (CKmer<" << SIZE << ">) failed for array of size " << size << "\n";
+				return false;
+			}
+		}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	uint32 n_trials = 1000;
+	if (argc > 1)
+		n_trials = atoi(argv[1]);
+	if (n_trials < 1)
+	{
+		std::cerr << "Usage: small_sort_test [n_trials]\n";
+		return 1;
+	}
+
+	bool ok = true;
+#ifndef __aarch64__
+	if (CCpuInfo::AVX2_Enabled())
+	{
+		ok = ok && TestBitonic<1>(n_trials);
+		ok = ok && TestBitonic<2>(n_trials);
+	}
+	else
+		std::cout << "AVX2 not supported, bitonic sort not tested\n";
+#endif
+	ok = ok && TestSmallSort<1>(n_trials / 10 + 1, 256);
+	ok = ok && TestSmallSort<2>(n_trials / 10 + 1, 256);
+	ok = ok && TestSmallSort<3>(n_trials / 10 + 1, 256);
+
+	std::cout << (ok ? "OK\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}